@@ -8,6 +8,8 @@ PROGRAMMER              DATE		REASON
 T. Mittan		3-09-93		Initial Development
 S. Nelson		11-94		Added Clarke spheroid default to UTM
 S. Nelson		 1-98		Changed datum to spheroid
+			10-26		Count the initializations of each
+							projection in for_init_serial
 
 ALGORITHM REFERENCES
 
@@ -22,6 +24,12 @@ ALGORITHM REFERENCES
 #include <stdio.h>
 #include "cproj.h"
 
+/* number of times each forward projection has been initialized.  pre-
+   initialized transformations (gctp_xform) use this to tell if another
+   caller has since changed the projection's parameters.
+---------------------------------------------------------------------*/
+long for_init_serial[MAXPROJ + 1];
+
 void for_init
 (
     long outsys,	/* output system code				*/
@@ -100,6 +108,9 @@ long isinusfor();
 
 /* Initialize forward transformations
 -----------------------------------*/
+  if ((outsys >= 0) && (outsys <= MAXPROJ))
+     for_init_serial[outsys]++;
+
   /* find the correct major and minor axis
   --------------------------------------*/
   sphdz(outspheroid,outparm,&r_major,&r_minor,&radius);
@@ -32,6 +32,20 @@ c.1.5	S. Nelson	 1-98		Changed the name datum to spheroid.
 					projections for inverse transformations.
 					For forward transformations the
 					temporary array still exists.
+		10-26		Re-initialize a projection if it has
+					been initialized by another caller
+					since (inv_init_serial,
+					for_init_serial).  Added
+					gctp_xform_init and gctp_xform.
+		10-26		Sinusoidal and Integerized Sinusoidal
+					transformations set up by
+					gctp_xform_init keep their own
+					parameters, so they are not affected
+					by other callers.  Added
+					gctp_xform_free.
+		10-26		Added gctp_xform_reentrant.
+		10-26		Added gctp_xform_array, which converts
+					an array of points in one call.
   
 ALGORITHM REFERENCES
 
@@ -43,6 +57,8 @@ ALGORITHM REFERENCES
     U.S. Geological Survey Professional Paper 1453 , United State Government
     Printing Office, Washington D.C., 1989.
 *******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
 #include "cproj.h"
 #include "isin.h"
 
@@ -60,6 +76,8 @@ static long outzn[MAXPROJ + 1];		/* output zone array		*/
 static double pdout[MAXPROJ+1][COEFCT];	/* output projection parm array	*/
 static long (*for_trans[MAXPROJ + 1])();/* forward function pointer array*/
 static long (*inv_trans[MAXPROJ + 1])();/* inverse function pointer array*/
+static long inser[MAXPROJ + 1];		/* inv_init_serial at input init  */
+static long outser[MAXPROJ + 1];	/* for_init_serial at output init */
 
 			/* Table of unit codes as specified by state
 			   laws as of 2/1/92 for NAD 1983 State Plane
@@ -131,6 +149,8 @@ if (iter == 0)
       outpj[i] = 0;
       outdat[i] = 0;
       outzn[i] = 0;
+      inser[i] = 0;
+      outser[i] = 0;
       for (j = 0; j < COEFCT; j++)
          {
          pdin[i][j] = 0.0;
@@ -146,7 +166,8 @@ else
    if (*insys != GEO)
      {
      if ((inzn[*insys] != *inzone) || (indat[*insys] != *inspheroid) || 
-         (inpj[*insys] != *insys))
+         (inpj[*insys] != *insys) || 
+         (inser[*insys] != inv_init_serial[*insys]))
         {
         ininit_flag = TRUE;
         }
@@ -161,7 +182,8 @@ else
    if (*outsys != GEO)
      {
      if ((outzn[*outsys] != *outzone) || (outdat[*outsys] != *outspheroid) || 
-         (outpj[*outsys] != *outsys))
+         (outpj[*outsys] != *outsys) || 
+         (outser[*outsys] != for_init_serial[*outsys]))
         {
         outinit_flag = TRUE;
         }
@@ -231,6 +253,7 @@ if (ininit_flag)
    /* Call the initialization function
    ----------------------------------*/
    inv_init(*insys,*inzone,inparm,*inspheroid,fn27,fn83,iflg,inv_trans);
+   inser[*insys] = inv_init_serial[*insys];
    if (*iflg != 0)
       {
       return;
@@ -297,6 +320,7 @@ if (outinit_flag)
       }
    else
       for_init(*outsys,*outzone,outparm,*outspheroid,fn27,fn83,iflg,for_trans);
+   outser[*outsys] = for_init_serial[*outsys];
    if (*iflg != 0)
       {
       return;
@@ -340,3 +364,515 @@ outcoor[1] *= factor;
 
 return;
 }
+
+/*******************************************************************************
+NAME                      GCTP_XFORM_INIT, GCTP_XFORM, GCTP_XFORM_ARRAY
+
+PURPOSE:	gctp_xform_init sets up a transformation between two projections
+		once: the projection numbers are checked, the unit conversion
+		factors are found and the inverse and forward transformations
+		are initialized.  gctp_xform then converts a single point
+		without repeating any of that work.  gctp_xform_array converts
+		an array of points, returning the status of each point.
+
+PROGRAMMER              DATE		REASON
+----------              ----		------
+			10-26		Initial Development
+			10-26		Added gctp_xform_array
+
+NOTES:
+  1. Sinusoidal and Integerized Sinusoidal are set up with their own copy of
+     the projection parameters (inv_ctx, for_ctx), so any number of these
+     transformations may be in use at once, from any number of threads.
+     gctp_xform_free releases that memory.
+  2. The other projection modules keep their parameters in static variables,
+     so each call to gctp_xform checks inv_init_serial/for_init_serial and
+     re-initializes the inverse or forward projection if something else has
+     initialized it since.  These transformations must not be used from more
+     than one thread at a time.
+  3. As in gctp, a UTM output with no zone and no lat/long in the first two
+     parameters is initialized from the first point converted.
+  4. gctp_xform_array uses the array versions of the Sinusoidal inverse and
+     forward and the Integerized Sinusoidal inverse (inv_arr_func,
+     for_arr_func), which do the arithmetic common to every point in loops
+     the compiler can vectorize.  Geographic input and output are plain
+     loops as well.  Other projections are converted one point at a time.
+     The results are the same as calling gctp_xform for each point.
+*******************************************************************************/
+
+/* set up a copy of the projection parameters for the projections which
+   support it, the same way inv_init/for_init set up the static copy.  ctx_func
+   is left NULL for the other projections.  arr_func is the array version of
+   ctx_func, or NULL if there isn't one.
+--------------------------------------------------------------------------*/
+static long xform_ctx_init
+(
+    long sys,		/* projection code				*/
+    double *parm,	/* projection parameter array			*/
+    long spheroid,	/* spheroid code				*/
+    long inverse,	/* TRUE for the inverse, FALSE for the forward	*/
+    long (**ctx_func)(),/* function taking the context			*/
+    long (**arr_func)(),/* array function taking the context		*/
+    void **ctx		/* projection context				*/
+)
+{
+long iflg = 0;		/* error flag					*/
+double r_major;		/* major axis in meters				*/
+double r_minor;		/* minor axis in meters				*/
+double radius;		/* radius of sphere				*/
+double center_long;	/* center longitude				*/
+SinCtx *sin_ctx;	/* Sinusoidal context				*/
+Isin_t *isin_ctx;	/* Integerized Sinusoidal handle		*/
+
+*ctx_func = NULL;
+*arr_func = NULL;
+*ctx = NULL;
+if ((sys != SNSOID) && (sys != ISIN))
+   return(0);
+
+sphdz(spheroid,parm,&r_major,&r_minor,&radius);
+center_long = paksz(parm[4],&iflg) * 3600 * S2R;
+if (iflg != 0)
+   return(iflg);
+
+if (sys == SNSOID)
+   {
+   sin_ctx = (SinCtx *)malloc(sizeof(SinCtx));
+   if (sin_ctx == NULL)
+      {
+      p_error("Error allocating the projection context","gctp-xform");
+      return(ISIN_ERROR);
+      }
+   if (inverse)
+      {
+      sininvctxint(sin_ctx,radius,center_long,parm[6],parm[7]);
+      *ctx_func = sininvctx;
+      *arr_func = sininvctxarr;
+      }
+   else
+      {
+      sinforctxint(sin_ctx,radius,center_long,parm[6],parm[7]);
+      *ctx_func = sinforctx;
+      *arr_func = sinforctxarr;
+      }
+   *ctx = sin_ctx;
+   }
+else
+   {
+   isin_ctx = NULL;
+   if (inverse)
+      {
+      iflg = isinusinvctxint(&isin_ctx,radius,center_long,parm[6],parm[7],
+                             parm[8],parm[10]);
+      *ctx_func = isinusinvctx;
+      *arr_func = isinusinvctxarr;
+      }
+   else
+      {
+      iflg = isinusforctxint(&isin_ctx,radius,center_long,parm[6],parm[7],
+                             parm[8],parm[10]);
+      *ctx_func = isinusforctx;
+      }
+   if (iflg != 0)
+      {
+      *ctx_func = NULL;
+      *arr_func = NULL;
+      return(iflg);
+      }
+   *ctx = isin_ctx;
+   }
+return(0);
+}
+
+/* initialize the inverse transformation of a pre-initialized transformation
+--------------------------------------------------------------------------*/
+static long xform_inv_init
+(
+    GctpXform *xf	/* transformation				*/
+)
+{
+long iflg = 0;		/* error flag					*/
+long (*trans[MAXPROJ + 1])();	/* inverse function pointer array	*/
+
+inv_init(xf->insys,xf->inzone,xf->inparm,xf->inspheroid,xf->fn27,xf->fn83,
+         &iflg,trans);
+xf->inv_serial = inv_init_serial[xf->insys];
+if (iflg != 0)
+   return(iflg);
+xf->inv_func = trans[xf->insys];
+return(0);
+}
+
+/* initialize the forward transformation of a pre-initialized transformation
+--------------------------------------------------------------------------*/
+static long xform_for_init
+(
+    GctpXform *xf,	/* transformation				*/
+    double lon,		/* longitude of the point being converted	*/
+    double lat		/* latitude of the point being converted	*/
+)
+{
+long i;			/* loop counter					*/
+long iflg = 0;		/* error flag					*/
+double temparr[COEFCT];	/* temporary projection array 			*/
+long (*trans[MAXPROJ + 1])();	/* forward function pointer array	*/
+
+if (xf->outsys == UTM)
+   {
+   for (i = 2; i < COEFCT; i++)
+       temparr[i] = xf->outparm[i];
+   if (xf->outparm[0] == 0.0)
+      {
+      temparr[0] = pakr2dm(lon);
+      temparr[1] = pakr2dm(lat);
+      }
+   else
+      {
+      temparr[0] = xf->outparm[0];
+      temparr[1] = xf->outparm[1];
+      }
+   for_init(xf->outsys,xf->outzone,temparr,xf->outspheroid,xf->fn27,
+            xf->fn83,&iflg,trans);
+   }
+else
+   for_init(xf->outsys,xf->outzone,xf->outparm,xf->outspheroid,xf->fn27,
+            xf->fn83,&iflg,trans);
+xf->for_serial = for_init_serial[xf->outsys];
+if (iflg != 0)
+   return(iflg);
+xf->for_func = trans[xf->outsys];
+return(0);
+}
+
+long gctp_xform_init
+(
+    GctpXform *xf,	/* transformation to initialize			*/
+    long insys,		/* input projection code			*/
+    long inzone,	/* input zone number				*/
+    double *inparm,	/* input projection parameter array		*/
+    long inunit,	/* input units					*/
+    long inspheroid,	/* input spheroid 				*/
+    long outsys,	/* output projection code			*/
+    long outzone,	/* output zone					*/
+    double *outparm,	/* output projection array			*/
+    long outunit,	/* output units					*/
+    long outspheroid,	/* output spheroid				*/
+    char fn27[],	/* file name of NAD 1927 parameter file		*/
+    char fn83[] 	/* file name of NAD 1983 parameter file		*/
+)
+{
+long i;			/* loop counter					*/
+long iflg;		/* error flag					*/
+long unit;		/* temporary unit variable			*/
+
+/* nothing to free yet
+--------------------*/
+xf->inv_ctx_func = NULL;
+xf->for_ctx_func = NULL;
+xf->inv_arr_func = NULL;
+xf->for_arr_func = NULL;
+xf->inv_ctx = NULL;
+xf->for_ctx = NULL;
+
+/* Check input and output projection numbers
+------------------------------------------*/
+if ((insys < GEO) || (insys > MAXPROJ))
+   {
+   p_error("Insys is illegal","GCTP-INPUT");
+   return(1);
+   }
+if ((outsys < GEO) || (outsys > MAXPROJ))
+   {
+   p_error("Outsys is illegal","GCTP-OUTPUT");
+   return(2);
+   }
+
+xf->insys = insys;
+xf->inzone = inzone;
+xf->inspheroid = inspheroid;
+xf->outsys = outsys;
+xf->outzone = outzone;
+xf->outspheroid = outspheroid;
+for (i = 0; i < COEFCT; i++)
+   {
+   xf->inparm[i] = inparm[i];
+   xf->outparm[i] = outparm[i];
+   }
+strncpy(xf->fn27,fn27,sizeof(xf->fn27) - 1);
+xf->fn27[sizeof(xf->fn27) - 1] = '\0';
+strncpy(xf->fn83,fn83,sizeof(xf->fn83) - 1);
+xf->fn83[sizeof(xf->fn83) - 1] = '\0';
+xf->inv_func = NULL;
+xf->for_func = NULL;
+xf->inv_serial = -1;
+xf->for_serial = -1;
+
+/* find the input unit conversion factor, using the legislated unit table
+   for State Plane
+-----------------------------------------------------------------------*/
+unit = inunit;
+if ((inspheroid == 0) && (insys == SPCS) && (inunit == STPLN_TABLE)) 
+		unit = FEET;
+if ((inspheroid == 8) && (insys == SPCS) && (inunit == STPLN_TABLE))
+		unit = NADUT[inzone/100];
+if (insys == GEO)
+   iflg = untfz(unit,RADIAN,&xf->in_factor); 
+else
+   iflg = untfz(unit,METER,&xf->in_factor); 
+if (iflg != 0)
+   return(iflg);
+
+/* find the output unit conversion factor
+---------------------------------------*/
+unit = outunit;
+if ((outspheroid == 0) && (outsys == SPCS) && (outunit == STPLN_TABLE)) 
+		unit = 1;
+if ((outspheroid == 8) && (outsys == SPCS) && (outunit == STPLN_TABLE))
+		unit = NADUT[outzone/100];
+if (outsys == GEO)
+   iflg = untfz(RADIAN,unit,&xf->out_factor); 
+else
+   iflg = untfz(METER,unit,&xf->out_factor); 
+if (iflg != 0)
+   return(iflg);
+
+/* Initialize inverse transformation
+----------------------------------*/
+if (insys != GEO)
+   {
+   iflg = xform_ctx_init(insys,inparm,inspheroid,TRUE,&xf->inv_ctx_func,
+                         &xf->inv_arr_func,&xf->inv_ctx);
+   if ((iflg == 0) && (xf->inv_ctx_func == NULL))
+      iflg = xform_inv_init(xf);
+   if (iflg != 0)
+      return(iflg);
+   }
+
+/* Initialize forward transformation, unless a UTM zone has to be found
+   from the first point
+---------------------------------------------------------------------*/
+if (outsys != GEO)
+   {
+   iflg = xform_ctx_init(outsys,outparm,outspheroid,FALSE,&xf->for_ctx_func,
+                         &xf->for_arr_func,&xf->for_ctx);
+   if ((iflg == 0) && (xf->for_ctx_func == NULL) &&
+       !((outsys == UTM) && (outzone == 0) && (outparm[0] == 0.0)))
+      iflg = xform_for_init(xf,0.0,0.0);
+   if (iflg != 0)
+      return(iflg);
+   }
+
+return(0);
+}
+
+long gctp_xform
+(
+    GctpXform *xf,	/* initialized transformation			*/
+    double *incoor,	/* input coordinates				*/
+    double *outcoor	/* output coordinates				*/
+)
+{
+double lon;		/* longitude					*/
+double lat;		/* latitude					*/
+long iflg;		/* error flag					*/
+
+/* Inverse transformations
+------------------------*/
+if (xf->insys == GEO)
+   {
+   lon = incoor[0] * xf->in_factor;
+   lat = incoor[1] * xf->in_factor;
+   }
+else if (xf->inv_ctx_func != NULL)
+   {
+   iflg = xf->inv_ctx_func(xf->inv_ctx, incoor[0] * xf->in_factor,
+                           incoor[1] * xf->in_factor, &lon, &lat);
+   if (iflg != 0)
+      return(iflg);
+   }
+else
+   {
+   if (xf->inv_serial != inv_init_serial[xf->insys])
+      {
+      iflg = xform_inv_init(xf);
+      if (iflg != 0)
+         return(iflg);
+      }
+   iflg = xf->inv_func(incoor[0] * xf->in_factor, incoor[1] * xf->in_factor,
+                       &lon, &lat);
+   if (iflg != 0)
+      return(iflg);
+   }
+
+/* Forward transformations
+------------------------*/
+if (xf->outsys == GEO)
+   {
+   outcoor[0] = lon;
+   outcoor[1] = lat;
+   }
+else if (xf->for_ctx_func != NULL)
+   {
+   iflg = xf->for_ctx_func(xf->for_ctx, lon, lat, &outcoor[0], &outcoor[1]);
+   if (iflg != 0)
+      return(iflg);
+   }
+else
+   {
+   if (xf->for_serial != for_init_serial[xf->outsys])
+      {
+      iflg = xform_for_init(xf,lon,lat);
+      if (iflg != 0)
+         return(iflg);
+      }
+   iflg = xf->for_func(lon, lat, &outcoor[0], &outcoor[1]);
+   if (iflg != 0)
+      return(iflg);
+   }
+
+outcoor[0] *= xf->out_factor;
+outcoor[1] *= xf->out_factor;
+
+return(0);
+}
+
+long gctp_xform_array
+(
+    GctpXform *xf,	/* initialized transformation			*/
+    long n,		/* number of points				*/
+    double *inx,	/* input x coordinates				*/
+    double *iny,	/* input y coordinates				*/
+    double *outx,	/* output x coordinates (may be inx)		*/
+    double *outy,	/* output y coordinates (may be iny)		*/
+    long *status	/* status of each point (0, GCTP_ERANGE,	*/
+			/* IN_BREAK or another GCTP error)		*/
+)
+{
+long i;			/* point index					*/
+long iflg;		/* error flag					*/
+
+/* Input units.  The longitudes/latitudes are kept in outx/outy between the
+   inverse and forward transformations.
+-------------------------------------------------------------------------*/
+for (i = 0; i < n; i++)
+   {
+   outx[i] = inx[i] * xf->in_factor;
+   outy[i] = iny[i] * xf->in_factor;
+   status[i] = 0;
+   }
+
+/* Inverse transformations
+------------------------*/
+if (xf->insys == GEO)
+   ;
+else if (xf->inv_arr_func != NULL)
+   {
+   iflg = xf->inv_arr_func(xf->inv_ctx, n, outx, outy, outx, outy, status);
+   if (iflg != 0)
+      return(iflg);
+   }
+else
+   {
+   for (i = 0; i < n; i++)
+      {
+      if (xf->inv_ctx_func != NULL)
+         status[i] = xf->inv_ctx_func(xf->inv_ctx, outx[i], outy[i],
+                                      &outx[i], &outy[i]);
+      else
+         {
+         if (xf->inv_serial != inv_init_serial[xf->insys])
+            {
+            iflg = xform_inv_init(xf);
+            if (iflg != 0)
+               return(iflg);
+            }
+         status[i] = xf->inv_func(outx[i], outy[i], &outx[i], &outy[i]);
+         }
+      }
+   }
+
+/* Forward transformations
+------------------------*/
+if (xf->outsys == GEO)
+   ;
+else if (xf->for_arr_func != NULL)
+   {
+   iflg = xf->for_arr_func(xf->for_ctx, n, outx, outy, outx, outy, status);
+   if (iflg != 0)
+      return(iflg);
+   }
+else
+   {
+   for (i = 0; i < n; i++)
+      {
+      if (status[i] != 0)
+         continue;
+      if (xf->for_ctx_func != NULL)
+         status[i] = xf->for_ctx_func(xf->for_ctx, outx[i], outy[i],
+                                      &outx[i], &outy[i]);
+      else
+         {
+         if (xf->for_serial != for_init_serial[xf->outsys])
+            {
+            iflg = xform_for_init(xf,outx[i],outy[i]);
+            if (iflg != 0)
+               return(iflg);
+            }
+         status[i] = xf->for_func(outx[i], outy[i], &outx[i], &outy[i]);
+         }
+      }
+   }
+
+/* Output units
+-------------*/
+for (i = 0; i < n; i++)
+   {
+   outx[i] *= xf->out_factor;
+   outy[i] *= xf->out_factor;
+   }
+
+return(0);
+}
+
+void gctp_xform_free
+(
+    GctpXform *xf	/* transformation to free			*/
+)
+{
+if (xf->inv_ctx != NULL)
+   {
+   if (xf->insys == ISIN)
+      Isin_inv_free((Isin_t *)xf->inv_ctx);
+   else
+      free(xf->inv_ctx);
+   xf->inv_ctx = NULL;
+   }
+if (xf->for_ctx != NULL)
+   {
+   if (xf->outsys == ISIN)
+      Isin_for_free((Isin_t *)xf->for_ctx);
+   else
+      free(xf->for_ctx);
+   xf->for_ctx = NULL;
+   }
+xf->inv_ctx_func = NULL;
+xf->for_ctx_func = NULL;
+xf->inv_arr_func = NULL;
+xf->for_arr_func = NULL;
+}
+
+/* TRUE if the transformation only uses its own projection parameters, so it
+   may be used at the same time as other transformations (i.e. from other
+   threads)
+--------------------------------------------------------------------------*/
+long gctp_xform_reentrant
+(
+    GctpXform *xf	/* initialized transformation			*/
+)
+{
+if ((xf->insys != GEO) && (xf->inv_ctx_func == NULL))
+   return(FALSE);
+if ((xf->outsys != GEO) && (xf->for_ctx_func == NULL))
+   return(FALSE);
+return(TRUE);
+}
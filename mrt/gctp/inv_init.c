@@ -8,6 +8,8 @@ PROGRAMMER              DATE		REASON
 T. Mittan		3-09-93		Initial Development
 S. Nelson		11-94		Added Clarke spheroid default to UTM
 S. Nelson		 1-98		Changed datum to spheroid.
+			10-26		Count the initializations of each
+							projection in inv_init_serial
 
 ALGORITHM REFERENCES
 
@@ -22,6 +24,12 @@ ALGORITHM REFERENCES
 #include <stdio.h>
 #include "cproj.h"
 
+/* number of times each inverse projection has been initialized.  pre-
+   initialized transformations (gctp_xform) use this to tell if another
+   caller has since changed the projection's parameters.
+---------------------------------------------------------------------*/
+long inv_init_serial[MAXPROJ + 1];
+
 void inv_init
 (
     long insys,		/* input system code				*/
@@ -101,6 +109,9 @@ long isinusinv();
 
 /* Initialize inverse transformations
 -----------------------------------*/
+  if ((insys >= 0) && (insys <= MAXPROJ))
+     inv_init_serial[insys]++;
+
   /* find the correct major and minor axis
   --------------------------------------*/
   sphdz(inspheroid,inparm,&r_major,&r_minor,&radius);
@@ -13,6 +13,9 @@ PROGRAMMER                DATE          REASON
 Robert Wolfe (STX)        1-2-97        Initial version.
 Raj Gejjagaraguppe (ARC)  1-15-97       Modified the code to work with
                                         GCTP software.
+                          10-26         Added the caller supplied handle
+                                        (ctx) versions of the GCTP interface.
+                          10-26         Added isinusinvctxarr.
  
 D*****************************************************************************/
 
@@ -83,6 +86,17 @@ long isinusforinit
     double djustify 
 );
 
+long isinusforctxint
+( 
+    Isin_t **handle,
+    double sphere, 
+    double lon_cen_mer, 
+    double false_east,
+    double false_north, 
+    double dzone, 
+    double djustify 
+);
+
 Isin_t *Isin_for_init
 (
     double sphere,
@@ -104,6 +118,17 @@ long isinusinvinit
     double djustify 
 );
 
+long isinusinvctxint
+( 
+    Isin_t **handle,
+    double sphere, 
+    double lon_cen_mer, 
+    double false_east,
+    double false_north, 
+    double dzone, 
+    double djustify 
+);
+
 Isin_t *Isin_inv_init
 ( 
     double sphere,
@@ -133,10 +158,22 @@ int Isin_fwd
     double *y 
 );
 
+long isinusforctx
+(
+    void *ctx,
+    double lon, 
+    double lat, 
+    double *x, 
+    double *y 
+);
+
 /* Inverse mapping; converts map projection coordinates ('x', 'y') to
  * geographic coordinates ('lon', 'lat') */
 long isinusinv( double, double, double *, double * );
 int Isin_inv( const Isin_t *, double, double, double *, double * );
+long isinusinvctx( void *, double, double, double *, double * );
+long isinusinvctxarr( void *, long, double *, double *, double *, double *,
+                      long * );
 
 /* Deallocate the 'isin' data structure and array memory */
 int Isin_for_free
@@ -12,6 +12,8 @@ Robert Wolfe (STX)        1-2-97        Initial version.
 Raj Gejjagaraguppe (ARC)  1-21-97       Modified and added code to make
                                         this work with GCTP software.
 Gail Schmidt (SAIC)       11-02         Changed ISIN_ERANGE to GCTP_ERANGE.
+                          10-26         Added isinusforctxint and isinusforctx,
+                                        which use a caller supplied handle.
  
 
    Usage Notes:
@@ -21,6 +23,9 @@ Gail Schmidt (SAIC)       11-02         Changed ISIN_ERANGE to GCTP_ERANGE.
         isinusfor     - Forward mapping; converts geographic coordinates 
                         (longitude/latitude) to map projection 
                         coordinates (x/y)
+        isinusforctxint,
+        isinusforctx  - Same as above, but for a caller supplied handle
+                        so several projections can be used at once
 
    2. Since there are discontinuities at the top and bottom of each zone 
       within the integerized sinusoidal grid care should be taken when 
@@ -90,10 +95,11 @@ static Isin_t *isin = NULL;
 
 /*
 !C******************************************************************************
-!Description: isinusforinit (initialize mapping) initializes the integerized 
- sinusoidal transformations.
+!Description: isinusforctxint (initialize mapping) initializes the integerized 
+ sinusoidal transformations for a caller supplied handle.
 
 !Input Parameters:
+                   address of the handle; a previous handle is freed
                    sphere radius (meters)
                    longitude of central meridian (radians)
                    easting at projection origin (meters)
@@ -122,8 +128,9 @@ static Isin_t *isin = NULL;
 
 !END****************************************************************************
 */
-long isinusforinit
+long isinusforctxint
 ( 
+    Isin_t **handle,
     double sphere, 
     double lon_cen_mer, 
     double false_east,
@@ -138,67 +145,69 @@ long isinusforinit
 
     /* Check to see if this data set was already initialized; if it was, 
      * free the data structure so it can be re-used */
-    if ( isin != NULL )
+    if ( *handle != NULL )
     {
-        istat = Isin_for_free( isin );
+        istat = Isin_for_free( *handle );
         if ( istat != ISIN_SUCCESS )
         {
-            error( "isinusforinit", "bad return from Isin_for_free" );
+            error( "isinusforctxint", "bad return from Isin_for_free" );
             return ISIN_ERROR;
         }
+        *handle = NULL;
     }
 
     /* Check the input parameters */
     if ( sphere <= 0.0 )
     {
-        error( "isinusforinit", "bad parameter; sphere radius invalid" );
+        error( "isinusforctxint", "bad parameter; sphere radius invalid" );
         return ISIN_ERROR;
     }
 
     if ( lon_cen_mer < -TWO_PI || lon_cen_mer > TWO_PI )
     {
-        error( "isinusforinit",
+        error( "isinusforctxint",
                "bad parameter; longitude of central meridian invalid" );
         return ISIN_ERROR;
     }
 
     if (dzone < (2.0 - EPS_CNVT) || dzone > ((double)NZONE_MAX + EPS_CNVT))
     {
-        error( "isinusforinit", "bad parameter; nzone out of range" );
+        error( "isinusforctxint", "bad parameter; nzone out of range" );
         return ISIN_ERROR;
     }
 
     nzone = (long)(dzone + EPS_CNVT);
     if ( fabs( dzone - nzone ) > EPS_CNVT )
     {
-        error("isinusforinit","bad parameter; nzone not near an integer value");
+        error( "isinusforctxint",
+               "bad parameter; nzone not near an integer value" );
         return ISIN_ERROR;
     }
 
     if ( ( nzone % 2 ) != 0 )
     {
-        error( "isinusforinit", "bad parameter; nzone not multiple of two" );
+        error( "isinusforctxint", "bad parameter; nzone not multiple of two" );
         return ISIN_ERROR;
     }
 
     if ( djustify < -EPS_CNVT || djustify > ( 2.0 + EPS_CNVT ) )
     {
-        error( "isinusforinit", "bad parameter; ijustify out of range" );
+        error( "isinusforctxint", "bad parameter; ijustify out of range" );
         return ISIN_ERROR;
     }
 
     ijustify = (int)(djustify + EPS_CNVT);
     if ( fabs( djustify - ijustify ) > EPS_CNVT )
     {
-        error( "isinusforinit",
+        error( "isinusforctxint",
                "bad parameter; ijustify not near an integer value" );
         return ISIN_ERROR;
     }
 
     /* Initialize the projection */
-    isin = Isin_for_init( sphere, lon_cen_mer, false_east, false_north,
-                          nzone, ijustify );
-    if ( isin == NULL )
+    *handle = Isin_for_init( sphere, lon_cen_mer, false_east,
+                             false_north, nzone, ijustify );
+    if ( *handle == NULL )
     {
         error( "Isin_for_init", "bad return from Isin_for_init" );
         return ISIN_ERROR;
@@ -207,6 +216,38 @@ long isinusforinit
     return ISIN_SUCCESS;
 }
 
+/*
+!C******************************************************************************
+!Description: isinusforinit (initialize mapping) initializes the integerized 
+ sinusoidal transformations used by isinusfor.
+
+!Input Parameters:
+                   same as isinusforctxint, without the handle
+
+!Output Parameters:
+ (none)
+
+!Team Unique Header:
+
+ ! Usage Notes:
+   1. See isinusforctxint.
+
+!END****************************************************************************
+*/
+long isinusforinit
+( 
+    double sphere, 
+    double lon_cen_mer, 
+    double false_east,
+    double false_north, 
+    double dzone, 
+    double djustify 
+)
+{
+    return isinusforctxint( &isin, sphere, lon_cen_mer, false_east,
+                            false_north, dzone, djustify );
+}
+
 /*
 !C******************************************************************************
 !Description: Isin_for_init (initialize mapping) initializes the integerized 
@@ -457,10 +498,11 @@ Isin_t *Isin_for_init
 
 /*
 !C******************************************************************************
-!Description: isinusfor (forward mapping) converts geographic
+!Description: isinusforctx (forward mapping) converts geographic
  coordinates ('lon', 'lat') to map projection coordinates ('x', 'y').
  
 !Input Parameters:
+ ctx            handle from isinusforctxint
  lon            longitude (radians)
  lat            latitude (radians)
  
@@ -471,14 +513,15 @@ Isin_t *Isin_for_init
 !Team Unique Header:
  
  ! Usage Notes:
-   1. 'isinusforinit' must have been previously called.
+   1. 'isinusforctxint' must have been previously called for the handle.
    2. The longitude must be in the range [-'TWO_PI' to 'TWO_PI'].
    3. The latitude must be in the range [-'HALF_PI' to 'HALF_PI'].
  
 !END****************************************************************************
 */
-long isinusfor
+long isinusforctx
 (
+    void *ctx,
     double lon, 
     double lat, 
     double *x, 
@@ -487,16 +530,49 @@ long isinusfor
 {
     int istat;                  /* Status returned from 'Isin_fwd' function */
 
-    istat = Isin_fwd( isin, lon, lat, x, y );
+    istat = Isin_fwd( (const Isin_t *)ctx, lon, lat, x, y );
     if ( istat != ISIN_SUCCESS )
     {
-        error( "isinusfor", "bad return from Isin_fwd" );
+        error( "isinusforctx", "bad return from Isin_fwd" );
         return ISIN_ERROR;
     }
 
     return ISIN_SUCCESS;
 }
 
+/*
+!C******************************************************************************
+!Description: isinusfor (forward mapping) converts geographic
+ coordinates ('lon', 'lat') to map projection coordinates ('x', 'y').
+ 
+!Input Parameters:
+ lon            longitude (radians)
+ lat            latitude (radians)
+ 
+!Output Parameters:
+ x              easting in map projection (same units as 'sphere')
+ y              northing in map projection (same units as 'sphere')
+ 
+!Team Unique Header:
+ 
+ ! Usage Notes:
+   1. 'isinusforinit' must have been previously called.
+   2. The longitude must be in the range [-'TWO_PI' to 'TWO_PI'].
+   3. The latitude must be in the range [-'HALF_PI' to 'HALF_PI'].
+ 
+!END****************************************************************************
+*/
+long isinusfor
+(
+    double lon, 
+    double lat, 
+    double *x, 
+    double *y 
+)
+{
+    return isinusforctx( isin, lon, lat, x, y );
+}
+
 /*
 !C******************************************************************************
 !Description: Isin_fwd (forward mapping) converts geographic
@@ -15,6 +15,9 @@ Gail Schmidt (ITSS)       11-2-01       In the inverse mapping, if the
                                         lat/long are out of range, return
                                         ISIN_ERANGE.
 Gail Schmidt (SAIC)       11-02         Changed ISIN_ERANGE to GCTP_ERANGE.
+                          10-26         Added isinusinvctxint and isinusinvctx,
+                                        which use a caller supplied handle.
+                          10-26         Added isinusinvctxarr.
  
  ! Usage Notes:
    1. The following functions are available:  
@@ -23,6 +26,10 @@ Gail Schmidt (SAIC)       11-02         Changed ISIN_ERANGE to GCTP_ERANGE.
         isinusinv     - Inverse mapping; converts map projection 
                         coordinates (x/y) to geographic coordinates 
                         (longitude/latitude)
+        isinusinvctxint,
+        isinusinvctx  - Same as above, but for a caller supplied handle
+                        so several projections can be used at once
+        isinusinvctxarr - Same as isinusinvctx, but for an array of points
 
    2. Since there are discontinuities at the top and bottom of each zone 
       within the integerized sinusoidal grid care should be taken when 
@@ -99,10 +106,11 @@ static Isin_t *isin = NULL;
 
 /*
 !C******************************************************************************
-!Description: isinusinvinit (initialize mapping) initializes the integerized 
- sinusoidal transformations.
+!Description: isinusinvctxint (initialize mapping) initializes the integerized 
+ sinusoidal transformations for a caller supplied handle.
 
 !Input Parameters:
+                   address of the handle; a previous handle is freed
                    sphere radius (meters)
                    longitude of central meridian (radians)
                    easting at projection origin (meters)
@@ -131,8 +139,9 @@ static Isin_t *isin = NULL;
 
 !END****************************************************************************
 */
-long isinusinvinit
+long isinusinvctxint
 ( 
+    Isin_t **handle,
     double sphere, 
     double lon_cen_mer, 
     double false_east,
@@ -147,75 +156,109 @@ long isinusinvinit
 
     /* Check to see if this data set was already initialized; if it was, 
      * free the data structure so it can be re-used */
-    if ( isin != NULL )
+    if ( *handle != NULL )
     {
-        istat = Isin_inv_free( isin );
+        istat = Isin_inv_free( *handle );
         if ( istat != ISIN_SUCCESS )
         {
-            error( "isinusinvinit", "bad return from Isin_inv_free" );
+            error( "isinusinvctxint", "bad return from Isin_inv_free" );
             return ISIN_ERROR;
         }
+        *handle = NULL;
     }
 
     /* Check the input parameters */
     if ( sphere <= 0.0 )
     {
-        error( "isinusinvinit", "bad parameter; sphere radius invalid" );
+        error( "isinusinvctxint", "bad parameter; sphere radius invalid" );
         return ISIN_ERROR;
     }
 
     if ( lon_cen_mer < -TWO_PI || lon_cen_mer > TWO_PI )
     {
-        error( "isinusinvinit",
+        error( "isinusinvctxint",
                "bad parameter; longitude of central meridian invalid" );
         return ISIN_ERROR;
     }
 
     if (dzone < (2.0 - EPS_CNVT) || dzone > ((double)NZONE_MAX + EPS_CNVT))
     {
-        error( "isinusinvinit", "bad parameter; nzone out of range" );
+        error( "isinusinvctxint", "bad parameter; nzone out of range" );
         return ISIN_ERROR;
     }
 
     nzone = (long)(dzone + EPS_CNVT);
     if ( fabs( dzone - nzone ) > EPS_CNVT )
     {
-        error("isinusinvinit","bad parameter; nzone not near an integer value");
+        error( "isinusinvctxint",
+               "bad parameter; nzone not near an integer value" );
         return ISIN_ERROR;
     }
 
     if ( ( nzone % 2 ) != 0 )
     {
-        error( "isinusinvinit", "bad parameter; nzone not multiple of two" );
+        error( "isinusinvctxint", "bad parameter; nzone not multiple of two" );
         return ISIN_ERROR;
     }
 
     if ( djustify < -EPS_CNVT || djustify > ( 2.0 + EPS_CNVT ) )
     {
-        error( "isinusinvinit", "bad parameter; ijustify out of range" );
+        error( "isinusinvctxint", "bad parameter; ijustify out of range" );
         return ISIN_ERROR;
     }
 
     ijustify = (int)(djustify + EPS_CNVT);
     if ( fabs( djustify - ijustify ) > EPS_CNVT )
     {
-        error( "isinusinvinit",
+        error( "isinusinvctxint",
                "bad parameter; ijustify not near an integer value" );
         return ISIN_ERROR;
     }
 
     /* Initialize the projection */
-    isin = Isin_inv_init( sphere, lon_cen_mer, false_east, false_north,
-                          nzone, ijustify );
-    if ( isin == NULL )
+    *handle = Isin_inv_init( sphere, lon_cen_mer, false_east,
+                             false_north, nzone, ijustify );
+    if ( *handle == NULL )
     {
-        error( "isinusinvinit", "bad return from Isin_inv_init" );
+        error( "isinusinvctxint", "bad return from Isin_inv_init" );
         return ISIN_ERROR;
     }
 
     return ISIN_SUCCESS;
 }
 
+/*
+!C******************************************************************************
+!Description: isinusinvinit (initialize mapping) initializes the integerized 
+ sinusoidal transformations used by isinusinv.
+
+!Input Parameters:
+                   same as isinusinvctxint, without the handle
+
+!Output Parameters:
+ (none)
+
+!Team Unique Header:
+
+ ! Usage Notes:
+   1. See isinusinvctxint.
+
+!END****************************************************************************
+*/
+long isinusinvinit
+( 
+    double sphere, 
+    double lon_cen_mer, 
+    double false_east,
+    double false_north, 
+    double dzone, 
+    double djustify 
+)
+{
+    return isinusinvctxint( &isin, sphere, lon_cen_mer, false_east,
+                            false_north, dzone, djustify );
+}
+
 /*
 !C******************************************************************************
 !Description: Isin_inv_init (initialize mapping) initializes the integerized 
@@ -465,10 +508,11 @@ Isin_t *Isin_inv_init
 
 /*
 !C******************************************************************************
-!Description: isinusinv (inverse mapping) maps from map projection coordinates
+!Description: isinusinvctx (inverse mapping) maps from map projection coordinates
  ('x', 'y') to geographic coordinates ('lon', 'lat').
  
 !Input Parameters:
+ ctx            handle from isinusinvctxint
  x              easting in map projection (same units as 'sphere')
  y              northing in map projection (same units as 'sphere')
  
@@ -479,15 +523,16 @@ Isin_t *Isin_inv_init
 !Team Unique Header:
  
  ! Usage Notes:
-   1. 'isinus_init' must have been previously called for the handle.
+   1. 'isinusinvctxint' must have been previously called for the handle.
    2. The longitude returned is in the range [-'PI' to 'PI').
    3. If the input point is in the fill area of the map projection
       a status of GCTP_ERANGE is returned.
  
 !END****************************************************************************
 */
-long isinusinv
+long isinusinvctx
 ( 
+    void *ctx,
     double x, 
     double y, 
     double *lon, 
@@ -496,16 +541,168 @@ long isinusinv
 {
     int istat;                  /* Status returned from 'Isin_inv' function */
 
-    istat = Isin_inv( isin, x, y, lon, lat );
+    istat = Isin_inv( (const Isin_t *)ctx, x, y, lon, lat );
     if ( istat == ISIN_ERROR )
     {
-        error( "isinusinv", "bad return from Isin_inv" );
+        error( "isinusinvctx", "bad return from Isin_inv" );
         return ISIN_ERROR;
     }
 
     return istat;
 }
 
+/*
+!C******************************************************************************
+!Description: isinusinvctxarr (inverse mapping) maps an array of points from
+ map projection coordinates ('x', 'y') to geographic coordinates ('lon', 'lat').
+ 
+!Input Parameters:
+ ctx            handle from isinusinvctxint
+ n              number of points
+ x              eastings in map projection (same units as 'sphere')
+ y              northings in map projection (same units as 'sphere')
+ status         status of each point; only points with GCTP_OK are mapped
+ 
+!Output Parameters:
+ lon            longitudes (radians)
+ lat            latitudes (radians)
+ status         GCTP_ERANGE for points in the fill area of the map projection
+ (returns)      status:
+                  ISIN_SUCCESS - normal return
+                  ISIN_ERROR - error return
+ 
+!Team Unique Header:
+ 
+ ! Usage Notes:
+   1. 'isinusinvctxint' must have been previously called for the handle.
+   2. The results are the same as calling 'isinusinvctx' for each point.  The
+      handle is checked once, and the latitudes and column numbers are
+      computed in a separate pass with no branches or function calls so the
+      compiler can vectorize it.
+   3. 'lon' may be the same array as 'x' and 'lat' the same as 'y'.
+ 
+!END****************************************************************************
+*/
+long isinusinvctxarr
+( 
+    void *ctx,
+    long n,
+    double *x, 
+    double *y, 
+    double *lon, 
+    double *lat,
+    long *status
+)
+{
+    const Isin_t *this = (const Isin_t *)ctx;
+    double false_east, false_north;
+    double sphere_inv, col_dist_inv;
+                                /* Local copies of the handle values */
+    double row, col;            /* Row (zone) and column; column is relative
+                                   to central; 0.5 is the center of a row or
+                                   column */
+    double flon;                /* Fractional longitude (multiples of PI) */
+    long irow;                  /* Integer row (zone) number */
+    long i;                     /* Point index */
+
+    if ( this == NULL )
+    {
+        Isin_error( &ISIN_BADHANDLE, "Isin_inv" );
+        error( "isinusinvctxarr", "bad return from Isin_inv" );
+        return ISIN_ERROR;
+    }
+    if ( this->key != ISIN_KEY )
+    {
+        Isin_error( &ISIN_BADKEY, "Isin_inv" );
+        error( "isinusinvctxarr", "bad return from Isin_inv" );
+        return ISIN_ERROR;
+    }
+
+    false_east = this->false_east;
+    false_north = this->false_north;
+    sphere_inv = this->sphere_inv;
+    col_dist_inv = this->col_dist_inv;
+
+    /* Latitude and column number (relative to center) */
+    for ( i = 0; i < n; i++ )
+    {
+        lon[i] = ( x[i] - false_east ) * col_dist_inv;
+        lat[i] = ( y[i] - false_north ) * sphere_inv;
+    }
+
+    for ( i = 0; i < n; i++ )
+    {
+        if ( status[i] != GCTP_OK )
+            continue;
+
+        if ( lat[i] < -HALF_PI || lat[i] > HALF_PI )
+        {
+            status[i] = GCTP_ERANGE;
+            continue;
+        }
+
+        /* Integer row number */
+        row = ( HALF_PI - lat[i] ) * this->ang_size_inv;
+        irow = (long)row;
+        if ( irow >= this->nrow_half )
+            irow = ( this->nrow - 1 ) - irow;
+        if ( irow < 0 )
+            irow = 0;
+
+        /* Fractional longitude (between 0 and 1) */
+        col = lon[i];
+        flon = ( col + this->row[irow].icol_cen ) * this->row[irow].ncol_inv;
+        if ( flon < 0.0 || flon > 1.0 )
+        {
+            status[i] = GCTP_ERANGE;
+            continue;
+        }
+
+        /* Actual longitude */
+        lon[i] = this->ref_lon + ( flon * TWO_PI );
+        if ( lon[i] >= PI )
+            lon[i] -= TWO_PI;
+        if ( lon[i] < -PI )
+            lon[i] += TWO_PI;
+    }
+
+    return ISIN_SUCCESS;
+}
+
+/*
+!C******************************************************************************
+!Description: isinusinv (inverse mapping) maps from map projection coordinates
+ ('x', 'y') to geographic coordinates ('lon', 'lat').
+ 
+!Input Parameters:
+ x              easting in map projection (same units as 'sphere')
+ y              northing in map projection (same units as 'sphere')
+ 
+!Output Parameters:
+ lon            longitude (radians)
+ lat            latitude (radians)
+ 
+!Team Unique Header:
+ 
+ ! Usage Notes:
+   1. 'isinus_init' must have been previously called for the handle.
+   2. The longitude returned is in the range [-'PI' to 'PI').
+   3. If the input point is in the fill area of the map projection
+      a status of GCTP_ERANGE is returned.
+ 
+!END****************************************************************************
+*/
+long isinusinv
+( 
+    double x, 
+    double y, 
+    double *lon, 
+    double *lat 
+)
+{
+    return isinusinvctx( isin, x, y, lon, lat );
+}
+
 /*
 !C******************************************************************************
 !Description: Isin_inv (inverse mapping) maps from map projection coordinates
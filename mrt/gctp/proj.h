@@ -105,6 +105,57 @@
 #define GEO_TRUE 1		/* True value for geometric true/false flags */
 #define GEO_FALSE -1		/*  False val for geometric true/false flags */
 
+/* Sinusoidal projection parameters.  sinforctxint/sininvctxint fill one of
+   these so several Sinusoidal projections can be in use at once. */
+
+typedef struct
+{
+    double lon_center;          /* Center longitude (projection center)      */
+    double R;                   /* Radius of the earth (sphere)              */
+    double false_easting;       /* x offset in meters                        */
+    double false_northing;      /* y offset in meters                        */
+}
+SinCtx;
+
+/* Pre-initialized transformation from one projection to another.  Filled by
+   gctp_xform_init and used by gctp_xform, which skips the per-call setup done
+   by gctp (parameter comparisons, unit factors, function table lookups). */
+
+typedef struct
+{
+    long insys;                 /* input projection code                     */
+    long inzone;                /* input zone number                         */
+    long inspheroid;            /* input spheroid                            */
+    double inparm[COEFCT];      /* input projection parameters               */
+    long outsys;                /* output projection code                    */
+    long outzone;               /* output zone number                        */
+    long outspheroid;           /* output spheroid                           */
+    double outparm[COEFCT];     /* output projection parameters              */
+    double in_factor;           /* input units to radians (GEO) or meters    */
+    double out_factor;          /* radians (GEO) or meters to output units   */
+    long (*inv_func)();         /* inverse transformation function           */
+    long (*for_func)();         /* forward transformation function           */
+    long inv_serial;            /* inv_init_serial when inverse was set up   */
+    long for_serial;            /* for_init_serial when forward was set up,
+                                   -1 if not yet initialized                 */
+    char fn27[256];             /* NAD 1927 parameter file                   */
+    char fn83[256];             /* NAD 1983 parameter file                   */
+    long (*inv_ctx_func)();     /* inverse function taking inv_ctx, or NULL
+                                   if inv_func is used                       */
+    long (*for_ctx_func)();     /* forward function taking for_ctx, or NULL
+                                   if for_func is used                       */
+    long (*inv_arr_func)();     /* array version of inv_ctx_func, or NULL    */
+    long (*for_arr_func)();     /* array version of for_ctx_func, or NULL    */
+    void *inv_ctx;              /* inverse projection parameters owned by
+                                   this transformation                       */
+    void *for_ctx;              /* forward projection parameters owned by
+                                   this transformation                       */
+}
+GctpXform;
+
+extern long inv_init_serial[MAXPROJ + 1];
+extern long for_init_serial[MAXPROJ + 1];
+
 /* GCTP Function prototypes */
 
 long alberforint
@@ -477,6 +528,51 @@ void gctp
     long *iflg               /* error flag                                   */
 );
 
+long gctp_xform_init
+(
+    GctpXform *xf,           /* (O) transformation to initialize             */
+    long insys,              /* input projection code                        */
+    long inzone,             /* input zone number                            */
+    double *inparm,          /* input projection parameter array             */
+    long inunit,             /* input units                                  */
+    long inspheroid,         /* input spheroid                               */
+    long outsys,             /* output projection code                       */
+    long outzone,            /* output zone                                  */
+    double *outparm,         /* output projection array                      */
+    long outunit,            /* output units                                 */
+    long outspheroid,        /* output spheroid                              */
+    char fn27[],             /* file name of NAD 1927 parameter file         */
+    char fn83[]              /* file name of NAD 1983 parameter file         */
+);
+
+long gctp_xform
+(
+    GctpXform *xf,           /* (I/O) initialized transformation             */
+    double *incoor,          /* (I) input coordinates                        */
+    double *outcoor          /* (O) output coordinates                       */
+);
+
+void gctp_xform_free
+(
+    GctpXform *xf            /* (I/O) transformation to free                 */
+);
+
+long gctp_xform_array
+(
+    GctpXform *xf,           /* (I/O) initialized transformation             */
+    long n,                  /* (I) number of points                         */
+    double *inx,             /* (I) input x coordinates                      */
+    double *iny,             /* (I) input y coordinates                      */
+    double *outx,            /* (O) output x coordinates (may be inx)        */
+    double *outy,            /* (O) output y coordinates (may be iny)        */
+    long *status             /* (O) status of each point                     */
+);
+
+long gctp_xform_reentrant
+(
+    GctpXform *xf            /* (I) initialized transformation               */
+);
+
 long gnomforint
 (
     double r,                /* (I) Radius of the earth (sphere)     */
@@ -1191,6 +1287,35 @@ long sinfor
     double *y                /* (O) Y projection coordinate */
 );
 
+long sinforctxint
+(
+    SinCtx *ctx,             /* (O) Projection context               */
+    double r,                /* (I) Radius of the earth (sphere)     */
+    double center_long,      /* (I) Center longitude                 */
+    double false_east,       /* x offset in meters                   */
+    double false_north       /* y offset in meters                   */
+);
+
+long sinforctx
+(
+    void *ctx,               /* (I) Context from sinforctxint */
+    double lon,              /* (I) Longitude */
+    double lat,              /* (I) Latitude */
+    double *x,               /* (O) X projection coordinate */
+    double *y                /* (O) Y projection coordinate */
+);
+
+long sinforctxarr
+(
+    void *ctx,               /* (I) Context from sinforctxint */
+    long n,                  /* (I) Number of points */
+    double *lon,             /* (I) Longitudes */
+    double *lat,             /* (I) Latitudes */
+    double *x,               /* (O) X projection coordinates */
+    double *y,               /* (O) Y projection coordinates */
+    long *status             /* (I/O) Status of each point */
+);
+
 long sininvint
 (
     double r,                /* (I) Radius of the earth (sphere)     */
@@ -1207,6 +1332,35 @@ long sininv
     double *lat              /* (O) Latitude */
 );
 
+long sininvctxint
+(
+    SinCtx *ctx,             /* (O) Projection context               */
+    double r,                /* (I) Radius of the earth (sphere)     */
+    double center_long,      /* (I) Center longitude                 */
+    double false_east,       /* x offset in meters                   */
+    double false_north       /* y offset in meters                   */
+);
+
+long sininvctx
+(
+    void *ctx,               /* (I) Context from sininvctxint */
+    double x,                /* (I) X projection coordinate */
+    double y,                /* (I) Y projection coordinate */
+    double *lon,             /* (O) Longitude */
+    double *lat              /* (O) Latitude */
+);
+
+long sininvctxarr
+(
+    void *ctx,               /* (I) Context from sininvctxint */
+    long n,                  /* (I) Number of points */
+    double *x,               /* (I) X projection coordinates */
+    double *y,               /* (I) Y projection coordinates */
+    double *lon,             /* (O) Longitudes */
+    double *lat,             /* (O) Latitudes */
+    long *status             /* (I/O) Status of each point */
+);
+
 long somforint
 (
     double r_major,          /* major axis                           */
@@ -9,6 +9,11 @@ PURPOSE:	Transforms input longitude and latitude to Easting and
 PROGRAMMER              DATE            
 ----------              ----           
 D. Steinwand, EROS      May, 1991     
+                        10-26         Moved the parameters into a SinCtx so
+                                      several projections can be used at
+                                      once (sinforctxint, sinforctx).
+                        10-26         Added sinforctxarr to convert an array
+                                      of points in one call.
 
 This function was adapted from the Sinusoidal projection code (FORTRAN) in the 
 General Cartographic Transformation Package software which is available from 
@@ -25,12 +30,28 @@ ALGORITHM REFERENCES
 *******************************************************************************/
 #include "cproj.h"
 
-/* Variables common to all subroutines in this code file
-  -----------------------------------------------------*/
-static double lon_center;	/* Center longitude (projection center) */
-static double R;		/* Radius of the earth (sphere) 	*/
-static double false_easting;	/* x offset in meters			*/
-static double false_northing;	/* y offset in meters			*/
+/* Parameters used by sinfor and sinforint.  sinforctxint and sinforctx
+   work on a caller supplied copy instead.
+  -----------------------------------------------------------------*/
+static SinCtx sin_ctx;
+
+/* Initialize a Sinusoidal projection context
+  -------------------------------------------*/
+long sinforctxint
+(
+    SinCtx *ctx,		/* (O) Projection context		*/
+    double r, 			/* (I) Radius of the earth (sphere) 	*/
+    double center_long,		/* (I) Center longitude 		*/
+    double false_east,		/* x offset in meters			*/
+    double false_north		/* y offset in meters			*/
+)
+{
+ctx->R = r;
+ctx->lon_center = center_long;
+ctx->false_easting = false_east;
+ctx->false_northing = false_north;
+return(GCTP_OK);
+}
 
 /* Initialize the Sinusoidal projection
   ------------------------------------*/
@@ -44,36 +65,86 @@ long sinforint
 {
 /* Place parameters in static storage for common use
   -------------------------------------------------*/
-R = r;
-lon_center = center_long;
-false_easting = false_east;
-false_northing = false_north;
+sinforctxint(&sin_ctx,r,center_long,false_east,false_north);
 
 /* Report parameters to the user
   -----------------------------*/
 ptitle("SINUSOIDAL"); 
 radius(r);
 cenlon(center_long);
-offsetp(false_easting,false_northing);
+offsetp(false_east,false_north);
 return(GCTP_OK);
 }
-
-/* Sinusoidal forward equations--mapping lat,long to x,y
-  -----------------------------------------------------*/
-long sinfor
+
+/* Sinusoidal forward equations using a projection context
+  -------------------------------------------------------*/
+long sinforctx
 (
+    void *ctx,			/* (I) Context from sinforctxint */
     double lon,			/* (I) Longitude */
     double lat,			/* (I) Latitude */
     double *x,			/* (O) X projection coordinate */
     double *y			/* (O) Y projection coordinate */
 )
 {
+SinCtx *sc = (SinCtx *)ctx;	/* projection context */
 double delta_lon;	/* Delta longitude (Given longitude - center */
 
 /* Forward equations
   -----------------*/
-delta_lon = adjust_lon(lon - lon_center);
-*x = R * delta_lon * cos(lat) + false_easting;
-*y = R * lat + false_northing;
+delta_lon = adjust_lon(lon - sc->lon_center);
+*x = sc->R * delta_lon * cos(lat) + sc->false_easting;
+*y = sc->R * lat + sc->false_northing;
 return(GCTP_OK);
 }
+
+/* Sinusoidal forward equations for an array of points.  Only points with a
+   status of GCTP_OK are converted.  x may be the same array as lon and y the
+   same as lat.  The northings are computed in a separate pass with no
+   function calls so the compiler can vectorize it; the results are the same
+   as calling sinforctx for each point.
+  -------------------------------------------------------------------------*/
+long sinforctxarr
+(
+    void *ctx,			/* (I) Context from sinforctxint */
+    long n,			/* (I) Number of points */
+    double *lon,		/* (I) Longitudes */
+    double *lat,		/* (I) Latitudes */
+    double *x,			/* (O) X projection coordinates */
+    double *y,			/* (O) Y projection coordinates */
+    long *status		/* (I/O) Status of each point */
+)
+{
+SinCtx *sc = (SinCtx *)ctx;	/* projection context */
+double delta_lon;	/* Delta longitude (Given longitude - center */
+long i;			/* point index */
+
+/* Forward equations.  The latitude is still needed for the easting, so
+   the easting is done before the northing overwrites it.
+  -----------------------------------------------------------------------*/
+for (i = 0; i < n; i++)
+   {
+   if (status[i] != GCTP_OK)
+      continue;
+   delta_lon = lon[i] - sc->lon_center;
+   if (fabs(delta_lon) > PI)
+      delta_lon = adjust_lon(delta_lon);
+   x[i] = sc->R * delta_lon * cos(lat[i]) + sc->false_easting;
+   }
+for (i = 0; i < n; i++)
+   y[i] = sc->R * lat[i] + sc->false_northing;
+return(GCTP_OK);
+}
+
+/* Sinusoidal forward equations--mapping lat,long to x,y
+  -----------------------------------------------------*/
+long sinfor
+(
+    double lon,			/* (I) Longitude */
+    double lat,			/* (I) Latitude */
+    double *x,			/* (O) X projection coordinate */
+    double *y			/* (O) Y projection coordinate */
+)
+{
+return(sinforctx(&sin_ctx,lon,lat,x,y));
+}
@@ -11,6 +11,11 @@ PROGRAMMER              DATE
 D. Steinwand, EROS      May, 1991     
 G. Schmidt, EROS        Nov, 2002     Return GCTP_ERANGE for data values that
                                       are out of valid lat/long range.
+                        10-26         Moved the parameters into a SinCtx so
+                                      several projections can be used at
+                                      once (sininvctxint, sininvctx).
+                        10-26         Added sininvctxarr to convert an array
+                                      of points in one call.
 
 This function was adapted from the Sinusoidal projection code (FORTRAN) in the 
 General Cartographic Transformation Package software which is available from 
@@ -27,12 +32,28 @@ ALGORITHM REFERENCES
 *******************************************************************************/
 #include "cproj.h"
 
-/* Variables common to all subroutines in this code file
-  -----------------------------------------------------*/
-static double lon_center;	/* Center longitude (projection center) */
-static double R;		/* Radius of the earth (sphere) 	*/
-static double false_easting;	/* x offset in meters			*/
-static double false_northing;	/* y offset in meters			*/
+/* Parameters used by sininv and sininvint.  sininvctxint and sininvctx
+   work on a caller supplied copy instead.
+  -----------------------------------------------------------------*/
+static SinCtx sin_ctx;
+
+/* Initialize a Sinusoidal projection context
+  -------------------------------------------*/
+long sininvctxint
+(
+    SinCtx *ctx,		/* (O) Projection context		*/
+    double r, 			/* (I) Radius of the earth (sphere) 	*/
+    double center_long,		/* (I) Center longitude 		*/
+    double false_east,		/* x offset in meters			*/
+    double false_north		/* y offset in meters			*/
+)
+{
+ctx->R = r;
+ctx->lon_center = center_long;
+ctx->false_easting = false_east;
+ctx->false_northing = false_north;
+return(GCTP_OK);
+}
 
 /* Initialize the Sinusoidal projection
   ------------------------------------*/
@@ -46,37 +67,36 @@ long sininvint
 {
 /* Place parameters in static storage for common use
   -------------------------------------------------*/
-R = r;
-lon_center = center_long;
-false_easting = false_east;
-false_northing = false_north;
+sininvctxint(&sin_ctx,r,center_long,false_east,false_north);
 
 /* Report parameters to the user
   -----------------------------*/
 ptitle("SINUSOIDAL"); 
 radius(r);
 cenlon(center_long);
-offsetp(false_easting,false_northing);
+offsetp(false_east,false_north);
 return(GCTP_OK);
 }
 
-/* Sinusoidal inverse equations--mapping x,y to lat,long 
-  -----------------------------------------------------*/
-long sininv
+/* Sinusoidal inverse equations using a projection context
+  -------------------------------------------------------*/
+long sininvctx
 (
+    void *ctx,		/* (I) Context from sininvctxint */
     double x,		/* (I) X projection coordinate */
     double y,		/* (I) Y projection coordinate */
     double *lon,		/* (O) Longitude */
     double *lat		/* (O) Latitude */
 )
 {
+SinCtx *sc = (SinCtx *)ctx;	/* projection context */
 double temp;		/* Re-used temporary variable */
 
 /* Inverse equations
   -----------------*/
-x -= false_easting;
-y -= false_northing;
-*lat = y / R;
+x -= sc->false_easting;
+y -= sc->false_northing;
+*lat = y / sc->R;
 if (fabs(*lat) > HALF_PI) 
    {
    return(GCTP_ERANGE);
@@ -84,10 +104,77 @@ if (fabs(*lat) > HALF_PI)
 temp = fabs(*lat) - HALF_PI;
 if (fabs(temp) > EPSLN)
    {
-   temp = lon_center + x / (R * cos(*lat));
+   temp = sc->lon_center + x / (sc->R * cos(*lat));
    *lon = adjust_lon(temp);
    }
-else *lon = lon_center;
+else *lon = sc->lon_center;
+return(GCTP_OK);
+}
+
+/* Sinusoidal inverse equations for an array of points.  Only points with a
+   status of GCTP_OK are converted; GCTP_ERANGE is stored in status for points
+   outside the projection.  lon may be the same array as x and lat the same
+   as y.  The offsets and latitudes are computed in a separate pass with no
+   function calls so the compiler can vectorize it; the results are the same
+   as calling sininvctx for each point.
+  -------------------------------------------------------------------------*/
+long sininvctxarr
+(
+    void *ctx,		/* (I) Context from sininvctxint */
+    long n,		/* (I) Number of points */
+    double *x,		/* (I) X projection coordinates */
+    double *y,		/* (I) Y projection coordinates */
+    double *lon,	/* (O) Longitudes */
+    double *lat,	/* (O) Latitudes */
+    long *status	/* (I/O) Status of each point */
+)
+{
+SinCtx *sc = (SinCtx *)ctx;	/* projection context */
+double fe = sc->false_easting;	/* local copies so the loop can be	*/
+double fn = sc->false_northing;	/* vectorized without reloading them	*/
+double r = sc->R;
+double temp;		/* Re-used temporary variable */
+long i;			/* point index */
+
+/* Inverse equations, first the part common to every point
+  --------------------------------------------------------*/
+for (i = 0; i < n; i++)
+   {
+   lon[i] = x[i] - fe;
+   lat[i] = (y[i] - fn) / r;
+   }
+
+/* then the longitude of each point within the projection
+  -------------------------------------------------------*/
+for (i = 0; i < n; i++)
+   {
+   if (status[i] != GCTP_OK)
+      continue;
+   if (fabs(lat[i]) > HALF_PI) 
+      {
+      status[i] = GCTP_ERANGE;
+      continue;
+      }
+   temp = fabs(lat[i]) - HALF_PI;
+   if (fabs(temp) > EPSLN)
+      {
+      temp = sc->lon_center + lon[i] / (r * cos(lat[i]));
+      lon[i] = (fabs(temp) <= PI) ? temp : adjust_lon(temp);
+      }
+   else lon[i] = sc->lon_center;
+   }
 return(GCTP_OK);
 }
 
+/* Sinusoidal inverse equations--mapping x,y to lat,long 
+  -----------------------------------------------------*/
+long sininv
+(
+    double x,		/* (I) X projection coordinate */
+    double y,		/* (I) Y projection coordinate */
+    double *lon,		/* (O) Longitude */
+    double *lat		/* (O) Latitude */
+)
+{
+return(sininvctx(&sin_ctx,x,y,lon,lat));
+}
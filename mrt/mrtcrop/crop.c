@@ -0,0 +1,644 @@
+/******************************************************************************
+
+FILE:  crop.c
+
+PURPOSE:  Crop an image (usually a mosaic) to each of a list of counties
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+         10/26                         Use the shape index
+         10/26                         Added the zonal statistics table (-z)
+         10/26                         Check the output names for truncation
+         10/26                         Keep the image's datum, so the
+                                       GeoTIFFs of a WGS84 geographic image
+                                       are EPSG:4326
+
+HARDWARE AND/OR SOFTWARE LIMITATIONS:
+  None
+
+PROJECT:    MODIS Reprojection Tool
+
+NOTES:
+  This replaces cutting the image once per county with gdalwarp -cutline.
+  The county polygons come from a shapefile, and every county is cropped
+  from one pass through each band (crop_rows.c), so the image is read once
+  however many counties there are.  The output files are laid out as
+  output_dir/<date>/<county code>.<band name>.tif, in the image's
+  projection, with the pixels outside the county set to background fill.
+  The crop target of the top-level makefile resamples each mosaic to
+  geographic WGS84 first, so the counties come out in EPSG:4326 as the
+  gdalwarp crops did.
+
+  With -z nothing is cropped: the same pass adds the pixels of each band
+  in each county to the county's statistics (see zonal.c), and the table
+  is written to output_dir/<date>.csv.
+
+******************************************************************************/
+#if defined(__CYGWIN__) || defined(WIN32)
+#include <getopt.h>             /* getopt  prototype */
+#else
+#include <unistd.h>             /* getopt  prototype */
+#endif
+
+#include <errno.h>
+#ifdef WIN32
+#  include <direct.h>
+#  define mkdir( path, mode ) _mkdir( path )
+#else
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#endif
+
+#include <time.h>               /* clock()   prototype */
+#include "crop.h"
+#include "mrt_dtype.h"
+
+/* Local prototypes */
+static int CheckCropArgs( int argc, char *argv[], char **input_filename,
+    char **shape_filename, char **list_filename, char **output_dir,
+    char **date, char **field, char **bandstr, int *zonal_stats,
+    int *nbins );
+static int GetImageDate( char *input_filename, char *date, size_t maxlen );
+static int MakeDirectory( char *path );
+static int CropImage( ModisDescriptor *modis, ShapeFile *shape,
+    ShapeIndex *index, CropCounty counties[], int ncounties,
+    ZonalTable *zonal, char *output_dir );
+
+int main
+(
+    int argc,
+    char *argv[]
+)
+
+{
+    ModisDescriptor *modis = NULL;   /* the image */
+    ShapeFile *shape = NULL;         /* the county shapes */
+    ShapeIndex *index = NULL;        /* the county shapes by code and
+                                        location */
+    CropCounty *counties = NULL;     /* the counties */
+    int ncounties = 0;               /* number of counties */
+    char *input_filename = NULL;     /* -i */
+    char *shape_filename = NULL;     /* -c */
+    char *list_filename = NULL;      /* -l */
+    char *output_dir = NULL;         /* -o */
+    char *date = NULL;               /* -d */
+    char *field = DEFAULT_CROP_FIELD;  /* -f */
+    char *bandstr = NULL;            /* -s */
+    int zonal_stats = FALSE;         /* -z */
+    int nbins = 0;                   /* -b */
+    ZonalTable *zonal = NULL;        /* statistics of the counties (-z) */
+    char **codes = NULL;             /* codes of the counties */
+    char image_date[SMALL_STRING];   /* date of the image */
+    char date_dir[LARGE_STRING + SMALL_STRING];  /* output directory */
+    char errmsg[2 * LARGE_STRING];   /* error message */
+    time_t startdate, enddate;       /* start and end date struct */
+    int status = MRT_NO_ERROR;       /* function return status */
+    int n;                           /* length of a constructed name */
+    size_t i;
+
+    /* Set up a log file and process the -g command line option if it exists */
+    InitLogHandler( argc, argv );
+
+    MessageHandler( NULL,
+       "*******************************************************************"
+       "***********\n");
+    MessageHandler( NULL, "%s (%s)", CROP_NAME, CROP_VERSION );
+    startdate = time( NULL );
+    MessageHandler( NULL, "Start Time:  %s", ctime( &startdate ) );
+    MessageHandler( NULL,
+    "------------------------------------------------------------------\n" );
+
+    if ( CheckCropArgs( argc, argv, &input_filename, &shape_filename,
+        &list_filename, &output_dir, &date, &field, &bandstr, &zonal_stats,
+        &nbins ) != CROP_SUCCESS )
+    {
+        ErrorHandler( FALSE, "mrtcrop", ERROR_GENERAL,
+            "Error processing the arguments for the crop tool" );
+        CloseLogHandler( );
+        return EXIT_FAILURE;
+    }
+
+    /* the date names the directory the counties go in */
+    if ( date )
+    {
+        strncpy( image_date, date, SMALL_STRING - 1 );
+        image_date[SMALL_STRING - 1] = '\0';
+    }
+    else if ( !GetImageDate( input_filename, image_date, SMALL_STRING ) )
+    {
+        snprintf( errmsg, sizeof( errmsg ),
+            "Can't tell the date of %s from its name (use -d)",
+            input_filename );
+        ErrorHandler( FALSE, "mrtcrop", ERROR_GENERAL, errmsg );
+        CloseLogHandler( );
+        return EXIT_FAILURE;
+    }
+
+    /* read the image header */
+    modis = ( ModisDescriptor * ) calloc( 1, sizeof( ModisDescriptor ) );
+    if ( modis == NULL )
+        ErrorHandler( TRUE, "mrtcrop", ERROR_MEMORY,
+            "Unable to allocate ModisDescriptor memory" );
+    InitializeModisDescriptor( modis );
+    modis->input_filename = input_filename;
+
+    status = GetInputFileExt( input_filename, &modis->input_filetype );
+    if ( status == MRT_NO_ERROR )
+    {
+        if ( modis->input_filetype == RAW_BINARY )
+            status = ReadHeaderFile( modis );
+        else
+            status = ReadHDFHeader( modis );
+    }
+    if ( status != MRT_NO_ERROR )
+    {
+        sprintf( errmsg, "Error reading %s", input_filename );
+        ErrorHandler( TRUE, "mrtcrop", ERROR_READ_INPUTPAR, errmsg );
+    }
+
+    if ( bandstr )
+    {
+        modis->tmpspectralsubset = bandstr;
+        GetSpectralSubsetCmdLine( modis );
+    }
+    else
+    {
+        for ( i = 0; i < modis->nbands; i++ )
+            modis->bandinfo[i].selected = 1;
+    }
+
+    /* the output is a subset of the image, as with NO_RESAMPLE, on the
+       image's datum (the counties are still projected without a datum
+       conversion, see crop_mask.c) */
+    modis->resampling_type = NO_RESAMPLE;
+    CopyInputParametersToOutput( modis );
+    modis->output_filetype = GEOTIFF;
+    for ( i = 0; i < modis->nbands; i++ )
+    {
+        modis->bandinfo[i].output_datatype = modis->bandinfo[i].input_datatype;
+        modis->bandinfo[i].output_pixel_size = modis->bandinfo[i].pixel_size;
+    }
+
+    status = CheckProjectionParams( modis );
+    if ( status != MRT_NO_ERROR )
+    {
+        sprintf( errmsg, "Projection parameter error (errval = %i)", status );
+        ErrorHandler( TRUE, "mrtcrop", status, errmsg );
+    }
+
+    /* find the counties */
+    shape = OpenShapeFile( shape_filename );
+    if ( !shape )
+        ErrorHandler( TRUE, "mrtcrop", ERROR_OPEN_INPUTIMAGE,
+            "Unable to open the county shapefile" );
+    index = OpenShapeIndex( shape, field );
+    if ( !index )
+        ErrorHandler( TRUE, "mrtcrop", ERROR_GENERAL,
+            "Unable to index the county shapefile" );
+    if ( ReadCropCounties( index, list_filename, &counties,
+        &ncounties ) != CROP_SUCCESS )
+        ErrorHandler( TRUE, "mrtcrop", ERROR_GENERAL,
+            "Unable to read the counties" );
+    MessageHandler( NULL, "Counties to crop: %d", ncounties );
+
+    if ( zonal_stats )
+    {
+        /* output_dir/<date>.csv */
+        n = snprintf( date_dir, sizeof( date_dir ), "%s/%s.csv", output_dir,
+            image_date );
+        if ( n < 0 || n >= ( int ) sizeof( date_dir ) )
+            ErrorHandler( TRUE, "mrtcrop", ERROR_GENERAL,
+                "Output directory name is too long" );
+        if ( !MakeDirectory( output_dir ) )
+        {
+            snprintf( errmsg, sizeof( errmsg ), "Unable to create %s",
+                output_dir );
+            ErrorHandler( TRUE, "mrtcrop", ERROR_OPEN_OUTPUTIMAGE, errmsg );
+        }
+
+        /* zone i is counties[i] */
+        codes = ( char ** ) malloc( ( ncounties + 1 ) * sizeof( char * ) );
+        if ( codes == NULL )
+            ErrorHandler( TRUE, "mrtcrop", ERROR_MEMORY, "County codes" );
+        for ( i = 0; i < ( size_t ) ncounties; i++ )
+            codes[i] = counties[i].code;
+        zonal = CreateZonalTable( ncounties, codes, nbins );
+        free( codes );
+        if ( zonal == NULL )
+            ErrorHandler( TRUE, "mrtcrop", ERROR_MEMORY,
+                "Unable to create the zonal statistics table" );
+    }
+    else
+    {
+        /* output_dir/<date> */
+        n = snprintf( date_dir, sizeof( date_dir ), "%s/%s", output_dir,
+            image_date );
+        if ( n < 0 || n >= ( int ) sizeof( date_dir ) )
+            ErrorHandler( TRUE, "mrtcrop", ERROR_GENERAL,
+                "Output directory name is too long" );
+        if ( !MakeDirectory( output_dir ) || !MakeDirectory( date_dir ) )
+        {
+            snprintf( errmsg, sizeof( errmsg ), "Unable to create %s",
+                date_dir );
+            ErrorHandler( TRUE, "mrtcrop", ERROR_OPEN_OUTPUTIMAGE, errmsg );
+        }
+    }
+
+    status = CropImage( modis, shape, index, counties, ncounties, zonal,
+        date_dir );
+    if ( status != MRT_NO_ERROR )
+    {
+        sprintf( errmsg, "Crop error (errval = %i)", status );
+        ErrorHandler( FALSE, "mrtcrop", status, errmsg );
+    }
+    else if ( zonal && !WriteZonalTable( zonal, date_dir ) )
+    {
+        sprintf( errmsg, "Unable to write %s", date_dir );
+        ErrorHandler( FALSE, "mrtcrop", ERROR_WRITE_OUTPUTIMAGE, errmsg );
+        status = ERROR_WRITE_OUTPUTIMAGE;
+    }
+
+    /* the same clean up whether the crop worked or not */
+    CloseZonalTable( zonal );
+    FreeCountySpans( counties, ncounties );
+    free( counties );
+    CloseShapeIndex( index );
+    CloseShapeFile( shape );
+    FreeVirtualMosaic( );
+
+    if ( status != MRT_NO_ERROR )
+    {
+        CloseLogHandler( );
+        return EXIT_FAILURE;
+    }
+
+    enddate = time( NULL );
+    MessageHandler( NULL, "End Time:  %s", ctime( &enddate ) );
+    MessageHandler( NULL, "Finished processing!\n" );
+    MessageHandler( NULL, "******************************************************************************\n");
+    CloseLogHandler( );
+
+    return EXIT_SUCCESS;
+}
+
+
+/******************************************************************************
+
+MODULE:  CropImage
+
+PURPOSE:  Crop each selected band of the image to the counties, or gather
+          its statistics in them
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+status          See mrt_error.h for a complete list of error codes
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+         10/26                         Zonal statistics (zonal)
+         10/26                         Close the input on every error
+
+NOTES:
+  The counties are rasterized again only when a band's grid isn't the
+  same as the last band's (an HDF-EOS file can have grids of several
+  resolutions).  After an error the rest of the bands are skipped, but the
+  input is closed as it is after the last band.
+
+******************************************************************************/
+static int CropImage
+(
+    ModisDescriptor *modis,    /* I: session info */
+    ShapeFile *shape,          /* I: county shapes */
+    ShapeIndex *index,         /* I: county shapes by location */
+    CropCounty counties[],     /* I/O: the counties */
+    int ncounties,             /* I: number of counties */
+    ZonalTable *zonal,         /* I/O: statistics of the counties, or NULL
+                                       to crop */
+    char *output_dir           /* I: directory for the output files */
+)
+
+{
+    FileDescriptor *input = NULL;    /* band of the image */
+    HdfEosFD *input_hdfptr = NULL;   /* HDF-EOS image */
+    double grid_corners[4][2];       /* corners of the rasterized grid */
+    size_t grid_nrows = 0, grid_ncols = 0;  /* size of the rasterized grid */
+    int ninside;                     /* counties on the image */
+    int status = MRT_NO_ERROR;       /* error status */
+    int stat;
+    size_t band;
+
+    /* HDF-EOS files get opened just once and stay open */
+    if ( modis->input_filetype == HDFEOS )
+    {
+        input_hdfptr = OpenHdfEosFile( modis->input_filename,
+            modis->input_filename, FILE_READ_MODE, &status );
+        if ( !input_hdfptr )
+            return ( ERROR_OPEN_INPUTIMAGE );
+    }
+
+    for ( band = 0; band < modis->nbands && status == MRT_NO_ERROR; band++ )
+    {
+        if ( !modis->bandinfo[band].selected )
+            continue;
+
+        /* open input file/grid/band/field */
+        switch ( modis->input_filetype )
+        {
+            case RAW_BINARY:
+            case VIRTUAL_MOSAIC:
+                input = OpenInImage( modis, ( int ) band, &status );
+                if ( input )
+                    ClobberFileBuffers( input );
+                break;
+
+            case HDFEOS:
+                input = MakeHdfEosFD( modis, input_hdfptr, FILE_READ_MODE,
+                    ( int ) band, &status );
+                if ( input )
+                    GetHdfEosField( modis, input_hdfptr, ( int ) band );
+                break;
+        }
+        if ( !input )
+        {
+            if ( status == MRT_NO_ERROR )
+                status = ERROR_OPEN_INPUTIMAGE;
+            break;
+        }
+
+        /* get the projection coordinate corners for the input file */
+        GetInputImageCorners( modis, input );
+
+        /* rasterize the counties if the grid changed */
+        if ( input->nrows != grid_nrows || input->ncols != grid_ncols ||
+             memcmp( input->coord_corners, grid_corners,
+             sizeof( grid_corners ) ) )
+        {
+            ninside = RasterizeCounties( modis, input, shape, index,
+                counties, ncounties );
+            if ( ninside < 0 )
+                status = ERROR_GENERAL;
+            else
+            {
+                MessageHandler( "CropImage", "%d of %d counties are on "
+                    "the " MRT_SIZE_T_FMT " x " MRT_SIZE_T_FMT " grid",
+                    ninside, ncounties, input->nrows, input->ncols );
+                grid_nrows = input->nrows;
+                grid_ncols = input->ncols;
+                memcpy( grid_corners, input->coord_corners,
+                    sizeof( grid_corners ) );
+            }
+        }
+
+        if ( status == MRT_NO_ERROR )
+        {
+            if ( zonal )
+                status = StatsBand( modis, input, ( int ) band, counties,
+                    ncounties, zonal );
+            else
+                status = CropBand( modis, input, ( int ) band, counties,
+                    ncounties, output_dir );
+        }
+
+        /* close input file */
+        switch ( modis->input_filetype )
+        {
+            case RAW_BINARY:
+            case VIRTUAL_MOSAIC:
+                CloseFile( input );
+                break;
+
+            case HDFEOS:
+                DestroyFileDescriptor( input );
+                break;
+        }
+        input = NULL;
+    }
+
+    /* close input HDF-EOS file */
+    if ( modis->input_filetype == HDFEOS )
+    {
+        input = MakeHdfEosFD( modis, input_hdfptr, FILE_READ_MODE, 0, &stat );
+        CloseFile( input );
+    }
+
+    return ( status );
+}
+
+
+/******************************************************************************
+
+MODULE:  CheckCropArgs
+
+PURPOSE:  Check the command-line arguments
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+CROP_SUCCESS    Success
+CROP_ERROR      Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+         10/26                         Added -z and -b
+
+NOTES:
+  The argument strings are returned, not copied.  Optional arguments that
+  aren't given are left alone.
+
+******************************************************************************/
+static int CheckCropArgs
+(
+    int argc,              /* I: number of arguments */
+    char *argv[],          /* I: argument strings */
+    char **input_filename, /* O: -i image to crop */
+    char **shape_filename, /* O: -c county shapefile */
+    char **list_filename,  /* O: -l file of county codes */
+    char **output_dir,     /* O: -o output directory */
+    char **date,           /* O: -d date of the image */
+    char **field,          /* O: -f attribute with the county codes */
+    char **bandstr,        /* O: -s spectral subset */
+    int *zonal_stats,      /* O: -z write the zonal statistics */
+    int *nbins             /* O: -b histogram bins of the statistics */
+)
+
+{
+    char errmsg[SMALL_STRING];   /* error message */
+    int c;
+    int i;
+
+    opterr = 0;         /* do not print error messages to stdout */
+    while ( ( c = getopt( argc, argv, "i:c:l:o:d:f:s:g:zb:" ) ) != -1 )
+    {
+        switch( c )
+        {
+            case 'i':   /* image to crop */
+                *input_filename = optarg;
+                break;
+
+            case 'c':   /* county shapefile */
+                *shape_filename = optarg;
+                break;
+
+            case 'l':   /* county codes */
+                *list_filename = optarg;
+                break;
+
+            case 'o':   /* output directory */
+                *output_dir = optarg;
+                break;
+
+            case 'd':   /* image date */
+                *date = optarg;
+                break;
+
+            case 'f':   /* county code attribute */
+                *field = optarg;
+                break;
+
+            case 's':   /* spectral subsetting */
+                for ( i = 0; i < (int) strlen( optarg ); i++ )
+                {
+                    if ( optarg[i] != '0' && optarg[i] != '1' &&
+                         optarg[i] != ' ' )
+                    {
+                        sprintf( errmsg, "Error processing spectral subset "
+                            "(%s) for crop tool. Only '0's and '1's are "
+                            "allowed.", optarg );
+                        ErrorHandler( FALSE, "CheckCropArgs", ERROR_GENERAL,
+                            errmsg );
+                        CropUsage( );
+                        return CROP_ERROR;
+                    }
+                }
+                *bandstr = optarg;
+                break;
+
+            case 'z':   /* zonal statistics instead of cropping */
+                *zonal_stats = TRUE;
+                break;
+
+            case 'b':   /* histogram bins */
+                if ( sscanf( optarg, "%i", nbins ) < 1 || *nbins < 0 )
+                {
+                    sprintf( errmsg, "Bad number of histogram bins (%s)",
+                        optarg );
+                    ErrorHandler( FALSE, "CheckCropArgs", ERROR_ZONAL_FIELD,
+                        errmsg );
+                    CropUsage( );
+                    return CROP_ERROR;
+                }
+                break;
+
+            case 'g':   /* log file name, should be processed in
+                           InitLogHandler() */
+                break;
+
+            default:
+                CropUsage( );
+                return CROP_ERROR;
+        }
+    }
+
+    if ( !*input_filename || !*shape_filename || !*output_dir )
+    {
+        CropUsage( );
+        return CROP_ERROR;
+    }
+
+    return CROP_SUCCESS;
+}
+
+
+/******************************************************************************
+
+MODULE:  GetImageDate
+
+PURPOSE:  Get the date of an image from its name
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            Success
+FALSE           The name doesn't have a date
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Mosaics are named <name>.<date>[_<anything>].<ext> (mosaic.A2017001.hdf),
+  so the date is the second part of the name, up to any '_'.
+
+******************************************************************************/
+static int GetImageDate
+(
+    char *input_filename,  /* I: image file name */
+    char *date,            /* O: date of the image */
+    size_t maxlen          /* I: size of date */
+)
+
+{
+    char *name;            /* file name without the path */
+    char *start, *end;     /* the date in the name */
+
+    name = strrchr( input_filename, '/' );
+    if ( name == NULL )
+        name = strrchr( input_filename, '\\' );
+    name = name ? name + 1 : input_filename;
+
+    start = strchr( name, '.' );
+    if ( start == NULL || strchr( start + 1, '.' ) == NULL )
+        return ( FALSE );
+    start++;
+
+    for ( end = start; *end != '.' && *end != '_'; end++ );
+    if ( end == start || ( size_t ) ( end - start ) >= maxlen )
+        return ( FALSE );
+
+    memcpy( date, start, end - start );
+    date[end - start] = '\0';
+
+    return ( TRUE );
+}
+
+
+/******************************************************************************
+
+MODULE:  MakeDirectory
+
+PURPOSE:  Create a directory if it doesn't exist
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            The directory exists
+FALSE           Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+
+******************************************************************************/
+static int MakeDirectory
+(
+    char *path             /* I: directory */
+)
+
+{
+    return ( mkdir( path, 0777 ) == 0 || errno == EEXIST );
+}
@@ -0,0 +1,90 @@
+#ifndef _CROP_H_
+#define _CROP_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "shared_resample.h"
+#include "shapefile.h"
+
+/* ERROR/SUCCESS defines */
+#define CROP_ERROR 0
+#define CROP_SUCCESS 1
+
+/* default attribute of the shapes with the county codes */
+#define DEFAULT_CROP_FIELD "GEOID"
+
+/* longest county code (and the 0 after it) */
+#define CROP_CODE_SIZE 32
+
+/* a run of columns of a row of the image inside a county */
+typedef struct
+{
+    int first, last;		/* first and last column */
+}
+CropSpan;
+
+/* a county, and the window of the image it's cropped to */
+typedef struct
+{
+    char code[CROP_CODE_SIZE];	/* county code (e.g. FIPS), which names
+				   its output files */
+    int record;			/* shape of the county in the shapefile */
+    int first_row, last_row;	/* rows of the window */
+    int first_col, last_col;	/* columns of the window (first_row >
+				   last_row if the county is off the image) */
+    int *row_spans;		/* first span of each row of the window,
+				   and the end of the spans after them */
+    CropSpan *spans;		/* runs of the window inside the county */
+    FileDescriptor *output;	/* output file of the band being cropped */
+}
+CropCounty;
+
+/* Local Prototypes */
+int ReadCropCounties
+(
+    ShapeIndex *index,         /* I: county shapes by code */
+    char *list_filename,       /* I: file of county codes, or NULL for all
+                                     the counties */
+    CropCounty **counties,     /* O: the counties */
+    int *ncounties             /* O: number of counties */
+);
+
+int RasterizeCounties
+(
+    ModisDescriptor *modis,    /* I: session info */
+    FileDescriptor *input,     /* I: band of the image */
+    ShapeFile *shape,          /* I: county shapes */
+    ShapeIndex *index,         /* I: county shapes by location */
+    CropCounty counties[],     /* I/O: the counties, with their windows and
+                                       spans set for the band's grid */
+    int ncounties              /* I: number of counties */
+);
+
+void FreeCountySpans
+(
+    CropCounty counties[],     /* I/O: the counties */
+    int ncounties              /* I: number of counties */
+);
+
+int CropBand
+(
+    ModisDescriptor *modis,    /* I: session info */
+    FileDescriptor *input,     /* I: band of the image */
+    int band,                  /* I: band number */
+    CropCounty counties[],     /* I/O: the counties */
+    int ncounties,             /* I: number of counties */
+    char *output_dir           /* I: directory for the band's output files */
+);
+
+int StatsBand
+(
+    ModisDescriptor *modis,    /* I: session info */
+    FileDescriptor *input,     /* I: band of the image */
+    int band,                  /* I: band number */
+    CropCounty counties[],     /* I: the counties */
+    int ncounties,             /* I: number of counties */
+    ZonalTable *zonal          /* I/O: statistics of the counties */
+);
+
+#endif /* _CROP_H_ */
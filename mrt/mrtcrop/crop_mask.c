@@ -0,0 +1,671 @@
+/******************************************************************************
+
+FILE:  crop_mask.c
+
+PURPOSE:  Find the counties to crop, and rasterize them to the image grid
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+         10/26                         Use the shape index
+
+HARDWARE AND/OR SOFTWARE LIMITATIONS:
+  None
+
+PROJECT:    MODIS Reprojection Tool
+
+NOTES:
+  The county polygons are lat/long.  Their points are projected to the
+  image, and each county is turned into the runs of image pixels whose
+  centers are inside it (the even-odd rule, so holes and islands work) for
+  every row of its bounding window.  The window is what the county is
+  cropped to, and the pixels of the window that aren't in a run are
+  background fill.  The shape index finds the counties by code, and
+  leaves out the counties that can't be on the image before their points
+  are read.
+
+******************************************************************************/
+#include <math.h>
+#include "crop.h"
+#include "worgen.h"
+#include "cproj.h"
+
+/* points projected along each edge of the image to find its lat/long
+   bounds, and the margin added around them (degrees) */
+#define CROP_EDGE_POINTS 64
+#define CROP_GEO_MARGIN 0.5
+
+static int GetImageGeoBounds( ModisDescriptor *modis, FileDescriptor *input,
+    GctpXform *to_image, double bounds[4] );
+static int CompareCountyCodes( const void *a, const void *b );
+static int CompareDoubles( const void *a, const void *b );
+static int RasterizeCounty( CropCounty *county, ShapePolygon *polygon,
+    int nrows, int ncols, double *crossings );
+
+/******************************************************************************
+
+MODULE:  ReadCropCounties
+
+PURPOSE:  Find the shapes of the counties to be cropped
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+CROP_SUCCESS    Success
+CROP_ERROR      Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The list file has county codes separated by white space.  A code that
+  isn't in the shapefile is reported and left out.  Without a list, every
+  shape with a code is a county.  The counties are in code order.
+
+******************************************************************************/
+int ReadCropCounties
+(
+    ShapeIndex *index,         /* I: county shapes by code */
+    char *list_filename,       /* I: file of county codes, or NULL for all
+                                     the counties */
+    CropCounty **counties,     /* O: the counties */
+    int *ncounties             /* O: number of counties */
+)
+
+{
+    FILE *list = NULL;               /* the list file */
+    CropCounty *c = NULL;            /* the counties */
+    char code[CROP_CODE_SIZE];       /* code in the list or shapefile */
+    char errmsg[LARGE_STRING];       /* error message */
+    char *key;                       /* code of a shape */
+    int nalloc;                      /* room for this many counties */
+    int n = 0;                       /* number of counties */
+    int i, j;
+
+    *counties = NULL;
+    *ncounties = 0;
+
+    if ( list_filename )
+    {
+        list = fopen( list_filename, "r" );
+        if ( !list )
+        {
+            sprintf( errmsg, "Unable to open %s", list_filename );
+            ErrorHandler( FALSE, "ReadCropCounties", ERROR_GENERAL, errmsg );
+            return CROP_ERROR;
+        }
+    }
+
+    nalloc = list ? 64 : index->nrecords;
+    c = ( CropCounty * ) calloc( nalloc > 0 ? nalloc : 1,
+        sizeof( CropCounty ) );
+    if ( !c )
+    {
+        if ( list )
+            fclose( list );
+        ErrorHandler( FALSE, "ReadCropCounties", ERROR_MEMORY, "Counties" );
+        return CROP_ERROR;
+    }
+
+    if ( list )
+    {
+        /* look up each listed code */
+        while ( fscanf( list, "%31s", code ) == 1 )
+        {
+            if ( n == nalloc )
+            {
+                CropCounty *more = ( CropCounty * ) realloc( c, 2 * nalloc *
+                    sizeof( CropCounty ) );
+                if ( !more )
+                {
+                    free( c );
+                    fclose( list );
+                    ErrorHandler( FALSE, "ReadCropCounties", ERROR_MEMORY,
+                        "Counties" );
+                    return CROP_ERROR;
+                }
+                c = more;
+                nalloc *= 2;
+            }
+            memset( &c[n], 0, sizeof( CropCounty ) );
+            strcpy( c[n].code, code );
+            c[n].record = FindShapeRecord( index, code );
+            if ( c[n].record >= 0 )
+                n++;
+            else
+            {
+                sprintf( errmsg, "County %s is not in the shapefile", code );
+                ErrorHandler( FALSE, "ReadCropCounties", ERROR_GENERAL,
+                    errmsg );
+            }
+        }
+        fclose( list );
+
+        /* without duplicates */
+        qsort( c, n, sizeof( CropCounty ), CompareCountyCodes );
+        for ( i = j = 0; i < n; i++ )
+            if ( j == 0 || strcmp( c[i].code, c[j - 1].code ) )
+                c[j++] = c[i];
+        n = j;
+    }
+    else
+    {
+        /* every shape with a code */
+        for ( i = 0; i < index->nrecords; i++ )
+        {
+            key = &index->keys[i * index->key_size];
+            if ( key[0] == '\0' || strlen( key ) >= CROP_CODE_SIZE ||
+                 FindShapeRecord( index, key ) != i )
+                continue;
+            strcpy( c[n].code, key );
+            c[n].record = i;
+            n++;
+        }
+        qsort( c, n, sizeof( CropCounty ), CompareCountyCodes );
+    }
+
+    /* no windows until the counties are rasterized */
+    for ( i = 0; i < n; i++ )
+    {
+        c[i].first_row = c[i].first_col = 0;
+        c[i].last_row = c[i].last_col = -1;
+    }
+
+    *counties = c;
+    *ncounties = n;
+    return CROP_SUCCESS;
+}
+
+/******************************************************************************
+
+MODULE:  RasterizeCounties
+
+PURPOSE:  Set the window and runs of each county for the grid of a band
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+n               Number of counties on the image
+-1              Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The county points are projected to the image with GCTP directly (no
+  datum conversion), the way the resampler maps lat/long without one.  A
+  county with a point that can't be projected is left off the image.
+
+******************************************************************************/
+int RasterizeCounties
+(
+    ModisDescriptor *modis,    /* I: session info */
+    FileDescriptor *input,     /* I: band of the image */
+    ShapeFile *shape,          /* I: county shapes */
+    ShapeIndex *index,         /* I: county shapes by location */
+    CropCounty counties[],     /* I/O: the counties, with their windows and
+                                       spans set for the band's grid */
+    int ncounties              /* I: number of counties */
+)
+
+{
+    ProjInfo *inproj = modis->in_projection_info;  /* image projection */
+    GctpXform xform;              /* lat/long to image transformation */
+    double geo_coef[NUM_PROJECTION_PARAMS];  /* lat/long parameters */
+    double ulx, uly;              /* UL extent of the image */
+    double *crossings = NULL;     /* where a row crosses a county's edges */
+    long *pstatus = NULL;         /* projection status of each point */
+    char *nearby = NULL;          /* shapes that may be on the image */
+    int *records = NULL;          /* shapes found in the index */
+    double bounds[4];             /* lat/long bounds of the image */
+    int nfound;                   /* shapes found in the index */
+    int maxpoints = 0;            /* room in crossings and pstatus */
+    int ninside = 0;              /* counties on the image */
+    char errmsg[SMALL_STRING];    /* error message */
+    ShapePolygon *polygon;        /* a county */
+    int i, p;
+
+    memset( geo_coef, 0, sizeof( geo_coef ) );
+    if ( gctp_call_init( &xform, GEO, 0, -1, geo_coef, DEGREE,
+            inproj->proj_code, inproj->zone_code, -1, inproj->proj_coef,
+            inproj->units ) != E_GEO_SUCC )
+        return ( -1 );
+
+    ulx = input->coord_corners[UL][0];
+    uly = input->coord_corners[UL][1];
+
+    /* the counties that can be on the image */
+    nearby = ( char * ) calloc( index->nrecords + 1, 1 );
+    records = ( int * ) malloc( ( index->nleaves + 1 ) * sizeof( int ) );
+    if ( !nearby || !records )
+        ErrorHandler( TRUE, "RasterizeCounties", ERROR_MEMORY,
+            "County search" );
+    if ( GetImageGeoBounds( modis, input, &xform, bounds ) )
+    {
+        nfound = SearchShapeIndex( index, bounds, records );
+        if ( nfound < 0 )
+        {
+            gctp_call_free( &xform );
+            free( nearby );
+            free( records );
+            return ( -1 );
+        }
+        for ( i = 0; i < nfound; i++ )
+            nearby[records[i]] = 1;
+    }
+    else
+        memset( nearby, 1, index->nrecords );
+    free( records );
+
+    for ( i = 0; i < ncounties; i++ )
+    {
+        CropCounty *c = &counties[i];
+
+        free( c->row_spans );
+        free( c->spans );
+        c->row_spans = NULL;
+        c->spans = NULL;
+        c->first_row = c->first_col = 0;
+        c->last_row = c->last_col = -1;
+        if ( !nearby[c->record] )
+            continue;
+
+        polygon = ReadShapePolygon( shape, c->record );
+        if ( !polygon )
+        {
+            gctp_call_free( &xform );
+            free( crossings );
+            free( pstatus );
+            free( nearby );
+            return ( -1 );
+        }
+
+        if ( polygon->npoints > maxpoints )
+        {
+            free( crossings );
+            free( pstatus );
+            maxpoints = polygon->npoints;
+            crossings = ( double * ) malloc( maxpoints * sizeof( double ) );
+            pstatus = ( long * ) malloc( maxpoints * sizeof( long ) );
+            if ( !crossings || !pstatus )
+                ErrorHandler( TRUE, "RasterizeCounties", ERROR_MEMORY,
+                    "County crossings" );
+        }
+
+        /* the points in image pixels */
+        gctp_call_xform_array( &xform, polygon->npoints, polygon->x,
+            polygon->y, polygon->x, polygon->y, pstatus );
+        for ( p = 0; p < polygon->npoints; p++ )
+        {
+            if ( pstatus[p] != E_GEO_SUCC )
+                break;
+            polygon->x[p] = ( polygon->x[p] - ulx ) / input->pixel_size;
+            polygon->y[p] = ( uly - polygon->y[p] ) / input->pixel_size;
+        }
+
+        if ( p < polygon->npoints )
+        {
+            sprintf( errmsg, "County %s can't be projected to the image",
+                c->code );
+            ErrorHandler( FALSE, "RasterizeCounties", ERROR_GENERAL, errmsg );
+        }
+        else if ( polygon->npoints > 0 &&
+                  !RasterizeCounty( c, polygon, ( int ) input->nrows,
+                      ( int ) input->ncols, crossings ) )
+        {
+            FreeShapePolygon( polygon );
+            gctp_call_free( &xform );
+            free( crossings );
+            free( pstatus );
+            free( nearby );
+            return ( -1 );
+        }
+
+        if ( c->first_row <= c->last_row )
+            ninside++;
+        FreeShapePolygon( polygon );
+    }
+
+    gctp_call_free( &xform );
+    free( crossings );
+    free( pstatus );
+    free( nearby );
+
+    return ( ninside );
+}
+
+/******************************************************************************
+
+MODULE:  GetImageGeoBounds
+
+PURPOSE:  Find the lat/long bounds of the image
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            Success
+FALSE           The bounds can't be found (no edge of the image is on
+                the earth)
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The bounds are those of points along the edges of the image, with a
+  margin for the edges bulging between the points.  If a pole is on the
+  image, the bounds take in all longitudes up to the pole.  An image
+  across the 180th meridian gets all longitudes too, since its edge
+  points are at both ends.
+
+******************************************************************************/
+static int GetImageGeoBounds
+(
+    ModisDescriptor *modis,    /* I: session info */
+    FileDescriptor *input,     /* I: band of the image */
+    GctpXform *to_image,       /* I: lat/long to image transformation */
+    double bounds[4]           /* O: west, south, east, north (degrees) */
+)
+
+{
+    ProjInfo *inproj = modis->in_projection_info;  /* image projection */
+    GctpXform to_geo;             /* image to lat/long transformation */
+    double geo_coef[NUM_PROJECTION_PARAMS];  /* lat/long parameters */
+    double ulx, uly, lrx, lry;    /* extent of the image */
+    double x[4], y[4];            /* a point on each edge */
+    double lon, lat;              /* a point in lat/long */
+    double t;                     /* how far along the edges */
+    int found = FALSE;            /* any points on the earth? */
+    int i, e;
+
+    ulx = input->coord_corners[UL][0];
+    uly = input->coord_corners[UL][1];
+    lrx = ulx + input->ncols * input->pixel_size;
+    lry = uly - input->nrows * input->pixel_size;
+
+    memset( geo_coef, 0, sizeof( geo_coef ) );
+    if ( gctp_call_init( &to_geo, inproj->proj_code, inproj->zone_code, -1,
+            inproj->proj_coef, inproj->units, GEO, 0, -1, geo_coef,
+            DEGREE ) != E_GEO_SUCC )
+        return ( FALSE );
+
+    for ( i = 0; i <= CROP_EDGE_POINTS; i++ )
+    {
+        t = ( double ) i / CROP_EDGE_POINTS;
+        x[0] = x[1] = ulx + t * ( lrx - ulx );
+        y[0] = uly;
+        y[1] = lry;
+        x[2] = ulx;
+        x[3] = lrx;
+        y[2] = y[3] = uly + t * ( lry - uly );
+
+        for ( e = 0; e < 4; e++ )
+        {
+            if ( gctp_call_xform( &to_geo, x[e], y[e], &lon, &lat ) !=
+                 E_GEO_SUCC )
+                continue;
+            if ( !found )
+            {
+                bounds[0] = bounds[2] = lon;
+                bounds[1] = bounds[3] = lat;
+                found = TRUE;
+            }
+            if ( lon < bounds[0] ) bounds[0] = lon;
+            if ( lat < bounds[1] ) bounds[1] = lat;
+            if ( lon > bounds[2] ) bounds[2] = lon;
+            if ( lat > bounds[3] ) bounds[3] = lat;
+        }
+    }
+    gctp_call_free( &to_geo );
+    if ( !found )
+        return ( FALSE );
+
+    bounds[0] -= CROP_GEO_MARGIN;
+    bounds[1] -= CROP_GEO_MARGIN;
+    bounds[2] += CROP_GEO_MARGIN;
+    bounds[3] += CROP_GEO_MARGIN;
+
+    /* a pole on the image */
+    for ( e = -1; e <= 1; e += 2 )
+    {
+        if ( gctp_call_xform( to_image, 0.0, e * 90.0, &lon, &lat ) ==
+             E_GEO_SUCC && lon >= ulx && lon <= lrx && lat >= lry &&
+             lat <= uly )
+        {
+            bounds[0] = -180.0;
+            bounds[2] = 180.0;
+            bounds[e < 0 ? 1 : 3] = e * 90.0;
+        }
+    }
+
+    return ( TRUE );
+}
+
+/******************************************************************************
+
+MODULE:  RasterizeCounty
+
+PURPOSE:  Set the window and runs of a county from its polygon in image
+          pixels
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            Success
+FALSE           Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Pixel (row, col) covers [col, col + 1) x [row, row + 1) in the polygon's
+  coordinates, so it's in the county if (col + 0.5, row + 0.5) is.  The
+  window is the pixels whose centers are in the polygon's bounding box,
+  clipped to the image.  A window with no runs is kept (it's background
+  fill), as gdalwarp -crop_to_cutline would.
+
+******************************************************************************/
+static int RasterizeCounty
+(
+    CropCounty *county,        /* I/O: county */
+    ShapePolygon *polygon,     /* I: the county in image pixels */
+    int nrows,                 /* I: rows in the image */
+    int ncols,                 /* I: columns in the image */
+    double *crossings          /* I: room for a crossing for each point */
+)
+
+{
+    double xmin, xmax, ymin, ymax;   /* bounding box */
+    double yc;                       /* center of the row */
+    int nspans = 0;                  /* runs so far */
+    int maxspans = 0;                /* room for runs */
+    int ncross;                      /* crossings of the row */
+    int row, first, last;            /* row, and columns of a run */
+    int part, p, q, k;
+
+    xmin = xmax = polygon->x[0];
+    ymin = ymax = polygon->y[0];
+    for ( p = 1; p < polygon->npoints; p++ )
+    {
+        if ( polygon->x[p] < xmin ) xmin = polygon->x[p];
+        if ( polygon->x[p] > xmax ) xmax = polygon->x[p];
+        if ( polygon->y[p] < ymin ) ymin = polygon->y[p];
+        if ( polygon->y[p] > ymax ) ymax = polygon->y[p];
+    }
+
+    /* off the image? */
+    if ( xmax <= 0.5 || ymax <= 0.5 || xmin >= ncols - 0.5 ||
+         ymin >= nrows - 0.5 )
+        return ( TRUE );
+
+    county->first_col = ( int ) ceil( xmin - 0.5 );
+    county->last_col = ( int ) ceil( xmax - 0.5 ) - 1;
+    county->first_row = ( int ) ceil( ymin - 0.5 );
+    county->last_row = ( int ) ceil( ymax - 0.5 ) - 1;
+    if ( county->first_col < 0 ) county->first_col = 0;
+    if ( county->last_col > ncols - 1 ) county->last_col = ncols - 1;
+    if ( county->first_row < 0 ) county->first_row = 0;
+    if ( county->last_row > nrows - 1 ) county->last_row = nrows - 1;
+    if ( county->first_col > county->last_col ||
+         county->first_row > county->last_row )
+    {
+        county->first_row = county->first_col = 0;
+        county->last_row = county->last_col = -1;
+        return ( TRUE );
+    }
+
+    county->row_spans = ( int * ) malloc( ( county->last_row -
+        county->first_row + 2 ) * sizeof( int ) );
+    if ( !county->row_spans )
+    {
+        ErrorHandler( FALSE, "RasterizeCounty", ERROR_MEMORY, "County rows" );
+        return ( FALSE );
+    }
+
+    for ( row = county->first_row; row <= county->last_row; row++ )
+    {
+        county->row_spans[row - county->first_row] = nspans;
+        yc = row + 0.5;
+
+        /* where each edge of each ring crosses the center of the row */
+        ncross = 0;
+        for ( part = 0; part < polygon->nparts; part++ )
+        {
+            for ( p = polygon->parts[part]; p < polygon->parts[part + 1]; p++ )
+            {
+                q = p + 1 < polygon->parts[part + 1] ? p + 1 :
+                    polygon->parts[part];
+                if ( ( polygon->y[p] <= yc ) == ( polygon->y[q] <= yc ) )
+                    continue;
+                crossings[ncross++] = polygon->x[p] + ( yc - polygon->y[p] ) *
+                    ( polygon->x[q] - polygon->x[p] ) /
+                    ( polygon->y[q] - polygon->y[p] );
+            }
+        }
+        qsort( crossings, ncross, sizeof( double ), CompareDoubles );
+
+        /* every other pair of crossings is inside */
+        for ( k = 0; k + 1 < ncross; k += 2 )
+        {
+            first = ( int ) ceil( crossings[k] - 0.5 );
+            last = ( int ) ceil( crossings[k + 1] - 0.5 ) - 1;
+            if ( first < county->first_col ) first = county->first_col;
+            if ( last > county->last_col ) last = county->last_col;
+            if ( first > last )
+                continue;
+
+            if ( nspans == maxspans )
+            {
+                CropSpan *more;
+
+                maxspans = maxspans ? 2 * maxspans : 64;
+                more = ( CropSpan * ) realloc( county->spans, maxspans *
+                    sizeof( CropSpan ) );
+                if ( !more )
+                {
+                    ErrorHandler( FALSE, "RasterizeCounty", ERROR_MEMORY,
+                        "County runs" );
+                    return ( FALSE );
+                }
+                county->spans = more;
+            }
+            county->spans[nspans].first = first;
+            county->spans[nspans].last = last;
+            nspans++;
+        }
+    }
+    county->row_spans[county->last_row - county->first_row + 1] = nspans;
+
+    return ( TRUE );
+}
+
+/******************************************************************************
+
+MODULE:  FreeCountySpans
+
+PURPOSE:  Free the runs of the counties
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+
+******************************************************************************/
+void FreeCountySpans
+(
+    CropCounty counties[],     /* I/O: the counties */
+    int ncounties              /* I: number of counties */
+)
+
+{
+    int i;
+
+    for ( i = 0; i < ncounties; i++ )
+    {
+        free( counties[i].row_spans );
+        free( counties[i].spans );
+        counties[i].row_spans = NULL;
+        counties[i].spans = NULL;
+    }
+}
+
+/******************************************************************************
+
+MODULE:  CompareCountyCodes, CompareDoubles
+
+PURPOSE:  qsort and bsearch comparisons
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+<0, 0, >0       a is before, the same as, or after b
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+
+******************************************************************************/
+static int CompareCountyCodes
+(
+    const void *a,
+    const void *b
+)
+
+{
+    return ( strcmp( ( ( const CropCounty * ) a )->code,
+        ( ( const CropCounty * ) b )->code ) );
+}
+
+static int CompareDoubles
+(
+    const void *a,
+    const void *b
+)
+
+{
+    double da = *( const double * ) a;
+    double db = *( const double * ) b;
+
+    return ( da < db ? -1 : da > db ? 1 : 0 );
+}
@@ -0,0 +1,443 @@
+/******************************************************************************
+
+FILE:  crop_rows.c
+
+PURPOSE:  Crop a band of the image to all the counties in one pass
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+         10/26                         Added the zonal statistics of a band
+                                       (StatsBand)
+         10/26                         Remove the partly written counties
+                                       when CropBand fails
+
+HARDWARE AND/OR SOFTWARE LIMITATIONS:
+  The output files of all the counties a row crosses are open at once.
+
+PROJECT:    MODIS Reprojection Tool
+
+NOTES:
+  The rows of the band are read once, from the first row of the top county
+  to the last row of the bottom one.  A county's GeoTIFF is opened when the
+  rows reach its window and closed after the last row of its window, and
+  each row read is copied, a run at a time, into the rows of all the
+  counties it crosses.  Rows that no county crosses are never read.
+
+  StatsBand makes the same pass, but adds the runs to the statistics of
+  the counties instead of writing them, so nothing is written but the
+  table.
+
+******************************************************************************/
+#include "crop.h"
+
+static int CompareFirstRows( const void *a, const void *b );
+static FileDescriptor *OpenCountyOutput( ModisDescriptor *modis,
+    FileDescriptor *input, int band, CropCounty *county, char *output_dir );
+
+/******************************************************************************
+
+MODULE:  CropBand
+
+PURPOSE:  Write a band of the image cropped to each county
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+status          See mrt_error.h for a complete list of error codes
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+         10/26                         Clean up after an error
+
+NOTES:
+  The counties must have been rasterized to the band's grid
+  (RasterizeCounties).  Each county's output is output_dir/<code>.<band
+  name>.tif, in the image's data type and projection.
+
+  If a county can't be opened or a row can't be read or written, the
+  counties still open are closed and removed, since they're only partly
+  written.  The counties already finished are kept.
+
+******************************************************************************/
+int CropBand
+(
+    ModisDescriptor *modis,    /* I: session info */
+    FileDescriptor *input,     /* I: band of the image */
+    int band,                  /* I: band number */
+    CropCounty counties[],     /* I/O: the counties */
+    int ncounties,             /* I: number of counties */
+    char *output_dir           /* I: directory for the band's output files */
+)
+
+{
+    CropCounty **order = NULL;     /* counties on the image, top down */
+    CropCounty **active = NULL;    /* counties crossing the row */
+    int norder = 0;                /* counties on the image */
+    int nactive = 0;               /* counties crossing the row */
+    int next = 0;                  /* next county to reach */
+    int maxcols = 0;               /* widest window */
+    void *background = NULL;       /* a window row of background fill */
+    void *outrow = NULL;           /* a row of a county */
+    double *fill = NULL;           /* background fill, for converting */
+    char *inrow;                   /* the row of the band */
+    char *partial;                 /* name of a partly written county */
+    char errmsg[SMALL_STRING];     /* error message */
+    size_t ds = input->datasize;   /* bytes in a pixel */
+    int status = MRT_NO_ERROR;     /* error status */
+    int row, i, s;
+
+    for ( i = 0; i < ncounties; i++ )
+        if ( counties[i].first_row <= counties[i].last_row &&
+             counties[i].last_col - counties[i].first_col + 1 > maxcols )
+            maxcols = counties[i].last_col - counties[i].first_col + 1;
+
+    order = ( CropCounty ** ) malloc( ( ncounties + 1 ) *
+        sizeof( CropCounty * ) );
+    active = ( CropCounty ** ) malloc( ( ncounties + 1 ) *
+        sizeof( CropCounty * ) );
+    background = malloc( ( maxcols + 1 ) * ds );
+    outrow = malloc( ( maxcols + 1 ) * ds );
+    fill = ( double * ) malloc( ( maxcols + 1 ) * sizeof( double ) );
+    if ( !order || !active || !background || !outrow || !fill )
+        ErrorHandler( TRUE, "CropBand", ERROR_MEMORY, "Crop buffers" );
+
+    /* background fill in the band's data type */
+    if ( !SelectRowConverters( input ) )
+        ErrorHandler( TRUE, "CropBand", ERROR_GENERAL, "Bad data type" );
+    for ( i = 0; i < maxcols; i++ )
+        fill[i] = input->background_fill;
+    input->write_convert( fill, background, maxcols );
+    free( fill );
+
+    for ( i = 0; i < ncounties; i++ )
+        if ( counties[i].first_row <= counties[i].last_row )
+            order[norder++] = &counties[i];
+    qsort( order, norder, sizeof( CropCounty * ), CompareFirstRows );
+
+    MessageHandler( "CropBand", "cropping band %s to %d counties",
+        modis->bandinfo[band].name, norder );
+
+    row = 0;
+    while ( status == MRT_NO_ERROR && ( next < norder || nactive > 0 ) )
+    {
+        /* skip to the next county if no county crosses the row */
+        if ( nactive == 0 && order[next]->first_row > row )
+            row = order[next]->first_row;
+
+        while ( next < norder && order[next]->first_row == row )
+        {
+            order[next]->output = OpenCountyOutput( modis, input, band,
+                order[next], output_dir );
+            if ( !order[next]->output )
+            {
+                sprintf( errmsg, "Unable to open the output of county %s",
+                    order[next]->code );
+                ErrorHandler( FALSE, "CropBand", ERROR_OPEN_OUTPUTIMAGE,
+                    errmsg );
+                status = ERROR_OPEN_OUTPUTIMAGE;
+                break;
+            }
+            active[nactive++] = order[next++];
+        }
+        if ( status != MRT_NO_ERROR )
+            break;
+
+        if ( !ReadRowNative( input, row ) )
+        {
+            ErrorHandler( FALSE, "CropBand", ERROR_READ_INPUTIMAGE,
+                "Error reading the input image" );
+            status = ERROR_READ_INPUTIMAGE;
+            break;
+        }
+        inrow = ( char * ) input->rowbuffer;
+
+        for ( i = 0; i < nactive; i++ )
+        {
+            CropCounty *c = active[i];
+            int r = row - c->first_row;
+
+            memcpy( outrow, background, ( c->last_col - c->first_col + 1 ) *
+                ds );
+            for ( s = c->row_spans[r]; s < c->row_spans[r + 1]; s++ )
+                memcpy( ( char * ) outrow + ( c->spans[s].first -
+                    c->first_col ) * ds, inrow + c->spans[s].first * ds,
+                    ( c->spans[s].last - c->spans[s].first + 1 ) * ds );
+
+            if ( !WriteRowNative( c->output, r, outrow ) )
+            {
+                sprintf( errmsg, "Error writing county %s", c->code );
+                ErrorHandler( FALSE, "CropBand", ERROR_WRITE_OUTPUTIMAGE,
+                    errmsg );
+                status = ERROR_WRITE_OUTPUTIMAGE;
+                break;
+            }
+
+            /* done with the county? */
+            if ( row == c->last_row )
+            {
+                CloseFile( c->output );
+                c->output = NULL;
+                active[i--] = active[--nactive];
+            }
+        }
+
+        row++;
+    }
+
+    /* after an error, the counties still open are only partly written */
+    for ( i = 0; i < nactive; i++ )
+    {
+        partial = strdup( active[i]->output->filename );
+        CloseFile( active[i]->output );
+        active[i]->output = NULL;
+        if ( partial )
+        {
+            remove( partial );
+            free( partial );
+        }
+    }
+
+    free( order );
+    free( active );
+    free( background );
+    free( outrow );
+
+    return ( status );
+}
+
+/******************************************************************************
+
+MODULE:  StatsBand
+
+PURPOSE:  Add the pixels of a band in each county to the county's zonal
+          statistics
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+status          See mrt_error.h for a complete list of error codes
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development (from CropBand)
+         10/26                         Return a read error to CropImage
+
+NOTES:
+  The counties must have been rasterized to the band's grid
+  (RasterizeCounties), and zone i of the table is counties[i].
+
+  A row that can't be read stops the pass with ERROR_READ_INPUTIMAGE; the
+  table is then only partly filled, and mrtcrop doesn't write it.
+
+******************************************************************************/
+int StatsBand
+(
+    ModisDescriptor *modis,    /* I: session info */
+    FileDescriptor *input,     /* I: band of the image */
+    int band,                  /* I: band number */
+    CropCounty counties[],     /* I: the counties */
+    int ncounties,             /* I: number of counties */
+    ZonalTable *zonal          /* I/O: statistics of the counties */
+)
+
+{
+    CropCounty **order = NULL;     /* counties on the image, top down */
+    CropCounty **active = NULL;    /* counties crossing the row */
+    int norder = 0;                /* counties on the image */
+    int nactive = 0;               /* counties crossing the row */
+    int next = 0;                  /* next county to reach */
+    ZonalBand *stats;              /* statistics of the band */
+    double *inrow;                 /* the row of the band */
+    int status = MRT_NO_ERROR;     /* error status */
+    int row, i, s;
+
+    stats = AddZonalBand( zonal, modis->bandinfo[band].name,
+        input->background_fill, modis->bandinfo[band].min_value,
+        modis->bandinfo[band].max_value );
+    order = ( CropCounty ** ) malloc( ( ncounties + 1 ) *
+        sizeof( CropCounty * ) );
+    active = ( CropCounty ** ) malloc( ( ncounties + 1 ) *
+        sizeof( CropCounty * ) );
+    inrow = ( double * ) malloc( ( input->ncols + 1 ) * sizeof( double ) );
+    if ( !stats || !order || !active || !inrow )
+        ErrorHandler( TRUE, "StatsBand", ERROR_MEMORY, "Zonal buffers" );
+
+    for ( i = 0; i < ncounties; i++ )
+        if ( counties[i].first_row <= counties[i].last_row )
+            order[norder++] = &counties[i];
+    qsort( order, norder, sizeof( CropCounty * ), CompareFirstRows );
+
+    MessageHandler( "StatsBand", "zonal statistics of band %s in %d "
+        "counties", modis->bandinfo[band].name, norder );
+
+    row = 0;
+    while ( status == MRT_NO_ERROR && ( next < norder || nactive > 0 ) )
+    {
+        /* skip to the next county if no county crosses the row */
+        if ( nactive == 0 && order[next]->first_row > row )
+            row = order[next]->first_row;
+
+        while ( next < norder && order[next]->first_row == row )
+            active[nactive++] = order[next++];
+
+        if ( !ReadRow( input, row, inrow ) )
+        {
+            ErrorHandler( FALSE, "StatsBand", ERROR_READ_INPUTIMAGE,
+                "Error reading the input image" );
+            status = ERROR_READ_INPUTIMAGE;
+            break;
+        }
+
+        for ( i = 0; i < nactive; i++ )
+        {
+            CropCounty *c = active[i];
+            int r = row - c->first_row;
+
+            for ( s = c->row_spans[r]; s < c->row_spans[r + 1]; s++ )
+                AccumulateZonalRun( stats, ( int ) ( c - counties ),
+                    &inrow[c->spans[s].first],
+                    c->spans[s].last - c->spans[s].first + 1 );
+
+            /* done with the county? */
+            if ( row == c->last_row )
+                active[i--] = active[--nactive];
+        }
+
+        row++;
+    }
+
+    free( order );
+    free( active );
+    free( inrow );
+
+    return ( status );
+}
+
+/******************************************************************************
+
+MODULE:  OpenCountyOutput
+
+PURPOSE:  Open and initialize the GeoTIFF of a county's window of a band
+
+RETURN VALUE:
+Type = FileDescriptor *
+Value           Description
+-----           -----------
+output          The output file
+NULL            Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+         10/26                         Check the name for truncation
+
+NOTES:
+  The output is set up the way NoResample sets up a spatial subset of the
+  input: the corners are the window's, in the image projection.
+
+  OpenGeoTIFFFile builds <name>.<band name>.tif in a LARGE_STRING buffer,
+  so a name that wouldn't fit there is an error.
+
+******************************************************************************/
+static FileDescriptor *OpenCountyOutput
+(
+    ModisDescriptor *modis,    /* I: session info */
+    FileDescriptor *input,     /* I: band of the image */
+    int band,                  /* I: band number */
+    CropCounty *county,        /* I: county */
+    char *output_dir           /* I: directory for the output file */
+)
+
+{
+    FileDescriptor *output;        /* the output file */
+    char filename[LARGE_STRING];   /* output base name */
+    double ulx = input->coord_corners[UL][0];   /* UL extent of the image */
+    double uly = input->coord_corners[UL][1];
+    double ps = input->pixel_size;
+    int status = MRT_NO_ERROR;
+    int n;                         /* length of the name */
+
+    /* OpenGeoTIFFFile adds the band name */
+    n = snprintf( filename, sizeof( filename ), "%s/%s", output_dir,
+        county->code );
+    if ( n < 0 || n + strlen( modis->bandinfo[band].name ) + sizeof( "..tif" )
+        > sizeof( filename ) )
+    {
+        ErrorHandler( FALSE, "OpenCountyOutput", ERROR_GENERAL,
+            "Output file name is too long" );
+        return ( NULL );
+    }
+    modis->output_filename = filename;
+    output = OpenOutImage( modis, band, &status );
+    modis->output_filename = NULL;
+    if ( !output )
+        return ( NULL );
+
+    output->nrows = county->last_row - county->first_row + 1;
+    output->ncols = county->last_col - county->first_col + 1;
+    output->coord_corners[UL][0] = ulx + county->first_col * ps;
+    output->coord_corners[UL][1] = uly - county->first_row * ps;
+    output->coord_corners[UR][0] = ulx + ( county->last_col + 1 ) * ps;
+    output->coord_corners[UR][1] = output->coord_corners[UL][1];
+    output->coord_corners[LL][0] = output->coord_corners[UL][0];
+    output->coord_corners[LL][1] = uly - ( county->last_row + 1 ) * ps;
+    output->coord_corners[LR][0] = output->coord_corners[UR][0];
+    output->coord_corners[LR][1] = output->coord_corners[LL][1];
+
+    /* reallocate based on window */
+    free( output->rowbuffer );
+    output->rowbuffer = calloc( output->ncols, output->datasize );
+    if ( !output->rowbuffer )
+        ErrorHandler( TRUE, "OpenCountyOutput", ERROR_MEMORY,
+            "Error allocating memory for the output Row Buffer" );
+
+    status = InitOutputFile( input, output, modis );
+    if ( status != MRT_NO_ERROR )
+    {
+        CloseFile( output );
+        return ( NULL );
+    }
+
+    return ( output );
+}
+
+/******************************************************************************
+
+MODULE:  CompareFirstRows
+
+PURPOSE:  qsort comparison of the first rows of two counties
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+<0, 0, >0       a starts above, on the same row as, or below b
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+
+******************************************************************************/
+static int CompareFirstRows
+(
+    const void *a,
+    const void *b
+)
+
+{
+    const CropCounty *ca = *( CropCounty * const * ) a;
+    const CropCounty *cb = *( CropCounty * const * ) b;
+
+    return ( ca->first_row - cb->first_row );
+}
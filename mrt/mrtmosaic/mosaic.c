@@ -10,6 +10,22 @@ Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          03/02  Gail Schmidt           Original Development
          11/02  Gail Schmidt           Support SIN data in addition to ISIN
+         10/26                         Keep the HDF-EOS input files open
+                                       across bands (OpenMosaicInput)
+         10/26                         Copy whole tile rows in their own data
+                                       type (CopyMosaicRow)
+         10/26                         Added -threads to mosaic raw binary
+                                       tiles on several threads
+                                       (mosaic_strips.c)
+         10/26                         Added -v to write a virtual mosaic
+                                       header
+         10/26                         Added -tile_size and -deflate to tile
+                                       and compress HDF-EOS output fields
+         10/26                         Added -r and -l to read only the
+                                       tiles and lines of a list of regions
+                                       (mosaic_region.c)
+         10/26                         Added -batch to mosaic many sets of
+                                       tiles in one process
 
 HARDWARE AND/OR SOFTWARE LIMITATIONS:
   None
@@ -33,21 +49,50 @@ NOTES:  Only SIN and ISIN data products can be mosaicked, since it will be
 
 /* Local prototypes */
 static int ExpandEnvironment( char *line, size_t max_linelen );
+static void FreeMosaicJob( int num_infiles, MosaicDescriptor infiles[],
+    MosaicDescriptor *mosaicfile, int numv_tiles, int **tile_array );
+static int TakeIntSwitch( int *argc, char *argv[], char *name, int *value );
 static MRT_UINT64 EstimateFileSize( MosaicDescriptor *mosaicfile );
+static HdfEosFD *OpenMosaicInput( MosaicDescriptor infiles[], int num_infiles,
+    HdfEosFD **input_hdfptr, unsigned long *input_strip, unsigned long strip,
+    int curr_infile );
 int getInputFileNamesFromFile( FILE * ifile, char ***str, int *n );
 void freeInputFileNameList( char **filelist, int nfiles );
 
-int main
+/******************************************************************************
+
+MODULE:  RunMosaic
+
+PURPOSE:  Mosaic one set of tiles (the whole run, or one job of a batch
+    run)
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+EXIT_SUCCESS    Successful completion
+EXIT_FAILURE    Error in processing
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development (from main)
+
+NOTES:
+  The log file must already be open.
+
+******************************************************************************/
+static int RunMosaic
 (
-    int argc,
-    char *argv[]
+    int argc,                /* I: number of arguments */
+    char *argv[]             /* I: argument strings */
 )
 
 {
     int i, j;
     int num_infiles;         /* number of input files in the argument list */
     int numh_tiles;          /* number of horiz tiles in the mosaic */
-    int numv_tiles;          /* number of vert tiles in the mosaic */
+    int numv_tiles = 0;      /* number of vert tiles in the mosaic */
     int nspectral_bands;     /* number of spectral bands selected */
     int **tile_array = NULL; /* 2D array of size [numv_tiles][numh_tiles]
                                 specifying which input file represents
@@ -56,7 +101,17 @@ int main
     int determine_tiles;     /* does the user want the tiles of each file? */
     int write_tmphdr;        /* does the user want the mosaic info written
                                 to TmpHdr.hdr? */
+    int virtual_mosaic;      /* does the user want a virtual mosaic header
+                                instead of the mosaic? */
     int spectral_subset;     /* did the user specify spectral subsetting? */
+    int nthreads;            /* number of mosaic threads (-threads) */
+    int tile_size;           /* HDF-EOS output tile size (-tile_size) */
+    int deflate_level;       /* HDF-EOS output deflate level (-deflate) */
+    int nregions = 0;        /* number of regions (-r) */
+    double *regions = NULL;  /* box of each region in the projection of the
+                                tiles */
+    char *region_filename;   /* regions to cut the mosaic to (-r) */
+    char *list_filename;     /* codes of the regions (-l) */
     int status = MRT_NO_ERROR;   /* function return status */
     time_t startdate, enddate;  /* start and end date struct */
     char errmsg[SMALL_STRING];  /* error message string */
@@ -73,22 +128,20 @@ int main
     MosaicDescriptor mosaicfile;
                              /* file descriptor for the output mosaic file */
 
-    /* Set up a log file and process the -g command line option if it exists */
-    InitLogHandler( argc, argv );
-
     /* Get the starting date and time */
     startdate = time( NULL );
+    InitializeMosaicDescriptor( &mosaicfile );
 
     /* Check the command-line arguments and verify that all the required
        arguments were specified.  Also read the input filenames and the
        output filename. */
     if ( CheckMosaicArgs( argc, argv, input_filenames, &num_infiles,
         output_filename, bandstr, &determine_tiles, &write_tmphdr,
-        &spectral_subset ) != MOSAIC_SUCCESS )
+        &virtual_mosaic, &spectral_subset, &nthreads, &tile_size,
+        &deflate_level, &region_filename, &list_filename ) != MOSAIC_SUCCESS )
     {
         ErrorHandler( FALSE, "mosaic", ERROR_GENERAL,
             "Error processing the arguments for the mosaic tool" );
-        CloseLogHandler( );
         return EXIT_FAILURE;
     }
 
@@ -97,7 +150,6 @@ int main
     if ( determine_tiles )
     {
         ReadTiles( input_filenames, num_infiles );
-        CloseLogHandler( );
         return EXIT_SUCCESS;
     }
 
@@ -107,7 +159,6 @@ int main
     {
         ErrorHandler( FALSE, "mosaic", ERROR_GENERAL,
             "Error allocating memory for the MosaicDescriptors" );
-        CloseLogHandler( );
         return EXIT_FAILURE;
     }
 
@@ -150,7 +201,8 @@ int main
                     "so that the tile numbers can be known.\n",
                     infiles[i].filename );
                 ErrorHandler( FALSE, "mosaic", ERROR_GENERAL, errmsg );
-                CloseLogHandler( );
+                FreeMosaicJob( num_infiles, infiles, &mosaicfile,
+                    numv_tiles, tile_array );
                 return EXIT_FAILURE;
             }
         }
@@ -196,10 +248,28 @@ int main
     {
         ErrorHandler( FALSE, "mosaic", ERROR_GENERAL,
             "Error: The input files must be of the same data product" );
-        CloseLogHandler( );
+        FreeMosaicJob( num_infiles, infiles, &mosaicfile,
+            numv_tiles, tile_array );
         return EXIT_FAILURE;
     }
 
+    /* If -r was specified, then leave out the tiles none of the regions
+       touch */
+    if ( region_filename )
+    {
+        if ( ReadMosaicRegions( region_filename, list_filename, &infiles[0],
+            &regions, &nregions ) != MOSAIC_SUCCESS ||
+             PruneMosaicTiles( &num_infiles, infiles, input_filenames,
+            regions, &nregions ) != MOSAIC_SUCCESS )
+        {
+            ErrorHandler( FALSE, "mosaic", ERROR_GENERAL,
+                "Error cutting the mosaic to the regions" );
+            FreeMosaicJob( num_infiles, infiles, &mosaicfile,
+                numv_tiles, tile_array );
+            return EXIT_FAILURE;
+        }
+    }
+
     /* Determine the order of the input tiles to create the output image
        and create the mosaicfile descriptor */
     if ( SortProducts( num_infiles, infiles, output_filename, &mosaicfile,
@@ -207,10 +277,17 @@ int main
     {
         ErrorHandler( FALSE, "mosaic", ERROR_GENERAL,
             "Error: The input files must be of the same data product" );
-        CloseLogHandler( );
+        FreeMosaicJob( num_infiles, infiles, &mosaicfile,
+            numv_tiles, tile_array );
         return EXIT_FAILURE;
     }
 
+    /* A virtual mosaic is read by the resampler a tile at a time, so only
+       a real mosaic is cut to the lines of the regions */
+    if ( regions && !virtual_mosaic )
+        CutMosaicRows( &mosaicfile, regions, nregions );
+    free( regions );
+
 #ifdef DEBUG
     printf ("   filename - %s\n", mosaicfile.filename);
     printf ("   nbands   - %d\n", mosaicfile.nbands);
@@ -241,11 +318,13 @@ int main
     {
         if ( OutputHdrMosaic( &mosaicfile, "TmpHdr.hdr" ) != MOSAIC_SUCCESS )
         {
-            CloseLogHandler( );
+            FreeMosaicJob( num_infiles, infiles, &mosaicfile,
+                numv_tiles, tile_array );
             return EXIT_FAILURE;
         }
 
-        CloseLogHandler( );
+        FreeMosaicJob( num_infiles, infiles, &mosaicfile,
+            numv_tiles, tile_array );
         return EXIT_SUCCESS;
     }
 
@@ -276,6 +355,31 @@ int main
         MessageHandler( NULL, "%s", tmpstr );
     }
 
+    /* If -v was specified, then write the mosaic header with the list of
+       tiles.  The resampler reads the tiles as one image. */
+    if ( virtual_mosaic )
+    {
+        if ( OutputVirtualHdrMosaic( &mosaicfile, output_filename,
+            numh_tiles, numv_tiles, tile_array, infiles ) != MOSAIC_SUCCESS )
+        {
+            ErrorHandler( FALSE, "mosaic", ERROR_GENERAL,
+                "Error writing the virtual mosaic header" );
+            FreeMosaicJob( num_infiles, infiles, &mosaicfile,
+                numv_tiles, tile_array );
+            return EXIT_FAILURE;
+        }
+
+        enddate = time( NULL );
+        MessageHandler( NULL, "End Time:  %s", ctime( &enddate ) );
+        MessageHandler( NULL, "Finished writing the virtual mosaic %s!\n",
+            output_filename );
+        MessageHandler( NULL,"******************************************************************************\n");
+
+        FreeMosaicJob( num_infiles, infiles, &mosaicfile,
+            numv_tiles, tile_array );
+        return EXIT_SUCCESS;
+    }
+
     /* If -s was specified, then read the spectral subset bands, otherwise
        all bands will be processed by default */
     nspectral_bands = GetSpectralSubsetMosaic( &mosaicfile, bandstr,
@@ -285,7 +389,8 @@ int main
         sprintf( errmsg, "Error processing spectral subset (%s) "
             "for mosaic tool", bandstr );
         ErrorHandler( FALSE, "mosaic", ERROR_GENERAL, errmsg );
-        CloseLogHandler( );
+        FreeMosaicJob( num_infiles, infiles, &mosaicfile,
+            numv_tiles, tile_array );
         return EXIT_FAILURE;
     }
 
@@ -310,7 +415,8 @@ int main
           sprintf( errmsg, "Estimated HDF file output size of %s bytes is "
                "greater than than the HDF v4 limit of 2G.", eststr );
           ErrorHandler( FALSE, "mosaic", ERROR_GENERAL, errmsg );
-          CloseLogHandler( );
+          FreeMosaicJob( num_infiles, infiles, &mosaicfile,
+              numv_tiles, tile_array );
           return EXIT_FAILURE;
        }
        /* Just state a warning if close. 150K? */
@@ -323,13 +429,22 @@ int main
        }
     }
 
+    /* Tile and compress the HDF-EOS output fields as requested */
+    mosaicfile.output_tile_size = tile_size;
+    if ( deflate_level > 0 )
+    {
+        mosaicfile.output_compression = COMPRESS_DEFLATE;
+        mosaicfile.output_compression_level = deflate_level;
+    }
+
     /* Mosaic the tiles together */
     if ( MosaicTiles ( numh_tiles, numv_tiles, tile_array, num_infiles,
-        infiles, &mosaicfile ) != MOSAIC_SUCCESS )
+        infiles, &mosaicfile, nthreads ) != MOSAIC_SUCCESS )
     {
         sprintf( errmsg, "Error in the mosaic process" );
         ErrorHandler( FALSE, "mosaic", ERROR_GENERAL, errmsg );
-        CloseLogHandler( );
+        FreeMosaicJob( num_infiles, infiles, &mosaicfile,
+            numv_tiles, tile_array );
         return EXIT_FAILURE;
     }
 
@@ -349,7 +464,8 @@ int main
         {
             sprintf( errmsg, "Error outputting the mosaic metadata (HDF-EOS)" );
             ErrorHandler( FALSE, "mosaic", ERROR_GENERAL, errmsg );
-            CloseLogHandler( );
+            FreeMosaicJob( num_infiles, infiles, &mosaicfile,
+                numv_tiles, tile_array );
             return EXIT_FAILURE;
         }
     }
@@ -363,11 +479,106 @@ int main
     MessageHandler( NULL, "Finished mosaicking!\n" );
     MessageHandler( NULL,"******************************************************************************\n");
 
-    CloseLogHandler( );
+    FreeMosaicJob( num_infiles, infiles, &mosaicfile,
+        numv_tiles, tile_array );
     return EXIT_SUCCESS;
 }
 
 
+/******************************************************************************
+
+MODULE:  main
+
+PURPOSE:  Program entry point
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+EXIT_SUCCESS    Successful completion
+EXIT_FAILURE    Error in processing
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         03/02  Gail Schmidt           Original Development
+         10/26                         Added -batch, which runs each job of
+                                       a batch file in this one process
+
+NOTES:
+
+******************************************************************************/
+int main
+(
+    int argc,
+    char *argv[]
+)
+
+{
+    int status;              /* function return status */
+
+    /* Set up a log file and process the -g command line option if it exists */
+    InitLogHandler( argc, argv );
+
+    /* Run each job of a batch file, or just the one on the command line */
+    if ( argc >= 3 && !strcmp( argv[1], "-batch" ) )
+    {
+        status = RunBatchJobs( argv[2], argv[0], RunMosaic );
+        if ( status != MRT_NO_ERROR )
+            status = EXIT_FAILURE;
+    }
+    else
+        status = RunMosaic( argc, argv );
+
+    CloseLogHandler( );
+    return status;
+}
+
+
+/******************************************************************************
+
+MODULE:  FreeMosaicJob
+
+PURPOSE:  Free the input and output descriptors and the tile array of a
+    mosaic
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+
+******************************************************************************/
+static void FreeMosaicJob
+(
+    int num_infiles,            /* I: number of input files */
+    MosaicDescriptor infiles[], /* I/O: descriptors of the input files */
+    MosaicDescriptor *mosaicfile,  /* I/O: descriptor of the mosaic */
+    int numv_tiles,             /* I: number of vert tiles in the mosaic */
+    int **tile_array            /* I: input file of each tile location */
+)
+
+{
+    int i;                      /* loop index */
+
+    for ( i = 0; i < num_infiles; i++ )
+        FreeMosaicDescriptor( &infiles[i] );
+    free( infiles );
+    FreeMosaicDescriptor( mosaicfile );
+
+    if ( tile_array )
+    {
+        for ( i = 0; i < numv_tiles; i++ )
+            free( tile_array[i] );
+        free( tile_array );
+    }
+}
+
+
 /******************************************************************************
 
 MODULE:  CheckMosaicArgs
@@ -386,8 +597,15 @@ HISTORY:
 Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          03/02  Gail Schmidt           Original Development
+         10/26                         Added -threads
+         10/26                         Added -v
+         10/26                         Added -tile_size and -deflate
+         10/26                         Added -r and -l
 
 NOTES:
+  -threads, -tile_size and -deflate aren't single character options, so
+  they're taken out of argv before getopt sees them.  A -threads value of 0
+  uses one thread per online processor.
 
 ******************************************************************************/
 int CheckMosaicArgs
@@ -403,8 +621,21 @@ int CheckMosaicArgs
                                  tiles for each input filename? */
     int *write_tmphdr,     /* O: was -h switch specified to write the
                                  raw binary header info for the mosaic? */
-    int *spectral_subset   /* O: was -s switch specified for spectral
+    int *virtual_mosaic,   /* O: was -v switch specified to write a virtual
+                                 mosaic header instead of the mosaic? */
+    int *spectral_subset,  /* O: was -s switch specified for spectral
                                  subsetting? */
+    int *nthreads,         /* O: number of threads from the -threads switch
+                                 (1 if not specified) */
+    int *tile_size,        /* O: HDF-EOS tile size from the -tile_size
+                                 switch (0 if not specified) */
+    int *deflate_level,    /* O: HDF-EOS deflate level from the -deflate
+                                 switch (0 if not specified) */
+    char **region_filename,
+                           /* O: regions from the -r switch (NULL if not
+                                 specified) */
+    char **list_filename   /* O: region codes from the -l switch (NULL if
+                                 not specified) */
 )
 
 {
@@ -421,12 +652,56 @@ int CheckMosaicArgs
     /* Initialize determine tiles, write tmphdr, and spectral subset to false */
     *determine_tiles = FALSE;
     *write_tmphdr = FALSE;
+    *virtual_mosaic = FALSE;
     *spectral_subset = FALSE;
+    *nthreads = 1;
+    *tile_size = 0;
+    *deflate_level = 0;
+    *region_filename = NULL;
+    *list_filename = NULL;
+
+    /* take out -threads, -tile_size, -deflate and their values */
+    if ( !TakeIntSwitch( &argc, argv, "-threads", nthreads ) ||
+         *nthreads < 0 )
+    {
+        ErrorHandler( FALSE, "CheckMosaicArgs", ERROR_THREADS_FIELD,
+            "Incorrect -threads command-line argument (value must be 0 "
+            "or greater)." );
+        MosaicUsage( );
+        return MOSAIC_ERROR;
+    }
+
+    if ( !TakeIntSwitch( &argc, argv, "-tile_size", tile_size ) ||
+         *tile_size < 0 || *tile_size % 16 != 0 )
+    {
+        ErrorHandler( FALSE, "CheckMosaicArgs", ERROR_TILESIZE_FIELD,
+            "Incorrect -tile_size command-line argument (value must be 0 "
+            "or a multiple of 16)." );
+        MosaicUsage( );
+        return MOSAIC_ERROR;
+    }
 
+    if ( !TakeIntSwitch( &argc, argv, "-deflate", deflate_level ) ||
+         *deflate_level < 0 || *deflate_level > 9 )
+    {
+        ErrorHandler( FALSE, "CheckMosaicArgs", ERROR_COMPRESSION_LEVEL_FIELD,
+            "Incorrect -deflate command-line argument (value must be 0 "
+            "to 9)." );
+        MosaicUsage( );
+        return MOSAIC_ERROR;
+    }
+
+    /* each job of a batch run starts over (glibc only resets the state it
+       keeps between calls if optind is 0) */
+#ifdef __GLIBC__
+    optind = 0;
+#else
+    optind = 1;
+#endif
     opterr = 0;         /* do not print error messages to stdout */
-    while ( ( c = getopt( argc, argv, "i:o:g:s:th" ) ) != -1 )
-    {   /* the -t (get tile info) and -h (output to TmpHdr.hdr) switches
-           don't have any arguments */
+    while ( ( c = getopt( argc, argv, "i:o:g:s:thvr:l:" ) ) != -1 )
+    {   /* the -t (get tile info), -h (output to TmpHdr.hdr) and -v (virtual
+           mosaic) switches don't have any arguments */
         switch( c )
         {
             case 'i':   /* input filenames */
@@ -487,12 +762,35 @@ int CheckMosaicArgs
                 hswitch = TRUE;
                 break;
 
+            case 'v':   /* write a virtual mosaic header (the mosaic header
+                           and the list of tiles) to the output .hdr file */
+                *virtual_mosaic = TRUE;
+                break;
+
+            case 'r':   /* regions (shapefile or lat/long boxes) to cut
+                           the mosaic to */
+                *region_filename = optarg;
+                break;
+
+            case 'l':   /* codes of the regions in the -r shapefile */
+                *list_filename = optarg;
+                break;
+
             case 'g':   /* log file name, should be processed in
                            InitLogHandler() */
                 break;
         }
     }
 
+    /* the regions are listed by code from a shapefile */
+    if ( *list_filename && !*region_filename )
+    {
+        ErrorHandler( FALSE, "CheckMosaicArgs", ERROR_GENERAL,
+            "A list of regions (-l) needs a region shapefile (-r)" );
+        MosaicUsage( );
+        return MOSAIC_ERROR;
+    }
+
     /* check usage - either input filenames and output filename or input
        filenames and tile switch must be specified. Or the hswitch may be
        specified by itself. */
@@ -502,8 +800,22 @@ int CheckMosaicArgs
         return MOSAIC_ERROR;
     }
 
+    /* a virtual mosaic is a raw binary header of any kind of tiles, with
+       all their bands (the resampler does the spectral subsetting) */
+    if ( *virtual_mosaic && oswitch )
+    {
+        GetInputFileExt( ofilename, &output_filetype );
+        if ( output_filetype != RAW_BINARY || *spectral_subset )
+        {
+            ErrorHandler( FALSE, "CheckMosaicArgs", ERROR_GENERAL,
+                "The virtual mosaic (-v) output must be a .hdr file, and "
+                "can't be spectrally subset (-s)" );
+            return MOSAIC_ERROR;
+        }
+    }
+
     /* verify that the input file type and output file types are the same */
-    if ( oswitch )
+    else if ( oswitch )
     {
         GetInputFileExt( ifilenames[0], &input_filetype );
         GetInputFileExt( ofilename, &output_filetype );
@@ -520,6 +832,59 @@ int CheckMosaicArgs
 }
 
 
+/******************************************************************************
+
+MODULE:  TakeIntSwitch
+
+PURPOSE:  Take a multi-character switch and its integer value out of the
+          command line arguments
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            The switch wasn't given, or was given with a value
+FALSE           The switch was given without an integer value
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  value is left alone if the switch isn't given.  If it's given more than
+  once, the last value is used.
+
+******************************************************************************/
+static int TakeIntSwitch
+(
+    int *argc,             /* I/O: number of arguments */
+    char *argv[],          /* I/O: argument strings */
+    char *name,            /* I: switch to take out (e.g. "-threads") */
+    int *value             /* O: value of the switch */
+)
+
+{
+    int i, j;              /* looping variables */
+
+    for ( i = 1; i < *argc; i++ )
+    {
+        if ( strcmp( argv[i], name ) )
+            continue;
+
+        if ( i + 1 >= *argc || sscanf( argv[i + 1], "%i", value ) < 1 )
+            return FALSE;
+
+        for ( j = i; j + 2 < *argc; j++ )
+            argv[j] = argv[j + 2];
+        *argc -= 2;
+        i--;
+    }
+
+    return TRUE;
+}
+
+
 /******************************************************************************
 
 MODULE:  GetInputFilenames
@@ -982,11 +1347,9 @@ int SortProducts
 
 {
     size_t i;
-    int ni, j, h, v;             /* looping variables */
+    int ni, h, v;                /* looping variables */
     int minh = 99, maxh = -9;    /* min/max horizontal tile locations */
     int minv = 99, maxv = -9;    /* min/max vertical tile locations */
-    int bounding_coord;          /* is this a bounding coordinate image? */
-    int modis_tile;              /* is this a bounding coordinate image? */
     char errmsg[SMALL_STRING];   /* error message string */
     int **tmp_tile_array;        /* temporary pointer for the tile_array so we
                                     can clean up the syntax */
@@ -994,7 +1357,6 @@ int SortProducts
         index_maxh = 0;          /* index of minh and maxh */
     int index_minv = 0,
         index_maxv = 0;          /* index of minv and maxv */
-    int status = MRT_NO_ERROR;       /* error code status */
 
     /* Find the min/max horizontal and vertical tile locations */
     for ( ni = 0; ni < num_infiles; ni++ )
@@ -1128,6 +1490,53 @@ int SortProducts
 
     /* Convert the image extents from meters to lat/long for the four
        mosaic corner points */
+    SetMosaicGeoCorners( mosaicfile );
+
+    /* Set the number of lines and samples to be for the entire mosaic */
+    for ( i = 0; i < mosaicfile->nbands; i++ )
+    {
+        mosaicfile->bandinfo[i].nlines *= *numv_tiles;
+        mosaicfile->bandinfo[i].nsamples *= *numh_tiles;
+    }
+
+    /* Done sorting */
+    return MOSAIC_SUCCESS;
+}
+
+/******************************************************************************
+
+MODULE:  SetMosaicGeoCorners
+
+PURPOSE:  Convert the corners of the mosaic from projection coordinates to
+          lat/long
+
+RETURN VALUE:
+Type = None
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         06/02  Gail Schmidt           Original Development (in
+                                       SortProducts)
+         10/26                         Moved out of SortProducts so a mosaic
+                                       cut to regions gets its corners too
+
+NOTES:
+  The bounding coordinates are used if a corner can't be converted.
+
+******************************************************************************/
+void SetMosaicGeoCorners
+(
+    MosaicDescriptor *mosaicfile  /* I/O: file descriptor for the output
+                                          mosaic file */
+)
+
+{
+    int j;                       /* looping variable */
+    int bounding_coord;          /* is this a bounding coordinate image? */
+    int modis_tile;              /* is this a bounding coordinate image? */
+    int status = MRT_NO_ERROR;   /* error code status */
+
     bounding_coord = FALSE;
     modis_tile = FALSE;
     for ( j = 0; j < 4; j++ )
@@ -1150,7 +1559,7 @@ int SortProducts
             if (mosaicfile->projection_type == PROJ_SIN ||
                 mosaicfile->projection_type == PROJ_ISIN)
             {
-                MessageHandler( "SortProducts", 
+                MessageHandler( "SetMosaicGeoCorners", 
                     "Corner point falls outside the bounds of "
                     "the input projection.  The rectangle will be bounded "
                     "at -180 or 180 degrees latitude." );
@@ -1167,7 +1576,7 @@ int SortProducts
             }
             else
             {
-                MessageHandler( "SortProducts", 
+                MessageHandler( "SetMosaicGeoCorners", 
                     "At least one corner point falls outside the bounds of "
                     "the input projection.  The bounding rectangular "
                     "coordinates from the metadata will be used for the "
@@ -1188,7 +1597,7 @@ int SortProducts
              mosaicfile->east_bound == 0.0 &&
              mosaicfile->west_bound == 0.0 )
         {
-            ErrorHandler( TRUE, "SortProducts", ERROR_GENERAL,
+            ErrorHandler( TRUE, "SetMosaicGeoCorners", ERROR_GENERAL,
                 "Error when converting the corners from projection x/y to "
                 "latitude/longitude.  This image set contains a bounding "
                 "coordinate and the lat/long bounding coordinate values are "
@@ -1205,16 +1614,6 @@ int SortProducts
         mosaicfile->ll_image_extent[LR][0] = mosaicfile->south_bound; 
         mosaicfile->ll_image_extent[LR][1] = mosaicfile->east_bound;
     }
-
-    /* Set the number of lines and samples to be for the entire mosaic */
-    for ( i = 0; i < mosaicfile->nbands; i++ )
-    {
-        mosaicfile->bandinfo[i].nlines *= *numv_tiles;
-        mosaicfile->bandinfo[i].nsamples *= *numh_tiles;
-    }
-
-    /* Done sorting */
-    return MOSAIC_SUCCESS;
 }
 
 /******************************************************************************
@@ -1235,8 +1634,26 @@ HISTORY:
 Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          07/02  Gail Schmidt           Original Development
+         10/26                         Keep the HDF-EOS input files and their
+                                       grids open for the whole mosaic;
+                                       only the field is selected per band
+         10/26                         Build the output rows from whole tile
+                                       rows in the data type of the files
+                                       rather than pixel by pixel
+         10/26                         Hand raw binary mosaics to
+                                       MosaicStrips when more than one
+                                       thread is asked for
+         10/26                         Only read the strips and rows of the
+                                       lines a mosaic is cut to
+         10/26                         Say when -threads is ignored for an
+                                       HDF-EOS mosaic
 
 NOTES:
+  The HDF-EOS input files are opened the first time they're needed and
+  stay open until the end (see OpenMosaicInput for the limit on open
+  files).  HDF-EOS mosaics are always done on this thread, whatever
+  -threads says.  When the mosaic is cut to the lines of some regions
+  (CutMosaicRows), the strips of tiles outside those lines aren't opened.
 
 ******************************************************************************/
 int MosaicTiles
@@ -1249,16 +1666,21 @@ int MosaicTiles
     int num_infiles,     /* I: number of input files */
     MosaicDescriptor infiles[],
                          /* I: file descriptor array for the input files */
-    MosaicDescriptor *mosaicfile
+    MosaicDescriptor *mosaicfile,
                          /* I: file descriptor for the output mosaic file */
+    int nthreads         /* I: number of threads (0 = one per processor) */
 )
 
 {
     int status = MRT_NO_ERROR;          /* return status error code */
     int v, h;                       /* looping variables */
     size_t curband, k,              /* looping variables */
-        currow, curcol;
-    size_t nrows = 0;               /* number of rows for current band */
+        currow;
+    size_t nrows = 0;               /* number of rows in a tile of the
+                                       current band */
+    size_t first_line, end_line;    /* lines of the tile mosaic the output
+                                       starts and ends at */
+    size_t first_row, end_row;      /* rows of a strip in the output */
     int outmulti_band = 0;          /* index for band num in the output image */
     int outcol;                     /* output column value for current row */
     int curr_infile;                /* location in infiles of the current
@@ -1272,9 +1694,26 @@ int MosaicTiles
     HdfEosFD **input_hdfptr = NULL, /* [array of] HDF-EOS file pointers for
                                        each input tile */
              *output_hdfptr = NULL; /* HDF-EOS file pointer for output */
+    unsigned long *input_strip = NULL;  /* last strip each input tile was
+                                       used for */
+    unsigned long strip = 0;        /* number of the current strip */
     double curr_resolution = 0.0;   /* determines when to open a new input
                                        file */
-    double *buffer = NULL;          /* output buffer */
+    double *buffer = NULL;          /* row conversion buffer */
+    char *outrow = NULL;            /* output row in the output data type */
+    char *background = NULL;        /* background fill of a missing tile in
+                                       the output data type */
+    size_t tile_ncols;              /* number of columns of a missing tile */
+
+    /* raw binary strips can be mosaicked on several threads; HDF-EOS
+       mosaics are always read and written by this thread since the HDF
+       library isn't thread-safe (see mosaic_strips.c) */
+    if ( mosaicfile->filetype == RAW_BINARY && nthreads != 1 )
+        return ( MosaicStrips( numh_tiles, numv_tiles, tile_array, infiles,
+            mosaicfile, nthreads ) );
+    if ( nthreads != 1 )
+        MessageHandler( "MosaicTiles", "-threads only applies to raw binary "
+            "mosaics, so this HDF-EOS mosaic is done on one thread" );
 
     /* allocate space in input to hold one row (numh_tiles) file descriptors */
     input = ( FileDescriptor ** )
@@ -1293,6 +1732,15 @@ int MosaicTiles
             "Error allocating memory for the horizontal input tiles" );
     }
 
+    /* allocate space to track when each input file was last used */
+    input_strip = ( unsigned long * ) calloc( num_infiles,
+        sizeof( unsigned long ) );
+    if ( input_strip == NULL )
+    {
+        ErrorHandler( TRUE, "MosaicTiles", ERROR_MEMORY,
+            "Error allocating memory for the horizontal input tiles" );
+    }
+
     /* open the output HDF-EOS file (stays open until all input files are
        read and output) */
     if ( mosaicfile->filetype == HDFEOS )
@@ -1317,7 +1765,7 @@ int MosaicTiles
         if ( !mosaicfile->bandinfo[curband].selected )
             continue;
 
-        /* allocate space for the output row buffer */
+        /* allocate space for the row conversion buffer */
         buffer = ( double * ) calloc( mosaicfile->bandinfo[curband].nsamples,
             sizeof( double ) );
         if ( buffer == NULL )
@@ -1381,9 +1829,44 @@ int MosaicTiles
                 break;
         }
 
+        /* the output rows are put together in the output data type, with
+           missing tiles filled with the background fill value of the first
+           input file */
+        if ( !SelectRowConverters( output ) )
+        {
+            ErrorHandler( TRUE, "MosaicTiles", ERROR_GENERAL,
+                "Unsupported output data type" );
+        }
+        tile_ncols = mosaicfile->bandinfo[curband].nsamples / numh_tiles;
+        outrow = ( char * ) malloc( mosaicfile->bandinfo[curband].nsamples *
+            output->datasize );
+        background = ( char * ) malloc( tile_ncols * output->datasize );
+        if ( outrow == NULL || background == NULL )
+        {
+            ErrorHandler( TRUE, "MosaicTiles", ERROR_MEMORY,
+                "Error allocating space for the output row buffer" );
+        }
+        FillBufferBackground( &mosaicfile->bandinfo[curband], numh_tiles,
+            buffer );
+        output->write_convert( buffer, background, tile_ncols );
+
+        /* all the lines of the tiles unless the mosaic was cut to the
+           lines of some regions */
+        nrows = infiles[0].bandinfo[curband].nlines;
+        first_line = mosaicfile->first_line[curband];
+        end_line = first_line + mosaicfile->bandinfo[curband].nlines;
+
         /* loop through the vertical tiles */
         for ( v = 0; v < numv_tiles; v++ )
         {
+            /* skip the strips outside the lines being mosaicked */
+            if ( ( v + 1 ) * nrows <= first_line || v * nrows >= end_line )
+                continue;
+            first_row = first_line > v * nrows ? first_line - v * nrows : 0;
+            end_row = end_line < ( v + 1 ) * nrows ? end_line - v * nrows :
+                nrows;
+            strip++;
+
             /* open all the horizontal tiles for this vertical set */
             for ( h = 0; h < numh_tiles; h++ )
             {
@@ -1407,7 +1890,6 @@ int MosaicTiles
                                 ErrorHandler( TRUE, "MosaicTiles",
                                     ERROR_OPEN_INPUTIMAGE, errstr );
                             }
-                            nrows = input[h]->nrows;
 
                             /* clear buffers to avoid reading data from
                                previous band */
@@ -1415,18 +1897,11 @@ int MosaicTiles
                             break;
 
                         case HDFEOS:
-                            /* open the input HDF-EOS file */
-                            input_hdfptr[curr_infile] = OpenHdfEosFile(
-                                infiles[curr_infile].filename, "",
-                                FILE_READ_MODE, &status );
-                            if ( input_hdfptr[curr_infile] == NULL )
-                            {
-                                sprintf( errstr,
-                                    "Error opening input image %s.",
-                                    infiles[curr_infile].filename );
-                                ErrorHandler( TRUE, "MosaicTiles",
-                                    ERROR_MEMORY, errstr );
-                            }
+                            /* get the input HDF-EOS file (opened the first
+                               time it's used) */
+                            OpenMosaicInput( infiles, num_infiles,
+                                input_hdfptr, input_strip, strip,
+                                curr_infile );
 
                             /* create a file descriptor */
                             input[h] = MakeHdfEosFDMosaic(
@@ -1441,7 +1916,6 @@ int MosaicTiles
                                 ErrorHandler( TRUE, "MosaicTiles",
                                     ERROR_OPEN_INPUTIMAGE, errstr );
                             }
-                            nrows = input[h]->nrows;
 
                             GetHdfEosFieldMosaic( input_hdfptr[curr_infile],
                                 curband );
@@ -1460,23 +1934,34 @@ int MosaicTiles
                         ErrorHandler( TRUE, "MosaicTiles",
                             ERROR_OPEN_INPUTIMAGE, errstr );
                     }
+
+                    /* pick the input conversion in case the data types
+                       differ */
+                    if ( !SelectRowConverters( input[h] ) )
+                    {
+                        sprintf( errstr, "Unsupported data type in input "
+                            "file: %s\n", infiles[curr_infile].filename );
+                        ErrorHandler( TRUE, "MosaicTiles",
+                            ERROR_OPEN_INPUTIMAGE, errstr );
+                    }
                 }
             }  /* for h */
 
             /* initialize status to terminal */
             fprintf( stdout, "%% complete (" MRT_SIZE_T_FMT " rows): 0%%",
-                     nrows );
+                     end_row - first_row );
             fflush( stdout );
             k = 0;
 
             /* loop through the rows reading the current row for each image
                then output the mosaicked row to the output file */
-            for ( currow = 0; currow < nrows; currow++ )
+            for ( currow = first_row; currow < end_row; currow++ )
             {
                 /* update status */
-                if ( 100 * currow / nrows > k )
+                if ( 100 * ( currow - first_row ) / ( end_row - first_row ) >
+                     k )
                 {
-                    k = 100 * currow / nrows;
+                    k = 100 * ( currow - first_row ) / ( end_row - first_row );
                     if ( k % 10 == 0 )
                     {
                         fprintf( stdout, " " MRT_SIZE_T_FMT "%%", k );
@@ -1491,31 +1976,28 @@ int MosaicTiles
                    write it to output */
                 for ( h = 0; h < numh_tiles; h++ )
                 {
-                    /* if this tile exists, then read it from the correct
-                       input file and fill in the output file */
+                    /* if this tile exists, then copy its row from the
+                       correct input file into the output row */
                     if ( tile_array[v][h] != -9 )
                     {
-                        for ( curcol = 0; curcol < input[h]->ncols; curcol++ )
-                        {
-                            /* read the input file */
-                            buffer[outcol++] = ReadBufferValue( curcol, currow,
-                                input[h] );
-                        }
+                        CopyMosaicRow( input[h], currow, output, buffer,
+                            &outrow[outcol * output->datasize] );
+                        outcol += input[h]->ncols;
                     }
 
                     /* otherwise fill this tile with background fill values;
                        use information from the first input file */
                     else
                     {
-                        FillBufferBackground( &mosaicfile->bandinfo[curband],
-                            numh_tiles, &buffer[outcol] );
-                        outcol += mosaicfile->bandinfo[curband].nsamples /
-                            numh_tiles;
+                        memcpy( &outrow[outcol * output->datasize],
+                            background, tile_ncols * output->datasize );
+                        outcol += tile_ncols;
                     }
                 } /* for h */
 
-                /* write the mosaic buffer to the output file */
-                if ( !WriteRow( output, currow + v * nrows, buffer ) )
+                /* write the mosaic row to the output file */
+                if ( !WriteRowNative( output, currow + v * nrows - first_line,
+                    outrow ) )
                 {
                     free( buffer );
                     ErrorHandler( TRUE, "MosaicTiles", ERROR_GENERAL,
@@ -1539,9 +2021,9 @@ int MosaicTiles
                             break;
 
                         case HDFEOS:
-                            CloseHdfEosFile( input[h] );
-                            curr_infile = tile_array[v][h];
-                            CloseHdfEos( input_hdfptr[curr_infile] );
+                            /* the file and its grids stay open for the
+                               next band */
+                            DestroyFileDescriptor( input[h] );
                             break;
                     }
                 }
@@ -1565,18 +2047,27 @@ int MosaicTiles
         }
         output = NULL;
 
-        /* free the buffer for this band */
+        /* free the buffers for this band */
         if ( buffer != NULL )
         {
            free( buffer );
            buffer = NULL;
         }
+        free( outrow );
+        outrow = NULL;
+        free( background );
+        background = NULL;
     }   /* for curband */
 
-    /* close output HDF-EOS file */
+    /* close output HDF-EOS file and the input files */
     if ( mosaicfile->filetype == HDFEOS )
     {
         CloseHdfEos( output_hdfptr );
+        for ( curr_infile = 0; curr_infile < num_infiles; curr_infile++ )
+        {
+            if ( input_hdfptr[curr_infile] != NULL )
+                CloseHdfEos( input_hdfptr[curr_infile] );
+        }
     }
 
     /* free space for the input FileDescriptor pointers */
@@ -1584,11 +2075,145 @@ int MosaicTiles
     input = NULL;
     free( input_hdfptr );
     input_hdfptr = NULL;
+    free( input_strip );
+    input_strip = NULL;
 
     return MOSAIC_SUCCESS;
 }
 
 
+/******************************************************************************
+
+MODULE:  OpenMosaicInput
+
+PURPOSE:  Get an open HDF-EOS input file, opening it if necessary
+
+RETURN VALUE:
+Type = HdfEosFD *
+Value           Description
+-----           -----------
+HdfEosFD*       The open input file
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  1. The input files stay open (with their grids attached) so the later
+     bands only have to select their field.  If MAX_OPEN_MOSAIC_INPUTS are
+     already open, the one which was used the longest time ago is closed
+     first, as long as it isn't used by the current strip.
+  2. Errors opening the file are fatal.
+
+******************************************************************************/
+static HdfEosFD *OpenMosaicInput
+(
+    MosaicDescriptor infiles[], /* I: file descriptor array for the input
+                                      files */
+    int num_infiles,            /* I: number of input files */
+    HdfEosFD **input_hdfptr,    /* I/O: HDF-EOS file pointer of each input
+                                        file (NULL if not open) */
+    unsigned long *input_strip, /* I/O: last strip each input file was used
+                                        for */
+    unsigned long strip,        /* I: number of the current strip */
+    int curr_infile             /* I: input file wanted */
+)
+
+{
+    int i;                      /* looping variable */
+    int nopen = 0;              /* number of input files open */
+    int oldest = -1;            /* open input file used longest ago */
+    int status = MRT_NO_ERROR;  /* return status error code */
+    char errstr[SMALL_STRING];  /* string for error messages */
+
+    input_strip[curr_infile] = strip;
+    if ( input_hdfptr[curr_infile] != NULL )
+        return ( input_hdfptr[curr_infile] );
+
+    /* make room for it if there are too many files open */
+    for ( i = 0; i < num_infiles; i++ )
+    {
+        if ( input_hdfptr[i] == NULL )
+            continue;
+        nopen++;
+        if ( input_strip[i] != strip &&
+             ( oldest < 0 || input_strip[i] < input_strip[oldest] ) )
+            oldest = i;
+    }
+    if ( nopen >= MAX_OPEN_MOSAIC_INPUTS && oldest >= 0 )
+    {
+        CloseHdfEos( input_hdfptr[oldest] );
+        input_hdfptr[oldest] = NULL;
+    }
+
+    /* open the input HDF-EOS file */
+    input_hdfptr[curr_infile] = OpenHdfEosFile( infiles[curr_infile].filename,
+        "", FILE_READ_MODE, &status );
+    if ( input_hdfptr[curr_infile] == NULL )
+    {
+        sprintf( errstr, "Error opening input image %s.",
+            infiles[curr_infile].filename );
+        ErrorHandler( TRUE, "MosaicTiles", ERROR_MEMORY, errstr );
+    }
+
+    return ( input_hdfptr[curr_infile] );
+}
+
+/******************************************************************************
+
+MODULE:  CopyMosaicRow
+
+PURPOSE:  Copy a row of an input tile into the output row
+
+RETURN VALUE:
+Type = None
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development (from the
+                                       ReadBufferValue loop of MosaicTiles)
+
+NOTES:
+  1. The row comes straight from the input's read cache.  If the input and
+     output data types are the same it's just copied, otherwise it's
+     converted through buffer.
+  2. A row which couldn't be read is filled with the input's background
+     fill, as ReadBufferValue does.
+  3. The converters of both files must have been picked
+     (SelectRowConverters).
+
+******************************************************************************/
+void CopyMosaicRow
+(
+    FileDescriptor *input,  /* I: input tile */
+    size_t row,             /* I: row of the tile to copy */
+    FileDescriptor *output, /* I: output file */
+    double *buffer,         /* I/O: conversion buffer (input->ncols values) */
+    void *outrow            /* O: where the row goes in the output row */
+)
+
+{
+    void *data;             /* the input row in its own data type */
+    size_t col;             /* looping variable */
+
+    data = ReadBufferRow( row, input );
+    if ( data == NULL )
+    {
+        for ( col = 0; col < input->ncols; col++ )
+            buffer[col] = input->background_fill;
+        output->write_convert( buffer, outrow, input->ncols );
+    }
+    else if ( input->datatype == output->datatype )
+        memcpy( outrow, data, input->ncols * output->datasize );
+    else
+    {
+        input->read_convert( data, buffer, input->ncols );
+        output->write_convert( buffer, outrow, input->ncols );
+    }
+}
+
 /******************************************************************************
 
 MODULE:  FillBufferBackground
@@ -6,6 +6,13 @@
 #include <string.h>
 #include "shared_mosaic.h"
 
+/* most HDF-EOS input files kept open at once by MosaicTiles (HDF allows
+   MAX_FILE (32) open files, including the output file) */
+#define MAX_OPEN_MOSAIC_INPUTS 24
+
+/* attribute of the region shapes with the codes in the -l list */
+#define MOSAIC_REGION_FIELD "GEOID"
+
 /* Local Prototypes */
 void CopyMosaicDescriptor
 (
@@ -20,4 +27,78 @@ int OutputHdrMosaic
     char *output_filename
 );
 
+int OutputVirtualHdrMosaic
+(
+    MosaicDescriptor *mosaic,  /* I: mosaic info */
+    char *output_filename,     /* I: name of the .hdr file */
+    int numh_tiles,            /* I: number of horiz tiles in the mosaic */
+    int numv_tiles,            /* I: number of vert tiles in the mosaic */
+    int **tile_array,          /* I: 2D array of size [numv_tiles][numh_tiles]
+                                     specifying which input file represents
+                                     that tile location */
+    MosaicDescriptor infiles[] /* I: file descriptor array for the input
+                                     files */
+);
+
+void CopyMosaicRow
+(
+    FileDescriptor *input,  /* I: input tile */
+    size_t row,             /* I: row of the tile to copy */
+    FileDescriptor *output, /* I: output file */
+    double *buffer,         /* I/O: conversion buffer (input->ncols values) */
+    void *outrow            /* O: where the row goes in the output row */
+);
+
+int MosaicStrips
+(
+    int numh_tiles,      /* I: number of horiz tiles in the mosaic */
+    int numv_tiles,      /* I: number of vert tiles in the mosaic */
+    int **tile_array,    /* I: 2D array of size [numv_tiles][numh_tiles]
+                               specifying which input file represents that
+                               tile location */
+    MosaicDescriptor infiles[],
+                         /* I: file descriptor array for the input files */
+    MosaicDescriptor *mosaicfile,
+                         /* I: file descriptor for the output mosaic file */
+    int nthreads         /* I: number of threads (0 = one per processor) */
+);
+
+void SetMosaicGeoCorners
+(
+    MosaicDescriptor *mosaicfile  /* I/O: file descriptor for the output
+                                          mosaic file */
+);
+
+int ReadMosaicRegions
+(
+    char *region_filename,     /* I: shapefile or file of lat/long boxes */
+    char *list_filename,       /* I: file of region codes, or NULL for all
+                                     the regions */
+    MosaicDescriptor *tile,    /* I: an input tile */
+    double **regions,          /* O: xmin, ymin, xmax, ymax of each region
+                                     in the projection of the tiles */
+    int *nregions              /* O: number of regions */
+);
+
+int PruneMosaicTiles
+(
+    int *num_infiles,          /* I/O: number of input files */
+    MosaicDescriptor infiles[],
+                               /* I/O: file descriptor array for the input
+                                       files */
+    char input_filenames[][FILENAME_LENGTH+1],
+                               /* I/O: input filenames */
+    double *regions,           /* I/O: boxes of the regions */
+    int *nregions              /* I/O: number of regions */
+);
+
+void CutMosaicRows
+(
+    MosaicDescriptor *mosaicfile,
+                               /* I/O: file descriptor for the output mosaic
+                                       file */
+    double *regions,           /* I: boxes of the regions */
+    int nregions               /* I: number of regions */
+);
+
 #endif /* _MOSAIC_H_ */
@@ -0,0 +1,670 @@
+/******************************************************************************
+
+FILE:  mosaic_region.c
+
+PURPOSE:  Cut a mosaic down to the tiles and lines that a list of lat/long
+          regions (polygons or boxes) touch
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+HARDWARE AND/OR SOFTWARE LIMITATIONS:
+  None
+
+PROJECT:    MODIS Reprojection Tool
+
+NOTES:
+  1. The regions are either the polygons of a shapefile (all of them, or
+     the ones listed by code) or a text file of lat/long boxes, one per
+     line:
+         ul_lat ul_lon lr_lat lr_lon
+     Blank lines and lines starting with # are skipped.
+  2. Each region is kept as the box (xmin, ymin, xmax, ymax) around its
+     points in the projection of the tiles.  A tile is read only if its
+     extent meets one of the boxes; the others are left out of the mosaic
+     the same as tiles that weren't given, so they're never opened.
+  3. The mosaic is then cut to the lines from the top of the highest box to
+     the bottom of the lowest one, on the pixels of the coarsest band, and
+     the strips of tiles above and below them aren't read either.  Whole
+     rows of the tiles are read, so the columns aren't cut.
+
+******************************************************************************/
+#include <math.h>
+#include "worgen.h"
+#include "mosaic.h"
+#include "mrt_dtype.h"
+#include "shapefile.h"
+
+/* points along each edge of a lat/long box */
+#define REGION_EDGE_POINTS 16
+
+static int AddRegion( GctpXform *xform, int npoints, double *lon,
+    double *lat, char *name, double **regions, int *nregions, int *nalloc );
+static int ReadShapeRegions( char *shape_filename, char *list_filename,
+    GctpXform *xform, double **regions, int *nregions, int *nalloc );
+static int ReadBoxRegions( char *box_filename, GctpXform *xform,
+    double **regions, int *nregions, int *nalloc );
+
+/******************************************************************************
+
+MODULE:  ReadMosaicRegions
+
+PURPOSE:  Read the regions and find their boxes in the projection of the
+          tiles
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+MOSAIC_SUCCESS  Successful completion
+MOSAIC_ERROR    Error in processing
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  A .shp region file is read as a shapefile, anything else as a file of
+  boxes.  The list of codes can only be used with a shapefile.  Regions
+  that can't be found or projected are skipped with a warning.
+
+******************************************************************************/
+int ReadMosaicRegions
+(
+    char *region_filename,     /* I: shapefile or file of lat/long boxes */
+    char *list_filename,       /* I: file of region codes, or NULL for all
+                                     the regions */
+    MosaicDescriptor *tile,    /* I: an input tile */
+    double **regions,          /* O: xmin, ymin, xmax, ymax of each region
+                                     in the projection of the tiles */
+    int *nregions              /* O: number of regions */
+)
+
+{
+    ProjInfo *inproj;             /* projection of the tiles */
+    GctpXform xform;              /* lat/long to tile transformation */
+    double geo_coef[NUM_PROJECTION_PARAMS];  /* lat/long parameters */
+    char *ext;                    /* extension of the region file */
+    int nalloc = 0;               /* regions allocated */
+    int status;                   /* return status */
+
+    *regions = NULL;
+    *nregions = 0;
+
+    inproj = GetInputProjectionMosaic( tile );
+    if ( inproj == NULL )
+    {
+        ErrorHandler( FALSE, "ReadMosaicRegions", ERROR_GENERAL,
+            "Error getting the projection of the tiles" );
+        return MOSAIC_ERROR;
+    }
+
+    memset( geo_coef, 0, sizeof( geo_coef ) );
+    if ( gctp_call_init( &xform, GEO, 0, -1, geo_coef, DEGREE,
+            inproj->proj_code, inproj->zone_code, inproj->sphere_code,
+            inproj->proj_coef, inproj->units ) != E_GEO_SUCC )
+    {
+        DestroyProjectionInfo( inproj );
+        ErrorHandler( FALSE, "ReadMosaicRegions", ERROR_GENERAL,
+            "Error setting up the lat/long to tile transformation" );
+        return MOSAIC_ERROR;
+    }
+    DestroyProjectionInfo( inproj );
+
+    ext = strrchr( region_filename, '.' );
+    if ( ext && ( !strcmp( ext, ".shp" ) || !strcmp( ext, ".SHP" ) ) )
+        status = ReadShapeRegions( region_filename, list_filename, &xform,
+            regions, nregions, &nalloc );
+    else if ( list_filename )
+    {
+        ErrorHandler( FALSE, "ReadMosaicRegions", ERROR_GENERAL,
+            "A list of regions (-l) can only be used with a shapefile" );
+        status = MOSAIC_ERROR;
+    }
+    else
+        status = ReadBoxRegions( region_filename, &xform, regions, nregions,
+            &nalloc );
+    gctp_call_free( &xform );
+
+    if ( status == MOSAIC_SUCCESS && *nregions == 0 )
+    {
+        ErrorHandler( FALSE, "ReadMosaicRegions", ERROR_GENERAL,
+            "None of the regions could be used" );
+        status = MOSAIC_ERROR;
+    }
+    if ( status != MOSAIC_SUCCESS )
+    {
+        free( *regions );
+        *regions = NULL;
+        *nregions = 0;
+    }
+
+    return status;
+}
+
+/******************************************************************************
+
+MODULE:  PruneMosaicTiles
+
+PURPOSE:  Drop the input tiles that none of the regions touch
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+MOSAIC_SUCCESS  Successful completion
+MOSAIC_ERROR    None of the tiles are touched
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+         10/26                         Free the dropped tiles
+
+NOTES:
+  The tiles that are kept stay in their order, and those dropped are
+  freed.  The regions that don't touch any tile are dropped as well, so
+  they don't stretch the lines the mosaic is cut to.
+
+******************************************************************************/
+int PruneMosaicTiles
+(
+    int *num_infiles,          /* I/O: number of input files */
+    MosaicDescriptor infiles[],
+                               /* I/O: file descriptor array for the input
+                                       files */
+    char input_filenames[][FILENAME_LENGTH+1],
+                               /* I/O: input filenames */
+    double *regions,           /* I/O: boxes of the regions */
+    int *nregions              /* I/O: number of regions */
+)
+
+{
+    char *touched;                /* regions touching a kept tile */
+    double *r;                    /* box of a region */
+    double xmin, xmax, ymin, ymax;  /* extent of a tile */
+    int keep;                     /* is the tile touched? */
+    int nkept = 0;                /* tiles kept */
+    int i, j;                     /* looping variables */
+
+    touched = ( char * ) calloc( *nregions, 1 );
+    if ( touched == NULL )
+    {
+        ErrorHandler( TRUE, "PruneMosaicTiles", ERROR_MEMORY,
+            "Error allocating memory for the regions" );
+    }
+
+    for ( i = 0; i < *num_infiles; i++ )
+    {
+        xmin = infiles[i].proj_image_extent[UL][0];
+        xmax = infiles[i].proj_image_extent[LR][0];
+        ymin = infiles[i].proj_image_extent[LR][1];
+        ymax = infiles[i].proj_image_extent[UL][1];
+
+        keep = FALSE;
+        for ( j = 0; j < *nregions; j++ )
+        {
+            r = &regions[4 * j];
+            if ( r[0] < xmax && r[2] > xmin && r[1] < ymax && r[3] > ymin )
+                keep = touched[j] = TRUE;
+        }
+
+        if ( !keep )
+        {
+            MessageHandler( "PruneMosaicTiles", "skipping %s (h%02dv%02d)",
+                infiles[i].filename, infiles[i].horiz, infiles[i].vert );
+            FreeMosaicDescriptor( &infiles[i] );
+            continue;
+        }
+
+        if ( nkept != i )
+        {
+            infiles[nkept] = infiles[i];
+            strcpy( input_filenames[nkept], input_filenames[i] );
+        }
+        nkept++;
+    }
+
+    for ( i = j = 0; i < *nregions; i++ )
+    {
+        if ( !touched[i] )
+            continue;
+        if ( j != i )
+            memcpy( &regions[4 * j], &regions[4 * i], 4 * sizeof( double ) );
+        j++;
+    }
+    free( touched );
+
+    MessageHandler( "PruneMosaicTiles", "%d of %d tiles touch %d regions",
+        nkept, *num_infiles, j );
+    *num_infiles = nkept;
+    *nregions = j;
+    if ( nkept == 0 )
+    {
+        ErrorHandler( FALSE, "PruneMosaicTiles", ERROR_GENERAL,
+            "None of the input tiles touch the regions" );
+        return MOSAIC_ERROR;
+    }
+
+    return MOSAIC_SUCCESS;
+}
+
+/******************************************************************************
+
+MODULE:  CutMosaicRows
+
+PURPOSE:  Cut the mosaic to the lines the regions touch
+
+RETURN VALUE:
+Type = None
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  This is called after SortProducts, which sets the mosaic up for whole
+  strips of tiles.  The first line of each band in the tile mosaic is kept
+  in first_line for MosaicTiles, and the extents, corners and bounding
+  coordinates are moved to the lines that are kept.
+
+******************************************************************************/
+void CutMosaicRows
+(
+    MosaicDescriptor *mosaicfile,
+                               /* I/O: file descriptor for the output mosaic
+                                       file */
+    double *regions,           /* I: boxes of the regions */
+    int nregions               /* I: number of regions */
+)
+
+{
+    double uly = mosaicfile->proj_image_extent[UL][1];
+    double lly;                   /* bottom of the tile mosaic */
+    double top, bottom;           /* lines of the regions */
+    double ps = 0.0;              /* coarsest pixel size */
+    double lat, lon;              /* latitude of the top and bottom */
+    size_t b;                     /* looping variable */
+    int i;                        /* looping variable */
+
+    lly = uly - mosaicfile->bandinfo[0].nlines *
+        mosaicfile->bandinfo[0].pixel_size;
+    top = lly;
+    bottom = uly;
+    for ( i = 0; i < nregions; i++ )
+    {
+        if ( regions[4 * i + 3] > top )
+            top = regions[4 * i + 3];
+        if ( regions[4 * i + 1] < bottom )
+            bottom = regions[4 * i + 1];
+    }
+    for ( b = 0; b < mosaicfile->nbands; b++ )
+        if ( mosaicfile->bandinfo[b].pixel_size > ps )
+            ps = mosaicfile->bandinfo[b].pixel_size;
+
+    /* out to the pixels of the coarsest band, inside the tiles */
+    if ( top > uly )
+        top = uly;
+    if ( bottom < lly )
+        bottom = lly;
+    top = uly - floor( ( uly - top ) / ps + 1.0e-6 ) * ps;
+    bottom = uly - ceil( ( uly - bottom ) / ps - 1.0e-6 ) * ps;
+    if ( top - bottom < ps )
+        bottom = top - ps;
+    if ( top > uly - ps / 2.0 && bottom < lly + ps / 2.0 )
+        return;
+
+    for ( b = 0; b < mosaicfile->nbands; b++ )
+    {
+        ps = mosaicfile->bandinfo[b].pixel_size;
+        mosaicfile->first_line[b] = ( int ) floor( ( uly - top ) / ps +
+            0.5 );
+        mosaicfile->bandinfo[b].nlines = ( size_t ) floor( ( top - bottom ) /
+            ps + 0.5 );
+    }
+
+    mosaicfile->proj_image_extent[UL][1] = top;
+    mosaicfile->proj_image_extent[UR][1] = top;
+    mosaicfile->proj_image_extent[LL][1] = bottom;
+    mosaicfile->proj_image_extent[LR][1] = bottom;
+    SetMosaicGeoCorners( mosaicfile );
+
+    /* the latitude of a line of SIN and ISIN is the same at every x, so
+       the bounding coordinates can be brought in to the lines that are
+       kept (they're all 0 for raw binary tiles) */
+    if ( ( mosaicfile->projection_type == PROJ_SIN ||
+           mosaicfile->projection_type == PROJ_ISIN ) &&
+         ( mosaicfile->north_bound != 0.0 || mosaicfile->south_bound != 0.0 ||
+           mosaicfile->east_bound != 0.0 || mosaicfile->west_bound != 0.0 ) )
+    {
+        if ( GetInputGeoCornerMosaic( mosaicfile, 0.0, top, &lat, &lon ) ==
+             MRT_NO_ERROR && lat < mosaicfile->north_bound )
+            mosaicfile->north_bound = lat;
+        if ( GetInputGeoCornerMosaic( mosaicfile, 0.0, bottom, &lat, &lon ) ==
+             MRT_NO_ERROR && lat > mosaicfile->south_bound )
+            mosaicfile->south_bound = lat;
+    }
+
+    MessageHandler( "CutMosaicRows", "mosaicking lines %d to %d of "
+        MRT_SIZE_T_FMT " in the first band", mosaicfile->first_line[0],
+        mosaicfile->first_line[0] + ( int ) mosaicfile->bandinfo[0].nlines - 1,
+        ( size_t ) floor( ( uly - lly ) /
+        mosaicfile->bandinfo[0].pixel_size + 0.5 ) );
+}
+
+/******************************************************************************
+
+MODULE:  AddRegion
+
+PURPOSE:  Project the lat/long points of a region and add the box around
+          them to the regions
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+MOSAIC_SUCCESS  Successful completion (including a region that was skipped)
+MOSAIC_ERROR    Error in processing
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The points are projected in place.  A region with a point that can't be
+  projected is skipped.
+
+******************************************************************************/
+static int AddRegion
+(
+    GctpXform *xform,          /* I/O: lat/long to tile transformation */
+    int npoints,               /* I: number of points */
+    double *lon,               /* I/O: longitude of the points (x on
+                                       return) */
+    double *lat,               /* I/O: latitude of the points (y on
+                                       return) */
+    char *name,                /* I: region, for messages */
+    double **regions,          /* I/O: boxes of the regions */
+    int *nregions,             /* I/O: number of regions */
+    int *nalloc                /* I/O: regions allocated */
+)
+
+{
+    long *pstatus;                /* projection status of each point */
+    double *r;                    /* box of the region */
+    double *more;                 /* reallocated regions */
+    char errmsg[LARGE_STRING];    /* error message */
+    int p;                        /* looping variable */
+
+    if ( npoints <= 0 )
+        return MOSAIC_SUCCESS;
+
+    pstatus = ( long * ) malloc( npoints * sizeof( long ) );
+    if ( pstatus == NULL )
+    {
+        ErrorHandler( FALSE, "AddRegion", ERROR_MEMORY,
+            "Error allocating memory for the region points" );
+        return MOSAIC_ERROR;
+    }
+
+    gctp_call_xform_array( xform, npoints, lon, lat, lon, lat, pstatus );
+    for ( p = 0; p < npoints; p++ )
+        if ( pstatus[p] != E_GEO_SUCC )
+            break;
+    free( pstatus );
+    if ( p < npoints )
+    {
+        sprintf( errmsg, "Region %.200s can't be projected to the tiles",
+            name );
+        ErrorHandler( FALSE, "AddRegion", ERROR_GENERAL, errmsg );
+        return MOSAIC_SUCCESS;
+    }
+
+    if ( *nregions == *nalloc )
+    {
+        *nalloc = *nalloc ? 2 * *nalloc : 64;
+        more = ( double * ) realloc( *regions, *nalloc * 4 *
+            sizeof( double ) );
+        if ( more == NULL )
+        {
+            ErrorHandler( FALSE, "AddRegion", ERROR_MEMORY,
+                "Error allocating memory for the regions" );
+            return MOSAIC_ERROR;
+        }
+        *regions = more;
+    }
+
+    r = &( *regions )[4 * ( *nregions )++];
+    r[0] = r[2] = lon[0];
+    r[1] = r[3] = lat[0];
+    for ( p = 1; p < npoints; p++ )
+    {
+        if ( lon[p] < r[0] )
+            r[0] = lon[p];
+        if ( lon[p] > r[2] )
+            r[2] = lon[p];
+        if ( lat[p] < r[1] )
+            r[1] = lat[p];
+        if ( lat[p] > r[3] )
+            r[3] = lat[p];
+    }
+
+    return MOSAIC_SUCCESS;
+}
+
+/******************************************************************************
+
+MODULE:  ReadShapeRegions
+
+PURPOSE:  Read the regions from the polygons of a shapefile
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+MOSAIC_SUCCESS  Successful completion
+MOSAIC_ERROR    Error in processing
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The listed codes are looked up on MOSAIC_REGION_FIELD with the shape
+  index (shp_index.c), the way mrtcrop finds its counties.
+
+******************************************************************************/
+static int ReadShapeRegions
+(
+    char *shape_filename,      /* I: shapefile of the regions */
+    char *list_filename,       /* I: file of region codes, or NULL for all
+                                     the shapes */
+    GctpXform *xform,          /* I/O: lat/long to tile transformation */
+    double **regions,          /* I/O: boxes of the regions */
+    int *nregions,             /* I/O: number of regions */
+    int *nalloc                /* I/O: regions allocated */
+)
+
+{
+    ShapeFile *shape;             /* the shapefile */
+    ShapeIndex *index = NULL;     /* the shapes by code */
+    ShapePolygon *polygon;        /* a region */
+    FILE *list = NULL;            /* list of codes */
+    char code[SMALL_STRING];      /* a region code */
+    char errmsg[LARGE_STRING];    /* error message */
+    int record = -1;              /* shape of the region */
+    int status = MOSAIC_SUCCESS;  /* return status */
+
+    shape = OpenShapeFile( shape_filename );
+    if ( shape == NULL )
+        return MOSAIC_ERROR;
+
+    if ( list_filename )
+    {
+        index = OpenShapeIndex( shape, MOSAIC_REGION_FIELD );
+        list = fopen( list_filename, "r" );
+        if ( index == NULL || list == NULL )
+        {
+            sprintf( errmsg, "Unable to look up the regions in %.200s",
+                list_filename );
+            ErrorHandler( FALSE, "ReadShapeRegions", ERROR_GENERAL, errmsg );
+            if ( list )
+                fclose( list );
+            CloseShapeIndex( index );
+            CloseShapeFile( shape );
+            return MOSAIC_ERROR;
+        }
+    }
+
+    while ( status == MOSAIC_SUCCESS )
+    {
+        /* the next listed region, or the next shape */
+        if ( list )
+        {
+            if ( fscanf( list, "%255s", code ) != 1 )
+                break;
+            record = FindShapeRecord( index, code );
+            if ( record < 0 )
+            {
+                sprintf( errmsg, "Region %.200s is not in the shapefile",
+                    code );
+                ErrorHandler( FALSE, "ReadShapeRegions", ERROR_GENERAL,
+                    errmsg );
+                continue;
+            }
+        }
+        else
+        {
+            if ( ++record >= shape->nrecords )
+                break;
+            sprintf( code, "%d", record );
+        }
+
+        polygon = ReadShapePolygon( shape, record );
+        if ( polygon == NULL )
+        {
+            status = MOSAIC_ERROR;
+            break;
+        }
+        status = AddRegion( xform, polygon->npoints, polygon->x, polygon->y,
+            code, regions, nregions, nalloc );
+        FreeShapePolygon( polygon );
+    }
+
+    if ( list )
+        fclose( list );
+    if ( index )
+        CloseShapeIndex( index );
+    CloseShapeFile( shape );
+
+    return status;
+}
+
+/******************************************************************************
+
+MODULE:  ReadBoxRegions
+
+PURPOSE:  Read the regions from a file of lat/long boxes
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+MOSAIC_SUCCESS  Successful completion
+MOSAIC_ERROR    Error in processing
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The edges of each box are followed with REGION_EDGE_POINTS points, since
+  a line of latitude or longitude isn't straight in the tile projection,
+  and the equator is added when the box crosses it (where a SIN box is
+  widest).
+
+******************************************************************************/
+static int ReadBoxRegions
+(
+    char *box_filename,        /* I: file of lat/long boxes */
+    GctpXform *xform,          /* I/O: lat/long to tile transformation */
+    double **regions,          /* I/O: boxes of the regions */
+    int *nregions,             /* I/O: number of regions */
+    int *nalloc                /* I/O: regions allocated */
+)
+
+{
+    FILE *fp;                     /* the box file */
+    char line[LARGE_STRING];      /* a line of the file */
+    char errmsg[LARGE_STRING];    /* error message */
+    char first;                   /* first character of a line */
+    double ul_lat, ul_lon, lr_lat, lr_lon;  /* corners of a box */
+    double lon[4 * REGION_EDGE_POINTS + 2];  /* points around the box */
+    double lat[4 * REGION_EDGE_POINTS + 2];
+    double t;                     /* distance along an edge */
+    int nline = 0;                /* line number */
+    int n, p;                     /* points around the box */
+    int status = MOSAIC_SUCCESS;  /* return status */
+
+    fp = fopen( box_filename, "r" );
+    if ( fp == NULL )
+    {
+        sprintf( errmsg, "Unable to open %.200s", box_filename );
+        ErrorHandler( FALSE, "ReadBoxRegions", ERROR_GENERAL, errmsg );
+        return MOSAIC_ERROR;
+    }
+
+    while ( status == MOSAIC_SUCCESS && fgets( line, sizeof( line ), fp ) )
+    {
+        nline++;
+        if ( sscanf( line, " %c", &first ) != 1 || first == '#' )
+            continue;
+
+        if ( sscanf( line, "%lf %lf %lf %lf", &ul_lat, &ul_lon, &lr_lat,
+                &lr_lon ) != 4 || ul_lat < lr_lat || ul_lon > lr_lon ||
+             ul_lat > 90.0 || lr_lat < -90.0 || ul_lon < -180.0 ||
+             lr_lon > 180.0 )
+        {
+            sprintf( errmsg, "Bad box on line %d of %.200s (expected "
+                "ul_lat ul_lon lr_lat lr_lon)", nline, box_filename );
+            ErrorHandler( FALSE, "ReadBoxRegions", ERROR_GENERAL, errmsg );
+            status = MOSAIC_ERROR;
+            break;
+        }
+
+        n = 0;
+        for ( p = 0; p < REGION_EDGE_POINTS; p++ )
+        {
+            t = ( double ) p / REGION_EDGE_POINTS;
+            lat[n] = ul_lat;
+            lon[n++] = ul_lon + t * ( lr_lon - ul_lon );
+            lat[n] = ul_lat + t * ( lr_lat - ul_lat );
+            lon[n++] = lr_lon;
+            lat[n] = lr_lat;
+            lon[n++] = lr_lon + t * ( ul_lon - lr_lon );
+            lat[n] = lr_lat + t * ( ul_lat - lr_lat );
+            lon[n++] = ul_lon;
+        }
+        if ( ul_lat > 0.0 && lr_lat < 0.0 )
+        {
+            lat[n] = 0.0;
+            lon[n++] = ul_lon;
+            lat[n] = 0.0;
+            lon[n++] = lr_lon;
+        }
+
+        sprintf( errmsg, "%d", nline );
+        status = AddRegion( xform, n, lon, lat, errmsg, regions, nregions,
+            nalloc );
+    }
+
+    fclose( fp );
+    return status;
+}
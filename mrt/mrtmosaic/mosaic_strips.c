@@ -0,0 +1,451 @@
+/******************************************************************************
+
+FILE:  mosaic_strips.c
+
+PURPOSE:  Mosaic raw binary tiles on several threads, one strip of tiles of
+          one band at a time
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development (from the band
+                                       and strip loops of MosaicTiles)
+         10/26                         Only read the strips and rows of the
+                                       lines a mosaic is cut to
+
+HARDWARE AND/OR SOFTWARE LIMITATIONS:
+  Requires POSIX threads
+
+PROJECT:    MODIS Reprojection Tool
+
+NOTES:
+  1. A strip is one row of tiles (one v) of one band.  The strips of all
+     the selected bands are put in one list, band by band, and each thread
+     takes the next strip in the list until there are none left.
+  2. Each band is a separate raw binary output file.  They are all opened
+     (in band order, so the messages are the same as MosaicTiles') before
+     the threads start and closed after they are done.  A strip's rows go
+     straight to their place in the file with WriteRowMultiFileAt, so the
+     threads never wait for each other to write and the output is the same
+     as MosaicTiles' no matter how many threads are used.
+  3. Each thread opens the input tiles of its strip itself, so no file
+     descriptor or read buffer is shared between the threads.
+  4. HDF-EOS mosaics aren't done here.  The HDF library can't be used by
+     more than one thread at a time and both the inputs and the output of
+     an HDF-EOS mosaic are HDF-EOS files, so every read and write would
+     have to go through one lock anyway; MosaicTiles' single writer is
+     used for them instead.
+
+******************************************************************************/
+#include <pthread.h>
+#include <unistd.h>
+#include "worgen.h"
+#include "mosaic.h"
+#include "mrt_dtype.h"
+
+/* an output band being mosaicked */
+typedef struct
+{
+    size_t band;                /* band number in the mosaic descriptor */
+    FileDescriptor *output;     /* raw binary output file of the band */
+    size_t nrows;               /* number of rows in a strip */
+    size_t first_line;          /* line of the tile mosaic the output
+                                   starts at */
+    size_t end_line;            /* line of the tile mosaic the output ends
+                                   before */
+    size_t tile_ncols;          /* number of columns of a missing tile */
+    char *background;           /* background fill of a missing tile in
+                                   the output data type */
+}
+StripBandType;
+
+/* strips shared between the threads */
+typedef struct
+{
+    pthread_mutex_t mutex;      /* protects the rest of this structure */
+    int numh_tiles;             /* number of horiz tiles in the mosaic */
+    int numv_tiles;             /* number of vert tiles in the mosaic */
+    int **tile_array;           /* input file of each tile location */
+    MosaicDescriptor *infiles;  /* file descriptor array for the inputs */
+    StripBandType *bands;       /* selected output bands */
+    size_t nstrips;             /* number of strips in all the bands */
+    size_t next_strip;          /* next strip to be mosaicked */
+    size_t ndone;               /* number of strips mosaicked */
+    size_t tenths;              /* tenths of the strips reported as done */
+}
+StripQueueType;
+
+/* state of each thread */
+typedef struct
+{
+    StripQueueType *queue;      /* strips shared with the other threads */
+    FileDescriptor **input;     /* input tiles of the current strip */
+    pthread_t thread;           /* thread id */
+}
+StripWorkerType;
+
+/******************************************************************************
+
+MODULE:  MosaicStrip
+
+PURPOSE:  Mosaic one strip of tiles of one band into its output file
+
+RETURN VALUE:
+Type = None
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development (from the strip
+                                       loop of MosaicTiles)
+
+NOTES:
+  Errors are fatal, as in MosaicTiles.  A strip outside the lines being
+  mosaicked isn't opened at all.
+
+******************************************************************************/
+static void MosaicStrip
+(
+    StripQueueType *q,          /* I: strips shared between the threads */
+    StripBandType *b,           /* I: band of the strip */
+    int v,                      /* I: vertical tile number of the strip */
+    FileDescriptor **input      /* I/O: input tiles (numh_tiles) */
+)
+
+{
+    MosaicDescriptor *mosaicfile;   /* input file of a tile */
+    FileDescriptor *output = b->output;  /* output file of the band */
+    int h;                          /* looping variable */
+    int status = MRT_NO_ERROR;      /* return status error code */
+    int curr_infile;                /* location in infiles of a tile */
+    size_t currow;                  /* looping variable */
+    size_t first_row, end_row;      /* rows of the strip in the output */
+    size_t outcol;                  /* output column value for current row */
+    double *buffer;                 /* row conversion buffer */
+    char *outrow;                   /* output row in the output data type */
+    char errstr[SMALL_STRING];      /* string for error messages */
+
+    /* skip the strip if it's outside the lines being mosaicked */
+    if ( ( v + 1 ) * b->nrows <= b->first_line ||
+         v * b->nrows >= b->end_line )
+        return;
+    first_row = b->first_line > v * b->nrows ?
+        b->first_line - v * b->nrows : 0;
+    end_row = b->end_line < ( v + 1 ) * b->nrows ?
+        b->end_line - v * b->nrows : b->nrows;
+
+    buffer = ( double * ) calloc( output->ncols, sizeof( double ) );
+    outrow = ( char * ) malloc( output->ncols * output->datasize );
+    if ( buffer == NULL || outrow == NULL )
+    {
+        ErrorHandler( TRUE, "MosaicStrip", ERROR_MEMORY,
+            "Error allocating space for the input/output row buffer" );
+    }
+
+    /* open all the horizontal tiles for this vertical set */
+    for ( h = 0; h < q->numh_tiles; h++ )
+    {
+        input[h] = NULL;
+        curr_infile = q->tile_array[v][h];
+        if ( curr_infile == -9 )
+            continue;
+
+        mosaicfile = &q->infiles[curr_infile];
+        input[h] = OpenInImageMosaic( mosaicfile, b->band, b->band, &status );
+        if ( input[h] == NULL || status != MRT_NO_ERROR )
+        {
+            sprintf( errstr, "Error opening raw binary image: %s\n",
+                mosaicfile->filename );
+            ErrorHandler( TRUE, "MosaicStrip", ERROR_OPEN_INPUTIMAGE,
+                errstr );
+        }
+
+        /* clear buffers to avoid reading data from previous band */
+        ClobberFileBuffers( input[h] );
+
+        /* pick the input conversion in case the data types differ */
+        if ( !SelectRowConverters( input[h] ) )
+        {
+            sprintf( errstr, "Unsupported data type in input file: %s\n",
+                mosaicfile->filename );
+            ErrorHandler( TRUE, "MosaicStrip", ERROR_OPEN_INPUTIMAGE,
+                errstr );
+        }
+    }
+
+    /* put each row together from the tiles and write it to its place in
+       the output file */
+    for ( currow = first_row; currow < end_row; currow++ )
+    {
+        outcol = 0;
+        for ( h = 0; h < q->numh_tiles; h++ )
+        {
+            if ( input[h] != NULL )
+            {
+                CopyMosaicRow( input[h], currow, output, buffer,
+                    &outrow[outcol * output->datasize] );
+                outcol += input[h]->ncols;
+            }
+            else
+            {
+                memcpy( &outrow[outcol * output->datasize], b->background,
+                    b->tile_ncols * output->datasize );
+                outcol += b->tile_ncols;
+            }
+        }
+
+        if ( !WriteRowMultiFileAt( output,
+            currow + v * b->nrows - b->first_line, outrow ) )
+        {
+            ErrorHandler( TRUE, "MosaicStrip", ERROR_GENERAL,
+                "Error writing the mosaicked row to the output file." );
+        }
+    }
+
+    /* close all the horizontal files */
+    for ( h = 0; h < q->numh_tiles; h++ )
+    {
+        if ( input[h] != NULL )
+        {
+            CloseFile( input[h] );
+            input[h] = NULL;
+        }
+    }
+
+    free( buffer );
+    free( outrow );
+}
+
+/******************************************************************************
+
+MODULE:  MosaicStripWorker
+
+PURPOSE:  Mosaic strips until there are none left
+
+RETURN VALUE:
+Type = void *
+Value           Description
+-----           -----------
+NULL            Always
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+
+******************************************************************************/
+static void *MosaicStripWorker
+(
+    void *arg                   /* I/O: StripWorkerType for this thread */
+)
+
+{
+    StripWorkerType *w = ( StripWorkerType * ) arg;  /* worker */
+    StripQueueType *q = w->queue;   /* shared strips */
+    size_t strip;                   /* strip being mosaicked */
+
+    while ( 1 )
+    {
+        /* claim the next strip */
+        pthread_mutex_lock( &q->mutex );
+        if ( q->next_strip >= q->nstrips )
+        {
+            pthread_mutex_unlock( &q->mutex );
+            break;
+        }
+        strip = q->next_strip++;
+        pthread_mutex_unlock( &q->mutex );
+
+        MosaicStrip( q, &q->bands[strip / q->numv_tiles],
+            ( int ) ( strip % q->numv_tiles ), w->input );
+
+        /* update status? (every 10%) */
+        pthread_mutex_lock( &q->mutex );
+        q->ndone++;
+        while ( q->tenths < 9 && q->tenths < 10 * q->ndone / q->nstrips )
+        {
+            q->tenths++;
+            fprintf( stdout, " " MRT_SIZE_T_FMT "%%", 10 * q->tenths );
+            fflush( stdout );
+        }
+        pthread_mutex_unlock( &q->mutex );
+    }
+
+    return ( NULL );
+}
+
+/******************************************************************************
+
+MODULE:  MosaicStrips
+
+PURPOSE:  Mosaic raw binary tiles together on several threads, filling in
+          empty tiles with the background fill value in the first tile.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+MOSAIC_SUCCESS  Successful completion
+MOSAIC_ERROR    Error in processing
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development (from
+                                       MosaicTiles)
+
+NOTES:
+  1. nthreads of 0 means one thread per online processor.  No more threads
+     are used than there are strips.
+  2. The calling thread is one of the workers.
+
+******************************************************************************/
+int MosaicStrips
+(
+    int numh_tiles,      /* I: number of horiz tiles in the mosaic */
+    int numv_tiles,      /* I: number of vert tiles in the mosaic */
+    int **tile_array,    /* I: 2D array of size [numv_tiles][numh_tiles]
+                               specifying which input file represents that
+                               tile location */
+    MosaicDescriptor infiles[],
+                         /* I: file descriptor array for the input files */
+    MosaicDescriptor *mosaicfile,
+                         /* I: file descriptor for the output mosaic file */
+    int nthreads         /* I: number of threads (0 = one per processor) */
+)
+
+{
+    StripQueueType q;               /* strips shared between the threads */
+    StripWorkerType *workers;       /* state of each thread */
+    StripBandType *b;               /* band being set up */
+    size_t curband;                 /* looping variable */
+    size_t nbands = 0;              /* number of selected bands */
+    int outmulti_band = 0;          /* index for band num in the output image */
+    int status = MRT_NO_ERROR;      /* return status error code */
+    int t;                          /* looping variable */
+    int nstarted = 0;               /* last worker thread started */
+    double *buffer;                 /* background fill conversion buffer */
+
+    memset( &q, 0, sizeof( q ) );
+    q.numh_tiles = numh_tiles;
+    q.numv_tiles = numv_tiles;
+    q.tile_array = tile_array;
+    q.infiles = infiles;
+    q.bands = ( StripBandType * ) calloc( mosaicfile->nbands,
+        sizeof( StripBandType ) );
+    if ( q.bands == NULL )
+    {
+        ErrorHandler( TRUE, "MosaicStrips", ERROR_MEMORY,
+            "Error allocating memory for the output bands" );
+    }
+
+    /* open the output file of each selected band */
+    for ( curband = 0; curband < mosaicfile->nbands; curband++ )
+    {
+        if ( !mosaicfile->bandinfo[curband].selected )
+            continue;
+
+        MessageHandler( "\nMosaic", "processing band %s",
+            mosaicfile->bandinfo[curband].name );
+
+        b = &q.bands[nbands++];
+        b->band = curband;
+        b->output = OpenOutImageMosaic( mosaicfile, curband, outmulti_band++,
+            &status );
+        if ( b->output == NULL )
+        {
+            ErrorHandler( TRUE, "MosaicStrips", ERROR_OPEN_OUTPUTIMAGE,
+                "Error creating the output file descriptor" );
+        }
+
+        /* the output rows are put together in the output data type, with
+           missing tiles filled with the background fill value of the first
+           input file */
+        if ( !SelectRowConverters( b->output ) )
+        {
+            ErrorHandler( TRUE, "MosaicStrips", ERROR_GENERAL,
+                "Unsupported output data type" );
+        }
+        b->nrows = infiles[0].bandinfo[curband].nlines;
+        b->first_line = mosaicfile->first_line[curband];
+        b->end_line = b->first_line + mosaicfile->bandinfo[curband].nlines;
+        b->tile_ncols = mosaicfile->bandinfo[curband].nsamples / numh_tiles;
+        buffer = ( double * ) calloc( b->tile_ncols, sizeof( double ) );
+        b->background = ( char * ) malloc( b->tile_ncols *
+            b->output->datasize );
+        if ( buffer == NULL || b->background == NULL )
+        {
+            ErrorHandler( TRUE, "MosaicStrips", ERROR_MEMORY,
+                "Error allocating space for the output row buffer" );
+        }
+        FillBufferBackground( &mosaicfile->bandinfo[curband], numh_tiles,
+            buffer );
+        b->output->write_convert( buffer, b->background, b->tile_ncols );
+        free( buffer );
+    }
+    q.nstrips = nbands * numv_tiles;
+
+    if ( nthreads <= 0 )
+        nthreads = ( int ) sysconf( _SC_NPROCESSORS_ONLN );
+    if ( ( size_t ) nthreads > q.nstrips )
+        nthreads = ( int ) q.nstrips;
+    if ( nthreads < 1 )
+        nthreads = 1;
+
+    workers = ( StripWorkerType * ) calloc( nthreads,
+        sizeof( StripWorkerType ) );
+    if ( workers == NULL )
+    {
+        ErrorHandler( TRUE, "MosaicStrips", ERROR_MEMORY,
+            "Error allocating memory for the mosaic threads" );
+    }
+    for ( t = 0; t < nthreads; t++ )
+    {
+        workers[t].queue = &q;
+        workers[t].input = ( FileDescriptor ** ) calloc( numh_tiles,
+            sizeof( FileDescriptor * ) );
+        if ( workers[t].input == NULL )
+        {
+            ErrorHandler( TRUE, "MosaicStrips", ERROR_MEMORY,
+                "Error allocating memory for the horizontal input tiles" );
+        }
+    }
+    pthread_mutex_init( &q.mutex, NULL );
+
+    /* the calling thread is the first worker */
+    MessageHandler( "\nMosaic", "using %d threads", nthreads );
+    fprintf( stdout, "%% complete (" MRT_SIZE_T_FMT " strips): 0%%",
+             q.nstrips );
+    fflush( stdout );
+    for ( t = 1; t < nthreads; t++ )
+    {
+        if ( pthread_create( &workers[t].thread, NULL, MosaicStripWorker,
+            &workers[t] ) == 0 )
+            nstarted = t;
+        else
+            break;
+    }
+    MosaicStripWorker( &workers[0] );
+    for ( t = 1; t <= nstarted; t++ )
+        pthread_join( workers[t].thread, NULL );
+
+    fprintf( stdout, " 100%%\n" );
+    fflush( stdout );
+
+    for ( t = 0; t < nthreads; t++ )
+        free( workers[t].input );
+    free( workers );
+    pthread_mutex_destroy( &q.mutex );
+
+    /* close the output files */
+    for ( curband = 0; curband < nbands; curband++ )
+    {
+        CloseFile( q.bands[curband].output );
+        free( q.bands[curband].background );
+    }
+    free( q.bands );
+
+    return MOSAIC_SUCCESS;
+}
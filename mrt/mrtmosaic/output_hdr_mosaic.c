@@ -16,6 +16,7 @@ Version  Date   Programmer       Code  Reason
          06/02  Gail Schmidt           Original development
          07/02  Gail Schmidt           Allow the output filename to be
                                        specified
+         10/26                         Added OutputVirtualHdrMosaic
 
 HARDWARE AND/OR SOFTWARE LIMITATIONS:
   None
@@ -137,3 +138,87 @@ int OutputHdrMosaic
 
     return ( MOSAIC_SUCCESS );
 }
+
+
+/******************************************************************************
+
+MODULE:  OutputVirtualHdrMosaic
+
+PURPOSE:  Write a virtual mosaic header: the mosaic .hdr file plus the list
+          of its tiles
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+MOSAIC_SUCCESS  Successful completion
+MOSAIC_ERROR    Error in processing
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The resampler reads a virtual mosaic straight from its tiles, so nothing
+  is mosaicked.  The tiles are listed as MOSAIC_TILES = ( numh numv ... ),
+  one per line, in the order of tile_array, with NONE for a missing tile.
+  The file names are written as they were given in the input file list.
+
+******************************************************************************/
+
+int OutputVirtualHdrMosaic
+(
+    MosaicDescriptor *mosaic,  /* I: mosaic info */
+    char *output_filename,     /* I: name of the .hdr file */
+    int numh_tiles,            /* I: number of horiz tiles in the mosaic */
+    int numv_tiles,            /* I: number of vert tiles in the mosaic */
+    int **tile_array,          /* I: 2D array of size [numv_tiles][numh_tiles]
+                                     specifying which input file represents
+                                     that tile location */
+    MosaicDescriptor infiles[] /* I: file descriptor array for the input
+                                     files */
+)
+
+{
+    int h, v;
+    FILE *fp;                  /* header file */
+    char errmsg[2 * LARGE_STRING];  /* error message */
+
+    /* write the header of the mosaic as if it had been made */
+    if ( OutputHdrMosaic( mosaic, output_filename ) != MOSAIC_SUCCESS )
+        return MOSAIC_ERROR;
+
+    /* and add the tiles */
+    fp = fopen( output_filename, "a" );
+    if ( fp == NULL )
+    {
+        sprintf( errmsg, "Unable to open %s", output_filename );
+        ErrorHandler( FALSE, "OutputVirtualHdrMosaic",
+            ERROR_OPEN_OUTPUTHEADER, errmsg );
+        return MOSAIC_ERROR;
+    }
+
+    fprintf( fp, "\nMOSAIC_TILES = ( %d %d\n", numh_tiles, numv_tiles );
+    for ( v = 0; v < numv_tiles; v++ )
+    {
+        for ( h = 0; h < numh_tiles; h++ )
+        {
+            if ( tile_array[v][h] != -9 )
+                fprintf( fp, "    %s\n", infiles[tile_array[v][h]].filename );
+            else
+                fprintf( fp, "    NONE\n" );
+        }
+    }
+    fprintf( fp, ")\n" );
+
+    if ( fclose( fp ) != 0 )
+    {
+        sprintf( errmsg, "Unable to write %s", output_filename );
+        ErrorHandler( FALSE, "OutputVirtualHdrMosaic",
+            ERROR_OPEN_OUTPUTHEADER, errmsg );
+        return MOSAIC_ERROR;
+    }
+
+    return ( MOSAIC_SUCCESS );
+}
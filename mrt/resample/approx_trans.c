@@ -0,0 +1,454 @@
+/******************************************************************************
+
+FILE:  approx_trans.c
+
+PURPOSE:  Map a row of output pixels back to input line/sample space, either
+          exactly (one projection call per pixel) or approximately (linear
+          interpolation between a sparse set of exactly projected control
+          points, subdivided until a maximum error is met)
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+         10/26                         Use a pre-initialized GCTP
+                                       transformation rather than gctp_call
+         10/26                         The exact transformer projects the row
+                                       in batches with gctp_call_xform_array
+
+HARDWARE AND/OR SOFTWARE LIMITATIONS:
+  None
+
+PROJECT:    MODIS Reprojection Tool
+
+NOTES:
+  1. The approximate transformer is only used if APPROX_MAX_ERROR was
+     specified in the parameter file with a value greater than zero.  The
+     default (0.0) projects every output pixel exactly.
+  2. Each output row is broken into segments of APPROX_GRID_STEP pixels.
+     Both ends of a segment are projected exactly, as is the middle pixel.
+     If the middle pixel falls within APPROX_MAX_ERROR input pixels of the
+     line/sample interpolated from the ends, then the rest of the segment
+     is interpolated.  Otherwise the segment is split in half and each half
+     is checked the same way.
+  3. If any control point falls outside the projection (GCTP_ERANGE or
+     IN_BREAK), then every pixel in that segment is projected exactly so
+     the edges of the valid projection space are handled the same as the
+     exact transformer.
+  4. Unless a datum conversion is being done, the exact transformer
+     projects MAP_BATCH pixels at a time with gctp_call_xform_array, which
+     gives the same results as projecting them one at a time.
+  5. c_transinit must already have been called (output to input) if a datum
+     conversion is being done.  Otherwise the output to input GCTP
+     transformation must have been set up with gctp_call_init.
+
+******************************************************************************/
+#include <math.h>
+#include "resample.h"
+#include "worgen.h"
+#include "cproj.h"
+
+/* number of output pixels between the control points on each row */
+#define APPROX_GRID_STEP 64
+
+/* number of output pixels projected in one gctp_call_xform_array call */
+#define MAP_BATCH 256
+
+/* information needed for mapping the pixels of a single output row */
+typedef struct
+{
+    ModisDescriptor *modis;     /* session info */
+    GctpXform *xform;           /* output to input GCTP transformation */
+    double outy;                /* output northing for the row */
+    double out_ulx;             /* output easting of the UL extent */
+    double out_pixel_size;      /* output pixel size */
+    double upleft_x, upleft_y;  /* UL input projection coords */
+    double in_pixel_size;       /* input pixel size */
+    double max_error;           /* max error in input pixels */
+    double *incol;              /* input sample for each output pixel */
+    double *inrow;              /* input line for each output pixel */
+    int *valid;                 /* does the output pixel map to input? */
+}
+RowMapType;
+
+/******************************************************************************
+
+MODULE:  MapOutputPixel
+
+PURPOSE:  Project a single output pixel back to input line/sample
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+E_GEO_SUCC      Pixel was mapped, or it fell outside the projection in which
+                case valid[j] is FALSE
+other           Error code from c_trans or gctp_call_xform
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+
+******************************************************************************/
+static int MapOutputPixel
+(
+    RowMapType *rm,             /* I/O: row mapping info */
+    size_t j                    /* I: output column to map */
+)
+
+{
+    ProjInfo *inproj, *outproj; /* input/output projection data for geolib */
+    int status;                 /* return status error code */
+    double inx, iny, outx, outy;/* input/output coordinates */
+
+    inproj = rm->modis->in_projection_info;
+    outproj = rm->modis->out_projection_info;
+
+    /* easting for this pixel. pass the center of the pixel rather than the
+       outer extent. */
+    outx = rm->out_ulx + j * rm->out_pixel_size + rm->out_pixel_size * 0.5;
+    outy = rm->outy;
+
+    if ( rm->modis->output_datum_code != E_NODATUM )
+    {
+        status = c_trans( &outproj->proj_code, &outproj->units,
+            &inproj->proj_code, &inproj->units, &outx, &outy, &inx, &iny );
+    }
+    else
+    {
+        /* Call GCTP directly to allow the semi-major and semi-minor
+           to be specified directly.  The transformation was set up once
+           by the caller. */
+        status = gctp_call_xform( rm->xform, outx, outy, &inx, &iny );
+    }
+
+    if ( status == GCTP_ERANGE || status == IN_BREAK )
+    {   /* The value was out of range for the projection so it will
+           be a background pixel. */
+        rm->valid[j] = FALSE;
+        return ( E_GEO_SUCC );
+    }
+    else if ( status != E_GEO_SUCC )
+        return ( status );
+
+    /* get input line/sample - don't round since our input UL coordinates
+       refer to the outer extent of the pixel */
+    rm->incol[j] = ( inx - rm->upleft_x ) / rm->in_pixel_size;
+    rm->inrow[j] = ( rm->upleft_y - iny ) / rm->in_pixel_size;
+    rm->valid[j] = TRUE;
+
+    return ( E_GEO_SUCC );
+}
+
+/******************************************************************************
+
+MODULE:  MapSegmentExact
+
+PURPOSE:  Project every pixel strictly between two output columns
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+E_GEO_SUCC      Successful completion
+other           Error code from c_trans or gctp_call_xform
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+
+******************************************************************************/
+static int MapSegmentExact
+(
+    RowMapType *rm,             /* I/O: row mapping info */
+    size_t j0,                  /* I: first column (already mapped) */
+    size_t j1,                  /* I: last column (already mapped) */
+    size_t skip                 /* I: column which is already mapped (or j0
+                                      if there isn't one) */
+)
+
+{
+    int status;                 /* return status error code */
+    size_t j;                   /* output column */
+
+    for ( j = j0 + 1; j < j1; j++ )
+    {
+        if ( j == skip )
+            continue;
+
+        status = MapOutputPixel( rm, j );
+        if ( status != E_GEO_SUCC )
+            return ( status );
+    }
+
+    return ( E_GEO_SUCC );
+}
+
+/******************************************************************************
+
+MODULE:  MapRowBatch
+
+PURPOSE:  Project every pixel of an output row, MAP_BATCH pixels at a time
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+E_GEO_SUCC      Successful completion
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Only used when there is no datum conversion.  The output coordinates are
+  built in incol/inrow, which are projected in place and then converted to
+  input line/sample.
+
+******************************************************************************/
+static int MapRowBatch
+(
+    RowMapType *rm,             /* I/O: row mapping info */
+    size_t ncols                /* I: number of output columns */
+)
+
+{
+    long status[MAP_BATCH];     /* projection status of each pixel */
+    size_t j0;                  /* first column of the batch */
+    size_t j;                   /* output column */
+    long i, n;                  /* pixel in the batch, batch size */
+    double *x, *y;              /* coordinates of the batch */
+
+    for ( j0 = 0; j0 < ncols; j0 += MAP_BATCH )
+    {
+        n = ( ncols - j0 < MAP_BATCH ) ? (long) ( ncols - j0 ) : MAP_BATCH;
+        x = &rm->incol[j0];
+        y = &rm->inrow[j0];
+
+        /* eastings for this batch. pass the center of the pixel rather
+           than the outer extent. */
+        for ( i = 0; i < n; i++ )
+        {
+            j = j0 + i;
+            x[i] = rm->out_ulx + j * rm->out_pixel_size +
+                rm->out_pixel_size * 0.5;
+            y[i] = rm->outy;
+        }
+
+        gctp_call_xform_array( rm->xform, n, x, y, x, y, status );
+
+        /* get input line/sample - don't round since our input UL
+           coordinates refer to the outer extent of the pixel.  Pixels out
+           of range for the projection will be background pixels. */
+        for ( i = 0; i < n; i++ )
+        {
+            x[i] = ( x[i] - rm->upleft_x ) / rm->in_pixel_size;
+            y[i] = ( rm->upleft_y - y[i] ) / rm->in_pixel_size;
+            rm->valid[j0 + i] = ( status[i] == E_GEO_SUCC );
+        }
+    }
+
+    return ( E_GEO_SUCC );
+}
+
+/******************************************************************************
+
+MODULE:  MapSegmentApprox
+
+PURPOSE:  Fill the pixels strictly between two exactly mapped output columns,
+          interpolating where the mapping is close enough to linear and
+          subdividing where it isn't
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+E_GEO_SUCC      Successful completion
+other           Error code from c_trans or gctp_call_xform
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Both j0 and j1 must be valid, exactly mapped pixels.  The recursion depth
+  is limited to log2(APPROX_GRID_STEP).
+
+******************************************************************************/
+static int MapSegmentApprox
+(
+    RowMapType *rm,             /* I/O: row mapping info */
+    size_t j0,                  /* I: first column (already mapped) */
+    size_t j1                   /* I: last column (already mapped) */
+)
+
+{
+    int status;                 /* return status error code */
+    size_t j;                   /* output column */
+    size_t mid;                 /* middle column of the segment */
+    double t;                   /* fraction of the way from j0 to j1 */
+    double dcol, drow;          /* change in sample/line from j0 to j1 */
+    double col_err, row_err;    /* error of the interpolated middle pixel */
+
+    /* nothing between the two columns */
+    if ( j1 - j0 < 2 )
+        return ( E_GEO_SUCC );
+
+    /* project the middle pixel exactly */
+    mid = j0 + ( j1 - j0 ) / 2;
+    status = MapOutputPixel( rm, mid );
+    if ( status != E_GEO_SUCC )
+        return ( status );
+
+    /* if the middle pixel isn't in the projection then the edge of the
+       projection is in this segment, so don't interpolate across it */
+    if ( !rm->valid[mid] )
+        return ( MapSegmentExact( rm, j0, j1, mid ) );
+
+    /* compare the exact middle pixel to the interpolated one */
+    dcol = rm->incol[j1] - rm->incol[j0];
+    drow = rm->inrow[j1] - rm->inrow[j0];
+    t = (double) ( mid - j0 ) / (double) ( j1 - j0 );
+    col_err = fabs( rm->incol[j0] + t * dcol - rm->incol[mid] );
+    row_err = fabs( rm->inrow[j0] + t * drow - rm->inrow[mid] );
+
+    if ( col_err > rm->max_error || row_err > rm->max_error )
+    {
+        /* not linear enough, so split the segment */
+        status = MapSegmentApprox( rm, j0, mid );
+        if ( status != E_GEO_SUCC )
+            return ( status );
+        return ( MapSegmentApprox( rm, mid, j1 ) );
+    }
+
+    /* linear enough, so interpolate the rest of the segment */
+    for ( j = j0 + 1; j < j1; j++ )
+    {
+        if ( j == mid )
+            continue;
+
+        t = (double) ( j - j0 ) / (double) ( j1 - j0 );
+        rm->incol[j] = rm->incol[j0] + t * dcol;
+        rm->inrow[j] = rm->inrow[j0] + t * drow;
+        rm->valid[j] = TRUE;
+    }
+
+    return ( E_GEO_SUCC );
+}
+
+/******************************************************************************
+
+MODULE:  MapOutputRow
+
+PURPOSE:  Map each pixel of an output row back to input line/sample space
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+E_GEO_SUCC      Successful completion
+other           Error code from c_trans or gctp_call_xform
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+         10/26                         Use MapRowBatch for the exact
+                                       transformer without a datum conversion
+
+NOTES:
+  Output pixels which fall outside the input projection have valid[j] set
+  to FALSE and should be filled with the background value.  incol/inrow are
+  not set for those pixels.
+
+******************************************************************************/
+int MapOutputRow
+(
+    ModisDescriptor *modis,     /* I: session info */
+    GctpXform *xform,           /* I/O: output to input GCTP transformation
+                                        (not used for datum conversions) */
+    FileDescriptor *input,      /* I: input file info */
+    FileDescriptor *output,     /* I: output file info */
+    size_t row,                 /* I: output row to map */
+    double upleft_x,            /* I: upper left input projection coord */
+    double upleft_y,            /* I: upper left input projection coord */
+    double *incol,              /* O: input sample for each output column */
+    double *inrow,              /* O: input line for each output column */
+    int *valid                  /* O: TRUE if the output pixel maps to a
+                                      valid input location */
+)
+
+{
+    RowMapType rm;              /* row mapping info */
+    int status;                 /* return status error code */
+    size_t j;                   /* output column */
+    size_t j0, j1;              /* control point columns */
+
+    rm.modis = modis;
+    rm.xform = xform;
+    rm.out_ulx = output->coord_corners[UL][0];
+    rm.out_pixel_size = output->output_pixel_size;
+    rm.upleft_x = upleft_x;
+    rm.upleft_y = upleft_y;
+    rm.in_pixel_size = input->pixel_size;
+    rm.max_error = modis->approx_max_error;
+    rm.incol = incol;
+    rm.inrow = inrow;
+    rm.valid = valid;
+
+    /* since we're on a grid, get output northing once. pass the center
+       of the pixel rather than the outer extent. */
+    rm.outy = output->coord_corners[UL][1] - row * output->output_pixel_size -
+        output->output_pixel_size * 0.5;
+
+    /* exact transformer: project every pixel */
+    if ( ( rm.max_error <= 0.0 || output->ncols < 2 ) &&
+         modis->output_datum_code == E_NODATUM )
+        return ( MapRowBatch( &rm, output->ncols ) );
+    if ( rm.max_error <= 0.0 || output->ncols < 2 )
+    {
+        for ( j = 0; j < output->ncols; j++ )
+        {
+            status = MapOutputPixel( &rm, j );
+            if ( status != E_GEO_SUCC )
+                return ( status );
+        }
+        return ( E_GEO_SUCC );
+    }
+
+    /* approximate transformer: walk the control points across the row */
+    j0 = 0;
+    status = MapOutputPixel( &rm, j0 );
+    if ( status != E_GEO_SUCC )
+        return ( status );
+
+    while ( j0 < output->ncols - 1 )
+    {
+        j1 = j0 + APPROX_GRID_STEP;
+        if ( j1 > output->ncols - 1 )
+            j1 = output->ncols - 1;
+
+        status = MapOutputPixel( &rm, j1 );
+        if ( status != E_GEO_SUCC )
+            return ( status );
+
+        if ( valid[j0] && valid[j1] )
+            status = MapSegmentApprox( &rm, j0, j1 );
+        else
+            status = MapSegmentExact( &rm, j0, j1, j0 );
+        if ( status != E_GEO_SUCC )
+            return ( status );
+
+        j0 = j1;
+    }
+
+    return ( E_GEO_SUCC );
+}
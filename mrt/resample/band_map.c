@@ -0,0 +1,710 @@
+/******************************************************************************
+
+FILE:  band_map.c
+
+PURPOSE:  Reuse the output geometry and the output to input mapping between
+          bands of the same resolution
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+         10/26                         Keep the mappings in the LUT cache
+                                       directory between runs
+         10/26                         Moved the LUT cache file handling to
+                                       lut_cache.c
+         10/26                         Keep the mapping between the jobs of
+                                       a batch run
+         10/26                         Keep the line/sample as floats, and
+                                       say when the mapping is too big
+
+HARDWARE AND/OR SOFTWARE LIMITATIONS:
+  None
+
+PROJECT:    MODIS Reprojection Tool
+
+NOTES:
+  1. The bands of a product which have the same resolution also have the
+     same input corners and size, so they get the same output corners and
+     every output pixel maps back to the same input line/sample.  Only the
+     pixel values differ.  Rather than walking the input boundary and
+     projecting every output pixel again for each band, the first band of a
+     resolution keeps its output corners and line/sample mapping here and
+     the following bands of that resolution use them as they are.
+  2. As with the ISIN shifts in the resamplers, the cache is kept in static
+     variables and is replaced when the resolution changes.  The corners
+     are forgotten after the last band, but the mapping is kept until the
+     end of the run (FreeBandMap), so the jobs of a batch run (-batch)
+     with the same grids map their bands only once.  The mapping's key is
+     its LUT header, which holds everything the mapping is derived from, so
+     a band which differs in any of them is simply mapped again.
+  3. The mapping takes 8 bytes per output pixel: the input sample and line
+     as floats, with a sample of MAP_NO_INPUT for pixels which don't map to
+     input.  A float keeps the line/sample to better than 1/100 of a pixel
+     for inputs of up to 100000 lines/samples, well inside the error of the
+     approximate transformer.  The band which fills in the mapping
+     resamples from the rounded values too (PutBandMapRow), and so do the
+     bands which aren't kept (RoundBandMapRow), so every band uses the
+     same locations whether or not its mapping was kept.  If the mapping
+     would be more than MAX_MAP_CACHE_SIZE, it isn't kept and each band is
+     mapped as before (the corners are still reused); a message says so.
+  4. A mapping is only used once a band has been completely resampled with
+     it.  The rows are filled in by the worker threads, each writing only
+     the rows it resamples.
+  5. If there is a LUT cache directory (see lut_cache.c), each completed
+     mapping is also written there as a lookup table file, and later runs
+     with the same geometry map that file into memory rather than
+     projecting anything.  The key holds everything the mapping is derived
+     from (projections, datums, approximation error, input and output
+     grids).  The resampling method isn't part of it, since NN, BI and CC
+     all use the same mapping.
+
+******************************************************************************/
+#include "resample.h"
+#ifndef WIN32
+#  include <sys/types.h>
+#  include <sys/mman.h>
+#endif
+
+/* identifies a mapping LUT cache file */
+#define LUT_MAGIC "MRTLUT2"
+
+/* bytes of mapping for each output pixel */
+#define MAP_PIXEL_BYTES ( 2 * sizeof( float ) )
+
+/* input sample kept for an output pixel which doesn't map to input */
+#define MAP_NO_INPUT -1.0e30f
+
+/* input and output geometry the cached corners are for */
+typedef struct
+{
+    ModisDescriptor *modis;     /* session info */
+    double in_pixel_size;       /* input pixel size */
+    size_t in_nrows, in_ncols;  /* input size */
+    double in_corners[4][2];    /* input projection corners */
+    double out_pixel_size;      /* output pixel size */
+}
+BandKeyType;
+
+/* key of a mapping LUT cache file.  The table is the input samples and
+   input lines of every output pixel, as floats. */
+typedef struct
+{
+    char magic[8];              /* LUT_MAGIC */
+    unsigned long byte_order;   /* LUT_BYTE_ORDER */
+    unsigned long header_size;  /* sizeof( LutHeaderType ) */
+    ProjInfo inproj, outproj;   /* input/output projections (no datum) */
+    long input_datum_code;      /* input datum */
+    long output_datum_code;     /* output datum (E_NODATUM if none) */
+    double approx_max_error;    /* approximate transformer error bound */
+    double in_pixel_size;       /* input pixel size */
+    size_t in_nrows, in_ncols;  /* input size */
+    double in_corners[4][2];    /* input projection corners */
+    double out_pixel_size;      /* output pixel size */
+    size_t out_nrows, out_ncols;  /* output size */
+    double upleft_x, upleft_y;  /* UL input projection coords */
+    double out_corners[4][2];   /* output projection corners */
+}
+LutHeaderType;
+
+/* output corners for the last resolution */
+static int have_corners = FALSE;
+static BandKeyType corner_key;
+static double out_corners[4][2];
+
+/* output to input mapping for the last resolution */
+static BandMapType band_map;
+
+/* LUT cache file of the mapping */
+static int lut_save = FALSE;    /* write the mapping once it's complete? */
+static LutHeaderType lut_header;  /* key of the mapping (in band_map too) */
+static char lut_name[LARGE_STRING];  /* LUT cache file name */
+static void *lut_map = NULL;    /* LUT cache file mapped into memory */
+static size_t lut_mapsize = 0;  /* size of lut_map */
+
+/******************************************************************************
+
+MODULE:  SetBandKey
+
+PURPOSE:  Fill in the key for the current band
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The key is cleared first so it can be compared with memcmp.
+
+******************************************************************************/
+static void SetBandKey
+(
+    ModisDescriptor *modis,     /* I: session info */
+    FileDescriptor *input,      /* I: input file info */
+    FileDescriptor *output,     /* I: output file info */
+    BandKeyType *key            /* O: key for this band */
+)
+
+{
+    memset( key, 0, sizeof( BandKeyType ) );
+    key->modis = modis;
+    key->in_pixel_size = input->pixel_size;
+    key->in_nrows = input->nrows;
+    key->in_ncols = input->ncols;
+    memcpy( key->in_corners, input->coord_corners, sizeof( key->in_corners ) );
+    key->out_pixel_size = output->output_pixel_size;
+}
+
+/******************************************************************************
+
+MODULE:  SetLutHeader
+
+PURPOSE:  Fill in the LUT cache file header (key) for a band
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The header is cleared first so it can be compared and hashed.
+
+******************************************************************************/
+static void SetLutHeader
+(
+    ResampleJob *job,           /* I: band being resampled */
+    LutHeaderType *header       /* O: key for this band */
+)
+
+{
+    ModisDescriptor *modis = job->modis;  /* session info */
+    FileDescriptor *input = job->input;   /* input file info */
+    FileDescriptor *output = job->output; /* output file info */
+
+    memset( header, 0, sizeof( LutHeaderType ) );
+    strcpy( header->magic, LUT_MAGIC );
+    header->byte_order = LUT_BYTE_ORDER;
+    header->header_size = sizeof( LutHeaderType );
+    header->inproj = *modis->in_projection_info;
+    header->inproj.datum_code = 0;
+    header->outproj = *modis->out_projection_info;
+    header->outproj.datum_code = 0;
+    header->input_datum_code = modis->input_datum_code;
+    header->output_datum_code = modis->output_datum_code;
+    header->approx_max_error = modis->approx_max_error;
+    header->in_pixel_size = input->pixel_size;
+    header->in_nrows = input->nrows;
+    header->in_ncols = input->ncols;
+    memcpy( header->in_corners, input->coord_corners,
+        sizeof( header->in_corners ) );
+    header->out_pixel_size = output->output_pixel_size;
+    header->out_nrows = output->nrows;
+    header->out_ncols = output->ncols;
+    header->upleft_x = job->upleft_x;
+    header->upleft_y = job->upleft_y;
+    memcpy( header->out_corners, output->coord_corners,
+        sizeof( header->out_corners ) );
+
+}
+
+/******************************************************************************
+
+MODULE:  LoadLutFile
+
+PURPOSE:  Use the mapping from a LUT cache file, if there is one for this
+          band
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            band_map holds the complete mapping from the file
+FALSE           No usable file
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The file is mapped into memory read-only where possible.  Otherwise (or
+  on Windows) the mapping is read into memory, if it isn't bigger than
+  MAX_MAP_CACHE_SIZE.
+
+******************************************************************************/
+static int LoadLutFile
+(
+    LutHeaderType *header,      /* I: key for this band */
+    char *name                  /* I: LUT cache file name */
+)
+
+{
+    FILE *fp;                   /* LUT cache file */
+    size_t npixels;             /* number of output pixels */
+    size_t filesize;            /* size of the file */
+    char *data;                 /* start of the mapping */
+    int ok;                     /* was the mapping read? */
+#ifndef WIN32
+    void *map;                  /* the file mapped into memory */
+#endif
+
+    npixels = header->out_nrows * header->out_ncols;
+    fp = OpenLutCacheFile( name, header, sizeof( LutHeaderType ),
+        npixels * MAP_PIXEL_BYTES );
+    if ( fp == NULL )
+        return ( FALSE );
+
+#ifndef WIN32
+    filesize = LUT_DATA_OFFSET( sizeof( LutHeaderType ) ) +
+        npixels * MAP_PIXEL_BYTES;
+    map = mmap( NULL, filesize, PROT_READ, MAP_PRIVATE, fileno( fp ), 0 );
+    if ( map != MAP_FAILED )
+    {
+        fclose( fp );
+        lut_map = map;
+        lut_mapsize = filesize;
+        data = ( char * ) map + LUT_DATA_OFFSET( sizeof( LutHeaderType ) );
+        band_map.incol = ( float * ) data;
+        band_map.inrow = ( float * ) ( data + npixels * sizeof( float ) );
+        return ( TRUE );
+    }
+#endif
+
+    /* read it instead */
+    if ( npixels > MAX_MAP_CACHE_SIZE / MAP_PIXEL_BYTES )
+    {
+        fclose( fp );
+        return ( FALSE );
+    }
+    band_map.incol = ( float * ) malloc( npixels * sizeof( float ) );
+    band_map.inrow = ( float * ) malloc( npixels * sizeof( float ) );
+    ok = band_map.incol != NULL && band_map.inrow != NULL &&
+         fread( band_map.incol, sizeof( float ), npixels, fp ) == npixels &&
+         fread( band_map.inrow, sizeof( float ), npixels, fp ) == npixels;
+    fclose( fp );
+    if ( !ok )
+    {
+        free( band_map.incol );
+        free( band_map.inrow );
+        band_map.incol = band_map.inrow = NULL;
+    }
+
+    return ( ok );
+}
+
+/******************************************************************************
+
+MODULE:  SaveLutFile
+
+PURPOSE:  Write the completed mapping to the LUT cache directory
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Failures are reported but aren't errors, the mapping just isn't kept.
+
+******************************************************************************/
+static void SaveLutFile
+(
+    void
+)
+
+{
+    size_t npixels;             /* number of output pixels */
+    void *arrays[2];            /* the arrays of the mapping */
+    size_t nbytes[2];           /* size of each array */
+
+    npixels = band_map.nrows * band_map.ncols;
+    arrays[0] = band_map.incol;
+    nbytes[0] = npixels * sizeof( float );
+    arrays[1] = band_map.inrow;
+    nbytes[1] = npixels * sizeof( float );
+
+    if ( WriteLutCacheFile( lut_name, &lut_header, sizeof( LutHeaderType ),
+        2, arrays, nbytes ) )
+        MessageHandler( NULL, "  saved the output to input mapping to %s",
+            lut_name );
+}
+
+/******************************************************************************
+
+MODULE:  GetBandOutputCorners
+
+PURPOSE:  Get the output projection corners, reusing those of the previous
+          band if it had the same geometry
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+status          See mrt_error.h for a complete list
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The input corners must have been set with GetInputImageCorners.
+
+******************************************************************************/
+int GetBandOutputCorners
+(
+    ModisDescriptor *modis,     /* I: session info */
+    FileDescriptor *output,     /* I/O: output file info */
+    FileDescriptor *input       /* I: input file info */
+)
+
+{
+    BandKeyType key;            /* geometry of this band */
+    int status;                 /* return status error code */
+
+    SetBandKey( modis, input, output, &key );
+    if ( have_corners && !memcmp( &key, &corner_key, sizeof( BandKeyType ) ) )
+    {
+        memcpy( output->coord_corners, out_corners, sizeof( out_corners ) );
+        return ( MRT_NO_ERROR );
+    }
+
+    have_corners = FALSE;
+    status = GetOutputImageCorners( modis, output, input );
+    if ( status == MRT_NO_ERROR )
+    {
+        memcpy( &corner_key, &key, sizeof( BandKeyType ) );
+        memcpy( out_corners, output->coord_corners, sizeof( out_corners ) );
+        have_corners = TRUE;
+    }
+
+    return ( status );
+}
+
+/******************************************************************************
+
+MODULE:  OpenBandMap
+
+PURPOSE:  Get the output to input mapping for a band, either one which is
+          already complete or an empty one to be filled in
+
+RETURN VALUE:
+Type = BandMapType *
+Value           Description
+-----           -----------
+NULL            The mapping can't be kept; map every row
+other           The mapping (complete is TRUE if it can be used as it is)
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+         10/26                         Look in the LUT cache directory
+         10/26                         Compare the whole geometry, so a
+                                       mapping is reused by later jobs
+         10/26                         Say when the mapping is too big to
+                                       keep
+
+NOTES:
+  The output corners and size must already be set (InitOutputFile).  Memory
+  allocation errors aren't fatal, the band is just mapped row by row.
+
+******************************************************************************/
+BandMapType *OpenBandMap
+(
+    ResampleJob *job            /* I: band being resampled */
+)
+
+{
+    FileDescriptor *output = job->output;  /* output file info */
+    LutHeaderType header;       /* geometry of this band */
+    size_t npixels;             /* number of output pixels */
+
+    /* the mapping depends on the projections, the input grid, the upper
+       left input coordinate and the output grid; the session doesn't
+       matter, so a later job of a batch run can use it too */
+    SetLutHeader( job, &header );
+    if ( band_map.complete &&
+         !memcmp( &header, &lut_header, sizeof( LutHeaderType ) ) )
+    {
+        MessageHandler( NULL, "  using the output to input mapping of the "
+            "previous band" );
+        return ( &band_map );
+    }
+
+    /* a different geometry, so start over */
+    FreeBandMap( );
+    npixels = output->nrows * output->ncols;
+    if ( npixels == 0 )
+        return ( NULL );
+
+    memcpy( &lut_header, &header, sizeof( LutHeaderType ) );
+    band_map.nrows = output->nrows;
+    band_map.ncols = output->ncols;
+    band_map.upleft_x = job->upleft_x;
+    band_map.upleft_y = job->upleft_y;
+    memcpy( band_map.out_corners, output->coord_corners,
+        sizeof( band_map.out_corners ) );
+    band_map.complete = FALSE;
+
+    /* has an earlier run left this mapping in the LUT cache? */
+    if ( LutCacheName( "mrt_map", &lut_header, sizeof( LutHeaderType ),
+        lut_name ) )
+    {
+        if ( LoadLutFile( &lut_header, lut_name ) )
+        {
+            MessageHandler( NULL, "  using the output to input mapping "
+                "from %s", lut_name );
+            band_map.complete = TRUE;
+            return ( &band_map );
+        }
+        lut_save = TRUE;
+    }
+
+    /* map this band into memory for the following bands */
+    if ( npixels > MAX_MAP_CACHE_SIZE / MAP_PIXEL_BYTES )
+    {
+        MessageHandler( NULL, "  the output to input mapping (%lu MB) is "
+            "bigger than %lu MB, so each band is mapped again",
+            ( unsigned long ) ( npixels / ( 1048576 / MAP_PIXEL_BYTES ) ),
+            ( unsigned long ) ( MAX_MAP_CACHE_SIZE / 1048576 ) );
+        FreeBandMap( );
+        return ( NULL );
+    }
+
+    band_map.incol = ( float * ) malloc( npixels * sizeof( float ) );
+    band_map.inrow = ( float * ) malloc( npixels * sizeof( float ) );
+    if ( band_map.incol == NULL || band_map.inrow == NULL )
+    {
+        MessageHandler( NULL, "  no memory to keep the output to input "
+            "mapping, so each band is mapped again" );
+        FreeBandMap( );
+        return ( NULL );
+    }
+
+    return ( &band_map );
+}
+
+/******************************************************************************
+
+MODULE:  RoundBandMapRow
+
+PURPOSE:  Round the mapping of an output row to what a kept mapping holds
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Used for the rows of a band whose mapping isn't kept, so the output
+  doesn't depend on whether there was room for the mapping.
+
+******************************************************************************/
+void RoundBandMapRow
+(
+    size_t ncols,               /* I: output row size */
+    double *incol,              /* I/O: input sample for each output pixel */
+    double *inrow               /* I/O: input line for each output pixel */
+)
+
+{
+    size_t j;                   /* output sample */
+
+    for ( j = 0; j < ncols; j++ )
+    {
+        incol[j] = ( float ) incol[j];
+        inrow[j] = ( float ) inrow[j];
+    }
+}
+
+/******************************************************************************
+
+MODULE:  PutBandMapRow
+
+PURPOSE:  Keep the mapping of an output row
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The line/sample are rounded to floats in place as well, so the band
+  being mapped resamples from the same locations as the following bands.
+  Called from several threads at once, each with its own rows.
+
+******************************************************************************/
+void PutBandMapRow
+(
+    BandMapType *map,           /* I/O: mapping being filled in */
+    size_t row,                 /* I: output row */
+    double *incol,              /* I/O: input sample for each output pixel */
+    double *inrow,              /* I/O: input line for each output pixel */
+    int *valid                  /* I: does each output pixel map to input? */
+)
+
+{
+    float *mapcol = &map->incol[row * map->ncols];  /* row's samples */
+    float *maprow = &map->inrow[row * map->ncols];  /* row's lines */
+    size_t j;                   /* output sample */
+
+    for ( j = 0; j < map->ncols; j++ )
+    {
+        if ( valid[j] )
+        {
+            mapcol[j] = ( float ) incol[j];
+            maprow[j] = ( float ) inrow[j];
+            incol[j] = mapcol[j];
+            inrow[j] = maprow[j];
+        }
+        else
+        {
+            mapcol[j] = MAP_NO_INPUT;
+            maprow[j] = MAP_NO_INPUT;
+        }
+    }
+}
+
+/******************************************************************************
+
+MODULE:  GetBandMapRow
+
+PURPOSE:  Get the mapping of an output row from a complete mapping
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+
+******************************************************************************/
+void GetBandMapRow
+(
+    BandMapType *map,           /* I: complete mapping */
+    size_t row,                 /* I: output row */
+    double *incol,              /* O: input sample for each output pixel */
+    double *inrow,              /* O: input line for each output pixel */
+    int *valid                  /* O: does each output pixel map to input? */
+)
+
+{
+    float *mapcol = &map->incol[row * map->ncols];  /* row's samples */
+    float *maprow = &map->inrow[row * map->ncols];  /* row's lines */
+    size_t j;                   /* output sample */
+
+    for ( j = 0; j < map->ncols; j++ )
+    {
+        valid[j] = mapcol[j] != MAP_NO_INPUT;
+        incol[j] = mapcol[j];
+        inrow[j] = maprow[j];
+    }
+}
+
+/******************************************************************************
+
+MODULE:  CloseBandMap
+
+PURPOSE:  Finish with the mapping of a band
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+         10/26                         Write the LUT cache file
+         10/26                         Keep the mapping after the last band
+
+NOTES:
+  The mapping is marked complete if the band was resampled successfully
+  (and written to the LUT cache directory if there is one).  The cached
+  corners are forgotten after the last band, since they're keyed by the
+  session; the mapping is kept for the next job until FreeBandMap.
+
+******************************************************************************/
+void CloseBandMap
+(
+    BandMapType *map,           /* I/O: mapping from OpenBandMap (or NULL) */
+    int success,                /* I: was every row mapped? */
+    int last_band               /* I: is this the last band to be processed */
+)
+
+{
+    if ( map != NULL && success && !map->complete )
+    {
+        map->complete = TRUE;
+
+        /* keep it for later runs too */
+        if ( lut_save )
+            SaveLutFile( );
+        lut_save = FALSE;
+    }
+
+    if ( map != NULL && !success )
+        FreeBandMap( );
+    if ( last_band )
+        have_corners = FALSE;
+}
+
+/******************************************************************************
+
+MODULE:  FreeBandMap
+
+PURPOSE:  Free the cached output to input mapping
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+         10/26                         Unmap a LUT cache file
+
+NOTES:
+
+******************************************************************************/
+void FreeBandMap
+(
+    void
+)
+
+{
+#ifndef WIN32
+    if ( lut_map != NULL )
+    {
+        /* the arrays are in the mapped LUT cache file */
+        munmap( lut_map, lut_mapsize );
+        lut_map = NULL;
+        lut_mapsize = 0;
+    }
+    else
+#endif
+    {
+        free( band_map.incol );
+        free( band_map.inrow );
+    }
+    memset( &band_map, 0, sizeof( BandMapType ) );
+    lut_save = FALSE;
+}
@@ -15,6 +15,9 @@ Version  Date   Programmer       Code  Reason
          01/07  Gail Schmidt           Modified the call to GCTP to send in
                                        a value of -1 for the sphere code since
                                        sphere codes aren't used for ISIN
+         10/26                         Added calc_isin_shift_xform, which
+                                       uses transformations set up once by
+                                       the caller
 
 HARDWARE AND/OR SOFTWARE LIMITATIONS:
   None
@@ -287,3 +290,97 @@ int calc_isin_shift
 
     return ( status );
 }
+
+/******************************************************************************
+
+MODULE:  calc_isin_shift_xform
+
+PURPOSE: Calculate the ISIN shift for a particular line/sample value, using
+         GCTP transformations set up by the caller.
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development (from
+                                       calc_isin_shift)
+
+NOTES:
+  1. The same calculation as calc_isin_shift when there is no datum
+     conversion, but the inverse (input projection to lat/long) and forward
+     (lat/long to input projection) transformations are set up once with
+     gctp_call_init rather than for each call.  Both use a sphere code of
+     -1, as calc_isin_shift does.
+  2. If the transformations are reentrant (gctp_xform_reentrant), several
+     threads can call this at once, each with its own transformations.
+
+******************************************************************************/
+int calc_isin_shift_xform
+(
+    int lisin,                  /* I: input projection line coord */
+    int sisin,                  /* I: input projection sample coord */
+    GctpXform *inv_xform,       /* I/O: input projection to lat/long */
+    GctpXform *for_xform,       /* I/O: lat/long to input projection */
+    double upleft_x,            /* I: upper left input projection coord */
+    double upleft_y,            /* I: upper left input projection coord */
+    double input_pixel_size,    /* I: pixel size for input image */
+    double *delta_s             /* O: shift for the ISIN shift calculation */
+)
+
+{
+    char errmsg[256];           /* error message string */
+    int status;                 /* return status error code */
+    double sisin_prime;         /* s-prime ISIN value (ISIN sample value with
+                                   line + 1) */
+    double xisin, yisin,        /* x/y ISIN values */
+           xisin_prime,
+           yisin_prime,
+           yisin_double_prime;
+    double lat_orig, long_orig;    /* original lat/long */
+    double lat_prime, long_prime;  /* lat/long for next line */
+
+    /** 1. (lisin, sisin) --> (xisin, yisin) --> (lat_orig, long_orig) **/
+
+    /* get the input projection coords for the center of the pixel */
+    xisin = upleft_x + sisin * input_pixel_size + 0.5 * input_pixel_size;
+    yisin = upleft_y - lisin * input_pixel_size - 0.5 * input_pixel_size;
+
+    /* go from input projection coords to input lat/long.  if this is a
+       bounding tile pixel value then just return and let the calling
+       routine handle the issue. */
+    status = gctp_call_xform( inv_xform, xisin, yisin, &long_orig,
+        &lat_orig );
+    if ( status != E_GEO_SUCC )
+        return ( status );
+
+    /** 2. (lisin + 1, sisin) --> (xisin, yisin_prime) -->
+           (lat_prime, long_prime) **/
+    yisin_prime = yisin + input_pixel_size;
+    status = gctp_call_xform( inv_xform, xisin, yisin_prime, &long_prime,
+        &lat_prime );
+    if ( status != E_GEO_SUCC )
+        return ( status );
+
+    /** 3. (lat_prime, long_orig) --> (xisin_prime, yisin_double_prime) -->
+           (lisin_prime, sisin_prime) **/
+    status = gctp_call_xform( for_xform, long_orig, lat_prime, &xisin_prime,
+        &yisin_double_prime );
+    if ( status != E_GEO_SUCC )
+        return ( status );
+
+    /* sanity check (NOTE: yisin_double_prime should be equal to
+       yisin_prime) */
+    if ( fabs ( yisin_double_prime - yisin_prime ) > .000005 )
+    {
+        sprintf( errmsg, "Error: yisin_double_prime (%.9f) should be equal "
+            "to yisin_prime (%.9f).\n", yisin_double_prime, yisin_prime );
+        ErrorHandler( TRUE, "calc_isin_shift_xform", ERROR_GENERAL, errmsg );
+    }
+
+    /* get the sample value for the input projection coords */
+    sisin_prime = ( xisin_prime - upleft_x ) / input_pixel_size;
+
+    /** 4. delta_s = sisin_prime - sisin **/
+    *delta_s = sisin_prime - sisin;
+
+    return ( E_GEO_SUCC );
+}
@@ -0,0 +1,670 @@
+/******************************************************************************
+
+FILE:  isin_shift.c
+
+PURPOSE:  Compute and keep the ISIN shift (delta_s) tables of the input
+          images
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development (from the ISIN
+                                       shift loops of NNResample, BIResample
+                                       and CCResample)
+
+HARDWARE AND/OR SOFTWARE LIMITATIONS:
+  Requires POSIX threads
+
+PROJECT:    MODIS Reprojection Tool
+
+NOTES:
+  1. The ISIN shift of an input line is linear along the line, so it is
+     kept as the shift at the first sample (delta_s_start) and its slope
+     (delta_s_slope), from calc_isin_shift at the first and last samples.
+     If either isn't available (bounding tiles) the slope is 0.0.
+  2. A table only depends on the input projection, the output datum and
+     the input grid, so the tables are kept for the whole run rather than
+     for one resolution of one resampler.  Up to MAX_ISIN_SHIFT_TABLES are
+     kept; the least recently used one is replaced.  FreeIsinShifts frees
+     them.
+  3. When there is no datum conversion the lines are computed on the
+     resampling threads (NUM_THREADS or -threads), each with its own GCTP
+     transformations (calc_isin_shift_xform).  Geolib keeps its state in
+     statics, so with a datum conversion they are computed one at a time
+     with calc_isin_shift, as before.  The slopes and statistics are always
+     worked out afterwards in line order, so the results are the same for
+     any number of threads.
+  4. If there is a LUT cache directory (see lut_cache.c), the tables are
+     also written there and read back by later runs.
+
+******************************************************************************/
+#include <pthread.h>
+#include "resample.h"
+#include "worgen.h"
+#include "cproj.h"
+#include "mrt_dtype.h"
+
+/* number of ISIN shift tables kept */
+#define MAX_ISIN_SHIFT_TABLES 4
+
+/* number of input lines given to a thread at a time */
+#define ISIN_LINES_PER_BATCH 32
+
+/* identifies an ISIN shift LUT cache file */
+#define ISIN_LUT_MAGIC "MRTISIN"
+
+/* what an ISIN shift table is computed from (also the LUT cache file key) */
+typedef struct
+{
+    char magic[8];              /* ISIN_LUT_MAGIC */
+    unsigned long byte_order;   /* LUT_BYTE_ORDER */
+    unsigned long key_size;     /* sizeof( IsinShiftKeyType ) */
+    ProjInfo inproj;            /* input projection */
+    long output_datum_code;     /* output datum (E_NODATUM if none) */
+    double pixel_size;          /* input pixel size */
+    size_t nrows, ncols;        /* input size */
+    double upleft_x, upleft_y;  /* UL input projection coords */
+}
+IsinShiftKeyType;
+
+/* statistics of an ISIN shift table, as reported when it is computed */
+typedef struct
+{
+    double min_delta;           /* minimum delta_s value */
+    double max_delta;           /* maximum delta_s value */
+    double sum_delta;           /* sum of delta_s values for average */
+    double count;               /* count of delta_s values */
+}
+IsinShiftStatsType;
+
+/* a kept ISIN shift table */
+typedef struct
+{
+    int used;                   /* does this entry hold a table? */
+    unsigned long last_use;     /* when it was last asked for */
+    IsinShiftKeyType key;       /* what it was computed from */
+    double *delta_s_start;      /* starting shift of each input line */
+    double *delta_s_slope;      /* shift slope of each input line */
+    IsinShiftStatsType stats;   /* statistics of the shifts */
+}
+IsinShiftTableType;
+
+/* input lines shared between the threads computing a table */
+typedef struct
+{
+    pthread_mutex_t mutex;      /* protects the rest of this structure */
+    size_t next_line;           /* next input line to compute */
+    size_t ndone;               /* number of lines computed */
+    size_t tenths;              /* tenths of the lines reported as done */
+    int status;                 /* error code of the first error */
+    int end_error;              /* was it for the last sample of a line? */
+}
+IsinShiftQueueType;
+
+/* state of each thread computing a table */
+typedef struct
+{
+    IsinShiftQueueType *queue;  /* lines shared with the other threads */
+    ModisDescriptor *modis;     /* session info */
+    FileDescriptor *input;      /* input file info */
+    double upleft_x, upleft_y;  /* UL input projection coords */
+    double *delta_s_start;      /* O: shift at the first sample */
+    double *delta_s_end;        /* O: shift at the last sample */
+    int have_xforms;            /* use inv_xform/for_xform? */
+    GctpXform inv_xform;        /* input projection to lat/long */
+    GctpXform for_xform;        /* lat/long to input projection */
+    pthread_t thread;           /* thread id */
+}
+IsinShiftWorkerType;
+
+/* the kept tables */
+static IsinShiftTableType tables[MAX_ISIN_SHIFT_TABLES];
+static unsigned long use_count = 0;
+
+/******************************************************************************
+
+MODULE:  IsinShiftWorker
+
+PURPOSE:  Compute the shifts at the first and last samples of input lines
+          until there are none left
+
+RETURN VALUE:
+Type = void *
+Value           Description
+-----           -----------
+NULL            Always
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  A shift which isn't available is stored as -99.0.  Errors are reported
+  through the queue.
+
+******************************************************************************/
+static void *IsinShiftWorker
+(
+    void *arg                   /* I/O: IsinShiftWorkerType for this thread */
+)
+
+{
+    IsinShiftWorkerType *w = ( IsinShiftWorkerType * ) arg;  /* worker */
+    IsinShiftQueueType *q = w->queue;   /* shared lines */
+    ProjInfo *inproj = w->modis->in_projection_info;  /* input projection */
+    size_t nrows = w->input->nrows;     /* input lines */
+    size_t first, i, last;      /* lines in the batch */
+    int sample;                 /* first or last sample */
+    int status = E_GEO_SUCC;    /* return status error code */
+    double delta_s;             /* shift for ISIN shift calculation */
+    double *out;                /* where the shift goes */
+
+    while ( 1 )
+    {
+        /* claim the next batch of lines */
+        pthread_mutex_lock( &q->mutex );
+        if ( q->status != E_GEO_SUCC || q->next_line >= nrows )
+        {
+            pthread_mutex_unlock( &q->mutex );
+            break;
+        }
+        first = q->next_line;
+        q->next_line += ISIN_LINES_PER_BATCH;
+        pthread_mutex_unlock( &q->mutex );
+
+        last = first + ISIN_LINES_PER_BATCH;
+        if ( last > nrows )
+            last = nrows;
+
+        for ( i = first; i < last && status == E_GEO_SUCC; i++ )
+        {
+            for ( sample = 0; sample < 2; sample++ )
+            {
+                /* calculate the delta_s for sample 0 and ncols-1 */
+                if ( w->have_xforms )
+                    status = calc_isin_shift_xform( i,
+                        sample ? w->input->ncols - 1 : 0, &w->inv_xform,
+                        &w->for_xform, w->upleft_x, w->upleft_y,
+                        w->input->pixel_size, &delta_s );
+                else
+                    status = calc_isin_shift( i,
+                        sample ? w->input->ncols - 1 : 0, inproj,
+                        w->upleft_x, w->upleft_y, w->input->pixel_size,
+                        w->modis->output_datum_code, &delta_s );
+
+                out = sample ? &w->delta_s_end[i] : &w->delta_s_start[i];
+                if ( status == GCTP_ERANGE || status == IN_BREAK )
+                {   /* The value was out of range for the projection. */
+                    *out = -99.0;
+                    status = E_GEO_SUCC;
+                }
+                else if ( status != E_GEO_SUCC )
+                {
+                    pthread_mutex_lock( &q->mutex );
+                    if ( q->status == E_GEO_SUCC )
+                    {
+                        q->status = status;
+                        q->end_error = sample;
+                    }
+                    pthread_mutex_unlock( &q->mutex );
+                    break;
+                }
+                else
+                    *out = delta_s;
+            }
+        }
+
+        if ( status != E_GEO_SUCC )
+            break;
+
+        /* update status? (every 10%) */
+        pthread_mutex_lock( &q->mutex );
+        q->ndone += last - first;
+        while ( q->tenths < 9 && q->tenths < 10 * q->ndone / nrows )
+        {
+            q->tenths++;
+            fprintf( stdout, " " MRT_SIZE_T_FMT "%%", 10 * q->tenths );
+            fflush( stdout );
+        }
+        pthread_mutex_unlock( &q->mutex );
+    }
+
+    return ( NULL );
+}
+
+/******************************************************************************
+
+MODULE:  ComputeIsinShifts
+
+PURPOSE:  Compute the ISIN shift table of an input image
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+E_GEO_SUCC      Successful completion
+other           Error code from calc_isin_shift
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development (from the ISIN
+                                       shift loops of the resamplers)
+
+NOTES:
+  Memory allocation errors are fatal.
+
+******************************************************************************/
+static int ComputeIsinShifts
+(
+    ModisDescriptor *modis,     /* I: session info */
+    FileDescriptor *input,      /* I: input file info */
+    double upleft_x,            /* I: upper left input projection coord */
+    double upleft_y,            /* I: upper left input projection coord */
+    char *name,                 /* I: resampler name for messages */
+    IsinShiftTableType *table   /* I/O: table to fill in (key is set) */
+)
+
+{
+    ProjInfo *inproj = modis->in_projection_info;  /* input projection */
+    ProjInfo geoinfo;           /* geographic projection */
+    IsinShiftQueueType q;       /* lines shared between the threads */
+    IsinShiftWorkerType *workers;  /* thread state */
+    IsinShiftStatsType *stats = &table->stats;  /* shift statistics */
+    double *delta_s_start;      /* starting shift of each line */
+    double *delta_s_slope;      /* shift slope of each line */
+    double *delta_s_end;        /* ending shift of each line */
+    int nthreads;               /* number of threads */
+    int nstarted = 0;           /* number of threads started */
+    int t;                      /* thread index */
+    int status;                 /* return status error code */
+    size_t i;                   /* line index */
+    size_t nbatches;            /* batches of lines */
+
+    delta_s_start = ( double * ) calloc( input->nrows, sizeof( double ) );
+    delta_s_slope = ( double * ) calloc( input->nrows, sizeof( double ) );
+    delta_s_end = ( double * ) calloc( input->nrows, sizeof( double ) );
+    if ( delta_s_start == NULL || delta_s_slope == NULL ||
+         delta_s_end == NULL )
+    {
+        ErrorHandler( TRUE, name, ERROR_MEMORY,
+           "Error allocating space for the delta_s buffers" );
+    }
+
+    /* how many threads?  geolib (datum conversions) isn't reentrant */
+    nthreads = GetResampleThreads( modis );
+    nbatches = ( input->nrows + ISIN_LINES_PER_BATCH - 1 ) /
+        ISIN_LINES_PER_BATCH;
+    if ( ( size_t ) nthreads > nbatches )
+        nthreads = ( int ) nbatches;
+    if ( nthreads < 1 || modis->output_datum_code != E_NODATUM )
+        nthreads = 1;
+
+    workers = ( IsinShiftWorkerType * ) calloc( nthreads,
+        sizeof( IsinShiftWorkerType ) );
+    if ( workers == NULL )
+    {
+        ErrorHandler( TRUE, name, ERROR_MEMORY,
+           "Error allocating space for the ISIN shift threads" );
+    }
+
+    memset( &q, 0, sizeof( IsinShiftQueueType ) );
+    q.status = E_GEO_SUCC;
+    pthread_mutex_init( &q.mutex, NULL );
+
+    /* Setup Geographic coordinates */
+    memset( &geoinfo, 0, sizeof( ProjInfo ) );
+    geoinfo.proj_code = GEO;
+    geoinfo.units = DEGREE;
+
+    for ( t = 0; t < nthreads; t++ )
+    {
+        workers[t].queue = &q;
+        workers[t].modis = modis;
+        workers[t].input = input;
+        workers[t].upleft_x = upleft_x;
+        workers[t].upleft_y = upleft_y;
+        workers[t].delta_s_start = delta_s_start;
+        workers[t].delta_s_end = delta_s_end;
+
+        /* set up this thread's transformations.  as in calc_isin_shift,
+           the sphere codes are -1 so the projection parameters are used. */
+        if ( modis->output_datum_code == E_NODATUM &&
+             gctp_call_init( &workers[t].inv_xform, inproj->proj_code,
+                inproj->zone_code, -1, inproj->proj_coef, inproj->units,
+                geoinfo.proj_code, geoinfo.zone_code, -1, geoinfo.proj_coef,
+                geoinfo.units ) == E_GEO_SUCC )
+        {
+            if ( gctp_call_init( &workers[t].for_xform, geoinfo.proj_code,
+                    geoinfo.zone_code, -1, geoinfo.proj_coef, geoinfo.units,
+                    inproj->proj_code, inproj->zone_code, -1,
+                    inproj->proj_coef, inproj->units ) == E_GEO_SUCC )
+                workers[t].have_xforms = TRUE;
+            else
+                gctp_call_free( &workers[t].inv_xform );
+        }
+
+        /* only use several threads if every thread can transform on its
+           own */
+        if ( t == 0 && ( !workers[0].have_xforms ||
+             !gctp_xform_reentrant( &workers[0].inv_xform ) ||
+             !gctp_xform_reentrant( &workers[0].for_xform ) ) )
+            nthreads = 1;
+    }
+
+    /* the calling thread is the first worker */
+    fprintf( stdout, "%% complete (" MRT_SIZE_T_FMT " rows): 0%%",
+             input->nrows );
+    fflush( stdout );
+    for ( t = 1; t < nthreads; t++ )
+    {
+        if ( workers[t].have_xforms && pthread_create( &workers[t].thread,
+            NULL, IsinShiftWorker, &workers[t] ) == 0 )
+            nstarted = t;
+        else
+            break;
+    }
+    IsinShiftWorker( &workers[0] );
+    for ( t = 1; t <= nstarted; t++ )
+        pthread_join( workers[t].thread, NULL );
+
+    for ( t = 0; t < nthreads; t++ )
+    {
+        if ( workers[t].have_xforms )
+        {
+            gctp_call_free( &workers[t].inv_xform );
+            gctp_call_free( &workers[t].for_xform );
+        }
+    }
+    free( workers );
+    pthread_mutex_destroy( &q.mutex );
+
+    status = q.status;
+    if ( status != E_GEO_SUCC )
+    {
+        free( delta_s_start );
+        free( delta_s_slope );
+        free( delta_s_end );
+        fprintf( stdout, "\n" );
+        if ( q.end_error )
+            ErrorHandler( FALSE, name, ERROR_GENERAL,
+                "Error calculating the ISIN delta_s_end value." );
+        else
+            ErrorHandler( FALSE, name, ERROR_GENERAL,
+                "Error calculating the ISIN delta_s_start value." );
+        return ( status );
+    }
+
+    fprintf( stdout, " 100%%\n" );
+    fflush( stdout );
+
+    /* work out the slope of each line.  if either the start and/or end
+       delta_s values are not available then set slope to 0.0. */
+    stats->min_delta = 99.0;
+    stats->max_delta = 0.0;
+    stats->sum_delta = 0.0;
+    stats->count = 0.0;
+    for ( i = 0; i < input->nrows; i++ )
+    {
+        if ( delta_s_start[i] == -99.0 || delta_s_end[i] == -99.0 )
+        {
+            delta_s_slope[i] = 0.0;
+
+            /* if delta_s_start is -99.0 then reset to 0.0 */
+            if ( delta_s_start[i] == -99.0 )
+                delta_s_start[i] = 0.0;
+        }
+        else
+        {
+            delta_s_slope[i] = ( delta_s_end[i] - delta_s_start[i] ) /
+                ( input->ncols - 1 );
+
+            /* generate delta_s statistics. delta's commonly fall
+               between 3.25 and -3.25. */
+            if ( delta_s_end[i] < stats->min_delta )
+                stats->min_delta = delta_s_end[i];
+            if ( delta_s_start[i] < stats->min_delta )
+                stats->min_delta = delta_s_start[i];
+            if ( delta_s_end[i] > stats->max_delta )
+                stats->max_delta = delta_s_end[i];
+            if ( delta_s_start[i] > stats->max_delta )
+                stats->max_delta = delta_s_start[i];
+            stats->sum_delta += delta_s_end[i] + delta_s_start[i];
+            stats->count += 2;
+        }
+    }
+    free( delta_s_end );
+
+    table->delta_s_start = delta_s_start;
+    table->delta_s_slope = delta_s_slope;
+
+    return ( E_GEO_SUCC );
+}
+
+/******************************************************************************
+
+MODULE:  ReportIsinShifts
+
+PURPOSE:  Print the statistics of an ISIN shift table
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development (from the
+                                       resamplers)
+
+NOTES:
+
+******************************************************************************/
+static void ReportIsinShifts
+(
+    char *module,               /* I: module name for the messages */
+    IsinShiftStatsType *stats   /* I: statistics to report */
+)
+
+{
+    MessageHandler( module, "ISIN Shift Statistics:" );
+    if ( stats->count != 0 )
+    {
+        MessageHandler( NULL, "  min delta shift = %f", stats->min_delta );
+        MessageHandler( NULL, "  max delta shift = %f", stats->max_delta );
+        MessageHandler( NULL, "  avg delta shift = %f",
+            stats->sum_delta / stats->count );
+    }
+    else
+    {
+        MessageHandler( NULL, "  min delta shift = 0.0" );
+        MessageHandler( NULL, "  max delta shift = 0.0" );
+        MessageHandler( NULL, "  avg delta shift = 0.0" );
+    }
+}
+
+/******************************************************************************
+
+MODULE:  GetIsinShifts
+
+PURPOSE:  Get the ISIN shift table of an input image, computing it if it
+          isn't already kept
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+E_GEO_SUCC      Successful completion
+other           Error code from calc_isin_shift
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The arrays belong to this module and stay valid until the next call (or
+  FreeIsinShifts).  Memory allocation errors are fatal.
+
+******************************************************************************/
+int GetIsinShifts
+(
+    ModisDescriptor *modis,     /* I: session info */
+    FileDescriptor *input,      /* I: input file info */
+    double upleft_x,            /* I: upper left input projection coord */
+    double upleft_y,            /* I: upper left input projection coord */
+    char *name,                 /* I: resampler name for messages */
+    double **delta_s_start,     /* O: starting shift of each input line */
+    double **delta_s_slope      /* O: shift slope of each input line */
+)
+
+{
+    IsinShiftKeyType key;       /* what the table is computed from */
+    IsinShiftTableType *table;  /* the table */
+    char module[SMALL_STRING];  /* module name for the messages */
+    char lut_name[LARGE_STRING];  /* LUT cache file name */
+    int have_lut;               /* is there a LUT cache file name? */
+    FILE *fp;                   /* LUT cache file */
+    void *arrays[3];            /* arrays of the LUT cache file */
+    size_t nbytes[3];           /* size of each array */
+    int status;                 /* return status error code */
+    int i;
+
+    memset( &key, 0, sizeof( IsinShiftKeyType ) );
+    strcpy( key.magic, ISIN_LUT_MAGIC );
+    key.byte_order = LUT_BYTE_ORDER;
+    key.key_size = sizeof( IsinShiftKeyType );
+    key.inproj = *modis->in_projection_info;
+    key.output_datum_code = modis->output_datum_code;
+    key.pixel_size = input->pixel_size;
+    key.nrows = input->nrows;
+    key.ncols = input->ncols;
+    key.upleft_x = upleft_x;
+    key.upleft_y = upleft_y;
+
+    /* is it already kept?  otherwise replace the least recently used */
+    use_count++;
+    table = &tables[0];
+    for ( i = 0; i < MAX_ISIN_SHIFT_TABLES; i++ )
+    {
+        if ( tables[i].used &&
+             !memcmp( &tables[i].key, &key, sizeof( IsinShiftKeyType ) ) )
+        {
+            tables[i].last_use = use_count;
+            *delta_s_start = tables[i].delta_s_start;
+            *delta_s_slope = tables[i].delta_s_slope;
+            return ( E_GEO_SUCC );
+        }
+        if ( !tables[i].used ||
+             ( table->used && tables[i].last_use < table->last_use ) )
+            table = &tables[i];
+    }
+
+    free( table->delta_s_start );
+    free( table->delta_s_slope );
+    memset( table, 0, sizeof( IsinShiftTableType ) );
+    table->key = key;
+
+    sprintf( module, "\n%s", name );
+    nbytes[0] = input->nrows * sizeof( double );
+    nbytes[1] = input->nrows * sizeof( double );
+    nbytes[2] = sizeof( IsinShiftStatsType );
+
+    /* has an earlier run left this table in the LUT cache? */
+    have_lut = LutCacheName( "mrt_isin", &key, sizeof( IsinShiftKeyType ),
+        lut_name );
+    fp = NULL;
+    if ( have_lut )
+        fp = OpenLutCacheFile( lut_name, &key, sizeof( IsinShiftKeyType ),
+            nbytes[0] + nbytes[1] + nbytes[2] );
+    if ( fp != NULL )
+    {
+        table->delta_s_start = ( double * ) malloc( nbytes[0] );
+        table->delta_s_slope = ( double * ) malloc( nbytes[1] );
+        if ( table->delta_s_start == NULL || table->delta_s_slope == NULL )
+        {
+            ErrorHandler( TRUE, name, ERROR_MEMORY,
+               "Error allocating space for the delta_s buffers" );
+        }
+
+        if ( fread( table->delta_s_start, 1, nbytes[0], fp ) == nbytes[0] &&
+             fread( table->delta_s_slope, 1, nbytes[1], fp ) == nbytes[1] &&
+             fread( &table->stats, 1, nbytes[2], fp ) == nbytes[2] )
+        {
+            fclose( fp );
+            MessageHandler( module, "Using the ISIN shifts from %s",
+                lut_name );
+            ReportIsinShifts( module, &table->stats );
+            table->used = TRUE;
+            table->last_use = use_count;
+            *delta_s_start = table->delta_s_start;
+            *delta_s_slope = table->delta_s_slope;
+            return ( E_GEO_SUCC );
+        }
+
+        fclose( fp );
+        free( table->delta_s_start );
+        free( table->delta_s_slope );
+        table->delta_s_start = NULL;
+        table->delta_s_slope = NULL;
+    }
+
+    /* compute it */
+    MessageHandler( module, "Calculating ISIN shifts for input image" );
+    status = ComputeIsinShifts( modis, input, upleft_x, upleft_y, name,
+        table );
+    if ( status != E_GEO_SUCC )
+        return ( status );
+    ReportIsinShifts( module, &table->stats );
+
+    /* keep it for later runs too */
+    if ( have_lut )
+    {
+        arrays[0] = table->delta_s_start;
+        arrays[1] = table->delta_s_slope;
+        arrays[2] = &table->stats;
+        if ( WriteLutCacheFile( lut_name, &key, sizeof( IsinShiftKeyType ),
+            3, arrays, nbytes ) )
+            MessageHandler( NULL, "  saved the ISIN shifts to %s", lut_name );
+    }
+
+    table->used = TRUE;
+    table->last_use = use_count;
+    *delta_s_start = table->delta_s_start;
+    *delta_s_slope = table->delta_s_slope;
+
+    return ( E_GEO_SUCC );
+}
+
+/******************************************************************************
+
+MODULE:  FreeIsinShifts
+
+PURPOSE:  Free the kept ISIN shift tables
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+
+******************************************************************************/
+void FreeIsinShifts
+(
+    void
+)
+
+{
+    int i;
+
+    for ( i = 0; i < MAX_ISIN_SHIFT_TABLES; i++ )
+    {
+        free( tables[i].delta_s_start );
+        free( tables[i].delta_s_slope );
+        memset( &tables[i], 0, sizeof( IsinShiftTableType ) );
+    }
+}
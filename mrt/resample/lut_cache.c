@@ -0,0 +1,226 @@
+/******************************************************************************
+
+FILE:  lut_cache.c
+
+PURPOSE:  Read and write the lookup table files in the LUT cache directory
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development (from band_map.c)
+
+HARDWARE AND/OR SOFTWARE LIMITATIONS:
+  The files are in the byte order and type sizes of the machine which wrote
+  them.  Callers put a byte order mark and their structure sizes in the key
+  so files from another kind of machine are just ignored.
+
+PROJECT:    MODIS Reprojection Tool
+
+NOTES:
+  1. The LUT cache directory is named by the MRT_LUT_CACHE_DIR environment
+     variable.  If it isn't set nothing is cached.
+  2. A LUT cache file is the key the table was computed for, zero padded to
+     LUT_DATA_OFFSET, followed by the arrays of the table.  The file name
+     is a hash of the key and the key is compared in full before a file is
+     used, so a hash collision only costs a recomputation.
+  3. Files are written under a temporary name and renamed, so runs sharing
+     the directory never see a partly written file.  Problems with the
+     directory are reported as warnings; the caller just computes the
+     table as usual.
+
+******************************************************************************/
+#include "resample.h"
+#ifndef WIN32
+#  include <unistd.h>
+#endif
+
+/******************************************************************************
+
+MODULE:  LutCacheName
+
+PURPOSE:  Get the LUT cache file name for a key
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            name is set
+FALSE           There is no LUT cache directory
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The key must have been cleared (memset) before it was filled in, so that
+  any padding is the same every time.  The name is the 64-bit FNV-1a hash of
+  the key (32 bits where unsigned long is 32 bits).
+
+******************************************************************************/
+int LutCacheName
+(
+    char *prefix,               /* I: file name prefix (kind of table) */
+    void *key,                  /* I: key of the table */
+    size_t keysize,             /* I: size of the key */
+    char *name                  /* O: LUT cache file name (LARGE_STRING) */
+)
+
+{
+    unsigned char *ptr = ( unsigned char * ) key;  /* bytes to hash */
+    unsigned long hash = 0x811c9dc5UL;  /* FNV-1a hash of the key */
+    char *dir;                  /* LUT cache directory */
+    size_t i;
+
+    dir = getenv( "MRT_LUT_CACHE_DIR" );
+    if ( dir == NULL || *dir == '\0' ||
+         strlen( dir ) + strlen( prefix ) + 64 > LARGE_STRING )
+        return ( FALSE );
+
+    if ( sizeof( unsigned long ) > 4 )
+        hash = ( 0xcbf29ce4UL << 16 << 16 ) | 0x84222325UL;  /* 64-bit basis */
+    for ( i = 0; i < keysize; i++ )
+    {
+        hash ^= ptr[i];
+        if ( sizeof( unsigned long ) > 4 )
+            hash *= ( 0x100UL << 16 << 16 ) | 0x1b3UL;  /* 64-bit prime */
+        else
+            hash *= 0x01000193UL;
+    }
+
+    sprintf( name, "%s/%s_%0*lx.lut", dir, prefix,
+        ( int ) ( 2 * sizeof( unsigned long ) ), hash );
+
+    return ( TRUE );
+}
+
+/******************************************************************************
+
+MODULE:  OpenLutCacheFile
+
+PURPOSE:  Open a LUT cache file for reading, if it's there and is for this
+          key
+
+RETURN VALUE:
+Type = FILE *
+Value           Description
+-----           -----------
+NULL            There is no usable file
+other           The file, positioned at the start of the table
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The file must hold exactly the key and datasize bytes of table.
+
+******************************************************************************/
+FILE *OpenLutCacheFile
+(
+    char *name,                 /* I: LUT cache file name */
+    void *key,                  /* I: key of the table */
+    size_t keysize,             /* I: size of the key */
+    size_t datasize             /* I: size of the table */
+)
+
+{
+    FILE *fp;                   /* LUT cache file */
+    char *file_key;             /* key read from the file */
+    int ok;                     /* is the file usable? */
+
+    fp = fopen( name, "rb" );
+    if ( fp == NULL )
+        return ( NULL );
+
+    file_key = ( char * ) malloc( keysize );
+    ok = file_key != NULL &&
+         fread( file_key, 1, keysize, fp ) == keysize &&
+         !memcmp( file_key, key, keysize ) &&
+         fseek( fp, 0L, SEEK_END ) == 0 &&
+         ( size_t ) ftell( fp ) == LUT_DATA_OFFSET( keysize ) + datasize &&
+         fseek( fp, ( long ) LUT_DATA_OFFSET( keysize ), SEEK_SET ) == 0;
+    free( file_key );
+    if ( !ok )
+    {
+        fclose( fp );
+        return ( NULL );
+    }
+
+    return ( fp );
+}
+
+/******************************************************************************
+
+MODULE:  WriteLutCacheFile
+
+PURPOSE:  Write a table to the LUT cache directory
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            The file was written
+FALSE           It wasn't (a warning has been printed)
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The arrays are written one after the other.
+
+******************************************************************************/
+int WriteLutCacheFile
+(
+    char *name,                 /* I: LUT cache file name */
+    void *key,                  /* I: key of the table */
+    size_t keysize,             /* I: size of the key */
+    int narrays,                /* I: number of arrays in the table */
+    void **arrays,              /* I: the arrays */
+    size_t *nbytes              /* I: size of each array */
+)
+
+{
+    FILE *fp;                   /* temporary LUT cache file */
+    char tempname[LARGE_STRING + 32];  /* temporary file name */
+    char pad[16];               /* zeros between the key and table */
+    size_t npad;                /* number of zeros */
+    int ok;                     /* was the file written? */
+    int i;
+
+#ifndef WIN32
+    sprintf( tempname, "%s.%ld.tmp", name, ( long ) getpid( ) );
+#else
+    sprintf( tempname, "%s.tmp", name );
+#endif
+
+    fp = fopen( tempname, "wb" );
+    if ( fp == NULL )
+    {
+        MessageHandler( NULL, "Warning: unable to create the LUT cache file "
+            "%s", tempname );
+        return ( FALSE );
+    }
+
+    memset( pad, 0, sizeof( pad ) );
+    npad = LUT_DATA_OFFSET( keysize ) - keysize;
+    ok = fwrite( key, 1, keysize, fp ) == keysize &&
+         fwrite( pad, 1, npad, fp ) == npad;
+    for ( i = 0; ok && i < narrays; i++ )
+        ok = fwrite( arrays[i], 1, nbytes[i], fp ) == nbytes[i];
+    if ( fclose( fp ) != 0 )
+        ok = FALSE;
+
+    if ( !ok || rename( tempname, name ) != 0 )
+    {
+        remove( tempname );
+        MessageHandler( NULL, "Warning: unable to write the LUT cache file "
+            "%s", name );
+        return ( FALSE );
+    }
+
+    return ( TRUE );
+}
@@ -29,6 +29,23 @@ Version  Date   Programmer       Code  Reason
                                        sample.  Our input space UL is based on
                                        the outer extent and not the center of
                                        the pixel.
+         10/26                         Map each output row through
+                                       MapOutputRow, which supports the
+                                       optional approximate transformer
+         10/26                         Set up the output to input GCTP
+                                       transformation once per band
+                                       (gctp_call_init)
+         10/26                         Free the GCTP transformation
+                                       (gctp_call_free) when the band is done
+         10/26                         Resample the rows with ResampleRows,
+                                       which can use several threads
+         10/26                         Resample integer bands in their own
+                                       data type (NNResampleRowNative)
+         10/26                         Reuse the output corners and mapping
+                                       of the previous band of the same
+                                       resolution (band_map.c)
+         10/26                         Get the ISIN shifts from GetIsinShifts,
+                                       which keeps them for the whole run
 
 HARDWARE AND/OR SOFTWARE LIMITATIONS:  
   None
@@ -47,6 +64,13 @@ NOTES:
      would produce inappropriate results for the "nearest pixel".  If the
      UL corner values referred to the center of the pixel, then rounding
      would be appropriate.
+  4. Nearest neighbor only moves pixels around, so when the input and
+     output have the same integer data type the output rows are gathered
+     straight from the input rows in that type (NN_NATIVE_ROW) and written
+     without any conversion.  Going through double and back gives exactly
+     the same values for these types.  32-bit unsigned and float bands still
+     go through double, since WriteRow clips them (to MRT_INT32_MAX, and
+     negative floats to zero).
 
 ******************************************************************************/
 #include "resample.h"
@@ -56,6 +80,128 @@ NOTES:
 
 /******************************************************************************
 
+MODULE:  NNResampleRow
+
+PURPOSE:  Nearest neighbor resample one output row
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development (from the row
+                                       loop in NNResample)
+
+NOTES:
+  Called from ResampleRows, possibly from several threads at once.
+
+******************************************************************************/
+static void NNResampleRow
+(
+    ResampleJob *job,           /* I: band being resampled */
+    FileDescriptor *input,      /* I: input to read */
+    double *incol,              /* I: input sample for each output pixel */
+    double *inrow,              /* I: input line for each output pixel */
+    int *valid,                 /* I: does the output pixel map to input? */
+    void *rowbuffer             /* O: resampled output row (double) */
+)
+
+{
+    double *buffer = ( double * ) rowbuffer;  /* resampled output row */
+    size_t j;                   /* output column */
+
+    /* loop through output cols */
+    for ( j = 0; j < job->output->ncols; j++ )
+    {
+        if ( !valid[j] )
+        {   /* The value was out of range for the projection so
+               just set it as a background pixel. */
+            buffer[j] = job->background;
+            continue;
+        }
+
+        /* resample from input */
+        buffer[j] = ReadBufferValue( (int)incol[j], (int)inrow[j], input );
+    }
+}
+
+/******************************************************************************
+
+MODULE:  NN_NATIVE_ROW
+
+PURPOSE:  Define a nearest neighbor row resampler for one data type which
+          gathers the input pixels into the output row without converting
+          them
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development (from
+                                       NNResampleRow)
+
+NOTES:
+  The input row is looked up once for each run of output pixels which come
+  from the same input line.  The pointer from ReadBufferRow stays valid
+  until the next lookup.  Pixels outside the input image, in rows which
+  couldn't be read, or outside the projection get the background fill,
+  which NNResample has already converted to the output data type.
+
+******************************************************************************/
+#define NN_NATIVE_ROW( name, type )                                         \
+static void name                                                            \
+(                                                                           \
+    ResampleJob *job,           /* I: band being resampled */               \
+    FileDescriptor *input,      /* I: input to read */                      \
+    double *incol,              /* I: input sample for each output pixel */ \
+    double *inrow,              /* I: input line for each output pixel */   \
+    int *valid,                 /* I: does the output pixel map to input? */\
+    void *rowbuffer             /* O: resampled output row */               \
+)                                                                           \
+                                                                            \
+{                                                                           \
+    type *buffer = ( type * ) rowbuffer;  /* resampled output row */        \
+    type *data = NULL;          /* input row */                             \
+    type fill;                  /* background fill */                       \
+    size_t j;                   /* output column */                         \
+    size_t col, row;            /* input sample and line */                 \
+    size_t data_row = ( size_t ) -1;  /* input line in data */              \
+                                                                            \
+    memcpy( &fill, job->background_native, sizeof( type ) );               \
+                                                                            \
+    /* loop through output cols */                                          \
+    for ( j = 0; j < job->output->ncols; j++ )                              \
+    {                                                                       \
+        if ( !valid[j] )                                                    \
+        {                                                                   \
+            buffer[j] = fill;                                               \
+            continue;                                                       \
+        }                                                                   \
+                                                                            \
+        /* resample from input */                                           \
+        col = ( size_t ) ( int ) incol[j];                                  \
+        row = ( size_t ) ( int ) inrow[j];                                  \
+        if ( row != data_row )                                              \
+        {                                                                   \
+            data = ( type * ) ReadBufferRow( row, input );                  \
+            data_row = row;                                                 \
+        }                                                                   \
+        buffer[j] = ( data != NULL && col < input->ncols ) ?                \
+            data[col] : fill;                                               \
+    }                                                                       \
+}
+
+NN_NATIVE_ROW( NNResampleRowInt8, MRT_INT8 )
+NN_NATIVE_ROW( NNResampleRowUInt8, MRT_UINT8 )
+NN_NATIVE_ROW( NNResampleRowInt16, MRT_INT16 )
+NN_NATIVE_ROW( NNResampleRowUInt16, MRT_UINT16 )
+NN_NATIVE_ROW( NNResampleRowInt32, MRT_INT32 )
+
+/******************************************************************************
+
 MODULE:  NNResample
 
 PURPOSE:  Nearest neighbor resampling 
@@ -71,6 +217,11 @@ Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          05/00   Rob Burrell            Original Development
          04/02   Gail Schmidt           Added call to GCTP directly
+         10/26                          Resample the rows with ResampleRows
+         10/26                          Resample integer bands without
+                                        converting them to double
+         10/26                          Reuse the output corners of the
+                                        previous band (GetBandOutputCorners)
 
 NOTES:
   Removed all the static variables from the original
@@ -89,35 +240,22 @@ int NNResample
 {
     ProjInfo *inproj, *outproj;	/* input/output projection data for geolib */
     int status = MRT_NO_ERROR;	/* return status error code */
-    size_t i, j, k;		/* loop & progress indices */
-    double row, col;		/* input file row/col position */
-    double *buffer = NULL;      /* output buffer */
-    double inx, iny, outx, outy;/* input/output coordinates */
     long prtprm[2];		/* logging flags for geolib */
+    ResampleJob job;            /* band for ResampleRows */
     double background;          /* background fill value */
     double upleft_x, upleft_y;  /* upper left projection coordinates */
-    double delta_s;             /* shift for ISIN shift calculation */
-    double delta_s_end;         /* ending shift for ISIN shift calculation */
-    long count = 0;             /* count of delta_s values */
-    double min_delta = 99.0;    /* minimum delta_s value */
-    double max_delta = 0.0;     /* maximum delta_s value */
-    double sum_delta = 0.0;     /* sum of delta_s values for average */
-
-    /* static variables to be reused for bands of the same resolution */
-    static double *delta_s_start = NULL;
+    double *delta_s_start = NULL;
                                 /* array of starting shifts for the ISIN
                                    shift calculation */
-    static double *delta_s_slope = NULL;
+    double *delta_s_slope = NULL;
                                 /* array of slope values for the delta_s */
-    static double previous_pixel_size = 0.0;
-                                /* value of the previous band's pixel size */
 
     /* get the background fill value */
     background = input->background_fill;
 
     /* get the projection coordinate corners for both files */
     GetInputImageCorners( modis, input );
-    GetOutputImageCorners( modis, output, input );
+    GetBandOutputCorners( modis, output, input );
 
     /* calculate the number of rows/cols for output */
     GetOutputExtents( output );
@@ -148,151 +286,15 @@ int NNResample
         upleft_y = input->coord_corners[UL][1];
     }
 
-    /* if the input projection is ISIN then calculate the delta_s slopes
-       for each line. if the resolution of this band is the same as the
-       previous band, then the delta_s calculations have already been done. */
-    if ( ( inproj->proj_code == ISINUS ) &&
-         ( input->pixel_size != previous_pixel_size ) )
+    /* if the input projection is ISIN then get the delta_s slopes for
+       each line. they are kept for the other bands of this input grid. */
+    if ( inproj->proj_code == ISINUS )
     {
-        MessageHandler( "\nNNResample",
-            "Calculating ISIN shifts for input image" );
-        fprintf( stdout, "%% complete (" MRT_SIZE_T_FMT " rows): 0%%",
-                 input->nrows );
-        fflush( stdout );
-
-        /* initialize space to store nrows starting shift values and
-           shift slopes */
-        if ( delta_s_start != NULL )
-            free( delta_s_start );
-        delta_s_start = ( double * ) calloc( input->nrows, sizeof( double ) );
-        if ( delta_s_start == NULL )
-        {
-            ErrorHandler( TRUE, "NNResample", ERROR_MEMORY,
-               "Error allocating space for the delta_s_start buffer" );
-        }
-
-        if ( delta_s_slope != NULL )
-            free( delta_s_slope );
-        delta_s_slope = ( double * ) calloc( input->nrows, sizeof( double ) );
-        if ( delta_s_slope == NULL )
-        {
-            free( delta_s_start );
-            ErrorHandler( TRUE, "NNResample", ERROR_MEMORY,
-               "Error allocating space for the delta_s_slope buffer" );
-        }
-
-        /* loop through the rows calculating the starting shift and slope
-           for each row. if a starting or ending shift value is not available
-           (bounding tiles) then set starting shift and slope to 0.0. */
-        k = 0;
-        for ( i = 0; i < input->nrows; i++ )
-        {
-            /* update status? */
-            if ( 100 * i / input->nrows > k )
-            {
-                k = 100 * i / input->nrows;
-                if ( k % 10 == 0 )
-                {
-                    fprintf( stdout, " " MRT_SIZE_T_FMT "%%", k );
-                    fflush( stdout );
-                }
-            }
-
-            /* calculate the delta_s for sample 0. keep for later
-               calculations. */
-            status = calc_isin_shift ( i, 0, inproj, upleft_x, upleft_y,
-                input->pixel_size, modis->output_datum_code, &delta_s );
-            if ( status == GCTP_ERANGE || status == IN_BREAK )
-            {   /* The value was out of range for the projection. */
-                delta_s_start[i] = -99.0;
-            }
-            else if ( status != E_GEO_SUCC )
-            {
-                free( delta_s_start );
-                free( delta_s_slope );
-                ErrorHandler( FALSE, "NNResample", ERROR_GENERAL,
-                    "Error calculating the ISIN delta_s_start value." );
-                return( status );
-            }
-            else
-            {
-                delta_s_start[i] = delta_s;
-            }
-
-            /* calculate the delta_s for sample ncols-1 */
-            status = calc_isin_shift ( i, input->ncols - 1, inproj, upleft_x,
-                upleft_y, input->pixel_size, modis->output_datum_code,
-                &delta_s );
-            if ( status == GCTP_ERANGE || status == IN_BREAK )
-            {   /* The value was out of range for the projection. */
-                delta_s_end = -99.0;
-            }
-            else if ( status != E_GEO_SUCC )
-            {
-                free( delta_s_start );
-                free( delta_s_slope );
-                ErrorHandler( FALSE, "NNResample", ERROR_GENERAL,
-                    "Error calculating the ISIN delta_s_end value." );
-                return( status );
-            }
-            else
-            {
-                delta_s_end = delta_s;
-            }
-
-            /* calculate the slope for the current row */
-            if ( delta_s_start[i] == -99.0 || delta_s_end == -99.0 )
-            {
-                /* if either the start and/or end delta_s values are not
-                   available then set slope to 0.0. reset delta_s_start to
-                   0.0 if it is not available. */
-                delta_s_slope[i] = 0.0;
-
-                /* if delta_s_start is -99.0 then reset to 0.0 */
-                if ( delta_s_start[i] == -99.0 )
-                    delta_s_start[i] = 0.0;
-            }
-            else
-            {
-                delta_s_slope[i] = ( delta_s_end - delta_s_start[i] ) /
-                    ( input->ncols - 1 );
-
-                /* generate delta_s statistics. delta's commonly fall
-                   between 3.25 and -3.25. */
-                if ( delta_s_end < min_delta )
-                    min_delta = delta_s_end;
-                if ( delta_s_start[i] < min_delta )
-                    min_delta = delta_s_start[i];
-                if ( delta_s_end > max_delta )
-                    max_delta = delta_s_end;
-                if ( delta_s_start[i] > max_delta )
-                    max_delta = delta_s_start[i];
-                sum_delta += delta_s_end + delta_s_start[i];
-                count += 2;
-            }
-        }  /* end for i = input->nrows */
-
-        fprintf( stdout, " 100%%\n" );
-        fflush( stdout );
-
-        /* output ISIN shift stats */
-        MessageHandler( "\nNNResample", "ISIN Shift Statistics:" );
-        if ( count != 0 )
-        {
-            MessageHandler( NULL, "  min delta shift = %f", min_delta );
-            MessageHandler( NULL, "  max delta shift = %f", max_delta );
-            MessageHandler( NULL, "  avg delta shift = %f", sum_delta / count );
-        }
-        else
-        {
-            MessageHandler( NULL, "  min delta shift = 0.0" );
-            MessageHandler( NULL, "  max delta shift = 0.0" );
-            MessageHandler( NULL, "  avg delta shift = 0.0" );
-        }
-
-        /* set the previous pixel size to the current pixel size */
-        previous_pixel_size = input->pixel_size;
-    }  /* end ISINUS */
+        status = GetIsinShifts( modis, input, upleft_x, upleft_y,
+            "NNResample", &delta_s_start, &delta_s_slope );
+        if ( status != E_GEO_SUCC )
+            return ( status );
+    }
 
     if ( modis->output_datum_code != E_NODATUM )
     {   /* Don't call c_transinit or c_trans if a datum shift is not
@@ -310,160 +312,70 @@ int NNResample
         /* check projection return value */
         if ( status != MRT_NO_ERROR )
         {
-            free( delta_s_start );
-            delta_s_start = NULL;
-            free( delta_s_slope );
-            delta_s_slope = NULL;
             ErrorHandler( FALSE, "NNResample", ERROR_GENERAL,
                "Error in initializing the inverse projection (c_transinit)" );
             return ( status );
         }
     }
 
-    /* allocate the local output buffer */
-    buffer = ( double * ) calloc( output->ncols, sizeof( double ) );
-    if ( buffer == NULL )
-    {
-        free( delta_s_start );
-        delta_s_start = NULL;
-        free( delta_s_slope );
-        delta_s_slope = NULL;
-        ErrorHandler( TRUE, "NNResample", ERROR_MEMORY,
-           "Error allocating space for the row buffer" );
-    }
-
     MessageHandler( "\nNNResample", "processing band %s",
         modis->bandinfo[input->bandnum].name );
 
-    /* initialize status to terminal */
-    fprintf( stdout, "%% complete (" MRT_SIZE_T_FMT " rows): 0%%",
-             output->nrows );
-    fflush( stdout );
-    k = 0;
-
-    /* loop through output rows */
-    for ( i = 0; i < output->nrows; i++ )
+    /* resample and write the output rows */
+    job.name = "NNResample";
+    job.modis = modis;
+    job.input = input;
+    job.output = output;
+    job.upleft_x = upleft_x;
+    job.upleft_y = upleft_y;
+    job.background = background;
+    job.is_isin = ( inproj->proj_code == ISINUS );
+    job.delta_s_start = delta_s_start;
+    job.delta_s_slope = delta_s_slope;
+    job.last_band = last_band;
+    job.map = NULL;
+    job.native = FALSE;
+    job.resample_row = NNResampleRow;
+
+    /* integer bands which keep their data type are resampled in it */
+    if ( input->datatype == output->datatype )
     {
-	/* update status ? */
-	if ( 100 * i / output->nrows > k )
-	{
-	    k = 100 * i / output->nrows;
-	    if ( k % 10 == 0 )
-	    {
-		fprintf( stdout, " " MRT_SIZE_T_FMT "%%", k );
-		fflush( stdout );
-	    }
-	}
-
-        /* since we're on a grid, get output northing once. pass the center
-           of the pixel rather than the outer extent. */
-        outy = output->coord_corners[UL][1] - i * output->output_pixel_size -
-               output->output_pixel_size * 0.5;
-
-	/* loop through output cols */
-	for ( j = 0; j < output->ncols; j++ )
-	{
-            /* easting for this pixel. pass the center of the pixel rather than
-               the outer extent. */
-            outx = output->coord_corners[UL][0] +
-                j * output->output_pixel_size +
-                output->output_pixel_size * 0.5;
-
-	    /* get input coords */
-            if ( modis->output_datum_code != E_NODATUM )
-            {
-                status = c_trans( &outproj->proj_code, &outproj->units,
-                    &inproj->proj_code, &inproj->units, &outx, &outy, &inx,
-                    &iny );
-                if ( status == GCTP_ERANGE || status == IN_BREAK )
-                {   /* The value was out of range for the projection so
-                       just set it as a background pixel. */
-                    buffer[j] = background;
-                    continue;
-                }
-                else if ( status != E_GEO_SUCC )
-                {
-                    ErrorHandler( FALSE, "NNResample", ERROR_GENERAL,
-                        "Error converting output projection coordinates to "
-                        "input projection coordinates." );
-                    free( delta_s_start );
-                    delta_s_start = NULL;
-                    free( delta_s_slope );
-                    delta_s_slope = NULL;
-                    free( buffer );
-                    return( status );
-                }
-            }
-            else
-            {
-                /* Call GCTP directly to allow the semi-major and semi-minor
-                   to be specified directly.  Both the input and output
-                   sphere values need to be -1, and thus the projection
-                   parameters for both input and output will be used.
-                   If processing UTM, then use the input sphere value. */
-                status = gctp_call( outproj->proj_code, outproj->zone_code,
-                    outproj->sphere_code, outproj->proj_coef, outproj->units,
-                    outx, outy, inproj->proj_code, inproj->zone_code,
-                    inproj->sphere_code, inproj->proj_coef, inproj->units,
-                    &inx, &iny );
-                if ( status == GCTP_ERANGE || status == IN_BREAK )
-                {   /* The value was out of range for the projection so
-                       just set it as a background pixel. */
-                    buffer[j] = background;
-                    continue;
-                }
-                else if ( status != E_GEO_SUCC )
-                {
-                    ErrorHandler( FALSE, "NNResample", ERROR_GENERAL,
-                        "Error converting output projection coordinates to "
-                        "input projection coordinates." );
-                    free( delta_s_start );
-                    delta_s_start = NULL;
-                    free( delta_s_slope );
-                    delta_s_slope = NULL;
-                    free( buffer );
-                    return( status );
-                }
-	    }
-
-	    /* get input row - don't round up since our input UL coordinates
-               refer to the outer extent of the pixel */
-            row = ( upleft_y - iny ) / input->pixel_size;
-            
-            /* get input col - don't round up since our input UL coordinates
-               refer to the outer extent of the pixel */
-            col = ( inx - upleft_x ) / input->pixel_size;
-
-	    /* resample from input */
-	    buffer[j] = ReadBufferValue( (int)col, (int)row, input );
-	}
-
-	/* write the resampled row to output */
-        if ( !WriteRow( output, i, buffer ) )
+        job.native = TRUE;
+        switch ( output->datatype )
         {
-            ErrorHandler( FALSE, "NoResample", ERROR_GENERAL,
-                "Error writing the resampled row to the output file.");
-            free( delta_s_start );
-            delta_s_start = NULL;
-            free( delta_s_slope );
-            delta_s_slope = NULL;
-            free( buffer );
-            return( E_GEO_FAIL );
+            case DFNT_INT8:
+                job.resample_row = NNResampleRowInt8;
+                break;
+            case DFNT_UINT8:
+                job.resample_row = NNResampleRowUInt8;
+                break;
+            case DFNT_INT16:
+                job.resample_row = NNResampleRowInt16;
+                break;
+            case DFNT_UINT16:
+                job.resample_row = NNResampleRowUInt16;
+                break;
+            case DFNT_INT32:
+                job.resample_row = NNResampleRowInt32;
+                break;
+            default:
+                job.native = FALSE;
+                break;
         }
     }
 
-    fprintf( stdout, " 100%%\n" );
-    fflush( stdout );
-
-    /* free up the allocated memory. don't free the static variables until
-       the last band. */
-    free( buffer );
-    if ( inproj->proj_code == ISINUS && last_band == TRUE )
+    /* the background fill is rounded and clipped the same as WriteRow
+       would */
+    if ( job.native && !SelectRowConverters( output ) )
+        job.native = FALSE;
+    if ( job.native )
+        output->write_convert( &background, job.background_native, 1 );
+    else
+        job.resample_row = NNResampleRow;
+    status = ResampleRows( &job );
+    if ( status != E_GEO_SUCC )
     {
-        free( delta_s_start );
-        delta_s_start = NULL;
-        free( delta_s_slope );
-        delta_s_slope = NULL;
+        return( status );
     }
 
     return ( MRT_NO_ERROR );
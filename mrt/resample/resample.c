@@ -3,9 +3,9 @@
 
 /******************************************************************************
 
-MODULE:  main
+MODULE:  RunResample
 
-PURPOSE:  Program entry point
+PURPOSE:  Resample one image (the whole run, or one job of a batch run)
 
 RETURN VALUE:
 Type = int
@@ -16,26 +16,21 @@ status          See mrt_error.h for a complete list of error codes
 HISTORY:
 Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
-         05/00  John Weiss             Original Development
-         05/00  John Weiss             Merge code from rlb
-         01/01  John Rishea            Standardized formatting
-         01/01  John Rishea            Added error check for unsuccessful
-                                       dynamic memory allocation
-         02/01  John Weiss             Add JR's metadata function call.
-         06/01  Gail Schmidt           Allow the resample.log file to be
-                                       specified via a command-line option
-         01/02  Gail Schmidt           Read the command-line parameters before
-                                       reading the parameter file and
-                                       processing the arguments.
- 
+         10/26                         Original Development (from main)
+         10/26                         Write the zonal statistics (-zonal)
+
 NOTES:
+  The log file must already be open.  What's kept for the whole run (the
+  output to input mapping and the ISIN shift tables) is freed by main.
 
-******************************************************************************/
+  With -zonal, the statistics of the output bands in the zones of the
+  label raster are written to <output file without extension>.zonal.csv.
 
-int main
+******************************************************************************/
+static int RunResample
 (
-    int argc,
-    char *argv[]
+    int argc,                   /* I: number of arguments */
+    char *argv[]                /* I: argument strings */
 )
 
 {
@@ -46,28 +41,10 @@ int main
     ModisDescriptor *modis = NULL;  /* session info */
     char str[LARGE_STRING+1];   /* misc string handling */
                                 /* SMALL_STRING defined in resample.h */
+    char *ext;                  /* extension of the output file name */
+    int zonal_errval = MRT_NO_ERROR;  /* status of the zonal statistics */
     time_t startdate, enddate;	/* start and end date struct */
 
-    /* check usage */
-    if ( argc < 3 )
-    {
-	Usage();
-	return ERROR_GENERAL;
-    }
-
-    /* set up a log file and process the -g command line option if it exists.
-       the -g option should be processed before Hdf2Hdr is called or any
-       other processing takes place. */
-    InitLogHandler( argc, argv );
-
-    /* see if we want to call Hdf2Hdr() */
-    if ( argc == 3 && strcmp( argv[1], "-h" ) == 0 )
-    {
-	errval = Hdf2Hdr( argv[2] );
-	CloseLogHandler();
-	return errval;
-    }
-
     /* print a log file header */
     MessageHandler( NULL,
        "*******************************************************************"
@@ -160,6 +137,19 @@ int main
 	ErrorHandler( TRUE, "main()", errval, str );
     }
 
+    /* read the zones of the zonal statistics */
+    if ( modis->zonal_filename )
+    {
+        modis->zonal = OpenZonalLabels( modis->zonal_filename,
+            modis->zonal_bins );
+        if ( !modis->zonal )
+        {
+            sprintf( str, "Unable to read the zones of %s",
+                modis->zonal_filename );
+            ErrorHandler( TRUE, "main()", ERROR_ZONAL_FIELD, str );
+        }
+    }
+
     /* invoke the resampler */
     fflush( stdout );
     errval = ResampleImage( modis );
@@ -175,6 +165,25 @@ int main
 	ErrorHandler( TRUE, "main()", errval, str );
     }
 
+    /* write the zonal statistics next to the output file */
+    if ( modis->zonal )
+    {
+        strncpy( str, modis->output_filename, LARGE_STRING - 16 );
+        str[LARGE_STRING - 16] = '\0';
+        ext = strrchr( str, '.' );
+        if ( ext && !strchr( ext, '/' ) )
+            *ext = '\0';
+        strcat( str, ".zonal.csv" );
+        if ( !WriteZonalTable( modis->zonal, str ) )
+            zonal_errval = ERROR_WRITE_OUTPUTIMAGE;
+        CloseZonalTable( modis->zonal );
+        modis->zonal = NULL;
+    }
+
+    /* the headers of the tiles of a virtual mosaic are kept until every
+       band has been resampled */
+    FreeVirtualMosaic( );
+
     /* write header file (multifile format) */
     if ( modis->output_filetype == RAW_BINARY )
         WriteHeaderFile( modis );
@@ -187,7 +196,6 @@ int main
     MessageHandler( NULL, "End Time:  %s", ctime( &enddate ) );
     MessageHandler( NULL, "Finished processing!\n" );
     MessageHandler( NULL, "******************************************************************************\n");
-    CloseLogHandler();
 
     /* if outputting to HDF-EOS, add metadata (if processing HDF-EOS input)
        and attributes */
@@ -202,7 +210,92 @@ int main
         }
     }
 
+    FreeModisDescriptor( modis );
+    free( modis );
+
     /* indicate successful completion of processing */
+    if ( errval == MRT_NO_ERROR )
+        errval = zonal_errval;
     return errval;
 }
 
+
+/******************************************************************************
+
+MODULE:  main
+
+PURPOSE:  Program entry point
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+status          See mrt_error.h for a complete list of error codes
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         05/00  John Weiss             Original Development
+         05/00  John Weiss             Merge code from rlb
+         01/01  John Rishea            Standardized formatting
+         01/01  John Rishea            Added error check for unsuccessful
+                                       dynamic memory allocation
+         02/01  John Weiss             Add JR's metadata function call.
+         06/01  Gail Schmidt           Allow the resample.log file to be
+                                       specified via a command-line option
+         01/02  Gail Schmidt           Read the command-line parameters before
+                                       reading the parameter file and
+                                       processing the arguments.
+         10/26                         Free the ISIN shift tables kept for
+                                       the run (FreeIsinShifts)
+         10/26                         Free the virtual mosaic tile headers
+         10/26                         Added -batch, which runs each job of
+                                       a batch file in this one process
+ 
+NOTES:
+
+******************************************************************************/
+
+int main
+(
+    int argc,
+    char *argv[]
+)
+
+{
+    int errval;			/* error status */
+
+    /* check usage */
+    if ( argc < 3 )
+    {
+	Usage();
+	return ERROR_GENERAL;
+    }
+
+    /* set up a log file and process the -g command line option if it exists.
+       the -g option should be processed before Hdf2Hdr is called or any
+       other processing takes place. */
+    InitLogHandler( argc, argv );
+
+    /* see if we want to call Hdf2Hdr() */
+    if ( argc == 3 && strcmp( argv[1], "-h" ) == 0 )
+    {
+	errval = Hdf2Hdr( argv[2] );
+	CloseLogHandler();
+	return errval;
+    }
+
+    /* run each job of a batch file, or just the one on the command line */
+    if ( strcmp( argv[1], "-batch" ) == 0 )
+	errval = RunBatchJobs( argv[2], argv[0], RunResample );
+    else
+	errval = RunResample( argc, argv );
+
+    /* the output to input mapping and the ISIN shift tables are kept until
+       every job has been run */
+    FreeBandMap( );
+    FreeIsinShifts( );
+    CloseLogHandler();
+
+    return errval;
+}
@@ -6,6 +6,69 @@
 #include <string.h>
 #include "shared_resample.h"
 
+/* largest output to input mapping kept for the following bands of the same
+   resolution (see band_map.c) */
+#define MAX_MAP_CACHE_SIZE 1073741824  /* 1 GB */
+
+/* byte order mark kept in the LUT cache file keys (see lut_cache.c) */
+#define LUT_BYTE_ORDER 0x01020304UL
+
+/* offset of the table in a LUT cache file with a key of keysize bytes */
+#define LUT_DATA_OFFSET( keysize ) ( ( ( keysize ) + 15 ) / 16 * 16 )
+
+/* The input line/sample of every output pixel of a band, kept so that the
+   following bands of the same resolution don't have to be mapped again.
+   The line/sample are kept as floats, and pixels which don't map to input
+   have a sample of MAP_NO_INPUT (see band_map.c). */
+typedef struct
+{
+    size_t nrows, ncols;        /* output size */
+    double upleft_x, upleft_y;  /* UL input projection coords */
+    double out_corners[4][2];   /* output projection corners */
+    float *incol;               /* input sample for each output pixel */
+    float *inrow;               /* input line for each output pixel */
+    int complete;               /* has every row been mapped? */
+}
+BandMapType;
+
+/* An output band to be resampled by ResampleRows.  The NN, BI and CC
+   resamplers fill this in and supply the function which resamples one
+   output row from the input line/sample locations of its pixels. */
+typedef struct ResampleJob_tag
+{
+    char *name;                 /* resampler name for messages */
+    ModisDescriptor *modis;     /* session info */
+    FileDescriptor *input;      /* input file info */
+    FileDescriptor *output;     /* output file info */
+    double upleft_x, upleft_y;  /* UL input projection coords */
+    double background;          /* background fill value */
+    int is_isin;                /* is the input projection ISIN? */
+    double *delta_s_start;      /* starting ISIN shift for each input line */
+    double *delta_s_slope;      /* ISIN shift slope for each input line */
+    int last_band;              /* is this the last band to be processed? */
+    BandMapType *map;           /* mapping shared with the other bands of
+                                   this resolution (set by ResampleRows) */
+    int native;                 /* does resample_row produce rows in the
+                                   output data type rather than double? */
+    size_t pixel_bytes;         /* bytes per pixel of the resampled rows
+                                   (set by ResampleRows) */
+    char background_native[sizeof( double )];
+                                /* background fill in the output data type
+                                   (native rows only) */
+    void ( *resample_row )      /* resample one output row */
+    (
+        struct ResampleJob_tag *job,    /* I: band being resampled */
+        FileDescriptor *input,  /* I: input to read (may be a thread's own
+                                      view of job->input) */
+        double *incol,          /* I: input sample for each output pixel */
+        double *inrow,          /* I: input line for each output pixel */
+        int *valid,             /* I: does the output pixel map to input? */
+        void *buffer            /* O: resampled output row (double, or
+                                      the output data type if native) */
+    );
+}
+ResampleJob;
+
 /* Local Prototypes */
 int calc_isin_shift
 (
@@ -19,6 +82,135 @@ int calc_isin_shift
     double *delta_s             /* O: shift for the ISIN shift calculation */
 );
 
+int calc_isin_shift_xform
+(
+    int lisin,                  /* I: input projection line coord */
+    int sisin,                  /* I: input projection sample coord */
+    GctpXform *inv_xform,       /* I/O: input projection to lat/long */
+    GctpXform *for_xform,       /* I/O: lat/long to input projection */
+    double upleft_x,            /* I: upper left input projection coord */
+    double upleft_y,            /* I: upper left input projection coord */
+    double input_pixel_size,    /* I: pixel size for input image */
+    double *delta_s             /* O: shift for the ISIN shift calculation */
+);
+
+int GetIsinShifts
+(
+    ModisDescriptor *modis,     /* I: session info */
+    FileDescriptor *input,      /* I: input file info */
+    double upleft_x,            /* I: upper left input projection coord */
+    double upleft_y,            /* I: upper left input projection coord */
+    char *name,                 /* I: resampler name for messages */
+    double **delta_s_start,     /* O: starting shift of each input line */
+    double **delta_s_slope      /* O: shift slope of each input line */
+);
+
+void FreeIsinShifts
+(
+    void
+);
+
+int LutCacheName
+(
+    char *prefix,               /* I: file name prefix (kind of table) */
+    void *key,                  /* I: key of the table */
+    size_t keysize,             /* I: size of the key */
+    char *name                  /* O: LUT cache file name (LARGE_STRING) */
+);
+
+FILE *OpenLutCacheFile
+(
+    char *name,                 /* I: LUT cache file name */
+    void *key,                  /* I: key of the table */
+    size_t keysize,             /* I: size of the key */
+    size_t datasize             /* I: size of the table */
+);
+
+int WriteLutCacheFile
+(
+    char *name,                 /* I: LUT cache file name */
+    void *key,                  /* I: key of the table */
+    size_t keysize,             /* I: size of the key */
+    int narrays,                /* I: number of arrays in the table */
+    void **arrays,              /* I: the arrays */
+    size_t *nbytes              /* I: size of each array */
+);
+
+int MapOutputRow
+(
+    ModisDescriptor *modis,     /* I: session info */
+    GctpXform *xform,           /* I/O: output to input GCTP transformation
+                                        (not used for datum conversions) */
+    FileDescriptor *input,      /* I: input file info */
+    FileDescriptor *output,     /* I: output file info */
+    size_t row,                 /* I: output row to map */
+    double upleft_x,            /* I: upper left input projection coord */
+    double upleft_y,            /* I: upper left input projection coord */
+    double *incol,              /* O: input sample for each output column */
+    double *inrow,              /* O: input line for each output column */
+    int *valid                  /* O: TRUE if the output pixel maps to a
+                                      valid input location */
+);
+
+int GetResampleThreads
+(
+    ModisDescriptor *modis      /* I: session info */
+);
+
+int ResampleRows
+(
+    ResampleJob *job            /* I: band to resample */
+);
+
+int GetBandOutputCorners
+(
+    ModisDescriptor *modis,     /* I: session info */
+    FileDescriptor *output,     /* I/O: output file info */
+    FileDescriptor *input       /* I: input file info */
+);
+
+BandMapType *OpenBandMap
+(
+    ResampleJob *job            /* I: band being resampled */
+);
+
+void RoundBandMapRow
+(
+    size_t ncols,               /* I: output row size */
+    double *incol,              /* I/O: input sample for each output pixel */
+    double *inrow               /* I/O: input line for each output pixel */
+);
+
+void PutBandMapRow
+(
+    BandMapType *map,           /* I/O: mapping being filled in */
+    size_t row,                 /* I: output row */
+    double *incol,              /* I/O: input sample for each output pixel */
+    double *inrow,              /* I/O: input line for each output pixel */
+    int *valid                  /* I: does each output pixel map to input? */
+);
+
+void GetBandMapRow
+(
+    BandMapType *map,           /* I: complete mapping */
+    size_t row,                 /* I: output row */
+    double *incol,              /* O: input sample for each output pixel */
+    double *inrow,              /* O: input line for each output pixel */
+    int *valid                  /* O: does each output pixel map to input? */
+);
+
+void CloseBandMap
+(
+    BandMapType *map,           /* I/O: mapping from OpenBandMap (or NULL) */
+    int success,                /* I: was every row mapped? */
+    int last_band               /* I: is this the last band to be processed */
+);
+
+void FreeBandMap
+(
+    void
+);
+
 int Hdf2Hdr
 (
     char *filename
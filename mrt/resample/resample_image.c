@@ -21,6 +21,11 @@ Version  Date   Programmer       Code  Reason
          05/01   John Weiss            Removed HDF SDS code
          07/01   Gail Schmidt          Check error status returned from
                                        the resampler
+         10/26                         Report the input read cache
+                                       statistics for each band
+         10/26                         Virtual mosaic input
+         10/26                         Gather the zonal statistics of each
+                                       output band (-zonal)
 
 NOTES:
 
@@ -45,6 +50,7 @@ int ResampleImage
     HdfEosFD *input_hdfptr = NULL, *output_hdfptr = NULL;
     double temp_parms[15];      /* temporary projection parameters */
     int last_band = TRUE;       /* are we processing the last band? */
+    ZonalBand *zonal_band;      /* zonal statistics of the band */
 
     /* first, setup the output band info so we can fill things in as we go */
     /* no output files written yet, this counter is for multi file headers */
@@ -112,6 +118,7 @@ int ResampleImage
 	switch ( modis->input_filetype )
 	{
 	    case RAW_BINARY:
+	    case VIRTUAL_MOSAIC:
 		/* open input file */
 		input = OpenInImage( modis, inband, &status );
 		if ( !input )
@@ -207,6 +214,19 @@ int ResampleImage
 		"problem opening output file" );
 	}
 
+	/* gather the zonal statistics of the band as it's written */
+	if ( modis->zonal )
+	{
+	    zonal_band = AddZonalBand( modis->zonal,
+		modis->bandinfo[inband].name, output->background_fill,
+		modis->bandinfo[inband].min_value,
+		modis->bandinfo[inband].max_value );
+	    if ( !zonal_band || !AttachZonalBand( zonal_band, output,
+		modis->out_projection_info->proj_code ) )
+		ErrorHandler( TRUE, "ResampleImage", ERROR_ZONAL_FIELD,
+		    "problem gathering the zonal statistics" );
+	}
+
         /* is this the last band?  loop through the rest of the bands to
            see if there are any other bands selected.  if this is the last
            band then let the resampling processes know so that they can
@@ -255,10 +275,14 @@ int ResampleImage
                 "Error occurred in the resample process" );
         }
 
+        /* report how well the input read cache did for this band */
+        ReportFileBufferStats( input );
+
 	/* close input file */
 	switch ( modis->input_filetype )
 	{
 	    case RAW_BINARY:
+	    case VIRTUAL_MOSAIC:
 		CloseFile( input );
 		break;
 
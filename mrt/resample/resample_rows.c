@@ -0,0 +1,805 @@
+/******************************************************************************
+
+FILE:  resample_rows.c
+
+PURPOSE:  Resample the rows of an output band, optionally on several threads
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development (row loop from
+                                       NNResample, BIResample and CCResample)
+         10/26                         Keep the read cache statistics of the
+                                       threads' input views
+         10/26                         Write rows resampled directly in the
+                                       output data type (job->native)
+         10/26                         Keep the output to input mapping for
+                                       the following bands (band_map.c)
+         10/26                         Added GetResampleThreads (also used for
+                                       the ISIN shifts)
+         10/26                         Copy rows to and from the compact
+                                       kept mapping
+
+HARDWARE AND/OR SOFTWARE LIMITATIONS:
+  Requires POSIX threads
+
+PROJECT:    MODIS Reprojection Tool
+
+NOTES:
+  1. The number of threads comes from the -threads command-line switch or
+     the NUM_THREADS parameter (0 = one per online processor).  With one
+     thread the rows are resampled and written by the calling thread,
+     exactly as before.
+  2. With more than one thread the output rows are split into batches of
+     ROWS_PER_BATCH rows.  Each worker thread takes the next batch, maps it
+     back to input space, resamples it into one of the batch slots and
+     marks the slot done.  The calling thread is the writer; it waits for
+     the batches in order and writes their rows, so the output is the same
+     no matter how many threads are used.  A batch is only started once
+     its slot has been written, which limits the memory used.
+  3. Each worker reads the input through its own copy of the input file
+     descriptor which has its own (smaller) read buffers.  The reads that
+     miss those buffers, and the writes, are serialized with io_mutex
+     since the raw binary FILE pointer, the shared row buffer and the
+     HDF-EOS library can't be used by more than one thread at a time.
+  4. Each worker has its own GCTP transformation.  If the transformation
+     isn't reentrant (see gctp_xform_reentrant), or the datum conversion
+     is done with geolib, then mapping each row is serialized with
+     map_mutex.
+  5. If job->native is set, resample_row produces rows in the output data
+     type and they are written with WriteRowNative, so the row buffers are
+     output->datasize bytes per pixel rather than a double.
+  6. The rows are copied into the mapping kept by band_map.c when there is
+     room for it, and the following bands of the same resolution copy them
+     back rather than mapping anything (see OpenBandMap).
+
+******************************************************************************/
+#include <pthread.h>
+#include <unistd.h>
+#include "resample.h"
+#include "worgen.h"
+#include "cproj.h"
+#include "mrt_dtype.h"
+
+/* number of output rows given to a worker thread at a time */
+#define ROWS_PER_BATCH 16
+
+/* number of batch slots for each worker thread */
+#define SLOTS_PER_THREAD 2
+
+/* smallest input read buffer given to each worker thread */
+#define MIN_THREAD_BUFFER_SIZE 4194304  /* 4 MB */
+
+/* serializes input reads and output writes between the threads */
+static pthread_mutex_t io_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* serializes the output to input mapping when it isn't reentrant */
+static pthread_mutex_t map_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* batches of output rows shared between the worker threads and the writer */
+typedef struct
+{
+    pthread_mutex_t mutex;      /* protects the rest of this structure */
+    pthread_cond_t cond;        /* signaled when any of it changes */
+    size_t nbatches;            /* number of batches in the band */
+    size_t next_batch;          /* next batch to be resampled */
+    size_t next_write;          /* next batch to be written */
+    size_t nslots;              /* number of batch slots */
+    char **slot;                /* resampled rows for each slot */
+    size_t *slot_batch;         /* batch completed in each slot */
+    int abort;                  /* has an error occurred? */
+    int status;                 /* error code of the first error */
+}
+BatchQueueType;
+
+/* private state of each worker */
+typedef struct
+{
+    ResampleJob *job;           /* band being resampled */
+    BatchQueueType *queue;      /* batches shared with the writer (NULL if
+                                   there is only one thread) */
+    FileDescriptor *input;      /* input to read from */
+    FileDescriptor view;        /* this worker's copy of the input file
+                                   descriptor (more than one thread) */
+    int have_view;              /* does view have its own read buffers? */
+    GctpXform xform;            /* output to input GCTP transformation */
+    int have_xform;             /* was xform initialized? */
+    int map_lock;               /* serialize MapOutputRow? */
+    double *incol;              /* input sample for each output pixel */
+    double *inrow;              /* input line for each output pixel */
+    int *valid;                 /* does each output pixel map to input? */
+    pthread_t thread;           /* worker thread id */
+}
+WorkerType;
+
+/******************************************************************************
+
+MODULE:  IoLock
+
+PURPOSE:  Lock or unlock the input/output mutex (FileDescriptor read_lock)
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+
+******************************************************************************/
+static void IoLock
+(
+    int lock                    /* I: TRUE to lock, FALSE to unlock */
+)
+
+{
+    if ( lock )
+        pthread_mutex_lock( &io_mutex );
+    else
+        pthread_mutex_unlock( &io_mutex );
+}
+
+/******************************************************************************
+
+MODULE:  InitWorker
+
+PURPOSE:  Set up the input view, GCTP transformation and line/sample
+          buffers for a worker
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+E_GEO_SUCC      Successful completion
+other           Error code from gctp_call_init
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Memory allocation errors are fatal.
+
+******************************************************************************/
+static int InitWorker
+(
+    ResampleJob *job,           /* I: band being resampled */
+    WorkerType *w,              /* O: worker to set up */
+    BatchQueueType *queue,      /* I: shared batches (NULL for one thread) */
+    int nthreads                /* I: number of worker threads */
+)
+
+{
+    ModisDescriptor *modis = job->modis;  /* session info */
+    ProjInfo *inproj, *outproj; /* input/output projection data */
+    size_t buffer_size;         /* read buffer size for this worker */
+    int status;                 /* return status error code */
+
+    inproj = modis->in_projection_info;
+    outproj = modis->out_projection_info;
+
+    memset( w, 0, sizeof( WorkerType ) );
+    w->job = job;
+    w->queue = queue;
+    w->input = job->input;
+
+    /* allocate the input line/sample locations for an output row.  the
+       input lines are stored after the input samples. */
+    w->incol = ( double * ) calloc( 2 * job->output->ncols,
+        sizeof( double ) );
+    w->valid = ( int * ) calloc( job->output->ncols, sizeof( int ) );
+    if ( w->incol == NULL || w->valid == NULL )
+    {
+        ErrorHandler( TRUE, job->name, ERROR_MEMORY,
+           "Error allocating space for the input line/sample buffers" );
+    }
+    w->inrow = &w->incol[job->output->ncols];
+
+    /* give each thread its own read buffers, sharing the file itself */
+    if ( nthreads > 1 )
+    {
+        buffer_size = MAX_BUFFER_SIZE / nthreads;
+        if ( buffer_size < MIN_THREAD_BUFFER_SIZE )
+            buffer_size = MIN_THREAD_BUFFER_SIZE;
+
+        w->view = *job->input;
+        memset( &w->view.cache, 0, sizeof( ReadCacheType ) );
+        CreateFileBuffersMax( &w->view, buffer_size );
+        w->view.read_lock = IoLock;
+        w->input = &w->view;
+        w->have_view = TRUE;
+    }
+
+    /* nothing to map if a previous band left the whole mapping */
+    if ( job->map != NULL && job->map->complete )
+        return ( E_GEO_SUCC );
+
+    if ( modis->output_datum_code != E_NODATUM )
+    {
+        /* c_transinit was called by the resampler and geolib keeps its
+           state in statics, so only one thread can map at a time */
+        w->map_lock = ( nthreads > 1 );
+    }
+    else
+    {
+        /* set up the output to input GCTP transformation once rather than
+           for every output pixel */
+        status = gctp_call_init( &w->xform, outproj->proj_code,
+            outproj->zone_code, outproj->sphere_code, outproj->proj_coef,
+            outproj->units, inproj->proj_code, inproj->zone_code,
+            inproj->sphere_code, inproj->proj_coef, inproj->units );
+        if ( status != E_GEO_SUCC )
+            return ( status );
+        w->have_xform = TRUE;
+        w->map_lock = ( nthreads > 1 && !gctp_xform_reentrant( &w->xform ) );
+    }
+
+    return ( E_GEO_SUCC );
+}
+
+/******************************************************************************
+
+MODULE:  FreeWorker
+
+PURPOSE:  Free everything set up by InitWorker
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Safe to call on a worker which InitWorker only partly set up.
+
+******************************************************************************/
+static void FreeWorker
+(
+    WorkerType *w               /* I/O: worker to free */
+)
+
+{
+    free( w->incol );
+    w->incol = NULL;
+    w->inrow = NULL;
+    free( w->valid );
+    w->valid = NULL;
+
+    if ( w->have_view )
+    {
+        /* keep the read cache statistics with the input */
+        w->job->input->cache.lookups += w->view.cache.lookups;
+        w->job->input->cache.misses += w->view.cache.misses;
+        DestroyFileBuffers( &w->view );
+        w->have_view = FALSE;
+    }
+
+    if ( w->have_xform )
+    {
+        gctp_call_free( &w->xform );
+        w->have_xform = FALSE;
+    }
+}
+
+/******************************************************************************
+
+MODULE:  ResampleOneRow
+
+PURPOSE:  Map an output row back to input space and resample it
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+E_GEO_SUCC      Successful completion
+other           Error code from MapOutputRow
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+         10/26                         Use or fill in the mapping kept for
+                                       the bands of this resolution
+         10/26                         Copy the row to and from the kept
+                                       mapping
+
+NOTES:
+
+******************************************************************************/
+static int ResampleOneRow
+(
+    WorkerType *w,              /* I/O: worker doing the resampling */
+    size_t row,                 /* I: output row to resample */
+    void *buffer                /* O: resampled output row */
+)
+
+{
+    ResampleJob *job = w->job;  /* band being resampled */
+    BandMapType *map = job->map;  /* mapping kept for the other bands */
+    double *incol = w->incol;   /* input sample for each output pixel */
+    double *inrow = w->inrow;   /* input line for each output pixel */
+    int *valid = w->valid;      /* does each output pixel map to input? */
+    int status;                 /* return status error code */
+
+    /* map the center of each pixel in this output row back to input
+       line/sample, unless a previous band already did */
+    if ( map != NULL && map->complete )
+        GetBandMapRow( map, row, incol, inrow, valid );
+    else
+    {
+        if ( w->map_lock )
+            pthread_mutex_lock( &map_mutex );
+        status = MapOutputRow( job->modis, &w->xform, w->input, job->output,
+            row, job->upleft_x, job->upleft_y, incol, inrow, valid );
+        if ( w->map_lock )
+            pthread_mutex_unlock( &map_mutex );
+        if ( status != E_GEO_SUCC )
+            return ( status );
+
+        /* keep it for the following bands */
+        if ( map != NULL )
+            PutBandMapRow( map, row, incol, inrow, valid );
+        else
+            RoundBandMapRow( job->output->ncols, incol, inrow );
+    }
+
+    /* resample from input */
+    job->resample_row( job, w->input, incol, inrow, valid, buffer );
+
+    return ( E_GEO_SUCC );
+}
+
+/******************************************************************************
+
+MODULE:  WriteResampledRow
+
+PURPOSE:  Write a resampled row to the output file
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            Successful write
+FALSE           Unable to write
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+
+******************************************************************************/
+static int WriteResampledRow
+(
+    ResampleJob *job,           /* I: band being resampled */
+    size_t row,                 /* I: output row to write */
+    void *buffer                /* I: resampled output row */
+)
+
+{
+    if ( job->native )
+        return ( WriteRowNative( job->output, row, buffer ) );
+    else
+        return ( WriteRow( job->output, row, ( double * ) buffer ) );
+}
+
+/******************************************************************************
+
+MODULE:  WorkerThread
+
+PURPOSE:  Resample batches of output rows until there are none left
+
+RETURN VALUE:
+Type = void *
+Value           Description
+-----           -----------
+NULL            Always
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Errors are reported through the queue's abort flag and status.
+
+******************************************************************************/
+static void *WorkerThread
+(
+    void *arg                   /* I/O: WorkerType for this thread */
+)
+
+{
+    WorkerType *w = ( WorkerType * ) arg;  /* this worker */
+    BatchQueueType *q = w->queue;   /* shared batches */
+    size_t rowbytes = w->job->output->ncols * w->job->pixel_bytes;
+                                /* bytes in a resampled row */
+    size_t nrows = w->job->output->nrows;  /* output rows */
+    size_t batch;               /* batch being resampled */
+    size_t slot;                /* slot for the batch */
+    size_t row, last;           /* output rows in the batch */
+    int status = E_GEO_SUCC;    /* return status error code */
+
+    while ( 1 )
+    {
+        /* claim the next batch once its slot has been written */
+        pthread_mutex_lock( &q->mutex );
+        while ( !q->abort && q->next_batch < q->nbatches &&
+                q->next_batch >= q->next_write + q->nslots )
+            pthread_cond_wait( &q->cond, &q->mutex );
+        if ( q->abort || q->next_batch >= q->nbatches )
+        {
+            pthread_mutex_unlock( &q->mutex );
+            break;
+        }
+        batch = q->next_batch++;
+        pthread_mutex_unlock( &q->mutex );
+
+        slot = batch % q->nslots;
+        row = batch * ROWS_PER_BATCH;
+        last = row + ROWS_PER_BATCH;
+        if ( last > nrows )
+            last = nrows;
+
+        for ( ; row < last; row++ )
+        {
+            status = ResampleOneRow( w, row,
+                &q->slot[slot][( row % ROWS_PER_BATCH ) * rowbytes] );
+            if ( status != E_GEO_SUCC )
+                break;
+        }
+
+        /* hand the batch (or the error) to the writer */
+        pthread_mutex_lock( &q->mutex );
+        if ( status != E_GEO_SUCC )
+        {
+            if ( !q->abort )
+            {
+                q->abort = TRUE;
+                q->status = status;
+            }
+        }
+        else
+            q->slot_batch[slot] = batch;
+        pthread_cond_broadcast( &q->cond );
+        pthread_mutex_unlock( &q->mutex );
+
+        if ( status != E_GEO_SUCC )
+            break;
+    }
+
+    return ( NULL );
+}
+
+/******************************************************************************
+
+MODULE:  GetResampleThreads
+
+PURPOSE:  Get the number of threads to resample with
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+n               Number of threads (at least 1)
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development (from
+                                       ResampleRows)
+
+NOTES:
+  modis->nthreads of 0 means one thread per online processor.
+
+******************************************************************************/
+int GetResampleThreads
+(
+    ModisDescriptor *modis      /* I: session info */
+)
+
+{
+    int nthreads;               /* number of threads */
+
+    nthreads = modis->nthreads;
+    if ( nthreads <= 0 )
+        nthreads = ( int ) sysconf( _SC_NPROCESSORS_ONLN );
+    if ( nthreads < 1 )
+        nthreads = 1;
+
+    return ( nthreads );
+}
+
+/******************************************************************************
+
+MODULE:  ResampleRows
+
+PURPOSE:  Resample and write every row of an output band
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+E_GEO_SUCC      Successful completion
+E_GEO_FAIL      Error writing a row
+other           Error code from gctp_call_init or MapOutputRow
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+         10/26                         Native data type rows (job->native)
+         10/26                         Reuse the output to input mapping
+                                       between bands (OpenBandMap)
+
+NOTES:
+  The caller must have called InitOutputFile, and c_transinit if a datum
+  conversion is being done.  Errors have already been reported with
+  ErrorHandler when a failure is returned.
+
+******************************************************************************/
+int ResampleRows
+(
+    ResampleJob *job            /* I: band to resample */
+)
+
+{
+    FileDescriptor *output = job->output;  /* output file info */
+    BatchQueueType q;           /* batches shared with the workers */
+    WorkerType *workers = NULL; /* worker state */
+    int nthreads;               /* number of worker threads */
+    int nstarted = 0;           /* number of worker threads started */
+    int status = E_GEO_SUCC;    /* return status error code */
+    int write_error = FALSE;    /* did writing a row fail? */
+    int reported = FALSE;       /* has the error already been reported? */
+    int ready;                  /* is the batch ready to be written? */
+    int t;                      /* thread index */
+    size_t i, k;                /* row & progress indices */
+    size_t batch, slot, last;   /* batch being written */
+    size_t rowbytes;            /* bytes in a resampled row */
+    char *buffer = NULL;        /* output buffer (one thread) */
+
+    /* how many threads? no more than there are batches of rows */
+    nthreads = GetResampleThreads( job->modis );
+    memset( &q, 0, sizeof( BatchQueueType ) );
+    q.nbatches = ( output->nrows + ROWS_PER_BATCH - 1 ) / ROWS_PER_BATCH;
+    if ( ( size_t ) nthreads > q.nbatches )
+        nthreads = ( int ) q.nbatches;
+    if ( nthreads < 1 )
+        nthreads = 1;
+
+    /* rows are doubles unless the resampler works in the output type */
+    if ( job->native )
+        job->pixel_bytes = output->datasize;
+    else
+        job->pixel_bytes = sizeof( double );
+    rowbytes = output->ncols * job->pixel_bytes;
+
+    /* reuse the mapping of the previous band of this resolution, or keep
+       this band's mapping for the following ones */
+    job->map = OpenBandMap( job );
+
+    workers = ( WorkerType * ) calloc( nthreads, sizeof( WorkerType ) );
+    if ( workers == NULL )
+    {
+        ErrorHandler( TRUE, job->name, ERROR_MEMORY,
+           "Error allocating space for the resampling threads" );
+    }
+
+    if ( nthreads > 1 )
+        MessageHandler( NULL, "  resampling with %d threads", nthreads );
+
+    /* initialize status to terminal */
+    fprintf( stdout, "%% complete (" MRT_SIZE_T_FMT " rows): 0%%",
+             output->nrows );
+    fflush( stdout );
+    k = 0;
+
+    if ( nthreads == 1 )
+    {
+        /* resample and write each row in this thread */
+        status = InitWorker( job, &workers[0], NULL, 1 );
+        if ( status != E_GEO_SUCC )
+        {
+            ErrorHandler( FALSE, job->name, ERROR_GENERAL,
+               "Error in initializing the inverse projection "
+               "(gctp_call_init)" );
+            FreeWorker( &workers[0] );
+            free( workers );
+            CloseBandMap( job->map, FALSE, job->last_band );
+            job->map = NULL;
+            return ( status );
+        }
+
+        buffer = ( char * ) calloc( output->ncols, job->pixel_bytes );
+        if ( buffer == NULL )
+        {
+            ErrorHandler( TRUE, job->name, ERROR_MEMORY,
+               "Error allocating space for the row buffer" );
+        }
+
+        for ( i = 0; i < output->nrows; i++ )
+        {
+            /* update status ? */
+            if ( 100 * i / output->nrows > k )
+            {
+                k = 100 * i / output->nrows;
+                if ( k % 10 == 0 )
+                {
+                    fprintf( stdout, " " MRT_SIZE_T_FMT "%%", k );
+                    fflush( stdout );
+                }
+            }
+
+            status = ResampleOneRow( &workers[0], i, buffer );
+            if ( status != E_GEO_SUCC )
+                break;
+
+            /* write the resampled row to output */
+            if ( !WriteResampledRow( job, i, buffer ) )
+            {
+                write_error = TRUE;
+                status = E_GEO_FAIL;
+                break;
+            }
+        }
+
+        free( buffer );
+        FreeWorker( &workers[0] );
+    }
+    else
+    {
+        /* allocate the batch slots */
+        q.nslots = SLOTS_PER_THREAD * nthreads;
+        if ( q.nslots > q.nbatches )
+            q.nslots = q.nbatches;
+        q.slot = ( char ** ) calloc( q.nslots, sizeof( char * ) );
+        q.slot_batch = ( size_t * ) calloc( q.nslots, sizeof( size_t ) );
+        if ( q.slot == NULL || q.slot_batch == NULL )
+        {
+            ErrorHandler( TRUE, job->name, ERROR_MEMORY,
+               "Error allocating space for the row buffers" );
+        }
+        for ( slot = 0; slot < q.nslots; slot++ )
+        {
+            q.slot[slot] = ( char * ) calloc( ROWS_PER_BATCH, rowbytes );
+            if ( q.slot[slot] == NULL )
+            {
+                ErrorHandler( TRUE, job->name, ERROR_MEMORY,
+                   "Error allocating space for the row buffers" );
+            }
+            q.slot_batch[slot] = ( size_t ) -1;
+        }
+        pthread_mutex_init( &q.mutex, NULL );
+        pthread_cond_init( &q.cond, NULL );
+
+        /* set up and start the workers */
+        for ( t = 0; t < nthreads; t++ )
+        {
+            status = InitWorker( job, &workers[t], &q, nthreads );
+            if ( status == E_GEO_SUCC && pthread_create( &workers[t].thread,
+                NULL, WorkerThread, &workers[t] ) != 0 )
+                status = E_GEO_FAIL;
+            if ( status != E_GEO_SUCC )
+            {
+                ErrorHandler( FALSE, job->name, ERROR_GENERAL,
+                   "Error in initializing the inverse projection "
+                   "(gctp_call_init) or starting a resampling thread" );
+                FreeWorker( &workers[t] );
+                reported = TRUE;
+                pthread_mutex_lock( &q.mutex );
+                q.abort = TRUE;
+                pthread_cond_broadcast( &q.cond );
+                pthread_mutex_unlock( &q.mutex );
+                break;
+            }
+            nstarted++;
+        }
+
+        /* write the batches in order as they are completed */
+        for ( batch = 0; batch < q.nbatches && !reported; batch++ )
+        {
+            slot = batch % q.nslots;
+            pthread_mutex_lock( &q.mutex );
+            while ( q.slot_batch[slot] != batch && !q.abort )
+                pthread_cond_wait( &q.cond, &q.mutex );
+            ready = !q.abort;
+            pthread_mutex_unlock( &q.mutex );
+            if ( !ready )
+                break;
+
+            last = ( batch + 1 ) * ROWS_PER_BATCH;
+            if ( last > output->nrows )
+                last = output->nrows;
+            for ( i = batch * ROWS_PER_BATCH; i < last; i++ )
+            {
+                /* update status ? */
+                if ( 100 * i / output->nrows > k )
+                {
+                    k = 100 * i / output->nrows;
+                    if ( k % 10 == 0 )
+                    {
+                        fprintf( stdout, " " MRT_SIZE_T_FMT "%%", k );
+                        fflush( stdout );
+                    }
+                }
+
+                /* write the resampled row to output */
+                IoLock( TRUE );
+                if ( !WriteResampledRow( job, i,
+                    &q.slot[slot][( i % ROWS_PER_BATCH ) * rowbytes] ) )
+                    write_error = TRUE;
+                IoLock( FALSE );
+                if ( write_error )
+                    break;
+            }
+
+            /* free the slot for the next batch, or stop the workers */
+            pthread_mutex_lock( &q.mutex );
+            if ( write_error && !q.abort )
+            {
+                q.abort = TRUE;
+                q.status = E_GEO_FAIL;
+            }
+            q.next_write = batch + 1;
+            pthread_cond_broadcast( &q.cond );
+            pthread_mutex_unlock( &q.mutex );
+            if ( write_error )
+                break;
+        }
+
+        /* wait for the workers and clean up */
+        for ( t = 0; t < nstarted; t++ )
+        {
+            pthread_join( workers[t].thread, NULL );
+            FreeWorker( &workers[t] );
+        }
+        if ( status == E_GEO_SUCC && q.abort )
+            status = q.status;
+
+        pthread_cond_destroy( &q.cond );
+        pthread_mutex_destroy( &q.mutex );
+        for ( slot = 0; slot < q.nslots; slot++ )
+            free( q.slot[slot] );
+        free( q.slot );
+        free( q.slot_batch );
+    }
+
+    free( workers );
+
+    /* the mapping can only be used by the next band if every row of this
+       one was mapped */
+    if ( status != E_GEO_SUCC )
+    {
+        CloseBandMap( job->map, FALSE, job->last_band );
+        job->map = NULL;
+    }
+
+    if ( status != E_GEO_SUCC && !reported )
+    {
+        if ( write_error )
+            ErrorHandler( FALSE, job->name, ERROR_GENERAL,
+                "Error writing the resampled row to the output file." );
+        else
+            ErrorHandler( FALSE, job->name, ERROR_GENERAL,
+                "Error converting output projection coordinates to "
+                "input projection coordinates." );
+        return ( status );
+    }
+    else if ( status != E_GEO_SUCC )
+        return ( status );
+
+    fprintf( stdout, " 100%%\n" );
+    fflush( stdout );
+
+    CloseBandMap( job->map, TRUE, job->last_band );
+    job->map = NULL;
+
+    return ( E_GEO_SUCC );
+}
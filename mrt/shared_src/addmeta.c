@@ -11,6 +11,7 @@ Version    Date     Programmer      Code     Reason
            02/01    John Rishea              Modified original file
                                              to use with ModisTool
            05/01    John Weiss               Handle HDF attributes
+           10/26                             Virtual mosaic input
 
 HARDWARE AND/OR SOFTWARE LIMITATIONS:
     None
@@ -73,6 +74,8 @@ Version    Date     Programmer      Code     Reason
                                              Doug Ilg's metadmp.c program.
            02/01    John Weiss               Adapt for use in MRT resampler.
            05/01    John Weiss               Handle HDF attributes
+           10/26                             Create the attributes for
+                                             virtual mosaic input too
 
 NOTES:
 
@@ -147,8 +150,10 @@ intn AppendMetadata
         status = SDend( old_sd_id);
     }
 
-    /* otherwise just add the attributes if processing raw binary to HDF-EOS */
-    else if ( modis->input_filetype == RAW_BINARY &&
+    /* otherwise just add the attributes if processing raw binary (or a
+       virtual mosaic) to HDF-EOS */
+    else if ( ( modis->input_filetype == RAW_BINARY ||
+                modis->input_filetype == VIRTUAL_MOSAIC ) &&
               modis->output_filetype == HDFEOS )
     {
         /* transfer attributes from old HDF file to new HDF file */
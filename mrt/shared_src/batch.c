@@ -0,0 +1,475 @@
+/******************************************************************************
+
+FILE:  batch.c
+
+PURPOSE:  Run the jobs of a batch file (-batch)
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+         10/26                         Bound the batch file name in messages
+         10/26                         Run the jobs in a worker process, so a
+                                       fatal error only ends its own job
+
+HARDWARE AND/OR SOFTWARE LIMITATIONS:
+  None
+
+PROJECT:    MODIS Reprojection Tool
+
+NOTES:
+  A batch file has one job per line: the arguments the tool would be given
+  on its command line for that job, without the program name.  Arguments
+  are separated by blanks, and one with blanks in it can be put in double
+  quotes.  Blank lines and lines starting with # are skipped.
+
+  The jobs are run one after the other in the same process, so whatever a
+  tool keeps between jobs (the resampler's output to input mapping and ISIN
+  shift tables, the HDF library and the log file) is set up only once.
+  That process is a worker forked for the batch: a fatal error in a job
+  (ErrorHandler exits) ends the worker rather than the tool, and a new
+  worker goes on from the next job.  On Windows the jobs are run in the
+  tool itself, and a fatal error ends the batch.
+
+******************************************************************************/
+#include <ctype.h>
+#ifndef WIN32
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
+#include "shared_resample.h"
+
+/* state of a batch run */
+#define BATCH_BETWEEN  0        /* no job is running */
+#define BATCH_RUNNING  1        /* a job is running */
+#define BATCH_FINISHED 2        /* the whole batch file has been read */
+
+/* how far a batch run has got; the worker sends it to the tool each time
+   it changes */
+typedef struct
+{
+    long offset;                /* batch file position after the last line
+                                   read */
+    int lineno;                 /* line number of the last line read */
+    int njobs;                  /* jobs started */
+    int nfailed;                /* jobs failed, and bad lines */
+    int errval;                 /* status of the last failure */
+    int state;                  /* BATCH_BETWEEN, BATCH_RUNNING or
+                                   BATCH_FINISHED */
+} BatchProgress;
+
+/******************************************************************************
+
+MODULE:  ReadBatchJob
+
+PURPOSE:  Read the next job of a batch file and split it into arguments
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+>0              Number of arguments, including the program name
+0               End of the batch file
+-1              A line that is too long or has too many arguments (the
+                line is skipped)
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  argv[0] is progname and argv[argc] is NULL, as for main.  The other
+  arguments point into line, so they're good until the next job is read.
+
+******************************************************************************/
+static int ReadBatchJob
+(
+    FILE *fp,                   /* I: the batch file */
+    char *progname,             /* I: program name (argv[0] of the job) */
+    char *line,                 /* O: the job's line */
+    int maxlen,                 /* I: size of line */
+    char *argv[],               /* O: the job's arguments */
+    int maxargs,                /* I: room in argv, with the NULL at the
+                                      end */
+    int *lineno                 /* I/O: line number in the batch file */
+)
+
+{
+    char *p, *q;                /* reading and writing in line */
+    int argc;                   /* number of arguments */
+    char errstr[SMALL_STRING];  /* error message */
+
+    while ( fgets( line, maxlen, fp ) )
+    {
+        ( *lineno )++;
+        if ( strchr( line, '\n' ) == NULL && !feof( fp ) )
+        {
+            /* skip the rest of the line */
+            while ( fgets( line, maxlen, fp ) && !strchr( line, '\n' ) )
+                ;
+            sprintf( errstr, "Line %d of the batch file is too long",
+                *lineno );
+            ErrorHandler( FALSE, "ReadBatchJob", ERROR_GENERAL, errstr );
+            return ( -1 );
+        }
+
+        argc = 0;
+        argv[argc++] = progname;
+        p = line;
+        while ( 1 )
+        {
+            while ( isspace( ( unsigned char ) *p ) )
+                p++;
+            if ( *p == '\0' || ( argc == 1 && *p == '#' ) )
+                break;
+
+            if ( argc >= maxargs - 1 )
+            {
+                sprintf( errstr, "Line %d of the batch file has too many "
+                    "arguments", *lineno );
+                ErrorHandler( FALSE, "ReadBatchJob", ERROR_GENERAL, errstr );
+                return ( -1 );
+            }
+
+            /* the argument is copied down over the quotes */
+            argv[argc++] = q = p;
+            while ( *p != '\0' && !isspace( ( unsigned char ) *p ) )
+            {
+                if ( *p == '"' )
+                {
+                    for ( p++; *p != '\0' && *p != '"'; p++ )
+                        *q++ = *p;
+                    if ( *p == '"' )
+                        p++;
+                }
+                else
+                    *q++ = *p++;
+            }
+            if ( *p != '\0' )
+                p++;
+            *q = '\0';
+        }
+
+        if ( argc > 1 )
+        {
+            argv[argc] = NULL;
+            return ( argc );
+        }
+    }
+
+    return ( 0 );
+}
+
+/******************************************************************************
+
+MODULE:  ReportBatchProgress
+
+PURPOSE:  Send the worker's progress to the tool
+
+RETURN VALUE:
+Type = None
+Value           Description
+-----           -----------
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  A report is much smaller than PIPE_BUF, so it's written in one piece.
+
+******************************************************************************/
+static void ReportBatchProgress
+(
+    int report_fd,              /* I: the pipe to the tool, or -1 when the
+                                      jobs are run in the tool */
+    BatchProgress *progress     /* I: the progress */
+)
+
+{
+#ifndef WIN32
+    if ( report_fd >= 0 )
+        write( report_fd, progress, sizeof( BatchProgress ) );
+#endif
+}
+
+/******************************************************************************
+
+MODULE:  RunJobs
+
+PURPOSE:  Run the jobs of a batch file from where it has got to
+
+RETURN VALUE:
+Type = None
+Value           Description
+-----           -----------
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  fp must be at progress->offset.
+
+******************************************************************************/
+static void RunJobs
+(
+    FILE *fp,                   /* I: the batch file */
+    char *batch_filename,       /* I: name of the batch file */
+    char *progname,             /* I: program name (argv[0] of each job) */
+    int ( *run_job )( int, char *[] ),  /* I: runs one job, given its
+                                             arguments */
+    BatchProgress *progress,    /* I/O: how far the batch has got */
+    int report_fd               /* I: where to report progress, or -1 */
+)
+
+{
+    char line[HUGE_STRING];     /* line of the current job */
+    char *argv[MAX_BATCH_ARGS]; /* arguments of the current job */
+    int argc;                   /* number of arguments */
+    int status;                 /* status of a job */
+    char errstr[SMALL_STRING];  /* error message */
+
+    while ( ( argc = ReadBatchJob( fp, progname, line, HUGE_STRING, argv,
+        MAX_BATCH_ARGS, &progress->lineno ) ) != 0 )
+    {
+        progress->offset = ftell( fp );
+        if ( argc < 0 )
+        {
+            progress->nfailed++;
+            progress->errval = ERROR_GENERAL;
+            ReportBatchProgress( report_fd, progress );
+            continue;
+        }
+
+        progress->njobs++;
+        progress->state = BATCH_RUNNING;
+        ReportBatchProgress( report_fd, progress );
+
+        MessageHandler( NULL, "Batch job %d (line %d of %.*s)",
+            progress->njobs, progress->lineno, SMALL_STRING,
+            batch_filename );
+        status = run_job( argc, argv );
+        if ( status != MRT_NO_ERROR )
+        {
+            sprintf( errstr, "Batch job %d (line %d) failed (errval = %i)",
+                progress->njobs, progress->lineno, status );
+            ErrorHandler( FALSE, "RunBatchJobs", status, errstr );
+            progress->nfailed++;
+            progress->errval = status;
+        }
+
+        progress->state = BATCH_BETWEEN;
+        ReportBatchProgress( report_fd, progress );
+    }
+
+    progress->state = BATCH_FINISHED;
+    ReportBatchProgress( report_fd, progress );
+}
+
+#ifndef WIN32
+/******************************************************************************
+
+MODULE:  RunBatchWorker
+
+PURPOSE:  Fork a worker to run the rest of a batch, and follow its progress
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            The batch can go on from progress (if it isn't finished)
+FALSE           The worker stopped without running a job
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  A job which is still running when the worker exits hit a fatal error.
+  ErrorHandler has already reported the error and AbortExit has exited
+  with its code, so the job is counted as failed with that code and the
+  batch goes on after it.
+
+  The worker leaves the log to the tool.  If a job kills it, AbortExit
+  appends what's been logged so far to the log file, and the messages
+  after that are appended when the tool closes the log.
+
+  If the worker can't be started, the rest of the jobs are run in the
+  tool.
+
+******************************************************************************/
+static int RunBatchWorker
+(
+    FILE *fp,                   /* I: the batch file */
+    char *batch_filename,       /* I: name of the batch file */
+    char *progname,             /* I: program name (argv[0] of each job) */
+    int ( *run_job )( int, char *[] ),  /* I: runs one job, given its
+                                             arguments */
+    BatchProgress *progress     /* I/O: how far the batch has got */
+)
+
+{
+    int fd[2];                  /* pipe from the worker */
+    pid_t pid;                  /* the worker */
+    int wstatus;                /* how the worker exited */
+    int nreports = 0;           /* reports from the worker */
+    int status;                 /* status of a job which killed the worker */
+    BatchProgress report;       /* a report from the worker */
+    char errstr[SMALL_STRING];  /* error message */
+
+    /* anything still buffered would be written by both processes */
+    fflush( stdout );
+
+    if ( pipe( fd ) != 0 )
+        pid = -1;
+    else if ( ( pid = fork( ) ) < 0 )
+    {
+        close( fd[0] );
+        close( fd[1] );
+    }
+
+    if ( pid < 0 )
+    {
+        ErrorHandler( FALSE, "RunBatchJobs", ERROR_GENERAL,
+            "Unable to start a batch worker; running the jobs here" );
+        fseek( fp, progress->offset, SEEK_SET );
+        RunJobs( fp, batch_filename, progname, run_job, progress, -1 );
+        return ( TRUE );
+    }
+
+    if ( pid == 0 )
+    {
+        /* the worker: run the rest of the batch.  _exit leaves closing the
+           log and the rest of the clean up to the tool. */
+        close( fd[0] );
+        fseek( fp, progress->offset, SEEK_SET );
+        RunJobs( fp, batch_filename, progname, run_job, progress, fd[1] );
+        fflush( stdout );
+        _exit( EXIT_SUCCESS );
+    }
+
+    /* the last report is where the worker got to */
+    close( fd[1] );
+    while ( read( fd[0], &report, sizeof( BatchProgress ) ) ==
+        sizeof( BatchProgress ) )
+    {
+        *progress = report;
+        nreports++;
+    }
+    close( fd[0] );
+    while ( waitpid( pid, &wstatus, 0 ) < 0 && errno == EINTR )
+        ;
+
+    if ( progress->state == BATCH_RUNNING )
+    {
+        /* AbortExit exits with the error code, made positive */
+        if ( WIFEXITED( wstatus ) && WEXITSTATUS( wstatus ) != 0 )
+            status = -WEXITSTATUS( wstatus );
+        else
+            status = ERROR_GENERAL;
+
+        sprintf( errstr, "Batch job %d (line %d) failed (errval = %i)",
+            progress->njobs, progress->lineno, status );
+        ErrorHandler( FALSE, "RunBatchJobs", status, errstr );
+        progress->nfailed++;
+        progress->errval = status;
+        progress->state = BATCH_BETWEEN;
+        return ( TRUE );
+    }
+
+    if ( progress->state != BATCH_FINISHED && nreports == 0 )
+    {
+        ErrorHandler( FALSE, "RunBatchJobs", ERROR_GENERAL,
+            "The batch worker stopped before running a job" );
+        progress->errval = ERROR_GENERAL;
+        return ( FALSE );
+    }
+
+    return ( TRUE );
+}
+#endif
+
+/******************************************************************************
+
+MODULE:  RunBatchJobs
+
+PURPOSE:  Run each job of a batch file
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+MRT_NO_ERROR    Every job was run successfully
+other           Status of the last job which failed (see mrt_error.h), or
+                ERROR_GENERAL for a bad line
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+         10/26                         Run the jobs in a worker process
+
+NOTES:
+  A job which fails doesn't stop the batch.  The jobs are run by a worker
+  process (RunBatchWorker), so that includes a job with a fatal error:
+  the worker exits, the job is counted as failed, and a new worker runs
+  the jobs after it.  A new worker starts without what the last one had
+  kept between jobs.  On Windows the jobs are run here, and a fatal error
+  still exits the program (see ErrorHandler).
+
+  MessageHandler formats into a fixed buffer, so the batch file name is
+  cut to SMALL_STRING characters in the messages.
+
+******************************************************************************/
+int RunBatchJobs
+(
+    char *batch_filename,       /* I: the batch file */
+    char *progname,             /* I: program name (argv[0] of each job) */
+    int ( *run_job )( int, char *[] )  /* I: runs one job, given its
+                                              arguments */
+)
+
+{
+    FILE *fp;                   /* the batch file */
+    BatchProgress progress;     /* how far the batch has got */
+    char errstr[SMALL_STRING];  /* error message */
+
+    fp = fopen( batch_filename, "r" );
+    if ( fp == NULL )
+    {
+        /* the name may not fit, but the message only gets cut short */
+        snprintf( errstr, sizeof( errstr ), "Unable to open batch file %s",
+            batch_filename );
+        ErrorHandler( TRUE, "RunBatchJobs", ERROR_OPEN_INPUTPAR, errstr );
+        return ( ERROR_OPEN_INPUTPAR );
+    }
+
+    progress.offset = 0;
+    progress.lineno = 0;
+    progress.njobs = 0;
+    progress.nfailed = 0;
+    progress.errval = MRT_NO_ERROR;
+    progress.state = BATCH_BETWEEN;
+
+#ifdef WIN32
+    RunJobs( fp, batch_filename, progname, run_job, &progress, -1 );
+#else
+    /* start a new worker each time one is killed by a job */
+    while ( progress.state != BATCH_FINISHED &&
+        RunBatchWorker( fp, batch_filename, progname, run_job, &progress ) )
+        ;
+#endif
+
+    fclose( fp );
+    MessageHandler( NULL, "Batch file %.*s: %d jobs run, %d failed",
+        SMALL_STRING, batch_filename, progress.njobs, progress.nfailed );
+
+    return ( progress.errval );
+}
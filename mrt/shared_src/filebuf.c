@@ -10,24 +10,43 @@ Version  Date   Programmer       Code  Reason
          05/00  Rob Burrell            Original Development
          04/02  Gail Schmidt           Changed data pointers from floats to
                                        doubles
-
-HARDWARE AND/OR SOFTWARE LIMITATIONS:  
+         10/26                         Added CreateFileBuffersMax and the
+                                       read lock for files shared between
+                                       threads
+         10/26                         Replaced the row queue of doubles with
+                                       a cache of native data type strips
+                                       and added the cache statistics
+         10/26                         Use the strips of memory mapped raw
+                                       binary input files in place
+         10/26                         Added ReadBufferRow
+
+HARDWARE AND/OR SOFTWARE LIMITATIONS:
   None
 
 PROJECT:    MODIS Reprojection Tool
 
 NOTES:
-  Basically just a pushdown and replace the least recently used 
-  image row.  Future development might include write buffers as well.
+  The input rows are cached in strips of CACHE_STRIP_ROWS rows, stored in
+  the file's own data type (so an int16 band takes a quarter of the memory
+  it would as doubles).  Each strip of the file maps straight to its cache
+  strip, if any, through the in_cache array and the cache strips are kept
+  in a least recently used list, so finding a pixel and replacing the
+  least recently used strip are both constant time.  Pixels are only
+  converted to double as they are returned by ReadBufferValue;
+  ReadBufferRow returns a whole row in the file's data type.  Strips of
+  raw binary files which are mapped into memory and don't need byte
+  swapping aren't copied at all; the cache strip just points into the
+  mapping.
 
 ******************************************************************************/
+#include "mrt_dtype.h"
 #include "shared_resample.h"
 
 /******************************************************************************
 
 MODULE:  CreateFileBuffers
 
-PURPOSE:  Initialize an LRU queue
+PURPOSE:  Initialize the read cache
 
 RETURN VALUE:
 Type = int
@@ -44,8 +63,8 @@ Version  Date   Programmer       Code  Reason
 
 NOTES:
   See shared_resample.h for memory allocation limits for the
-  buffering scheme.  
-  
+  buffering scheme.
+
 ******************************************************************************/
 int CreateFileBuffers
 (
@@ -53,67 +72,100 @@ int CreateFileBuffers
 )
 
 {
+    return ( CreateFileBuffersMax( file, MAX_BUFFER_SIZE ) );
+}
+
+/******************************************************************************
+
+MODULE:  CreateFileBuffersMax
+
+PURPOSE:  Initialize the read cache using at most the specified memory
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            Success
+FALSE           Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development (from
+                                       CreateFileBuffers)
+         10/26                         Allocate native data type strips
+
+NOTES:
+  Used to give each resampling thread its own, smaller, read buffer.
+
+******************************************************************************/
+int CreateFileBuffersMax
+(
+    FileDescriptor *file,	/* I/O:  file for which buffers are created */
+    size_t max_size		/* I:  maximum number of bytes to allocate */
+)
+
+{
+    ReadCacheType *cache = &file->cache;  /* the read cache */
     size_t i;			/* init loop index */
-    QueueType *curr = NULL,	/* queue pointers */
-              tempqueue;
-    size_t rowsize;		/* number of bytes/row */
-    size_t numrows;		/* number of rows we can allocate */
+    size_t stripsize;		/* number of bytes/strip */
+    size_t nfilestrips;		/* number of strips in the file */
+    size_t numstrips;		/* number of strips we can allocate */
 
     /* how many bytes do we need */
-    rowsize = file->ncols * sizeof( double );
+    cache->rowsize = file->ncols * file->datasize;
+    stripsize = cache->rowsize * CACHE_STRIP_ROWS;
+    nfilestrips = ( file->nrows + CACHE_STRIP_ROWS - 1 ) / CACHE_STRIP_ROWS;
 
-    /* how many rows can we make from the max memory allowed */
-    numrows = MAX_BUFFER_SIZE / rowsize;
+    /* how many strips can we make from the max memory allowed */
+    numstrips = ( stripsize > 0 ) ? max_size / stripsize : 2;
 
     /* if we've got more memory than we need, reduce the total.
      * This will mean the entire image can live in memory */
-    if ( numrows > file->nrows )
-	numrows = file->nrows;
+    if ( numstrips > nfilestrips )
+	numstrips = nfilestrips;
 
-    /* the queue must have at least two entries to complete the
+    /* the list must have at least two entries to complete the
      * circle */
-    if ( numrows < 2 )
-	numrows = 2;
+    if ( numstrips < 2 )
+	numstrips = 2;
 
     /* save the total in the file descriptor */
-    file->queuetop.numbuffers = numrows;
+    cache->numstrips = numstrips;
+    cache->lookups = 0.0;
+    cache->misses = 0.0;
 
     /* a list of flags for easy checking */
-    file->queuetop.in_cache =
-	( QueueType ** ) calloc( file->nrows, sizeof( QueueType * ) );
-    if ( !file->queuetop.in_cache )
-	ErrorHandler( TRUE, "CreateFileBuffers", ERROR_MEMORY, "Queue Cache" );
-
-    /* just a place holder to simplify the loop */
-    curr = &tempqueue;
-    curr->prev = NULL;
-
-    /* allocate the doubly linked list of buffers */
-    for ( i = 0; i < numrows; i++ )
+    cache->in_cache =
+	( CacheStripType ** ) calloc( nfilestrips, sizeof( CacheStripType * ) );
+    if ( !cache->in_cache )
+	ErrorHandler( TRUE, "CreateFileBuffers", ERROR_MEMORY, "Strip Cache" );
+
+    /* allocate the strips and their data, each all at once */
+    cache->strips =
+	( CacheStripType * ) calloc( numstrips, sizeof( CacheStripType ) );
+    if ( !cache->strips )
+	ErrorHandler( TRUE, "CreateFileBuffers", ERROR_MEMORY, "Strip" );
+
+    cache->data = calloc( numstrips, stripsize > 0 ? stripsize : 1 );
+    if ( !cache->data )
+	ErrorHandler( TRUE, "CreateFileBuffers", ERROR_MEMORY,
+            "Strip Buffer" );
+
+    /* link the strips into the LRU list and mark them as unused */
+    for ( i = 0; i < numstrips; i++ )
     {
-	/* create an element */
-	curr->next = ( QueueType * ) calloc( 1, sizeof( QueueType ) );
-	if ( !curr->next )
-	    ErrorHandler( TRUE, "CreateFileBuffers", ERROR_MEMORY, "Node" );
-
-	/* link it to the previous and the next */
-	curr->next->prev = curr;
-	curr = curr->next;
-
-	/* allocate the buffer itself */
-	curr->data = ( double * ) calloc( file->ncols, sizeof( double ) );
-
-	if ( !curr->data )
-	    ErrorHandler( TRUE, "CreateFileBuffers", ERROR_MEMORY,
-            "Row Buffer" );
-
-	/* mark this row as unused */
-	curr->row = (size_t)-1;
+	cache->strips[i].prev = ( i > 0 ) ? &cache->strips[i-1] : NULL;
+	cache->strips[i].next =
+	    ( i < numstrips - 1 ) ? &cache->strips[i+1] : NULL;
+	cache->strips[i].slab = ( char * ) cache->data + i * stripsize;
+	cache->strips[i].data = cache->strips[i].slab;
+	cache->strips[i].strip = (size_t)-1;
     }
 
-    /* set the descriptor to hold the queue */
-    file->queuetop.first = tempqueue.next;
-    file->queuetop.last = curr;
+    /* set the descriptor to hold the list */
+    cache->first = &cache->strips[0];
+    cache->last = &cache->strips[numstrips - 1];
 
     return ( TRUE );
 }
@@ -131,12 +183,12 @@ HISTORY:
 Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          05/00   Rob Burrell            Original Development
-         01/01   John Rishea            Standardized formatting 
+         01/01   John Rishea            Standardized formatting
 NOTES:
   Since we may be reading from different bands having
   the same size, we can simply "clobber" the buffers
-  to prevent future reads from getting "old" data 
-  
+  to prevent future reads from getting "old" data
+
 ******************************************************************************/
 void ClobberFileBuffers
 (
@@ -145,17 +197,17 @@ void ClobberFileBuffers
 
 {
     size_t i;			/* loop index for flags */
-    QueueType *curr = NULL;	/* linked list walker */
-
-    /* set all flags to empty */
-    for ( i = 0; i < file->nrows; i++ )
-	file->queuetop.in_cache[i] = NULL;
+    CacheStripType *curr = NULL;	/* linked list walker */
 
-    /* run through and set all buffers to empty */
-    curr = file->queuetop.first;
+    /* run through and set all strips to empty */
+    curr = file->cache.first;
     while ( curr )
     {
-	curr->row = (size_t)-1;
+	if ( curr->strip != (size_t)-1 )
+	    file->cache.in_cache[curr->strip] = NULL;
+	curr->strip = (size_t)-1;
+	for ( i = 0; i < CACHE_STRIP_ROWS; i++ )
+	    curr->row_ok[i] = FALSE;
 	curr = curr->next;
     }
 }
@@ -164,7 +216,7 @@ void ClobberFileBuffers
 
 MODULE:  DestroyFileBuffers
 
-PURPOSE:  Free all memory used by the queue
+PURPOSE:  Free all memory used by the read cache
 
 RETURN VALUE:
 Type = int
@@ -176,10 +228,10 @@ HISTORY:
 Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          05/00   Rob Burrell            Original Development
-         01/01   John Rishea            Standardized formatting 
+         01/01   John Rishea            Standardized formatting
 
 NOTES:
-  
+
 ******************************************************************************/
 int DestroyFileBuffers
 (
@@ -187,38 +239,229 @@ int DestroyFileBuffers
 )
 
 {
-    QueueType *curr = NULL,	/* linked list walkers */
-              *next = NULL;
-
-    /* don't assume the flag list is available */
-    if ( file->queuetop.in_cache )
-	free( file->queuetop.in_cache );
+    /* don't assume the flag list or the strips are available */
+    free( file->cache.in_cache );
+    free( file->cache.strips );
+    free( file->cache.data );
 
     /* mark it gone */
-    file->queuetop.in_cache = NULL;
+    file->cache.in_cache = NULL;
+    file->cache.strips = NULL;
+    file->cache.data = NULL;
+    file->cache.first = NULL;
+    file->cache.last = NULL;
+    return ( TRUE );
+}
+
+/******************************************************************************
+
+MODULE:  ReportFileBufferStats
+
+PURPOSE:  Report and reset the read cache hit/miss statistics
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  A miss is a strip read from the file.  Every other pixel lookup is a hit.
+
+******************************************************************************/
+void ReportFileBufferStats
+(
+    FileDescriptor *file	/* I/O:  file whose stats are reported */
+)
+
+{
+    ReadCacheType *cache = &file->cache;  /* the read cache */
+
+    if ( cache->lookups > 0.0 )
+    {
+	MessageHandler( NULL, "  read cache: %.0f lookups, %.0f hits, "
+	    "%.0f misses (%.2f%% hit rate, " MRT_SIZE_T_FMT " strips of %d "
+	    "rows)", cache->lookups, cache->lookups - cache->misses,
+	    cache->misses, 100.0 * ( cache->lookups - cache->misses ) /
+	    cache->lookups, cache->numstrips, CACHE_STRIP_ROWS );
+    }
+
+    cache->lookups = 0.0;
+    cache->misses = 0.0;
+}
+
+/******************************************************************************
+
+MODULE:  LoadCacheStrip
+
+PURPOSE:  Read a strip of the file into the least recently used cache strip
+
+RETURN VALUE:
+Type = CacheStripType *
+Value           Description
+-----           -----------
+strip           The cache strip now holding the file strip
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development (from
+                                       ReadBufferValue)
+
+NOTES:
+  The strip is moved to the top of the list.
+
+******************************************************************************/
+static CacheStripType *LoadCacheStrip
+(
+    FileDescriptor *file,	/* I:  file to read from */
+    size_t strip		/* I:  strip of the file to read */
+)
 
-    /* don't assume the buffers are available */
-    if ( file->queuetop.first )
+{
+    ReadCacheType *cache = &file->cache;  /* the read cache */
+    CacheStripType *curr = NULL;	/* strip to replace */
+    size_t i;			/* row in the strip */
+    size_t row;			/* row in the file */
+    size_t nrows;		/* rows of the file in the strip */
+    void *mapped = NULL;	/* strip in the file's memory mapping */
+
+    /* throw away the least recently used strip */
+    curr = cache->last;
+    if ( curr->strip != (size_t)-1 )
+	cache->in_cache[curr->strip] = NULL;
+
+    /* if the rows can be used straight from the memory mapping there is
+     * nothing to read */
+    row = strip * CACHE_STRIP_ROWS;
+    nrows = file->nrows - row;
+    if ( nrows > CACHE_STRIP_ROWS )
+	nrows = CACHE_STRIP_ROWS;
+    if ( file->filetype == RAW_BINARY )
+	mapped = MapRowMultiFile( file, row, nrows );
+
+    if ( mapped )
+    {
+	curr->data = mapped;
+	for ( i = 0; i < CACHE_STRIP_ROWS; i++ )
+	    curr->row_ok[i] = ( i < nrows );
+    }
+    else
     {
-	curr = file->queuetop.first;
-	while ( curr )
+	/* read the new rows, if a read failed, lets just mark the row as
+	 * empty rather than complaining.  the file and its row buffer may
+	 * be shared with other threads. */
+	curr->data = curr->slab;
+	if ( file->read_lock )
+	    file->read_lock( TRUE );
+	for ( i = 0; i < CACHE_STRIP_ROWS; i++ )
 	{
-	    next = curr->next;
-	    free( curr->data );
-	    free( curr );
-	    curr = next;
+	    curr->row_ok[i] = ( i < nrows && ReadRowNative( file, row + i ) );
+	    if ( curr->row_ok[i] )
+		memcpy( ( char * ) curr->data + i * cache->rowsize,
+		    file->rowbuffer, cache->rowsize );
 	}
+	if ( file->read_lock )
+	    file->read_lock( FALSE );
     }
-    /* mark it gone */
-    file->queuetop.first = NULL;
-    return ( TRUE );
+    cache->misses++;
+
+    /* move it from the bottom to the top of the list */
+    if ( curr != cache->first )
+    {
+	cache->last = curr->prev;
+	cache->last->next = NULL;
+	curr->prev = NULL;
+	curr->next = cache->first;
+	cache->first->prev = curr;
+	cache->first = curr;
+    }
+
+    /* set the flags to show this strip available */
+    curr->strip = strip;
+    cache->in_cache[strip] = curr;
+
+    return ( curr );
+}
+
+/******************************************************************************
+
+MODULE:  ReadBufferRow
+
+PURPOSE:  Get a row of native data from the read cache
+
+RETURN VALUE:
+Type = void *
+Value           Description
+-----           -----------
+data            the row in the file's data type
+NULL            the row is outside the image or couldn't be read
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development (from
+                                       ReadBufferValue)
+
+NOTES:
+  Check the in_cache array to see if the strip holding the row we need is
+  in memory.  If it is, move it to the top of the list.  If it is not,
+  throw away the strip at the bottom (least recently used), read the new
+  strip into it and move it to the top.  The row stays valid until the
+  next call which has to read a strip.
+
+******************************************************************************/
+void *ReadBufferRow
+(
+    size_t row,			/* I:  row to find */
+    FileDescriptor *file	/* I:  file to read from */
+)
+
+{
+    ReadCacheType *cache = &file->cache;  /* the read cache */
+    CacheStripType *curr = NULL;	/* strip holding the row */
+    size_t strip;		/* strip of the file holding the row */
+
+    /* if we're outside the image, there is no row */
+    if ( row >= file->nrows )
+	return ( NULL );
+
+    cache->lookups++;
+
+    /* find the strip, reading it if it isn't in memory */
+    strip = row / CACHE_STRIP_ROWS;
+    curr = cache->in_cache[strip];
+    if ( !curr )
+	curr = LoadCacheStrip( file, strip );
+    else if ( curr != cache->first )
+    {
+	/* take it out of the list */
+	curr->prev->next = curr->next;
+	if ( curr->next )
+	    curr->next->prev = curr->prev;
+	else
+	    cache->last = curr->prev;
+
+	/* move it to the top of the list */
+	curr->prev = NULL;
+	curr->next = cache->first;
+	cache->first->prev = curr;
+	cache->first = curr;
+    }
+
+    row -= strip * CACHE_STRIP_ROWS;
+    if ( !curr->row_ok[row] )
+	return ( NULL );
+    return ( ( char * ) curr->data + row * cache->rowsize );
 }
 
 /******************************************************************************
 
 MODULE:  ReadBufferValue
 
-PURPOSE:  Get a pixel value from a read buffer
+PURPOSE:  Get a pixel value from the read cache
 
 RETURN VALUE:
 Type = double
@@ -231,16 +474,13 @@ Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          05/00   Rob Burrell            Original Development
          01/01   John Rishea            Standardized formatting
+         10/26                         Look up the native data type strip
+                                       and convert just the one pixel
+         10/26                         Find the row with ReadBufferRow
 
 NOTES:
-  Check the queue to see if the row we need is available.
-  
-  If it is the first row, just return a value from that
-  row.  If the row is in the queue, find it, move it to 
-  the top, and return a value.  If the row is not in the 
-  queue, throw away the row at the bottom (least recently 
-  used), read a new row, move it to the top, and return
-  a pixel.
+  Rows which are outside the image or couldn't be read return the
+  background fill.
 
 ******************************************************************************/
 double ReadBufferValue
@@ -251,86 +491,41 @@ double ReadBufferValue
 )
 
 {
-    size_t i;			/* loop index for setting an empty row */
-    QueueType *curr = NULL,	/* linked list walkers */
-              *topnext = NULL;
+    void *data;			/* the row's native data */
 
     /* if we're outside the image, return no value */
-    if ( (col >= file->ncols) || (row >= file->nrows) )
+    if ( col >= file->ncols )
 	return ( file->background_fill );
 
-    /* grab the first row in the queue */
-    topnext = file->queuetop.first;
-
-    /* if this is the row we need, return a value */
-    if ( topnext->row == row )
-	return ( topnext->data[col] );
+    data = ReadBufferRow( row, file );
+    if ( !data )
+	return ( file->background_fill );
 
-    /* check the flag list to see if this row is in memory */
-    if ( file->queuetop.in_cache[row] )
+    /* convert the pixel to double */
+    switch ( file->datatype )
     {
-	/* grab the element */
-	curr = file->queuetop.in_cache[row];
+	case DFNT_INT8:
+	    return ( ( double ) ( ( MRT_INT8_PTR ) data )[col] );
 
-	/* take it out of the loop */
-	curr->prev->next = curr->next;
+	case DFNT_UINT8:
+	    return ( ( double ) ( ( MRT_UINT8_PTR ) data )[col] );
 
-	/* if there's another following, we're not at the bottom,
-	 * close the link */
-	if ( curr->next )
-	    curr->next->prev = curr->prev;
+	case DFNT_INT16:
+	    return ( ( double ) ( ( MRT_INT16_PTR ) data )[col] );
 
-	else
-	{
-	    /* we're at the bottom, save the new bottom by pointing
-	     * the list header at the new bottom */
-	    file->queuetop.last = curr->prev;
-	    curr->prev->next = NULL;
-	}
-
-	/* move it to the top of the list */
-	curr->next = topnext;
-	curr->next->prev = curr;
-	file->queuetop.first = curr;
+	case DFNT_UINT16:
+	    return ( ( double ) ( ( MRT_UINT16_PTR ) data )[col] );
 
-	return ( curr->data[col] );
-    }
+	case DFNT_INT32:
+	    return ( ( double ) ( ( MRT_INT32_PTR ) data )[col] );
 
-    /* oops, need to read a row, get the last row in the queue */
-    curr = file->queuetop.last;
+	case DFNT_UINT32:
+	    return ( ( double ) ( ( MRT_UINT32_PTR ) data )[col] );
 
-    /* If this row has been used before, set the flag to empty 
-     * for the row we're going to toss, this may only save a few
-     * clocks in the beginning. */
-    if ( curr->row != (size_t)-1 ) 
-	file->queuetop.in_cache[curr->row] = NULL;
+	case DFNT_FLOAT32:
+	    return ( ( double ) ( ( MRT_FLOAT4_PTR ) data )[col] );
 
-    /* read a new row into the buffer, if the read failed, lets
-     * just set it to empty rather than complaining */
-    if ( !ReadRow( file, row, curr->data ) )
-    {
-	for ( i = 0; i < file->ncols; i++ )
-	    curr->data[i] = file->background_fill;
+	default:
+	    return ( file->background_fill );
     }
-
-    /* the prev to the bottom is now the botton (bottom->next = NULL) */
-    curr->prev->next = NULL;
-
-    /* the last queuetop gets pushed down */
-    curr->next = topnext;
-
-    /* the new bottom is set */
-    file->queuetop.last = curr->prev;
-
-    /* old queuetop points back to the new queuetop */
-    curr->next->prev = curr;
-
-    /* set the new queuetop */
-    file->queuetop.first = curr;
-
-    /* set the flags to show this row available */
-    curr->row = row;
-    file->queuetop.in_cache[row] = curr;
-
-    return ( curr->data[col] );
 }
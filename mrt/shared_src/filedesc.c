@@ -208,8 +208,6 @@ int DestroyFileDescriptor
 )
 
 {
-    boolean DestroyFileBuffers( FileDescriptor *file );
-
     /* throw away read buffers */
     DestroyFileBuffers( file );
 
@@ -19,6 +19,13 @@ Version  Date   Programmer       Code  Reason
          01/01  John Rishea            Moved local prototypes to loc_prot.h
          04/02  Gail Schmidt           Changed data pointers from floats to
                                        doubles
+         10/26                         Added ReadRowNative
+         10/26                         Convert rows with the kernels in
+                                       rowconv.c
+         10/26                         Added WriteRowNative
+         10/26                         Read virtual mosaic rows
+         10/26                         Gather zonal statistics of the rows
+                                       written
 
 HARDWARE AND/OR SOFTWARE LIMITATIONS:  
   None
@@ -34,9 +41,10 @@ NOTES:
 
 /******************************************************************************
 
-MODULE:  ReadRow
+MODULE:  ReadRowNative
 
-PURPOSE:  Reads a row of data from an input file
+PURPOSE:  Reads a row of data from an input file into the file's row buffer
+          without converting it
 
 RETURN VALUE:
 Type = int
@@ -48,29 +56,21 @@ FALSE           Unable to read
 HISTORY:
 Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
-         05/00  Rob Burrell            Original Development
-         01/01  John Rishea            Standardized formatting
+         10/26                         Original Development (from ReadRow)
+         10/26                         Virtual mosaics
 
 NOTES:
+  The data is left in file->rowbuffer in the file's native data type.
 
 ******************************************************************************/
-int ReadRow
+int ReadRowNative
 (
     FileDescriptor *file,	/* I:  input file descriptor */
-    int row,			/* I:  row number to read */
-    double *buffer		/* I/O:  buffer to hold data */
+    int row			/* I:  row number to read */
 )
 
 {
     int status = FALSE;                 /* error status */
-    size_t i;                           /* loop index for conversion */
-    MRT_INT8_PTR cptr = NULL;           /* cast pointer for char data */
-    MRT_UINT8_PTR ucptr = NULL;         /* cast ptr for unsigned char data */
-    MRT_INT16_PTR sptr = NULL;          /* cast pointer for short data */
-    MRT_UINT16_PTR usptr = NULL;        /* cast ptr for unsigned short data */
-    MRT_INT32_PTR lptr = NULL;          /* cast pointer for int (4-byte) data */
-    MRT_UINT32_PTR ulptr = NULL;        /* ptr for unsigned int (4-byte) data */
-    MRT_FLOAT4_PTR fptr = NULL;         /* ptr for 4-byte float data */
 
     /* read in a row of data from which type of file */
     switch ( file->filetype )
@@ -82,63 +82,113 @@ int ReadRow
 	case HDFEOS:
 	    status = ReadRowHdfEos( file, row );
 	    break;
+
+	case VIRTUAL_MOSAIC:
+	    status = ReadRowVirtualMosaic( file, row );
+	    break;
     }
 
+    return status;
+}
+
+/******************************************************************************
+
+MODULE:  ReadRow
+
+PURPOSE:  Reads a row of data from an input file
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            Successful read
+FALSE           Unable to read
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         05/00  Rob Burrell            Original Development
+         01/01  John Rishea            Standardized formatting
+         10/26                         Read with ReadRowNative
+         10/26                         Convert with file->read_convert
+
+NOTES:
+
+******************************************************************************/
+int ReadRow
+(
+    FileDescriptor *file,	/* I:  input file descriptor */
+    int row,			/* I:  row number to read */
+    double *buffer		/* I/O:  buffer to hold data */
+)
+
+{
+    int status = FALSE;                 /* error status */
+
+    /* pick the conversion from the file's data type, once */
+    if ( file->convert_datatype != file->datatype &&
+         !SelectRowConverters( file ) )
+        return FALSE;
+
+    /* read in a row of data */
+    status = ReadRowNative( file, row );
+
     /* was the read successful ? */
     if ( status == FALSE )
 	return FALSE;
 
     /* convert everything to double */
-    switch ( file->datatype )
-    {
-	case DFNT_INT8:
-	    cptr = ( MRT_INT8_PTR ) file->rowbuffer;
-	    for ( i = 0; i < file->ncols; i++ )
-		buffer[i] = ( double ) cptr[i];
-	    break;
+    file->read_convert( file->rowbuffer, buffer, file->ncols );
 
-	case DFNT_UINT8:
-	    ucptr = ( MRT_UINT8_PTR ) file->rowbuffer;
-	    for ( i = 0; i < file->ncols; i++ )
-		buffer[i] = ( double ) ucptr[i];
-	    break;
+    return status;
+}
 
-	case DFNT_INT16:
-	    sptr = ( MRT_INT16_PTR ) file->rowbuffer;
-	    for ( i = 0; i < file->ncols; i++ )
-		buffer[i] = ( double ) sptr[i];
-	    break;
+/******************************************************************************
 
-	case DFNT_UINT16:
-	    usptr = ( MRT_UINT16_PTR ) file->rowbuffer;
-	    for ( i = 0; i < file->ncols; i++ )
-		buffer[i] = ( double ) usptr[i];
-	    break;
+MODULE:  WriteRowBuffer
 
-	case DFNT_INT32:
-	    lptr = ( MRT_INT32_PTR ) file->rowbuffer;
-	    for ( i = 0; i < file->ncols; i++ )
-		buffer[i] = ( double ) lptr[i];
-	    break;
+PURPOSE:  Writes the file's row buffer to an output file
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            Successful write
+FALSE           Unable to write
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development (from WriteRow)
+
+NOTES:
 
-	case DFNT_UINT32:
-	    ulptr = ( MRT_UINT32_PTR ) file->rowbuffer;
-	    for ( i = 0; i < file->ncols; i++ )
-		buffer[i] = ( double ) ulptr[i];
+******************************************************************************/
+static int WriteRowBuffer
+(
+    FileDescriptor *file,	/* I:  output file descriptor */
+    int row			/* I:  row number to write */
+)
+
+{
+    int status = FALSE;			/* error status */
+
+    switch ( file->filetype )
+    {
+	case RAW_BINARY:
+	    status = WriteRowMultiFile( file );
 	    break;
 
-	    /* no conversion required */
-	case DFNT_FLOAT32:
-            fptr = ( MRT_FLOAT4_PTR ) file->rowbuffer;
-            for ( i = 0; i < file->ncols; i++ )
-                buffer[i] = ( double ) fptr[i];
-            break;
+	case HDFEOS:
+	    status = WriteRowHdfEos( file, row );
+	    break;
 
-	default:
-	    return ( FALSE );
+	case GEOTIFF:
+	    status = WriteRowGeoTIFF( file, row );
+	    break;
     }
 
-    return status;
+    return ( status );
 }
 
 /******************************************************************************
@@ -159,8 +209,12 @@ Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          05/00   Rob Burrell            Original Development
          01/01   John Rishea            Standardized formatting 
+         10/26                          Convert with file->write_convert
+         10/26                          Gather zonal statistics
 
 NOTES:
+  When file->zonal is set, the row is added to the zonal statistics as it
+  is stored, after rounding and clipping.
 
 ******************************************************************************/
 int WriteRow
@@ -172,142 +226,63 @@ int WriteRow
 
 {
     int status = FALSE;			/* error status */
-    size_t i;                           /* loop index for conversion */
-    MRT_INT8_PTR  cptr = NULL;          /* cast pointer for char data */
-    MRT_UINT8_PTR ucptr = NULL;         /* cast ptr for unsigned char data */
-    MRT_INT16_PTR sptr = NULL;          /* cast pointer for short data */
-    MRT_UINT16_PTR usptr = NULL;        /* cast ptr for unsigned short data */
-    MRT_INT32_PTR lptr = NULL;          /* cast pointer for int (4-byte) data */
-    MRT_UINT32_PTR ulptr = NULL;        /* ptr for unsigned int (4-byte) data */
-    MRT_FLOAT4_PTR fptr = NULL;         /* ptr for 4-byte float data */
-    double bufferd;
+
+    /* pick the conversion from the file's data type, once */
+    if ( file->convert_datatype != file->datatype &&
+         !SelectRowConverters( file ) )
+        return FALSE;
 
     /* convert from double to desired data type */
-    switch ( file->datatype )
-    {
-	case DFNT_INT8:
-	    cptr = ( MRT_INT8_PTR ) file->rowbuffer;
-	    for ( i = 0; i < file->ncols; i++ )
-	    {
-                bufferd = buffer[i] < 0.0 ? buffer[i] - (double)0.5 :
-                                            buffer[i] + (double)0.5;
-		if ( bufferd < MRT_INT8_MIN )
-		    cptr[i] = MRT_INT8_MIN;
-		else if ( bufferd > MRT_INT8_MAX )
-		    cptr[i] = MRT_INT8_MAX;
-		else
-		    cptr[i] = ( MRT_INT8 ) bufferd;
-	    }
-	    break;
+    file->write_convert( buffer, file->rowbuffer, file->ncols );
 
-	case DFNT_UINT8:
-	    ucptr = ( MRT_UINT8_PTR ) file->rowbuffer;
-	    for ( i = 0; i < file->ncols; i++ )
-	    {
-                bufferd = buffer[i] < 0.0 ? buffer[i] - (double)0.5 :
-                                            buffer[i] + (double)0.5;
-		if ( bufferd < 0.0 )
-		    ucptr[i] = 0;
-		else if ( bufferd > MRT_UINT8_MAX )
-		    ucptr[i] = MRT_UINT8_MAX;
-		else
-		    ucptr[i] = ( MRT_UINT8 ) bufferd;
-	    }
-	    break;
+    if ( file->zonal && !AccumulateZonalRow( file, row ) )
+        return FALSE;
 
-	case DFNT_INT16:
-	    sptr = ( MRT_INT16_PTR ) file->rowbuffer;
-	    for ( i = 0; i < file->ncols; i++ )
-	    {
-                bufferd = buffer[i] < 0.0 ? buffer[i] - (double)0.5 :
-                                            buffer[i] + (double)0.5;
-		if ( bufferd < MRT_INT16_MIN )
-		    sptr[i] = MRT_INT16_MIN;
-		else if ( bufferd > MRT_INT16_MAX )
-		    sptr[i] = MRT_INT16_MAX;
-		else
-		    sptr[i] = ( MRT_INT16 ) bufferd;
-	    }
-	    break;
+    /* write row to file */
+    status = WriteRowBuffer( file, row );
 
-	case DFNT_UINT16:
-	    usptr = ( MRT_UINT16_PTR ) file->rowbuffer;
-	    for ( i = 0; i < file->ncols; i++ )
-	    {
-                bufferd = buffer[i] < 0.0 ? buffer[i] - (double)0.5 :
-                                            buffer[i] + (double)0.5;
-		if ( bufferd < 0.0 )
-		    usptr[i] = 0;
-		else if ( bufferd > MRT_UINT16_MAX )
-		    usptr[i] = MRT_UINT16_MAX;
-		else
-		    usptr[i] = ( MRT_UINT16 ) bufferd;
-	    }
-	    break;
+    return ( status );
+}
 
-	case DFNT_INT32:
-	    lptr = ( MRT_INT32_PTR ) file->rowbuffer;
-	    for ( i = 0; i < file->ncols; i++ )
-	    {
-                bufferd = buffer[i] < 0.0 ? buffer[i] - (double)0.5 :
-                                            buffer[i] + (double)0.5;
-		if ( bufferd < MRT_INT32_MIN )
-		    lptr[i] = MRT_INT32_MIN;
-		else if ( bufferd > MRT_INT32_MAX )
-		    lptr[i] = MRT_INT32_MAX;
-		else
-		    lptr[i] = ( MRT_INT32 ) bufferd;
-	    }
-	    break;
+/******************************************************************************
 
-	case DFNT_UINT32:
-	    ulptr = ( MRT_UINT32_PTR ) file->rowbuffer;
-	    for ( i = 0; i < file->ncols; i++ )
-	    {
-                bufferd = buffer[i] < 0.0 ? buffer[i] - (double)0.5 :
-                                            buffer[i] + (double)0.5;
-		if ( bufferd < 0 )
-		    ulptr[i] = 0;
-		else if ( bufferd > MRT_INT32_MAX )
-		    ulptr[i] = MRT_INT32_MAX;
-		else
-		    ulptr[i] = ( MRT_INT32 ) bufferd;
-	    }
-	    break;
+MODULE:  WriteRowNative
 
-	    /* no conversion required */
-	case DFNT_FLOAT32:
-            fptr = ( MRT_FLOAT4_PTR ) file->rowbuffer;
-            for ( i = 0; i < file->ncols; i++ )
-            {
-               if( buffer[i] < 0.0 )
-                  fptr[i] = 0.0;
-               else if( buffer[i] > MRT_FLOAT4_MAX )
-                  fptr[i] = MRT_FLOAT4_MAX;
-               else 
-                  fptr[i] = ( MRT_FLOAT4 ) buffer[i];
-            }
-	    break;
+PURPOSE:  Writes a row of data which is already in the file's data type to
+          an output file
 
-	default:
-	    return ( FALSE );
-    }
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            Successful write
+FALSE           Unable to write
 
-    /* write row to file */
-    switch ( file->filetype )
-    {
-	case RAW_BINARY:
-	    status = WriteRowMultiFile( file );
-	    break;
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development (from WriteRow)
+         10/26                         Gather zonal statistics
 
-	case HDFEOS:
-	    status = WriteRowHdfEos( file, row );
-	    break;
+NOTES:
+  No rounding or clipping is done; the row is written as it is.  As with
+  WriteRow, the row is added to the zonal statistics when file->zonal is
+  set.
 
-	case GEOTIFF:
-	    status = WriteRowGeoTIFF( file, row );
-	    break;
-    }
+******************************************************************************/
+int WriteRowNative
+(
+    FileDescriptor *file,	/* I:  output file descriptor */
+    int row,			/* I:  row number to write */
+    void *buffer		/* I:  buffer of data to write */
+)
 
-    return ( status );
+{
+    memcpy( file->rowbuffer, buffer, file->ncols * file->datasize );
+
+    if ( file->zonal && !AccumulateZonalRow( file, row ) )
+        return FALSE;
+
+    /* write row to file */
+    return ( WriteRowBuffer( file, row ) );
 }
@@ -14,6 +14,7 @@ Version  Date   Programmer       Code  Reason
          06/00  John Weiss             Remove multi-file specific routines
          01/01  John Rishea            Standardized formatting 
          01/01  John Rishea            Moved local prototypes to loc_prot.h
+         10/26                         Support for virtual mosaic input files
 
 HARDWARE AND/OR SOFTWARE LIMITATIONS:  
   None
@@ -44,6 +45,7 @@ Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          05/00   Rob Burrell            Original Development
          01/01   John Rishea            Standardized formatting
+         10/26                          Virtual mosaics
 
 NOTES:
 
@@ -65,6 +67,10 @@ FileDescriptor *OpenInImage
 	case HDFEOS:
 	    return ( NULL );
 
+	case VIRTUAL_MOSAIC:
+	    return ( OpenVirtualMosaic( modis, FILE_READ_MODE, bandnum,
+                status ) );
+
 	case GEOTIFF:
 	    ErrorHandler( TRUE, "OpenInImage", ERROR_GENERAL,
 		"GeoTIFF not supported for input" );
@@ -240,6 +246,7 @@ Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          05/00   Rob Burrell            Original Development
          01/01   John Rishea            Standardized formatting
+         10/26                          Virtual mosaics
 
 NOTES:
 
@@ -262,6 +269,9 @@ int CloseFile
         case GEOTIFF:
             return ( CloseGeoTIFFFile( filedescriptor ) );
 
+        case VIRTUAL_MOSAIC:
+            return ( CloseVirtualMosaic( filedescriptor ) );
+
         default:
             ErrorHandler( TRUE, "CloseFile", ERROR_GENERAL,
                 "Bad filetype passed" );
@@ -17,6 +17,13 @@ Version  Date   Programmer       Code  Reason
          01/07  Gail Schmidt           Modified the module to allow the input
                                        and output sphere codes to be specified
                                        for UTM projections.
+         10/26                         Added gctp_call_init and gctp_call_xform
+                                       to set up a transformation once and
+                                       reuse it for many points.
+         10/26                         Added gctp_call_free for the
+                                       projection parameters owned by a
+                                       transformation.
+         10/26                         Added gctp_call_xform_array.
 
 HARDWARE AND/OR SOFTWARE LIMITATIONS:  
   None
@@ -121,3 +128,234 @@ int gctp_call
 
     return E_GEO_SUCC;
 }
+
+/******************************************************************************
+
+MODULE:  gctp_call_init
+
+PURPOSE:  Set up a GCTP transformation from one projection to another so
+          that many points can be converted with gctp_call_xform.  The data
+          directory, spheroids, unit factors and projection initialization
+          are handled here once rather than for every point.
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+E_GEO_SUCC      Successful initialization
+E_GEO_FAIL      Error initializing the transformation
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original development
+
+NOTES:
+  The sphere codes are handled the same as gctp_call: they are only used for
+  UTM, otherwise the projection parameters define the sphere.
+
+******************************************************************************/
+int gctp_call_init
+(
+    GctpXform *xform,        /* O: transformation to be initialized */
+    long in_proj_code,
+    long in_zone_code,       /* not used except for UTM */
+    long in_sphere_code,     /* not used except for UTM */
+    double in_proj_parms[],
+    long in_units,
+    long out_proj_code,
+    long out_zone_code,      /* not used except for UTM */
+    long out_sphere_code,    /* not used except for UTM */
+    double out_proj_parms[],
+    long out_units
+)
+
+{
+    long iflg;                  /* error flag */
+    long in_spheroid;           /* input sphere value */
+    long out_spheroid;          /* output sphere value */
+    char fn27[CMLEN];		/* name of NAD 1927 parameter file */
+    char fn83[CMLEN];		/* name of NAD 1983 parameter file */
+    char *ptr;			/* point to mrttables */
+
+    /* Place State Plane directory in fn27, fn83 */
+    ptr = (char *)getenv( "MRT_DATA_DIR" );
+    if( ptr == NULL ) {
+       ptr = (char *)getenv( "MRTDATADIR" );
+       if (ptr == NULL) {
+          ErrorHandler( FALSE, "gctp_call_init", ERROR_ENV,
+            "MRT_DATA_DIR nor MRTDATADIR not defined" );
+          return( E_GEO_FAIL );
+       }
+    }
+    sprintf( fn27, "%s/nad27sp", ptr );
+    sprintf( fn83, "%s/nad83sp", ptr );
+
+    /* If not processing UTM, then use the projection parameters for the
+       spheroid information. Otherwise use the spheroid passed to the
+       routine. */
+    if (in_proj_code != UTM)
+        in_spheroid = -1;
+    else
+        in_spheroid = in_sphere_code;
+
+    if (out_proj_code != UTM)
+        out_spheroid = -1;
+    else
+        out_spheroid = out_sphere_code;
+
+    /* don't print error messages */
+    init( -1, -1, NULL, NULL );
+
+    iflg = gctp_xform_init( xform, in_proj_code, in_zone_code, in_proj_parms,
+        in_units, in_spheroid, out_proj_code, out_zone_code, out_proj_parms,
+        out_units, out_spheroid, fn27, fn83 );
+    if ( iflg != 0 )
+    {
+        gctp_xform_free( xform );
+        ErrorHandler( FALSE, "gctp_call_init", ERROR_GENERAL,
+            "Error initializing the GCTP transformation." );
+        return( E_GEO_FAIL );
+    }
+
+    return E_GEO_SUCC;
+}
+
+/******************************************************************************
+
+MODULE:  gctp_call_xform
+
+PURPOSE:  Convert a point using a transformation set up by gctp_call_init
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+E_GEO_SUCC      Successful conversion
+GCTP_ERANGE     Point is out of range for the projection
+GCTP_IN_BREAK   Point lies in the break of an interrupted projection
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original development
+
+NOTES:
+  Any other GCTP error is fatal, the same as gctp_call.
+
+******************************************************************************/
+int gctp_call_xform
+(
+    GctpXform *xform,        /* I/O: transformation from gctp_call_init */
+    double in_x,
+    double in_y,
+    double *out_x,
+    double *out_y
+)
+
+{
+    long iflg;                  /* error flag */
+    double in_coords[2];        /* input x/y coords */
+    double out_coords[2];       /* output x/y coords */
+
+    in_coords[0] = in_x;
+    in_coords[1] = in_y;
+    iflg = gctp_xform( xform, in_coords, out_coords );
+    if ( iflg == GCTP_ERANGE || iflg == GCTP_IN_BREAK )
+        return iflg;
+    else if ( iflg != 0 )
+    {
+        ErrorHandler( TRUE, "GCTP_CALL_XFORM", ERROR_GENERAL,
+            "Error projecting input coordinates to output coordinates." );
+    }
+
+    *out_x = out_coords[0];
+    *out_y = out_coords[1];
+
+    return E_GEO_SUCC;
+}
+
+/******************************************************************************
+
+MODULE:  gctp_call_xform_array
+
+PURPOSE:  Convert an array of points using a transformation set up by
+          gctp_call_init
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+E_GEO_SUCC      Successful conversion.  status[i] is E_GEO_SUCC,
+                GCTP_ERANGE or GCTP_IN_BREAK for each point.
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original development
+
+NOTES:
+  Any other GCTP error is fatal, the same as gctp_call_xform.  out_x/out_y
+  may be the same arrays as in_x/in_y.  The outputs are not meaningful for
+  points whose status isn't E_GEO_SUCC.
+
+******************************************************************************/
+int gctp_call_xform_array
+(
+    GctpXform *xform,        /* I/O: transformation from gctp_call_init */
+    long n,                  /* I: number of points */
+    double *in_x,            /* I: input x coords */
+    double *in_y,            /* I: input y coords */
+    double *out_x,           /* O: output x coords */
+    double *out_y,           /* O: output y coords */
+    long *status             /* O: status of each point */
+)
+
+{
+    long i;                     /* point index */
+    long iflg;                  /* error flag */
+
+    iflg = gctp_xform_array( xform, n, in_x, in_y, out_x, out_y, status );
+    for ( i = 0; iflg == 0 && i < n; i++ )
+    {
+        if ( status[i] != 0 && status[i] != GCTP_ERANGE &&
+             status[i] != GCTP_IN_BREAK )
+            iflg = status[i];
+    }
+
+    if ( iflg != 0 )
+    {
+        ErrorHandler( TRUE, "GCTP_CALL_XFORM_ARRAY", ERROR_GENERAL,
+            "Error projecting input coordinates to output coordinates." );
+    }
+
+    return E_GEO_SUCC;
+}
+
+/******************************************************************************
+
+MODULE:  gctp_call_free
+
+PURPOSE:  Free the memory held by a transformation from gctp_call_init
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original development
+
+NOTES:
+  It is safe to call this on a transformation which was zeroed but never
+  initialized, or which has already been freed.
+
+******************************************************************************/
+void gctp_call_free
+(
+    GctpXform *xform         /* I/O: transformation from gctp_call_init */
+)
+
+{
+    gctp_xform_free( xform );
+}
@@ -9,6 +9,8 @@ HISTORY:
 Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          06/00  John Weiss             Original Development
+         10/26                         Added tiled and compressed fields
+                                       (DefineHdfEosFieldLayout)
 
 HARDWARE AND/OR SOFTWARE LIMITATIONS: 
   None
@@ -310,6 +312,7 @@ Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          06/00  John Weiss             Original Development
          01/01  John Rishea            Standardized formatting
+         10/26                         Tile and compress the field
 
 NOTES:
 
@@ -391,9 +394,13 @@ int CreateHdfEosField
 	    return ERROR_DATA_TYPE;
     }
 
-    /* define a field/band/entry in the grid */
-    status = GDdeffield( hdfptr->gid, fieldname, "YDim,XDim", numbertype,
-                         HDFE_NOMERGE );
+    /* define a field/band/entry in the grid, tiled and compressed as
+       requested */
+    status = DefineHdfEosFieldLayout( output, modis->output_tile_size,
+        modis->output_compression, modis->output_compression_level );
+    if ( status != -1 )
+        status = GDdeffield( hdfptr->gid, fieldname, "YDim,XDim", numbertype,
+                             HDFE_NOMERGE );
 
     /* check if field was successfully created */
     if ( status == -1 )
@@ -422,3 +429,141 @@ int CreateHdfEosField
 
     return status;
 }
+
+/******************************************************************************
+
+MODULE:  HdfEosTileDim
+
+PURPOSE:  Pick the tile size along one dimension of an HDF field
+
+RETURN VALUE:
+Type = int32
+Value           Description
+-----           -----------
+size            Tile size, a divisor of dim
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The tile size is the largest divisor of dim no bigger than tile_size, if
+  that's at least half of tile_size.  Otherwise (e.g. a prime number of
+  rows) it's the smallest divisor bigger than tile_size, which may be dim
+  itself.
+
+******************************************************************************/
+static int32 HdfEosTileDim
+(
+    size_t dim,			/* I:  size of the dimension */
+    int tile_size		/* I:  requested tile size */
+)
+
+{
+    size_t size;		/* candidate tile size */
+
+    if ( ( size_t ) tile_size >= dim )
+	return ( ( int32 ) dim );
+
+    for ( size = tile_size; dim % size != 0; size-- )
+	;
+    if ( size * 2 >= ( size_t ) tile_size )
+	return ( ( int32 ) size );
+
+    for ( size = tile_size + 1; dim % size != 0; size++ )
+	;
+    return ( ( int32 ) size );
+}
+
+/******************************************************************************
+
+MODULE:  DefineHdfEosFieldLayout
+
+PURPOSE:  Set the tiling and compression of the next field defined in an
+          output HDF file
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+0               Success
+-1              Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Must be called before GDdeffield.  HDF-EOS only takes tiles that evenly
+  divide the field, so the tile size is adjusted to fit each dimension (see
+  HdfEosTileDim).  A compressed field is always tiled (DEFAULT_TILE_SIZE
+  if no tile size is given), since HDF can only write a compressed untiled
+  field in one piece.  The rows of a tiled field are buffered (tilerows in
+  the HdfEosFD) so WriteRowHdfEos can write a whole row of tiles at a time.
+
+******************************************************************************/
+int DefineHdfEosFieldLayout
+(
+    FileDescriptor *output,	/* I/O:  output file descriptor */
+    int tile_size,		/* I:  square tile size (0 = untiled) */
+    CompressionType compression,/* I:  compression of the field */
+    int compression_level	/* I:  deflate level (1-9) */
+)
+
+{
+    int32 tiledims[2];		/* tile rows and columns */
+    intn compparm[1];		/* deflate level */
+    char str[LARGE_STRING];	/* error message */
+    HdfEosFD *hdfptr = ( HdfEosFD * ) output->fileptr;
+
+    /* drop the buffer of the previous field */
+    if ( hdfptr->tilerows != NULL )
+    {
+	free( hdfptr->tilerows );
+	hdfptr->tilerows = NULL;
+    }
+    hdfptr->tile_rows = 0;
+
+    if ( compression == COMPRESS_NONE && tile_size == 0 )
+	return ( 0 );
+    if ( tile_size == 0 )
+	tile_size = DEFAULT_TILE_SIZE;
+
+    tiledims[0] = HdfEosTileDim( output->nrows, tile_size );
+    tiledims[1] = HdfEosTileDim( output->ncols, tile_size );
+    if ( GDdeftile( hdfptr->gid, HDFE_TILE, 2, tiledims ) == -1 )
+    {
+	sprintf( str, "Unable to tile the fields of grid %s",
+	    hdfptr->currgrid );
+	ErrorHandler( FALSE, "DefineHdfEosFieldLayout", ERROR_OPEN_OUTPUTIMAGE,
+	    str );
+	return ( -1 );
+    }
+
+    if ( compression != COMPRESS_NONE )
+    {
+	compparm[0] = compression_level;
+	if ( GDdefcomp( hdfptr->gid, HDFE_COMP_DEFLATE, compparm ) == -1 )
+	{
+	    sprintf( str, "Unable to compress the fields of grid %s",
+		hdfptr->currgrid );
+	    ErrorHandler( FALSE, "DefineHdfEosFieldLayout",
+		ERROR_OPEN_OUTPUTIMAGE, str );
+	    return ( -1 );
+	}
+    }
+
+    hdfptr->tilerows = malloc( ( size_t ) tiledims[0] * output->ncols *
+	output->datasize );
+    if ( hdfptr->tilerows == NULL )
+    {
+	ErrorHandler( FALSE, "DefineHdfEosFieldLayout", ERROR_MEMORY,
+	    "Unable to allocate the HDF-EOS tile row buffer" );
+	return ( -1 );
+    }
+    hdfptr->tile_rows = tiledims[0];
+
+    return ( 0 );
+}
@@ -9,6 +9,7 @@ HISTORY:
 Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          06/00  John Weiss             Original Development
+         10/26                         Tile and compress the output fields
 
 HARDWARE AND/OR SOFTWARE LIMITATIONS: 
   None
@@ -274,6 +275,7 @@ HISTORY:
 Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          07/02  Gail Schmidt           Original Development
+         10/26                         Tile and compress the field
 
 NOTES:
 
@@ -355,9 +357,13 @@ int CreateHdfEosFieldMosaic
 	    return ERROR_DATA_TYPE;
     }
 
-    /* define a field/band/entry in the grid */
-    status = GDdeffield( hdfptr->gid, fieldname, "YDim,XDim", numbertype,
-                         HDFE_NOMERGE );
+    /* define a field/band/entry in the grid, tiled and compressed as
+       requested */
+    status = DefineHdfEosFieldLayout( output, mosaic->output_tile_size,
+        mosaic->output_compression, mosaic->output_compression_level );
+    if ( status != -1 )
+        status = GDdeffield( hdfptr->gid, fieldname, "YDim,XDim", numbertype,
+                             HDFE_NOMERGE );
 
     /* check if field was successfully created */
     if ( status == -1 )
@@ -8,6 +8,8 @@ HISTORY:
 Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          06/00  John Weiss             Original Development
+         10/26                         Buffer the rows of tiled fields
+         10/26                         Read input rows a block at a time
 
 HARDWARE AND/OR SOFTWARE LIMITATIONS:  
   None
@@ -21,9 +23,9 @@ NOTES:
 
 /******************************************************************************
 
-MODULE:  ReadRowHdfEos
+MODULE:  ReadRowsHdfEos
 
-PURPOSE:  Read a row from an HDF-EOS file
+PURPOSE:  Read consecutive rows from an HDF-EOS file
 
 RETURN VALUE:
 Type = int
@@ -35,16 +37,20 @@ FALSE           Failure
 HISTORY:
 Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
-         06/00  John Weiss             Original Development
-         01/01  John Rishea            Standardized formatting
+         10/26                         Original Development (from
+                                       ReadRowHdfEos)
 
 NOTES:
+  The rows are one after the other in buffer only if YDim comes before XDim
+  in the field's dimension list (or nrows is 1).
 
 ******************************************************************************/
-int ReadRowHdfEos
+static int ReadRowsHdfEos
 (
-    FileDescriptor *file,	/* I/O:  file to read */
-    int row			/* I:  row number to read */
+    FileDescriptor *file,	/* I:  file to read */
+    int row,			/* I:  first row to read */
+    int nrows,			/* I:  number of rows to read */
+    void *buffer		/* O:  the rows */
 )
 
 {
@@ -65,14 +71,14 @@ int ReadRowHdfEos
 	    start[hdfptr->pos[1]] = 0;		  /* XDim: start[1] = 0; */
 	    edge[hdfptr->pos[1]] = file->ncols;	  /* XDim: edge[1] = ncols; */
 	    start[hdfptr->pos[0]] = row;	  /* YDim: start[0] = row#; */
-	    edge[hdfptr->pos[0]] = 1;		  /* YDim: edge[0] = 1; */
+	    edge[hdfptr->pos[0]] = nrows;	  /* YDim: edge[0] = nrows; */
 	    break;
     }
 
-    /* read row of data */
+    /* read rows of data */
     /* according to Robert Wolfe, HDF library handles byte order */
     status = GDreadfield( hdfptr->gid, hdfptr->currfield, start, NULL,
-                          edge, file->rowbuffer );
+                          edge, buffer );
     if ( status == -1 )
         return ( FALSE );
     else
@@ -81,6 +87,132 @@ int ReadRowHdfEos
 
 /******************************************************************************
 
+MODULE:  SetHdfEosBlock
+
+PURPOSE:  Pick the number of rows read at once from the current field of an
+          HDF-EOS file and allocate the block for them
+
+RETURN VALUE:
+Type = void
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  A tiled (chunked) field is read a whole row of tiles at a time, so each
+  tile is only read and decompressed once.  Other fields are read
+  HDF_BLOCK_ROWS rows at a time.  Blocks are kept under MAX_HDF_BLOCK_SIZE
+  bytes.  If YDim comes after XDim, or the block can't be allocated, rows
+  are read one at a time (block_rows is 1).
+
+******************************************************************************/
+static void SetHdfEosBlock
+(
+    FileDescriptor *file	/* I/O:  file to read */
+)
+
+{
+    int32 tilecode;		/* is the field tiled */
+    int32 tilerank;		/* number of tile dimensions */
+    int32 tiledims[8];		/* tile size in each dimension */
+    size_t rowsize = file->ncols * file->datasize;	/* bytes in a row */
+    size_t nrows;		/* rows in a block */
+    HdfEosFD *hdfptr = ( HdfEosFD * ) file->fileptr;	/* cast to HDF FD */
+
+    hdfptr->block_start = -1;
+    hdfptr->block_rows = 1;
+    if ( hdfptr->pos[0] > hdfptr->pos[1] || rowsize == 0 )
+	return;
+
+    nrows = HDF_BLOCK_ROWS;
+    if ( GDtileinfo( hdfptr->gid, hdfptr->currfield, &tilecode, &tilerank,
+	     tiledims ) != -1 && tilecode == HDFE_TILE &&
+	 hdfptr->pos[0] < tilerank && tiledims[hdfptr->pos[0]] > 0 )
+	nrows = tiledims[hdfptr->pos[0]];
+    if ( nrows > file->nrows )
+	nrows = file->nrows;
+    if ( nrows * rowsize > MAX_HDF_BLOCK_SIZE )
+	nrows = MAX_HDF_BLOCK_SIZE / rowsize;
+    if ( nrows < 2 )
+	return;
+
+    free( hdfptr->block );
+    hdfptr->block = malloc( nrows * rowsize );
+    if ( hdfptr->block != NULL )
+	hdfptr->block_rows = ( int ) nrows;
+}
+
+/******************************************************************************
+
+MODULE:  ReadRowHdfEos
+
+PURPOSE:  Read a row from an HDF-EOS file
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            Success
+FALSE           Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         06/00  John Weiss             Original Development
+         01/01  John Rishea            Standardized formatting
+         10/26                         Serve rows from a block of rows read
+                                       at once
+
+NOTES:
+  The rows are read a block (see SetHdfEosBlock) at a time, and each row is
+  copied out of the block as it's asked for.  If a block can't be read, its
+  rows are read one at a time.
+
+******************************************************************************/
+int ReadRowHdfEos
+(
+    FileDescriptor *file,	/* I/O:  file to read */
+    int row			/* I:  row number to read */
+)
+
+{
+    size_t rowsize = file->ncols * file->datasize;	/* bytes in a row */
+    HdfEosFD *hdfptr = ( HdfEosFD * ) file->fileptr;	/* cast to HDF FD */
+
+    /* pick the block size for a new field */
+    if ( hdfptr->block_rows == 0 )
+	SetHdfEosBlock( file );
+
+    /* read the block holding the row, if it isn't already in */
+    if ( hdfptr->block_rows > 1 &&
+	 ( row < hdfptr->block_start ||
+	   row >= hdfptr->block_start + hdfptr->block_nrows ) )
+    {
+	hdfptr->block_start = row - row % hdfptr->block_rows;
+	hdfptr->block_nrows = hdfptr->block_rows;
+	if ( ( size_t ) ( hdfptr->block_start + hdfptr->block_nrows ) >
+	     file->nrows )
+	    hdfptr->block_nrows = file->nrows - hdfptr->block_start;
+	if ( !ReadRowsHdfEos( file, hdfptr->block_start, hdfptr->block_nrows,
+		 hdfptr->block ) )
+	    hdfptr->block_start = -1;
+    }
+
+    if ( hdfptr->block_start >= 0 && row >= hdfptr->block_start &&
+	 row < hdfptr->block_start + hdfptr->block_nrows )
+    {
+	memcpy( file->rowbuffer, ( char * ) hdfptr->block +
+	    ( row - hdfptr->block_start ) * rowsize, rowsize );
+	return ( TRUE );
+    }
+
+    return ( ReadRowsHdfEos( file, row, 1, file->rowbuffer ) );
+}
+
+/******************************************************************************
+
 MODULE:  WriteRowHdfEos
 
 PURPOSE:  Write a row to an HDF-EOS file
@@ -98,8 +230,12 @@ Version  Date   Programmer       Code  Reason
          06/00  John Weiss             Original Development
          01/01  John Rishea            Standardized formatting
          01/01  John Rishea            Removed testing code
+         10/26                         Buffer the rows of tiled fields
 
 NOTES:
+  Rows must be written in order.  Rows of a tiled field are buffered until
+  a whole row of tiles (or the last row of the field) is in, and then they
+  are written together, so HDF writes each tile once.
 
 ******************************************************************************/
 int WriteRowHdfEos
@@ -111,6 +247,8 @@ int WriteRowHdfEos
 {
     int32 status;		/* error status */
     int32 start[2], edge[2];	/* limits of write */
+    void *data = file->rowbuffer;	/* rows to write */
+    size_t rowsize = file->ncols * file->datasize;	/* bytes in a row */
     HdfEosFD *hdfptr = ( HdfEosFD * ) file->fileptr;	/* cast to HDF FD */
 
     /* set up GDwritefield() call */
@@ -119,10 +257,24 @@ int WriteRowHdfEos
     edge[0] = 1;
     edge[1] = file->ncols;
 
-    /* write row of data */
+    /* buffer the rows of a tiled field until a row of tiles is in */
+    if ( hdfptr->tile_rows > 0 )
+    {
+        memcpy( ( char * ) hdfptr->tilerows + row % hdfptr->tile_rows *
+            rowsize, file->rowbuffer, rowsize );
+        if ( ( row + 1 ) % hdfptr->tile_rows != 0 &&
+             ( size_t ) row != file->nrows - 1 )
+            return ( TRUE );
+
+        start[0] = row - row % hdfptr->tile_rows;
+        edge[0] = row % hdfptr->tile_rows + 1;
+        data = hdfptr->tilerows;
+    }
+
+    /* write row(s) of data */
     /* according to Robert Wolfe, HDF library handles byte order */
     status = GDwritefield( hdfptr->gid, hdfptr->currfield, start, NULL,
-                           edge, file->rowbuffer );
+                           edge, data );
     if ( status == -1 )
         return ( FALSE );
     else
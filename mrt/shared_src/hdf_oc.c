@@ -9,6 +9,11 @@ Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          06/00  John Weiss             Original Development
          06/01  John Weiss             Add 3-D/4-D data support.
+         10/26                         Detach the grids kept attached by
+                                       GetHdfEosFieldMosaic when closing
+         10/26                         Free the tile row buffer
+         10/26                         Free the input block and empty it
+                                       when the field changes
 
 HARDWARE AND/OR SOFTWARE LIMITATIONS:  
   None
@@ -23,6 +28,48 @@ NOTES:
 
 /******************************************************************************
 
+MODULE:  DetachHdfEosGrids
+
+PURPOSE:  Detach an HDF-EOS file from its grid(s)
+
+RETURN VALUE:
+Type = void
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  If GetHdfEosFieldMosaic has kept several grids attached (grid_ids), all of
+  them are detached; the current grid is one of them.
+
+******************************************************************************/
+static void DetachHdfEosGrids
+(
+    HdfEosFD *hdfptr         /* I/O: hdf file pointer to detach */
+)
+
+{
+    int i;
+
+    if ( hdfptr->grid_ids != NULL )
+    {
+        for ( i = 0; i < hdfptr->ngrids; i++ )
+        {
+            if ( hdfptr->grid_ids[i] >= 0 )
+                GDdetach( hdfptr->grid_ids[i] );
+        }
+        free( hdfptr->grid_ids );
+        hdfptr->grid_ids = NULL;
+    }
+    else if ( hdfptr->gid >= 0 )
+        GDdetach( hdfptr->gid );
+    hdfptr->gid = -1;
+}
+
+/******************************************************************************
+
 MODULE:  OpenHdfEosFile
 
 PURPOSE:  Open an HDF-EOS file for reading or writing
@@ -114,6 +161,9 @@ HdfEosFD *OpenHdfEosFile
 	hdfptr->currgrid = NULL;
 	hdfptr->fieldlist = NULL;
 	hdfptr->currfield = NULL;
+	hdfptr->block_rows = 0;
+	hdfptr->block_start = -1;
+	hdfptr->block = NULL;
     }
 
     /* open output HDF-EOS file */
@@ -149,6 +199,8 @@ HdfEosFD *OpenHdfEosFile
 	hdfptr->currgrid = NULL;
 	hdfptr->fieldlist = NULL;
 	hdfptr->currfield = NULL;
+	hdfptr->tile_rows = 0;
+	hdfptr->tilerows = NULL;
     }
 
     /* finish up */
@@ -168,6 +220,9 @@ HISTORY:
 Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          02/03  Gail Schmidt           Original Development
+         10/26                         Detach every grid kept attached
+         10/26                         Free the tile row buffer
+         10/26                         Free the input block
 
 NOTES:
 
@@ -178,12 +233,8 @@ void CloseHdfEos
 )
  
 {
-    /* detach from the grid */
-    if ( hdfptr->gid >= 0 )
-    {
-        GDdetach( hdfptr->gid );
-        hdfptr->gid = -1;
-    }
+    /* detach from the grid(s) */
+    DetachHdfEosGrids( hdfptr );
 
     /* close the file id */
     if ( hdfptr->fid >= 0 )
@@ -201,6 +252,10 @@ void CloseHdfEos
         free( hdfptr->fieldlist );
     if ( hdfptr->currfield != NULL )
         free( hdfptr->currfield );
+    if ( hdfptr->tilerows != NULL )
+        free( hdfptr->tilerows );
+    if ( hdfptr->block != NULL )
+        free( hdfptr->block );
 
     /* free hdfptr itself */
     free( hdfptr );
@@ -301,6 +356,9 @@ Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          06/00  John Weiss             Original Development
          01/01  John Rishea            Standardized formatting 
+         10/26                         Detach every grid kept attached
+         10/26                         Free the tile row buffer
+         10/26                         Free the input block
 
 NOTES:
 
@@ -316,10 +374,15 @@ int CloseHdfEosFile
     switch ( filedescriptor->fileopentype )
     {
 	case FILE_READ_MODE:
-	    GDdetach( hdfptr->gid );
-            hdfptr->gid = -1;
+	    DetachHdfEosGrids( hdfptr );
 	    GDclose( hdfptr->fid );
             hdfptr->fid = -1;
+            if ( hdfptr->block != NULL )
+            {
+                free( hdfptr->block );
+                hdfptr->block = NULL;
+            }
+            hdfptr->block_rows = 0;
 	    DestroyFileDescriptor( filedescriptor );
 	    break;
 
@@ -328,6 +391,12 @@ int CloseHdfEosFile
             hdfptr->gid = -1;
 	    GDclose( hdfptr->fid );
             hdfptr->fid = -1;
+            if ( hdfptr->tilerows != NULL )
+            {
+                free( hdfptr->tilerows );
+                hdfptr->tilerows = NULL;
+            }
+            hdfptr->tile_rows = 0;
 	    DestroyFileDescriptor( filedescriptor );
 	    break;
 
@@ -360,6 +429,7 @@ Version  Date   Programmer       Code  Reason
          01/01  John Rishea            Removed testing code
          05/02  Gail Schmidt           Keep the original grid/Vgroup name
                                        if input file is HDF-EOS
+         10/26                         Empty the input block
 
 NOTES:
 
@@ -568,6 +638,7 @@ int GetHdfEosField
     hdfptr->currfield = strdup( fieldname );
     hdfptr->dim3 = dim3;
     hdfptr->dim4 = dim4;
+    hdfptr->block_rows = 0;
 
     return MRT_NO_ERROR;
 }
@@ -8,6 +8,10 @@ HISTORY:
 Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          07/02  Gail Schmidt           Original Development
+         10/26                         Keep the input grids attached between
+                                       bands
+         10/26                         Empty the input block when the field
+                                       changes
 
 HARDWARE AND/OR SOFTWARE LIMITATIONS:  
   None
@@ -106,6 +110,70 @@ FileDescriptor *MakeHdfEosFDMosaic
 
 /******************************************************************************
 
+MODULE:  AttachHdfEosGridMosaic
+
+PURPOSE:  Get the id of a grid of an HDF-EOS file, attaching to it if it
+          isn't already attached
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+-1              Unable to attach to the grid
+other           Grid id
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The grids stay attached until the file is closed (CloseHdfEos), so moving
+  to another band of an open input file doesn't attach anything again.
+
+******************************************************************************/
+static int AttachHdfEosGridMosaic
+(
+    HdfEosFD *hdfptr,		/* I/O: file to attach */
+    int gridnum,		/* I:   number of the grid in gridlist */
+    char *gridname		/* I:   name of the grid */
+)
+
+{
+    int i;
+
+    if ( gridnum < 0 || gridnum >= hdfptr->ngrids )
+        return ( -1 );
+
+    /* the first time, start keeping track of the attached grids */
+    if ( hdfptr->grid_ids == NULL )
+    {
+        hdfptr->grid_ids = ( int * ) malloc( hdfptr->ngrids * sizeof( int ) );
+        if ( hdfptr->grid_ids == NULL )
+        {
+            ErrorHandler( TRUE, "GetHdfEosField", ERROR_MEMORY,
+                "Unable to allocate memory for the grid ids." );
+            return ( -1 );
+        }
+        for ( i = 0; i < hdfptr->ngrids; i++ )
+            hdfptr->grid_ids[i] = -1;
+
+        /* detach from a grid attached by anything else */
+        if ( hdfptr->gid >= 0 )
+        {
+            GDdetach( hdfptr->gid );
+            hdfptr->gid = -1;
+        }
+    }
+
+    if ( hdfptr->grid_ids[gridnum] < 0 )
+        hdfptr->grid_ids[gridnum] = GDattach( hdfptr->fid, gridname );
+
+    return ( hdfptr->grid_ids[gridnum] );
+}
+
+/******************************************************************************
+
 MODULE:  GetHdfEosFieldMosaic
 
 PURPOSE:  Get next HDF-EOS field by number for mosaicking
@@ -120,6 +188,9 @@ HISTORY:
 Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          07/02  Gail Schmidt           Original Development
+         10/26                         Keep the grids attached
+                                       (AttachHdfEosGridMosaic)
+         10/26                         Empty the input block
 
 NOTES:
 
@@ -133,6 +204,7 @@ int GetHdfEosFieldMosaic
 {
     int k, m, n;
     int bandnum;
+    int gridnum = 0;		/* number of the grid in gridlist */
     int dim3 = 0, dim4 = 0, dim3d = 0, dim4d = 0;
     int32 tmprank[256], tmpnumtype[256];
     int32 rank, numbertype;
@@ -161,12 +233,8 @@ int GetHdfEosFieldMosaic
 	*gridend = '\0';
     }
 
-    /* if necessary, detach from old grid */
-    if ( hdfptr->gid >= 0 )
-	GDdetach( hdfptr->gid );
-
-    /* attach to first grid */
-    hdfptr->gid = GDattach( hdfptr->fid, gridname );
+    /* attach to first grid (unless it already is) */
+    hdfptr->gid = AttachHdfEosGridMosaic( hdfptr, gridnum, gridname );
     if ( hdfptr->gid < 0 )
     {
 	sprintf( errstr, "Unable to attach to grid %s", gridname );
@@ -209,11 +277,9 @@ int GetHdfEosFieldMosaic
 	    else
 		gridlist = NULL;
 
-	    /* detach from old grid */
-	    GDdetach( hdfptr->gid );
-
-	    /* attach to new grid */
-	    hdfptr->gid = GDattach( hdfptr->fid, gridname );
+	    /* attach to new grid (the old grid stays attached) */
+	    gridnum++;
+	    hdfptr->gid = AttachHdfEosGridMosaic( hdfptr, gridnum, gridname );
 	    if ( hdfptr->gid < 0 )
 	    {
 		sprintf( errstr, "Unable to attach to grid %s", gridname );
@@ -327,6 +393,7 @@ int GetHdfEosFieldMosaic
     hdfptr->currfield = strdup( fieldname );
     hdfptr->dim3 = dim3;
     hdfptr->dim4 = dim4;
+    hdfptr->block_rows = 0;
 
     return MRT_NO_ERROR;
 }
@@ -23,6 +23,13 @@ Version  Date   Programmer       Code  Reason
                                        coordinates
          01/02  Gail Schmidt           Initialize the switches to false
          01/07  Gail Schmidt           Initialize the input sphere code
+         10/26                         Initialize the virtual mosaic tiles
+         10/26                         Initialize the output tiling and
+                                       compression
+         10/26                         Initialize the COG switch
+         10/26                         Initialize the compression level and
+                                       the mosaic output layout
+         10/26                         Initialize the zonal statistics
 
 NOTES:
 
@@ -54,6 +61,15 @@ void InitializeModisDescriptor
     P->input_sphere_code = -1;
     P->input_zone_code = 0;
     P->output_zone_code = 0;
+    P->approx_max_error = 0.0;
+    P->nthreads = 1;
+    P->output_tile_size = 0;
+    P->output_compression = COMPRESS_NONE;
+    P->output_compression_level = DEFAULT_COMPRESSION_LEVEL;
+    P->output_cog = FALSE;
+    P->numh_tiles = 0;
+    P->numv_tiles = 0;
+    P->tile_filenames = NULL;
     P->in_projection_info = NULL;
     P->out_projection_info = NULL;
     P->output_file_info = NULL;
@@ -96,11 +112,84 @@ void InitializeModisDescriptor
     P->tswitch = FALSE;
     P->uswitch = FALSE;
     P->xswitch = FALSE;
+    P->nswitch = FALSE;
 
     for ( iparam = 0; iparam < NSTRINGS; iparam++ )
         P->ParamsPresent[iparam] = 0;
 
     P->tmpspectralsubset = NULL;
+
+    P->zonal_filename = NULL;
+    P->zonal_bins = 0;
+    P->zonal = NULL;
+}
+
+
+/******************************************************************************
+
+MODULE:  FreeModisDescriptor
+
+PURPOSE:  Free the memory held by a modis descriptor
+
+RETURN VALUE:
+Type = none
+Value           Description
+-----           -----------
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The descriptor itself isn't freed, and the pointers it held are set to
+  NULL.  Used between the jobs of a batch run (-batch).
+
+******************************************************************************/
+void FreeModisDescriptor
+(
+    ModisDescriptor *P	/* I/O:  the descriptor to free */
+)
+
+{
+    size_t k;
+    int i;
+
+    free( P->parameter_filename );
+    free( P->input_filename );
+    free( P->output_filename );
+    P->parameter_filename = P->input_filename = P->output_filename = NULL;
+
+    if ( P->bandinfo )
+    {
+	for ( k = 0; k < P->nbands; k++ )
+	    free( P->bandinfo[k].name );
+	free( P->bandinfo );
+	P->bandinfo = NULL;
+    }
+
+    if ( P->tile_filenames )
+    {
+	for ( i = 0; i < P->numh_tiles * P->numv_tiles; i++ )
+	    free( P->tile_filenames[i] );
+	free( P->tile_filenames );
+	P->tile_filenames = NULL;
+    }
+
+    DestroyProjectionInfo( P->in_projection_info );
+    DestroyProjectionInfo( P->out_projection_info );
+    P->in_projection_info = P->out_projection_info = NULL;
+
+    free( P->output_file_info );
+    P->output_file_info = NULL;
+
+    free( P->tmpspectralsubset );
+    P->tmpspectralsubset = NULL;
+
+    free( P->zonal_filename );
+    P->zonal_filename = NULL;
+    CloseZonalTable( P->zonal );
+    P->zonal = NULL;
 }
 
 
@@ -119,6 +208,8 @@ HISTORY:
 Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          03/02  Gail Schmidt           Original Development
+         10/26                         Initialize the first lines of the
+                                       bands
 
 NOTES:
 
@@ -143,6 +234,9 @@ void InitializeMosaicDescriptor
     P->datum_code = E_NODATUM;
     P->zone_code = 0;
     P->projection_info = NULL;
+    P->output_tile_size = 0;
+    P->output_compression = COMPRESS_NONE;
+    P->output_compression_level = DEFAULT_COMPRESSION_LEVEL;
 
     for ( i = 0; i < 15; i++ )
     {
@@ -158,9 +252,57 @@ void InitializeMosaicDescriptor
         }
     }
 
+    for ( i = 0; i < MAXBANDS; i++ )
+        P->first_line[i] = 0;
+
     P->north_bound = 0.0;
     P->south_bound = 0.0;
     P->east_bound = 0.0;
     P->west_bound = 0.0;
 }
 
+
+/******************************************************************************
+
+MODULE:  FreeMosaicDescriptor
+
+PURPOSE:  Free the memory held by a mosaic descriptor
+
+RETURN VALUE:
+Type = none
+Value           Description
+-----           -----------
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The descriptor itself isn't freed, and the pointers it held are set to
+  NULL.
+
+******************************************************************************/
+void FreeMosaicDescriptor
+(
+    MosaicDescriptor *P    /* I/O:  the descriptor to free */
+)
+
+{
+    size_t k;                   /* loop index */
+
+    free( P->filename );
+    P->filename = NULL;
+
+    if ( P->bandinfo )
+    {
+        for ( k = 0; k < P->nbands; k++ )
+            free( P->bandinfo[k].name );
+        free( P->bandinfo );
+        P->bandinfo = NULL;
+    }
+
+    DestroyProjectionInfo( P->projection_info );
+    P->projection_info = NULL;
+}
+
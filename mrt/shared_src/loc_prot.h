@@ -10,6 +10,11 @@ Version  Date   Programmer       Code  Reason
          05/00  Rob Burrell            Initial development            
          01/01  John Rishea            Standardized formatting
          01/01  John Rishea            Added prototypes
+         10/26                         Added the virtual mosaic routines
+         10/26                         Added the batch job and descriptor
+                                       freeing routines
+         10/26                         Added the zonal statistics routines
+         10/26                         Added DestroyFileBuffers
  
 HARDWARE AND/OR SOFTWARE LIMITATIONS:  
   None
@@ -84,6 +89,46 @@ int gctp_call
     double *out_y
 );
 
+int gctp_call_init
+(
+    GctpXform *xform,        /* O: transformation to be initialized */
+    long in_proj_code,
+    long in_zone_code,       /* not used except for UTM */
+    long in_sphere_code,     /* not used except for UTM */
+    double in_proj_parms[],
+    long in_units,
+    long out_proj_code,
+    long out_zone_code,      /* not used except for UTM */
+    long out_sphere_code,    /* not used except for UTM */
+    double out_proj_parms[],
+    long out_units
+);
+
+int gctp_call_xform
+(
+    GctpXform *xform,        /* I/O: transformation from gctp_call_init */
+    double in_x,
+    double in_y,
+    double *out_x,
+    double *out_y
+);
+
+int gctp_call_xform_array
+(
+    GctpXform *xform,        /* I/O: transformation from gctp_call_init */
+    long n,                  /* I: number of points */
+    double *in_x,            /* I: input x coords */
+    double *in_y,            /* I: input y coords */
+    double *out_x,           /* O: output x coords */
+    double *out_y,           /* O: output y coords */
+    long *status             /* O: status of each point */
+);
+
+void gctp_call_free
+(
+    GctpXform *xform         /* I/O: transformation from gctp_call_init */
+);
+
 void print_proj
 (
     long proj,		/* Projection ID as defined in proj.h */
@@ -119,6 +164,11 @@ void InitializeModisDescriptor
     ModisDescriptor * P     /* I/O:  the descriptor to initialize */
 );
 
+void FreeModisDescriptor
+(
+    ModisDescriptor * P     /* I/O:  the descriptor to free */
+);
+
 /************************************
  * 
  * Message and error handling 
@@ -331,6 +381,17 @@ int CreateFileBuffers
     FileDescriptor *file        /* I/O:  file for which buffers are created */
 );
 
+int CreateFileBuffersMax
+(
+    FileDescriptor *file,       /* I/O:  file for which buffers are created */
+    size_t max_size             /* I:  maximum number of bytes to allocate */
+);
+
+int DestroyFileBuffers
+(
+    FileDescriptor *file	/* I:  file for which buffers are destroyed */
+);
+
 int CreateHdfEosField
 (
     FileDescriptor *input,      /* input file descriptor */
@@ -338,6 +399,14 @@ int CreateHdfEosField
     ModisDescriptor *modis      /* session info */
 );
 
+int DefineHdfEosFieldLayout
+(
+    FileDescriptor *output,     /* I/O:  output file descriptor */
+    int tile_size,              /* I:  square tile size (0 = untiled) */
+    CompressionType compression,/* I:  compression of the field */
+    int compression_level       /* I:  deflate level (1-9) */
+);
+
 int CreateHdfEosGrid
 (
     FileDescriptor *input,      /* input file descriptor */
@@ -352,6 +421,17 @@ int InitOutputFile
     ModisDescriptor * modis     /* I:  session info */
 );
 
+int SelectRowConverters
+(
+    FileDescriptor * file   /* I/O:  file descriptor */
+);
+
+int ReadRowNative
+(
+    FileDescriptor * file,  /* I:  input file descriptor */
+    int row                 /* I:  row number to read into file->rowbuffer */
+);
+
 int ReadRow
 (
     FileDescriptor * file,  /* I:  input file descriptor */
@@ -366,6 +446,12 @@ double ReadBufferValue
     FileDescriptor * file   /* I:  file to read from */
 );
 
+void *ReadBufferRow
+( 
+    size_t row,             /* I:  row to find */
+    FileDescriptor * file   /* I:  file to read from */
+);
+
 int ReadHDFHeader
 ( 
     ModisDescriptor *modis     /* I/O:  session info */
@@ -383,6 +469,13 @@ int WriteRow
     double *buffer          /* I:  buffer of data to write */
 );
 
+int WriteRowNative
+( 
+    FileDescriptor * file,  /* I:  output file descriptor */
+    int row,                /* I:  row number to write */
+    void *buffer            /* I:  row in the file's data type */
+);
+
 MrtEndianness GetMachineEndianness(void);
 
 int ReadRowHdfEos
@@ -397,6 +490,13 @@ int ReadRowMultiFile
     int row                     /* I:  row number to read */
 );
 
+void *MapRowMultiFile
+(
+    FileDescriptor *file,       /* I:  file to read from */
+    size_t row,                 /* I:  first row number */
+    size_t nrows                /* I:  number of rows needed */
+);
+
 int WriteRowGeoTIFF
 (
     FileDescriptor *file,       /* I:  file to write */
@@ -414,6 +514,13 @@ int WriteRowMultiFile
     FileDescriptor *file        /* I:  file to write data */
 );
 
+int WriteRowMultiFileAt
+(
+    FileDescriptor *file,       /* I:  file to write data */
+    size_t row,                 /* I:  row number to write */
+    void *buffer                /* I:  row in the file's data type */
+);
+
 int CloseGeoTIFFFile
 (
     FileDescriptor *filedescriptor      /* file to close */
@@ -450,12 +557,54 @@ FileDescriptor *OpenMultiFile
     int *status                 /* O:  error status */
 );
 
+FileDescriptor *OpenVirtualMosaic
+(
+    ModisDescriptor *modis,     /* I:  session info */
+    FileOpenType mode,          /* I:  reading (virtual mosaics can't be
+                                       written) */
+    int bandnum,                /* I:  band number to read */
+    int *status                 /* O:  error status */
+);
+
+int CloseVirtualMosaic
+(
+    FileDescriptor *filedescriptor      /* I:  the file to close */
+);
+
+FileDescriptor *GetVirtualMosaicTile
+(
+    FileDescriptor *file,       /* I/O:  band of the virtual mosaic */
+    int tile                    /* I:  the tile (v * numh_tiles + h) */
+);
+
+void FreeVirtualMosaic
+(
+    void
+);
+
+int ReadRowVirtualMosaic
+(
+    FileDescriptor *file,       /* I/O:  file to read */
+    int row                     /* I:  row number to read */
+);
+
 int SetTIFFTags
 (
     FileDescriptor *output,     /* I:  file info */
     ModisDescriptor *modis      /* I:  session info */
 );
 
+int CreateGeoTIFFOverviews
+(
+    FileDescriptor *output,     /* I/O:  GeoTIFF file */
+    ModisDescriptor *modis      /* I:  session info */
+);
+
+int WriteCOGFile
+(
+    FileDescriptor *file        /* I:  GeoTIFF file, with its levels closed */
+);
+
 int GetParameterFilename
 (
     int argc,                   /* I:  number of arguments */
@@ -660,6 +809,12 @@ void ClobberFileBuffers
     FileDescriptor *file    /* I: file for which we are clobbering buffers */
 );
 
+void ReportFileBufferStats
+(
+    FileDescriptor *file    /* I/O: file whose read cache stats are reported
+                                    and reset */
+);
+
 int CloseFile
 (
     FileDescriptor *filedescriptor      /* I:  file to close */
@@ -762,4 +917,81 @@ void HDF2RB_Usage
 (
     void
 );
+void CropUsage
+(
+    void
+);
+
+void GetSpectralSubsetCmdLine
+(
+    ModisDescriptor *P     /* I/O:  session info */
+);
+
+int RunBatchJobs
+(
+    char *batch_filename,       /* I: the batch file */
+    char *progname,             /* I: program name (argv[0] of each job) */
+    int ( *run_job )( int, char *[] )  /* I: runs one job, given its
+                                              arguments */
+);
+
+/************************************
+ * 
+ * Zonal statistics 
+ * 
+ ************************************/
+ZonalTable *CreateZonalTable
+(
+    int nzones,			/* I:  number of zones */
+    char *codes[],		/* I:  code of each zone */
+    int nbins			/* I:  histogram bins (0 = no histogram) */
+);
+
+ZonalTable *OpenZonalLabels
+(
+    char *label_filename,	/* I:  label raster (.hdr) */
+    int nbins			/* I:  histogram bins (0 = no histogram) */
+);
+
+ZonalBand *AddZonalBand
+(
+    ZonalTable *table,		/* I/O:  the zones */
+    char *name,			/* I:  band name */
+    double fill,		/* I:  background fill value */
+    double min_value,		/* I:  smallest valid value */
+    double max_value		/* I:  largest valid value */
+);
+
+int AttachZonalBand
+(
+    ZonalBand *band,		/* I:  band of a table with a label raster */
+    FileDescriptor *output,	/* I/O:  output file the band is written to */
+    long proj_code		/* I:  GCTP projection of the output */
+);
+
+void AccumulateZonalRun
+(
+    ZonalBand *band,		/* I/O:  band whose statistics are added to */
+    int zone,			/* I:  zone the pixels are in */
+    double *values,		/* I:  the pixels */
+    size_t n			/* I:  number of pixels */
+);
+
+int AccumulateZonalRow
+(
+    FileDescriptor *file,	/* I/O:  output file, with the row to add in
+				         its row buffer */
+    int row			/* I:  row number */
+);
+
+int WriteZonalTable
+(
+    ZonalTable *table,		/* I:  the statistics */
+    char *filename		/* I:  CSV file to write */
+);
+
+void CloseZonalTable
+(
+    ZonalTable *table		/* I:  table to free (may be NULL) */
+);
 #endif
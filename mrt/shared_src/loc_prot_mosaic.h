@@ -8,6 +8,7 @@ HISTORY:
 Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          03/02  Gail Schmidt           Initial development            
+         10/26                         Added FreeMosaicDescriptor
  
 HARDWARE AND/OR SOFTWARE LIMITATIONS:  
   None
@@ -46,8 +47,21 @@ int CheckMosaicArgs
                                  tiles for each input filename? */
     int *write_tmphdr,     /* O: was -h switch specified to write the
                                  raw binary header info for the mosaic? */
-    int *spectral_subset   /* O: was -s switch specified for spectral
+    int *virtual_mosaic,   /* O: was -v switch specified to write a virtual
+                                 mosaic header instead of the mosaic? */
+    int *spectral_subset,  /* O: was -s switch specified for spectral
                                  subsetting? */
+    int *nthreads,         /* O: number of threads from the -threads switch
+                                 (1 if not specified) */
+    int *tile_size,        /* O: HDF-EOS tile size from the -tile_size
+                                 switch (0 if not specified) */
+    int *deflate_level,    /* O: HDF-EOS deflate level from the -deflate
+                                 switch (0 if not specified) */
+    char **region_filename,
+                           /* O: regions from the -r switch (NULL if not
+                                 specified) */
+    char **list_filename   /* O: region codes from the -l switch (NULL if
+                                 not specified) */
 );
 
 int CompareProducts
@@ -117,6 +131,11 @@ void InitializeMosaicDescriptor
     MosaicDescriptor *P    /* I/O:  the descriptor to initialize */
 );
 
+void FreeMosaicDescriptor
+(
+    MosaicDescriptor *P    /* I/O:  the descriptor to free */
+);
+
 FileDescriptor *MakeHdfEosFDMosaic
 (
     MosaicDescriptor *mosaic,   /* I:  session info */
@@ -137,8 +156,9 @@ int MosaicTiles
     int num_infiles,     /* I: number of input files */
     MosaicDescriptor infiles[],
                          /* I: file descriptor array for the input files */
-    MosaicDescriptor *mosaicfile
+    MosaicDescriptor *mosaicfile,
                          /* I: file descriptor for the output mosaic file */
+    int nthreads         /* I: number of threads (0 = one per processor) */
 );
 
 void MosaicUsage
@@ -177,6 +197,19 @@ int OutputHdrMosaic
     char *output_filename
 );
 
+int OutputVirtualHdrMosaic
+(
+    MosaicDescriptor *mosaic,  /* I: mosaic info */
+    char *output_filename,     /* I: name of the .hdr file */
+    int numh_tiles,            /* I: number of horiz tiles in the mosaic */
+    int numv_tiles,            /* I: number of vert tiles in the mosaic */
+    int **tile_array,          /* I: 2D array of size [numv_tiles][numh_tiles]
+                                     specifying which input file represents
+                                     that tile location */
+    MosaicDescriptor infiles[] /* I: file descriptor array for the input
+                                     files */
+);
+
 void PrintOutputFileInfoMosaic
 (
     MosaicDescriptor *mosaic
@@ -25,6 +25,11 @@ Version  Date   Programmer       Code  Reason
          01/07  Gail Schmidt           Modified the call to GCTP to send in
                                        the sphere code which will be used
                                        for UTM only
+         10/26                         WalkInputBoundary sets up the GCTP
+                                       transformation once rather than
+                                       calling gctp_call for every point
+         10/26                         WalkInputBoundary frees its GCTP
+                                       transformation
 
 HARDWARE AND/OR SOFTWARE LIMITATIONS:  
   None
@@ -3196,6 +3201,7 @@ int WalkInputBoundary
     ProjInfo *inproj, *outproj;   /* input/output projection data structures */
     int status = ERROR_GENERAL;   /* error code status */
     long prtprm[2];               /* geolib terminal printing flags */
+    GctpXform xform;              /* input to output GCTP transformation */
     double inlat, inlon;          /* input lat/long coordinates for walking
                                      around the edges of the input rectangle */
     double inx, iny;              /* input coordinates for walking around the
@@ -3227,6 +3233,21 @@ int WalkInputBoundary
                 "coords" );
         }
     }
+    else
+    {
+        /* Set up the input to output GCTP transformation once rather than
+           for every point on the boundary */
+        status = gctp_call_init( &xform, inproj->proj_code,
+            inproj->zone_code, inproj->sphere_code, inproj->proj_coef,
+            inproj->units, outproj->proj_code, outproj->zone_code,
+            outproj->sphere_code, outproj->proj_coef, outproj->units );
+        if ( status != E_GEO_SUCC )
+        {
+            ErrorHandler( TRUE, "WalkInputBoundary", ERROR_GENERAL,
+                "Error in gctp_call_init for input coords to output "
+                "coords" );
+        }
+    }
 
     /* Initialize min/max x/y to find the output rectangle */
     *minx = *miny = MRT_FLOAT4_MAX;
@@ -3258,14 +3279,9 @@ int WalkInputBoundary
             else
             {
                 /* Call GCTP directly to allow the semi-major and semi-minor
-                   to be specified directly.  Both the input and output
-                   sphere values need to be -1, and thus the projection
-                   parameters for both input and output will be used. */
-                status = gctp_call( inproj->proj_code, inproj->zone_code,
-                    inproj->sphere_code, inproj->proj_coef, inproj->units,
-                    inx, iny, outproj->proj_code, outproj->zone_code,
-                    outproj->sphere_code, outproj->proj_coef, outproj->units,
-                    &outx, &outy );
+                   to be specified directly.  The transformation was set up
+                   once above. */
+                status = gctp_call_xform( &xform, inx, iny, &outx, &outy );
             }
                      
             /* Only use the point if the output projection value is valid */
@@ -3302,14 +3318,9 @@ int WalkInputBoundary
             else
             {
                 /* Call GCTP directly to allow the semi-major and semi-minor
-                   to be specified directly.  Both the input and output
-                   sphere values need to be -1, and thus the projection
-                   parameters for both input and output will be used. */
-                status = gctp_call( inproj->proj_code, inproj->zone_code,
-                    inproj->sphere_code, inproj->proj_coef, inproj->units,
-                    inx, iny, outproj->proj_code, outproj->zone_code,
-                    outproj->sphere_code, outproj->proj_coef, outproj->units,
-                    &outx, &outy );
+                   to be specified directly.  The transformation was set up
+                   once above. */
+                status = gctp_call_xform( &xform, inx, iny, &outx, &outy );
             }
                      
             /* Only use the point if the output projection value is valid */
@@ -3346,14 +3357,9 @@ int WalkInputBoundary
             else
             {
                 /* Call GCTP directly to allow the semi-major and semi-minor
-                   to be specified directly.  Both the input and output
-                   sphere values need to be -1, and thus the projection
-                   parameters for both input and output will be used. */
-                status = gctp_call( inproj->proj_code, inproj->zone_code,
-                    inproj->sphere_code, inproj->proj_coef, inproj->units,
-                    inx, iny, outproj->proj_code, outproj->zone_code,
-                    outproj->sphere_code, outproj->proj_coef, outproj->units,
-                    &outx, &outy );
+                   to be specified directly.  The transformation was set up
+                   once above. */
+                status = gctp_call_xform( &xform, inx, iny, &outx, &outy );
             }
                      
             /* Only use the point if the output projection value is valid */
@@ -3390,14 +3396,9 @@ int WalkInputBoundary
             else
             {
                 /* Call GCTP directly to allow the semi-major and semi-minor
-                   to be specified directly.  Both the input and output
-                   sphere values need to be -1, and thus the projection
-                   parameters for both input and output will be used. */
-                status = gctp_call( inproj->proj_code, inproj->zone_code,
-                    inproj->sphere_code, inproj->proj_coef, inproj->units,
-                    inx, iny, outproj->proj_code, outproj->zone_code,
-                    outproj->sphere_code, outproj->proj_coef, outproj->units,
-                    &outx, &outy );
+                   to be specified directly.  The transformation was set up
+                   once above. */
+                status = gctp_call_xform( &xform, inx, iny, &outx, &outy );
             }
                      
             /* Only use the point if the output projection value is valid */
@@ -3414,5 +3415,8 @@ int WalkInputBoundary
         inx += infile->pixel_size;
     }
 
+    if ( modis->output_datum_code == E_NODATUM )
+        gctp_call_free( &xform );
+
     return ( MRT_NO_ERROR );
 }
@@ -122,9 +122,9 @@ static char *formal_message[NUM_ERROR_CODES] = {
     "Bad or Missing SPATIAL_SUBSET_TYPE Field",
     "Bad or Missing BYTE_ORDER Field",
     "Bad or missing BYTE_ORDER Value",
-    "None",
-    "None",
-    "None",
+    "Bad or Missing APPROX_MAX_ERROR Field",
+    "Bad or Missing APPROX_MAX_ERROR Value",
+    "Bad or Missing NUM_THREADS Field",
 
     "Projection Processing Error",	/* -70 *//* gctp & geolib */
     "Open Datum File Error",
@@ -159,7 +159,12 @@ static char *formal_message[NUM_ERROR_CODES] = {
     "Illegal source or target unit code",
     "Missing projection parameters",
     "Invalid corner coordinates for input image",
-    "Output window falls outside mapping grid"	/* -103 */
+    "Output window falls outside mapping grid",	/* -103 */
+    "Bad or Missing OUTPUT_TILE_SIZE Field",
+    "Bad or Missing OUTPUT_COMPRESSION Field",
+    "Bad or Missing OUTPUT_COG Field",
+    "Bad or Missing OUTPUT_COMPRESSION_LEVEL Field",
+    "Bad -zonal or -zonal_bins Argument"
 };
 
 void AbortExit
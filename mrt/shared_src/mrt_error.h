@@ -15,7 +15,7 @@ NOTES:
   
 ******************************************************************************/
 
-#define NUM_ERROR_CODES                 104
+#define NUM_ERROR_CODES                 109
 
 #define MRT_NO_ERROR                     0
 
@@ -93,6 +93,9 @@ NOTES:
 #define ERROR_SPATIAL_SUBSET_TYPE       -64
 #define ERROR_BYTEORDER_FIELD           -65
 #define ERROR_BYTEORDER_VALUE           -66
+#define ERROR_APPROXERR_FIELD           -67
+#define ERROR_APPROXERR_VALUE           -68
+#define ERROR_THREADS_FIELD             -69
 
 #define ERROR_PROJECTION                -70
 #define ERROR_OPEN_DATUMFILE 		-71
@@ -129,3 +132,8 @@ NOTES:
 #define ERROR_GCTP_MISPAR               -101
 #define ERROR_INPUT_WINDOW              -102
 #define ERROR_OUTPUT_WINDOW             -103
+#define ERROR_TILESIZE_FIELD            -104
+#define ERROR_COMPRESSION_FIELD         -105
+#define ERROR_COG_FIELD                 -106
+#define ERROR_COMPRESSION_LEVEL_FIELD   -107
+#define ERROR_ZONAL_FIELD               -108
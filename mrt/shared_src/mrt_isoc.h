@@ -18,6 +18,12 @@
 #define swab       _swab
 #define strcasecmp _stricmp
 
+/* older compilers only have _snprintf, which returns -1 rather than the
+   full length when the output is truncated */
+#if defined( _MSC_VER ) && _MSC_VER < 1900
+#define snprintf   _snprintf
+#endif
+
 #endif
 
 #endif
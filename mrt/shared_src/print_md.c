@@ -9,6 +9,11 @@ HISTORY:
 Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          05/00  John Weiss             Original Development
+         10/26                         Print the virtual mosaic file type
+         10/26                         Print the output tiling and
+                                       compression
+         10/26                         Print the COG switch
+         10/26                         Print the deflate level
 
 HARDWARE AND/OR SOFTWARE LIMITATIONS:  
   None
@@ -32,7 +37,7 @@ static char *ProjectionStrings[] =
 
 static char *FileTypeStrings[] =
 {
-    "BAD", "RAW_BINARY", "HDF-EOS", "GEOTIFF"
+    "BAD", "RAW_BINARY", "HDF-EOS", "GEOTIFF", "VIRTUAL_MOSAIC"
 };
 
 static char *ResamplingTypeStrings[] =
@@ -40,6 +45,11 @@ static char *ResamplingTypeStrings[] =
     "BAD", "NN", "BI", "CC", "NONE"
 };
 
+static char *CompressionTypeStrings[] =
+{
+    "NONE", "DEFLATE", "LZW"
+};
+
 static char *RawBinaryEndianness[] =
 {
    "Not Applicable", "BIG_ENDIAN", "LITTLE_ENDIAN"
@@ -102,6 +112,9 @@ void PrintModisDescriptor
     if( P->input_filetype == RAW_BINARY )
        MessageHandler( NULL, "input_file_endian:       %s",
            RawBinaryEndianness[P->input_file_endian] );
+    if( P->input_filetype == VIRTUAL_MOSAIC )
+       MessageHandler( NULL, "input_mosaic_tiles:      %d x %d",
+           P->numh_tiles, P->numv_tiles );
     MessageHandler( NULL, "output_filetype:         %s",
         FileTypeStrings[P->output_filetype] );
     if( P->output_filetype == RAW_BINARY )
@@ -191,6 +204,23 @@ void PrintModisDescriptor
     }
     MessageHandler( NULL, "resampling_type:         %s",
             ResamplingTypeStrings[P->resampling_type] );
+    if ( P->approx_max_error > 0.0 )
+        MessageHandler( NULL, "approx_max_error:        %f input pixels",
+            P->approx_max_error );
+    if ( P->nthreads != 1 )
+        MessageHandler( NULL, "num_threads:             %d%s", P->nthreads,
+            P->nthreads == 0 ? " (one per processor)" : "" );
+    if ( P->output_tile_size > 0 )
+        MessageHandler( NULL, "output_tile_size:        %d",
+            P->output_tile_size );
+    if ( P->output_compression != COMPRESS_NONE )
+        MessageHandler( NULL, "output_compression:      %s",
+            CompressionTypeStrings[P->output_compression] );
+    if ( P->output_compression == COMPRESS_DEFLATE )
+        MessageHandler( NULL, "compression_level:       %d",
+            P->output_compression_level );
+    if ( P->output_cog )
+        MessageHandler( NULL, "output_cog:              YES" );
 
     strcpy( msgstr, "input projection parameters:  " );
     for ( i = 0; i < 15; i++ )
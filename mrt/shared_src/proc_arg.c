@@ -10,6 +10,10 @@ Version  Date   Programmer       Code  Reason
          04/00  John Weiss             Original Development
          01/01  John Rishea            Standardized formatting
          01/01  John Rishea            Moved some local prototypes to loc_prot.h
+         10/26                         Added the -threads switch
+         10/26                         Restart getopt for each batch job
+         10/26                         Added the -zonal and -zonal_bins
+                                       switches
 
 HARDWARE AND/OR SOFTWARE LIMITATIONS:  
   None
@@ -73,6 +77,20 @@ int GetUTMZoneArg
     char *str			/* I:  string to be parsed */
 );
 
+static int GetThreadsArg
+(
+    ModisDescriptor *P,		/* O:  session info */
+    int *argc,			/* I/O:  number of arguments */
+    char *argv[]		/* I/O:  argument strings */
+);
+
+static int GetZonalArgs
+(
+    ModisDescriptor *P,		/* O:  session info */
+    int *argc,			/* I/O:  number of arguments */
+    char *argv[]		/* I/O:  argument strings */
+);
+
 /******************************************************************************
 
 MODULE:  ProcessArguments
@@ -93,6 +111,9 @@ Version  Date   Programmer       Code  Reason
          04/00  John Weiss             More options
          05/00  John Weiss             Remove output filetype switch
          01/01  John Rishea            Standardized formatting
+         10/26                         Added -threads
+         10/26                         Restart getopt for each batch job
+         10/26                         Added -zonal and -zonal_bins
 
 NOTES:
 
@@ -115,6 +136,22 @@ int ProcessArguments
 	return ERROR_NOCOMMANDLINE_ARGUMENT;
     }
 
+    /* -threads, -zonal and -zonal_bins aren't single character options, so
+       take them out before getopt sees them */
+    i = GetThreadsArg( P, &argc, argv );
+    if ( i != MRT_NO_ERROR )
+        return i;
+    i = GetZonalArgs( P, &argc, argv );
+    if ( i != MRT_NO_ERROR )
+        return i;
+
+    /* each job of a batch run starts over (glibc only resets the state it
+       keeps between calls if optind is 0) */
+#ifdef __GLIBC__
+    optind = 0;
+#else
+    optind = 1;
+#endif
     opterr = 0;		/* do not print error messages to stdout */
     while ( ( c = getopt( argc, argv, "fg:h:i:j:l:o:p:r:s:a:t:u:x:" ) ) != -1 )
     {
@@ -939,6 +976,154 @@ int GetUTMZoneArg
 }
 
 
+/******************************************************************************
+
+MODULE:  GetThreadsArg
+
+PURPOSE:  get the number of resampling threads from the -threads
+          command-line argument, and remove it from the argument list
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+status		See mrt_error.h for a complete list of codes
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  A value of 0 uses one thread per online processor.
+
+******************************************************************************/
+static int GetThreadsArg
+(
+    ModisDescriptor *P,		/* O:  session info */
+    int *argc,			/* I/O:  number of arguments */
+    char *argv[]		/* I/O:  argument strings */
+)
+
+{
+    int i, j;
+    int nthreads;
+    char s[SMALL_STRING];
+
+    for ( i = 1; i < *argc; i++ )
+    {
+        if ( strcmp( argv[i], "-threads" ) )
+            continue;
+
+        /* scan the number of threads */
+        if ( i + 1 >= *argc || sscanf( argv[i + 1], "%i", &nthreads ) < 1 ||
+             nthreads < 0 )
+        {
+            sprintf( s, "Incorrect -threads command-line argument (value "
+                        "must be 0 or greater).\n" );
+            ErrorHandler( FALSE, "GetThreadsArg", ERROR_THREADS_FIELD, s );
+            Usage(  );
+            return ERROR_THREADS_FIELD;
+        }
+
+        P->nswitch = TRUE;
+        P->ParamsPresent[NUM_THREADS] = 1;
+        P->nthreads = nthreads;
+
+        /* remove the switch and its value */
+        for ( j = i; j + 2 < *argc; j++ )
+            argv[j] = argv[j + 2];
+        *argc -= 2;
+        i--;
+    }
+
+    return MRT_NO_ERROR;
+}
+
+
+/******************************************************************************
+
+MODULE:  GetZonalArgs
+
+PURPOSE:  get the zone label raster and the number of histogram bins from
+          the -zonal and -zonal_bins command-line arguments, and remove them
+          from the argument list
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+status		See mrt_error.h for a complete list of codes
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The label raster is opened later, by OpenZonalLabels.
+
+******************************************************************************/
+static int GetZonalArgs
+(
+    ModisDescriptor *P,		/* O:  session info */
+    int *argc,			/* I/O:  number of arguments */
+    char *argv[]		/* I/O:  argument strings */
+)
+
+{
+    int i, j;
+    int nbins;
+    char s[SMALL_STRING];
+
+    for ( i = 1; i < *argc; i++ )
+    {
+        if ( !strcmp( argv[i], "-zonal" ) )
+        {
+            if ( i + 1 >= *argc )
+            {
+                sprintf( s, "Missing -zonal label raster.\n" );
+                ErrorHandler( FALSE, "GetZonalArgs", ERROR_ZONAL_FIELD, s );
+                Usage(  );
+                return ERROR_ZONAL_FIELD;
+            }
+
+            free( P->zonal_filename );
+            P->zonal_filename = strdup( argv[i + 1] );
+            if ( P->zonal_filename == NULL )
+            {
+                sprintf( s, "strdup mem for zonal_filename not allocated." );
+                ErrorHandler( TRUE, "GetZonalArgs", ERROR_MEMORY, s );
+                return ERROR_MEMORY;
+            }
+        }
+        else if ( !strcmp( argv[i], "-zonal_bins" ) )
+        {
+            if ( i + 1 >= *argc ||
+                 sscanf( argv[i + 1], "%i", &nbins ) < 1 || nbins < 0 )
+            {
+                sprintf( s, "Incorrect -zonal_bins command-line argument "
+                            "(value must be 0 or greater).\n" );
+                ErrorHandler( FALSE, "GetZonalArgs", ERROR_ZONAL_FIELD, s );
+                Usage(  );
+                return ERROR_ZONAL_FIELD;
+            }
+            P->zonal_bins = nbins;
+        }
+        else
+            continue;
+
+        /* remove the switch and its value */
+        for ( j = i; j + 2 < *argc; j++ )
+            argv[j] = argv[j + 2];
+        *argc -= 2;
+        i--;
+    }
+
+    return MRT_NO_ERROR;
+}
+
+
 /******************************************************************************
 
 MODULE:  GetPixelSizeArg
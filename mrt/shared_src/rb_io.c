@@ -13,6 +13,10 @@ Version  Date   Programmer       Code  Reason
                                        replaced with BYTE_ORDER
                                        Also removed swab definition for Linux
                                        since swab is defined for Linux now
+         10/26                         Added MapRowMultiFile and read rows
+                                       from the memory mapping of the input
+                                       file
+         10/26                         Added WriteRowMultiFileAt
 
 HARDWARE AND/OR SOFTWARE LIMITATIONS:  
   None
@@ -24,7 +28,7 @@ NOTES:
 ******************************************************************************/
 #if defined(__linux__)
 #  ifndef _XOPEN_SOURCE
-#    define _XOPEN_SOURCE
+#    define _XOPEN_SOURCE 500   /* for pwrite */
 #    include <unistd.h>
 #    undef _XOPEN_SOURCE
 #  else
@@ -42,49 +46,37 @@ NOTES:
 
 /******************************************************************************
 
-MODULE:  ReadRowMultiFile
+MODULE:  NeedByteSwap
 
-PURPOSE:  Read a row of data from a multi-file
+PURPOSE:  Determine if the data read from a multi-file must be byte swapped
 
 RETURN VALUE:
 Type = int
 Value           Description
 -----           -----------
-TRUE            Success
-FALSE           Failure
+TRUE            The file's byte order is not the machine's
+FALSE           No byte swapping is needed
 
 HISTORY:
 Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
-         05/00  Rob Burrell            Original Development
-         06/00  John Weiss             byte swapping for endian issues
-         01/01  John Rishea            Standardized formatting
-         01/01  John Rishea            Added check for memory allocation 
+         10/26                         Original Development (from
+                                       ReadRowMultiFile)
+
 NOTES:
+  Exits if the byte order of the file is not known.
 
 ******************************************************************************/
-
-int ReadRowMultiFile
+static int NeedByteSwap
 (
-    FileDescriptor *file,	/* I/O:  file to read from */
-    int row			/* I:  row number to read */
+    FileDescriptor *file	/* I:  file to read from */
 )
 
 {
-    int status = TRUE;		/* error status */
-    int offset;			/* offset into file */
-    size_t i;			/* index for byte swapping */
-    int tmp;			/* temp value for byte swapping */
-    unsigned char *val = NULL;	/* single byte for byte swapping */
-    static unsigned char *bufswp = NULL;	/* pointer for swab */
     /* true if machine is big endian */
     MrtEndianness machineEndianness = MRT_UNKNOWN_ENDIAN;
     int doByteSwap = 0;         /* true if byte swapping is to occur */
 
-    /* seek to correct spot in file for read */
-    offset = file->datasize * row * file->ncols;
-    fseek( ( FILE * ) file->fileptr, offset, SEEK_SET );
-
     /* unfortunately, byte order is an issue for multifile I/O.
      * check the endianness of the raw binary file against the
      * endianness of the machine.  If it is the same, then no
@@ -107,9 +99,126 @@ int ReadRowMultiFile
         machineEndianness != MRT_LITTLE_ENDIAN )
        doByteSwap = 1;
 
-    if( !doByteSwap )
+    /* byte data never needs to be swapped */
+    if ( file->datasize == 1 )
+       doByteSwap = 0;
+
+    return ( doByteSwap );
+}
+
+/******************************************************************************
+
+MODULE:  MapRowMultiFile
+
+PURPOSE:  Get a pointer to rows of a multi-file straight from its memory
+          mapping
+
+RETURN VALUE:
+Type = void *
+Value           Description
+-----           -----------
+pointer         The first of the rows in the mapping
+NULL            The file isn't mapped, the rows aren't all in the file, or
+                the data has to be byte swapped (use ReadRowMultiFile)
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The rows are contiguous in the file, so the pointer covers all nrows of
+  them.  The data must not be modified.
+
+******************************************************************************/
+void *MapRowMultiFile
+(
+    FileDescriptor *file,	/* I:  file to read from */
+    size_t row,			/* I:  first row number */
+    size_t nrows		/* I:  number of rows needed */
+)
+
+{
+    size_t rowsize;		/* bytes in a row */
+
+    if ( file->map == NULL || NeedByteSwap( file ) )
+	return ( NULL );
+
+    /* the offset is in size_t since the whole file fits in the address
+       space */
+    rowsize = file->ncols * file->datasize;
+    if ( ( row + nrows ) * rowsize > file->mapsize )
+	return ( NULL );
+
+    return ( ( char * ) file->map + row * rowsize );
+}
+
+/******************************************************************************
+
+MODULE:  ReadRowMultiFile
+
+PURPOSE:  Read a row of data from a multi-file
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            Success
+FALSE           Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         05/00  Rob Burrell            Original Development
+         06/00  John Weiss             byte swapping for endian issues
+         01/01  John Rishea            Standardized formatting
+         01/01  John Rishea            Added check for memory allocation 
+         10/26                         Copy from the memory mapping if the
+                                       file is mapped, otherwise seek with
+                                       a long offset rather than an int.
+                                       Byte swap in place.
+NOTES:
+
+******************************************************************************/
+
+int ReadRowMultiFile
+(
+    FileDescriptor *file,	/* I/O:  file to read from */
+    int row			/* I:  row number to read */
+)
+
+{
+    int status = TRUE;		/* error status */
+    size_t rowsize;		/* bytes in a row */
+    size_t i;			/* index for byte swapping */
+    int tmp;			/* temp value for byte swapping */
+    unsigned char *val = NULL;	/* single byte for byte swapping */
+    int doByteSwap = 0;         /* true if byte swapping is to occur */
+
+    doByteSwap = NeedByteSwap( file );
+    rowsize = file->ncols * file->datasize;
+
+    if ( file->map != NULL )
+    {
+       /* copy the row from the mapping */
+       if ( ( ( size_t ) row + 1 ) * rowsize > file->mapsize )
+       {
+          /* oops, the row isn't in the file */
+          ErrorHandler( TRUE, "ReadRowMultiFile", ERROR_READ_INPUTIMAGE,
+                        "Read wrong number of data items" );
+          return FALSE;
+       }
+       memcpy( file->rowbuffer, ( char * ) file->map + ( size_t ) row *
+               rowsize, rowsize );
+    }
+    else
     {
-       /* read big endian data, no need to byte swap */
+       /* seek to correct spot in file for read.  a long offset is 64 bits
+          on LP64 systems, so large files don't overflow the offset. */
+       fseek( ( FILE * ) file->fileptr, ( long ) row * ( long ) rowsize,
+              SEEK_SET );
+
+       /* read row */
        if ( fread( file->rowbuffer, file->datasize, file->ncols,
                    ( FILE * ) file->fileptr ) != file->ncols )
        {
@@ -118,76 +227,26 @@ int ReadRowMultiFile
                         "Read wrong number of data items" );
           return FALSE;
        }
-    } 
-    else
+    }
+
+    if ( doByteSwap )
     {
        /* have to byte swap int/float big endian data on little endian boxes */
+       val = file->rowbuffer;
        switch ( file->datasize )
        {
-       /* byte data? no need to byte swap */
-       case 1:
-          /* read row */
-          if ( fread( file->rowbuffer, file->datasize, file->ncols,
-                      ( FILE * ) file->fileptr ) != file->ncols )
-          {
-             /* oops, read wrong number of data items */
-             ErrorHandler( TRUE, "ReadRowMultiFile", ERROR_READ_INPUTIMAGE,
-             "Read wrong number of data items" );
-             return FALSE;
-          }
-          break;
-
-       /* 2-byte values: assume that swab is implemented efficiently */
+       /* 2-byte values */
        case 2:
-          /* allocate memory for swap buffer */
-          if ( bufswp == NULL )
-             bufswp = calloc( file->ncols, file->datasize );
-
-          /* if swap buffer memory can't be allocated, exit w/ error */
-          if ( bufswp == NULL )
-          {
-             /* log error */
-             ErrorHandler( TRUE, "ReadRowMultiFile", ERROR_MEMORY,
-                           "Unable to allocate memory for byte swapping" );
-             return FALSE;
-          } 
-
-          /* read row */
-          if ( fread( bufswp, file->datasize, file->ncols,
-                      ( FILE * ) file->fileptr ) != file->ncols )
+          for ( i = 0; i < file->ncols; i++, val += 2 )
           {
-             /* free allocated memory */
-             free ( bufswp );
-
-             /* oops, read wrong number of data items */
-             ErrorHandler( TRUE, "ReadRowMultiFile", ERROR_READ_INPUTIMAGE,
-                           "Read wrong number of data items" );
-             return FALSE;
+             tmp = val[0];
+             val[0] = val[1];
+             val[1] = tmp;
           }
-
-	  /* swap bytes: swab(src, dest, n) */
-	  swab( bufswp, file->rowbuffer, file->datasize * file->ncols );
-
-          /* free allocated memory */
-          free ( bufswp );
-          bufswp = NULL;
-	
        	  break;
 
        /* 4-byte values: we better do this by hand (or use htonl() ?) */
        case 4:
-          /* read row */
-          if ( fread( file->rowbuffer, file->datasize, file->ncols,
-                      ( FILE * ) file->fileptr ) != file->ncols )
-          {
-          /* oops, read wrong number of data items */
-          ErrorHandler( TRUE, "ReadRowMultiFile", ERROR_READ_INPUTIMAGE,
-                        "Read wrong number of data items" );
-          return FALSE;
-          }
-
-          /* swap bytes */
-          val = file->rowbuffer;
           for ( i = 0; i < file->ncols; i++, val += 4 )
           {
              tmp = val[0];
@@ -258,6 +317,81 @@ int WriteRowMultiFile
     return ( status );
 }
 
+/******************************************************************************
+
+MODULE:  WriteRowMultiFileAt
+
+PURPOSE:  Write a row of data to its place in a multi-file file
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            Success
+FALSE           Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development (from
+                                       WriteRowMultiFile)
+
+NOTES:
+  1. Unlike WriteRowMultiFile the row is written at its own offset in the
+     file, from the caller's buffer rather than file->rowbuffer.  Several
+     threads may write rows of the same file at once since neither the
+     file position nor the row buffer is shared.
+  2. The file must not be written with WriteRowMultiFile as well, since
+     stdio's buffer isn't used.
+
+******************************************************************************/
+
+int WriteRowMultiFileAt
+(
+    FileDescriptor *file,	/* I:  file to write data */
+    size_t row,			/* I:  row number to write */
+    void *buffer		/* I:  row in the file's data type */
+)
+{
+    size_t nbytes = file->ncols * file->datasize;  /* bytes left to write */
+    char *ptr = ( char * ) buffer;	/* next byte to write */
+#ifndef WIN32
+    int fd = fileno( ( FILE * ) file->fileptr );  /* output file */
+    off_t offset = ( off_t ) row * ( off_t ) nbytes;  /* where it goes */
+    ssize_t nwritten;		/* bytes written by one pwrite */
+
+    /* pwrite may write less than asked for, so keep going until the whole
+       row is out */
+    while ( nbytes > 0 )
+    {
+	nwritten = pwrite( fd, ptr, nbytes, offset );
+	if ( nwritten <= 0 )
+	{
+	    /* oops, wrote wrong number of data items */
+	    ErrorHandler( TRUE, "WriteRowMultiFileAt",
+		ERROR_WRITE_OUTPUTIMAGE, "Wrote wrong number of data items" );
+	    return FALSE;
+	}
+	ptr += nwritten;
+	offset += nwritten;
+	nbytes -= ( size_t ) nwritten;
+    }
+#else
+    /* no pwrite, so the rows can only be written by one thread at a time */
+    if ( fseek( ( FILE * ) file->fileptr, ( long ) ( row * nbytes ),
+	    SEEK_SET ) != 0 ||
+	 fwrite( ptr, 1, nbytes, ( FILE * ) file->fileptr ) != nbytes )
+    {
+	/* oops, wrote wrong number of data items */
+	ErrorHandler( TRUE, "WriteRowMultiFileAt", ERROR_WRITE_OUTPUTIMAGE,
+	    "Wrote wrong number of data items" );
+	return FALSE;
+    }
+#endif
+
+    return ( TRUE );
+}
+
 /*************************************************************************
 
 MODULE: read_tile_number_rb
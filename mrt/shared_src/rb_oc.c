@@ -11,6 +11,7 @@ Version  Date   Programmer       Code  Reason
          05/00  Rob Burrell            Original Development
          06/00  John Weiss             support for input/output HDF-EOS files
          06/00  Rob Burrell            support for output GeoTIFF files
+         10/26                         Map raw binary input files into memory
 
 HARDWARE AND/OR SOFTWARE LIMITATIONS:  
   None
@@ -22,6 +23,67 @@ NOTES:
 ******************************************************************************/
 #include "shared_mosaic.h"
 #include <errno.h>
+#ifndef WIN32
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#endif
+
+/******************************************************************************
+
+MODULE:  MapMultiFile
+
+PURPOSE:  Map a multifile input file into memory
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  1. If the file can't be mapped (or this is Windows), file->map is left
+     NULL and the rows are read with fseek/fread as before.
+  2. sequential tells the kernel how the rows will be read: TRUE for top
+     to bottom (mosaicking, no resampling), FALSE for the random order of
+     the resamplers (which read a strip of rows at a time).
+
+******************************************************************************/
+static void MapMultiFile
+(
+    FileDescriptor *file,	/* I/O:  file opened for reading */
+    int sequential		/* I:  will the rows be read in order? */
+)
+
+{
+#ifndef WIN32
+    struct stat st;		/* file size */
+    void *map;			/* the mapping */
+
+    file->map = NULL;
+    file->mapsize = 0;
+
+    if ( fstat( fileno( ( FILE * ) file->fileptr ), &st ) != 0 ||
+         st.st_size <= 0 || ( off_t ) ( size_t ) st.st_size != st.st_size )
+        return;
+
+    map = mmap( NULL, ( size_t ) st.st_size, PROT_READ, MAP_PRIVATE,
+        fileno( ( FILE * ) file->fileptr ), 0 );
+    if ( map == MAP_FAILED )
+        return;
+
+    madvise( map, ( size_t ) st.st_size,
+        sequential ? MADV_SEQUENTIAL : MADV_RANDOM );
+
+    file->map = map;
+    file->mapsize = ( size_t ) st.st_size;
+#else
+    file->map = NULL;
+    file->mapsize = 0;
+#endif
+}
 
 /******************************************************************************
 
@@ -47,6 +109,7 @@ Version  Date   Programmer       Code  Reason
                                         the pathname to insure that the
                                         extension was being pulled from the
                                         filename and not the pathname.
+         10/26                          Map input files into memory
 
 NOTES:
 
@@ -116,6 +179,13 @@ FileDescriptor *OpenMultiFile
 		DestroyFileDescriptor( file );
 		file = NULL;
 	    }
+	    else
+	    {
+		/* read the rows straight from memory.  if we're not
+		   resampling then the rows are read in order. */
+		MapMultiFile( file,
+		    modis->resampling_type == NO_RESAMPLE );
+	    }
 	}
     }
 
@@ -189,6 +259,7 @@ HISTORY:
 Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          07/02   Gail Schmidt           Original Development
+         10/26                          Map input files into memory
 
 NOTES:
 
@@ -260,6 +331,11 @@ FileDescriptor *OpenMultiFileMosaic
 		DestroyFileDescriptor( file );
 		file = NULL;
 	    }
+	    else
+	    {
+		/* read the rows straight from memory, in order */
+		MapMultiFile( file, TRUE );
+	    }
 	}
     }
 
@@ -335,6 +411,7 @@ Version  Date   Programmer       Code  Reason
          05/00   Rob Burrell            Original Development
          01/01   John Rishea            Standardized formatting
          01/01   John Rishea            Combined cases in switch stmt 
+         10/26                          Unmap input files
 NOTES:
 
 ******************************************************************************/
@@ -349,6 +426,12 @@ int CloseMultiFile
     switch ( filedescriptor->fileopentype )
     {
 	case FILE_READ_MODE:
+#ifndef WIN32
+	    if ( filedescriptor->map )
+		munmap( filedescriptor->map, filedescriptor->mapsize );
+#endif
+	    filedescriptor->map = NULL;
+	    /* fall through */
 
 	case FILE_WRITE_MODE:
 	    fclose( ( FILE * ) filedescriptor->fileptr );
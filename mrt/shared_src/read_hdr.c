@@ -9,6 +9,8 @@ Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          05/00  John Weiss             Original Development
          04/01  Rob Burrell            Add GetInputEllipseCode for UTM and Geo
+         10/26                         Added the MOSAIC_TILES field of a
+                                       virtual mosaic header
 
 HARDWARE AND/OR SOFTWARE LIMITATIONS:  
   None
@@ -43,6 +45,7 @@ static int CheckFields ( int nstrings, int StringsPresent[],
 static int CheckFieldsMosaic ( int nstrings, int StringsPresent[],
     MosaicDescriptor *P );
 static int GetByteOrder ( char *tmpstr, MrtEndianness *input_byte_order );
+static int GetMosaicTiles ( char *tmpstr, ModisDescriptor *P );
 
 
 /* Create some defines to make the code a little easier
@@ -66,7 +69,8 @@ typedef enum { MRT_PROJECTION_TYPE,         /* 0 */
                MRT_BACKGROUND_FILL,
                MRT_DATUM,                   /* 15 */
                MRT_UTM_ZONE,
-               MRT_BYTE_ORDER } HeaderStringsEnums;
+               MRT_BYTE_ORDER,
+               MRT_MOSAIC_TILES } HeaderStringsEnums;
 
 static char *HeaderStrings[] = {
         "PROJECTION_TYPE",         /* 0 */
@@ -86,7 +90,8 @@ static char *HeaderStrings[] = {
         "BACKGROUND_FILL",
         "DATUM",                   /* 15 */
         "UTM_ZONE",
-        "BYTE_ORDER"
+        "BYTE_ORDER",
+        "MOSAIC_TILES"
     };
 #define MRT_NUMBER_OF_HEADER_STRINGS  (sizeof(HeaderStrings)/sizeof(HeaderStrings[0]))
 
@@ -121,8 +126,12 @@ Version  Date   Programmer       Code  Reason
                                        ellipsoid support
          11/02  Gail Schmidt           Added support for Albers Equal Area.
          07/03  Gail Schmidt           Added support for Equirectangular
+         10/26                         Read the tile list of a virtual
+                                       mosaic header (MOSAIC_TILES)
   
 NOTES:
+  A header with a MOSAIC_TILES field describes a virtual mosaic, and the
+  input file type is changed to VIRTUAL_MOSAIC.
 
 ******************************************************************************/
 
@@ -369,6 +378,12 @@ int ReadHeaderFile
                 /* determine Raw Binary data endianness: BYTE_ORDER = ... */
                 n = GetByteOrder( bufptr, &P->input_file_endian );
                 break;
+
+            case MRT_MOSAIC_TILES:
+                /* determine the tiles of a virtual mosaic:
+                   MOSAIC_TILES = ( ... ) */
+                n = GetMosaicTiles( bufptr, P );
+                break;
 	}
 
 	/* make sure we got a valid field */
@@ -416,6 +431,7 @@ Version  Date   Programmer       Code  Reason
          01/07  Gail Schmidt           Modified the call to GCTP to send in
                                        the sphere code which will be
                                        used for UTM only
+         10/26                         Reject virtual mosaic headers
 
 NOTES:
 
@@ -669,6 +685,16 @@ int ReadHeaderFileMosaic
                 /* determine Raw Binary data endianness: BYTE_ORDER = ... */
                 n = GetByteOrder( bufptr, &mosaic->input_file_endian );
                 break;
+
+            case MRT_MOSAIC_TILES:
+                /* the tiles of a virtual mosaic have to be mosaicked
+                   themselves */
+                sprintf( error_str, "%s is a virtual mosaic and can't be "
+                    "used as a mosaic input. Use its tiles.",
+                    mosaic->filename );
+                ErrorHandler( TRUE, "ReadHeaderFileMosaic",
+                    ERROR_READ_INPUTHEADER, error_str );
+                return ERROR_READ_INPUTHEADER;
         }
 
         /* make sure we got a valid field */
@@ -1037,6 +1063,10 @@ static int CheckFields
     if ( !StringsPresent[MRT_UTM_ZONE] )
         StringsPresent[MRT_UTM_ZONE] = 1;
 
+    /* MOSAIC_TILES is only in virtual mosaic headers */
+    if ( !StringsPresent[MRT_MOSAIC_TILES] )
+        StringsPresent[MRT_MOSAIC_TILES] = 1;
+
     /* check that all fields are present */
     for ( i = 0; i < nstrings; i++ )
     {
@@ -1157,6 +1187,10 @@ static int CheckFieldsMosaic
     }
     if ( !StringsPresent[MRT_UTM_ZONE] ) StringsPresent[MRT_UTM_ZONE] = 1;
 
+    /* MOSAIC_TILES is never in a mosaic input (see ReadHeaderFileMosaic) */
+    if ( !StringsPresent[MRT_MOSAIC_TILES] )
+        StringsPresent[MRT_MOSAIC_TILES] = 1;
+
     /* check that all fields are present */
     for ( i = 0; i < nstrings; i++ )
     {
@@ -2176,3 +2210,102 @@ static int GetByteOrder
     return n;
 }
 
+/******************************************************************************
+
+MODULE:  GetMosaicTiles
+
+PURPOSE:  Read the tile list of a virtual mosaic header
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+n               Number of characters parsed
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The field is MOSAIC_TILES = ( numh numv file ... ) with the numv rows of
+  numh tile files from the top left, as written by mrtmosaic -v.  NONE is
+  a missing tile.  The tiles are the raw binary headers or HDF-EOS files
+  that were mosaicked, and are read as one image (see vm_oc.c).
+
+******************************************************************************/
+static int GetMosaicTiles
+(
+    char *tmpstr,               /* I: the field, after its name */
+    ModisDescriptor *P          /* O: numh_tiles, numv_tiles, tile_filenames
+                                      and input_filetype */
+)
+
+{
+    int i, n = 0, len = 0;
+    int ntiles;
+    char s[LINE_BUFSIZ];
+
+    /* read the open paren and the number of tiles */
+    if ( sscanf( tmpstr, " = ( %d %d%n", &P->numh_tiles, &P->numv_tiles,
+         &len ) != 2 || len < 1 || P->numh_tiles < 1 || P->numv_tiles < 1 )
+    {
+        sprintf( s, "Incorrect MOSAIC_TILES field (bad or missing number "
+            "of tiles)." );
+        ErrorHandler( TRUE, "ReadHeaderFile", ERROR_READ_INPUTHEADER, s );
+        return ERROR_READ_INPUTHEADER;
+    }
+    tmpstr += len;
+
+    ntiles = P->numh_tiles * P->numv_tiles;
+    P->tile_filenames = ( char ** ) calloc( ntiles, sizeof( char * ) );
+    if ( P->tile_filenames == NULL )
+    {
+        sprintf( s, "Unable to allocate memory for the mosaic tiles." );
+        ErrorHandler( TRUE, "ReadHeaderFile", ERROR_MEMORY, s );
+        return ERROR_MEMORY;
+    }
+
+    /* read the file names */
+    for ( i = 0; i < ntiles; i++ )
+    {
+        if ( sscanf( tmpstr, "%s%n", s, &n ) < 1 || strcmp( s, ")" ) == 0 )
+        {
+            sprintf( s, "Incorrect MOSAIC_TILES field (missing tiles)." );
+            ErrorHandler( TRUE, "ReadHeaderFile", ERROR_READ_INPUTHEADER, s );
+            return ERROR_READ_INPUTHEADER;
+        }
+
+        if ( strcasecmp( s, "NONE" ) != 0 )
+        {
+            P->tile_filenames[i] = strdup( s );
+            if ( P->tile_filenames[i] == NULL )
+            {
+                sprintf( s, "Unable to allocate strdup memory for the "
+                    "mosaic tiles." );
+                ErrorHandler( TRUE, "ReadHeaderFile", ERROR_MEMORY, s );
+                return ERROR_MEMORY;
+            }
+        }
+
+        len += n;
+        tmpstr += n;
+    }
+
+    /* read the close paren */
+    n = 0;
+    sscanf( tmpstr, " )%n", &n );
+    if ( n < 1 )
+    {
+        sprintf( s, "Incorrect MOSAIC_TILES field (bad or missing close "
+            "paren)." );
+        ErrorHandler( TRUE, "ReadHeaderFile", ERROR_READ_INPUTHEADER, s );
+        return ERROR_READ_INPUTHEADER;
+    }
+
+    /* the rows come from the tiles */
+    P->input_filetype = VIRTUAL_MOSAIC;
+
+    /* return number of characters parsed */
+    return len + n;
+}
@@ -21,6 +21,14 @@ Version  Date   Programmer       Code  Reason
          03/03  Gail Schmidt           Bumped up the size of a line and file
                                        buffer to read all the input mosaic
                                        files
+         10/26                         Added the optional APPROX_MAX_ERROR
+                                       field
+         10/26                         Added the optional NUM_THREADS field
+         10/26                         Added the optional OUTPUT_TILE_SIZE
+                                       and OUTPUT_COMPRESSION fields
+         10/26                         Added the optional OUTPUT_COG field
+         10/26                         Added the optional
+                                       OUTPUT_COMPRESSION_LEVEL field
 
 HARDWARE AND/OR SOFTWARE LIMITATIONS:  
   None
@@ -250,6 +258,42 @@ int GetOutputDatum
     ModisDescriptor *P
 );
 
+int GetApproxMaxError
+(
+    char *str,
+    ModisDescriptor *P
+);
+
+int GetNumThreads
+(
+    char *str,
+    ModisDescriptor *P
+);
+
+int GetOutputTileSize
+(
+    char *str,
+    ModisDescriptor *P
+);
+
+int GetOutputCompression
+(
+    char *str,
+    ModisDescriptor *P
+);
+
+int GetOutputCOG
+(
+    char *str,
+    ModisDescriptor *P
+);
+
+int GetOutputCompressionLevel
+(
+    char *str,
+    ModisDescriptor *P
+);
+
 void PrintModisDescriptor
 (
     ModisDescriptor *P 
@@ -286,7 +330,13 @@ int ReadParameterFile
 	"OUTPUT_PROJECTION_PARAMETERS",
 	"OUTPUT_PIXEL_SIZE",
         "UTM_ZONE",
-        "DATUM"};
+        "DATUM",
+        "APPROX_MAX_ERROR",
+        "NUM_THREADS",
+        "OUTPUT_TILE_SIZE",
+        "OUTPUT_COMPRESSION",
+        "OUTPUT_COG",
+        "OUTPUT_COMPRESSION_LEVEL"};
     /* There are loops in this code that loop through the following
      * enumeration, starting at "INPUT_FILENAME" while the counter
      * is less than NSTRINGS.  Just be carefull adding items to the
@@ -296,7 +346,9 @@ int ReadParameterFile
         INPUT_FILENAME, SPECTRAL_SUBSET, SPATIAL_SUBSET_TYPE,
         SPATIAL_SUBSET_UL, SPATIAL_SUBSET_LR, OUTPUT_FILENAME,
         RESAMPLING_TYPE, OUTPUT_PROJ_TYPE, OUTPUT_PROJ_PARMS,
-        PIXEL_SIZE, UTM_ZONE, DATUM, NSTRINGS } ParamType;
+        PIXEL_SIZE, UTM_ZONE, DATUM, APPROX_MAX_ERROR, NUM_THREADS,
+        OUTPUT_TILE_SIZE, OUTPUT_COMPRESSION, OUTPUT_COG,
+        OUTPUT_COMPRESSION_LEVEL, NSTRINGS } ParamType;
     ParamType iparam;
     /* these enums must also be changed in the shared_resample.h file */
 
@@ -590,6 +642,41 @@ int ReadParameterFile
                    code */
                 n = GetOutputDatum( bufptr, P );
 		break;
+
+            case APPROX_MAX_ERROR:
+                /* determine the max error for the approximate transformer:
+                   APPROX_MAX_ERROR = ... */
+                n = GetApproxMaxError( bufptr, P );
+		break;
+
+            case NUM_THREADS:
+                /* determine the number of resampling threads:
+                   NUM_THREADS = ... (-threads overrides this) */
+                n = GetNumThreads( bufptr, P );
+		break;
+
+            case OUTPUT_TILE_SIZE:
+                /* determine the output tile size: OUTPUT_TILE_SIZE = ... */
+                n = GetOutputTileSize( bufptr, P );
+		break;
+
+            case OUTPUT_COMPRESSION:
+                /* determine the output compression:
+                   OUTPUT_COMPRESSION = ... */
+                n = GetOutputCompression( bufptr, P );
+		break;
+
+            case OUTPUT_COG:
+                /* determine if a cloud optimized GeoTIFF is written:
+                   OUTPUT_COG = ... */
+                n = GetOutputCOG( bufptr, P );
+		break;
+
+            case OUTPUT_COMPRESSION_LEVEL:
+                /* determine the deflate level:
+                   OUTPUT_COMPRESSION_LEVEL = ... */
+                n = GetOutputCompressionLevel( bufptr, P );
+		break;
 	}
 
 	/* make sure we got a valid field */
@@ -667,12 +754,20 @@ int ReadParameterFileHDF2RB
 	"OUTPUT_PROJECTION_PARAMETERS",
 	"OUTPUT_PIXEL_SIZE",
         "UTM_ZONE",
-        "DATUM"};
+        "DATUM",
+        "APPROX_MAX_ERROR",
+        "NUM_THREADS",
+        "OUTPUT_TILE_SIZE",
+        "OUTPUT_COMPRESSION",
+        "OUTPUT_COG",
+        "OUTPUT_COMPRESSION_LEVEL"};
     typedef enum {
         INPUT_FILENAME, SPECTRAL_SUBSET, SPATIAL_SUBSET_TYPE,
         SPATIAL_SUBSET_UL, SPATIAL_SUBSET_LR, OUTPUT_FILENAME,
         RESAMPLING_TYPE, OUTPUT_PROJ_TYPE, OUTPUT_PROJ_PARMS,
-        PIXEL_SIZE, UTM_ZONE, DATUM, NSTRINGS } ParamType;
+        PIXEL_SIZE, UTM_ZONE, DATUM, APPROX_MAX_ERROR, NUM_THREADS,
+        OUTPUT_TILE_SIZE, OUTPUT_COMPRESSION, OUTPUT_COG,
+        OUTPUT_COMPRESSION_LEVEL, NSTRINGS } ParamType;
     ParamType iparam;
     /* these enums must also be changed in the shared_resample.h file */
 
@@ -808,7 +903,10 @@ int ReadParameterFileHDF2RB
                HDF2RB conversion */
             if ( iparam == SPATIAL_SUBSET_TYPE || iparam == RESAMPLING_TYPE ||
                  iparam == OUTPUT_PROJ_TYPE || iparam == OUTPUT_PROJ_PARMS ||
-                 iparam == PIXEL_SIZE || iparam == UTM_ZONE || iparam == DATUM )
+                 iparam == PIXEL_SIZE || iparam == UTM_ZONE || iparam == DATUM ||
+                 iparam == APPROX_MAX_ERROR || iparam == NUM_THREADS ||
+                 iparam == OUTPUT_TILE_SIZE || iparam == OUTPUT_COMPRESSION ||
+                 iparam == OUTPUT_COG || iparam == OUTPUT_COMPRESSION_LEVEL )
                 continue;
 
 	    /* check for match to fieldname */
@@ -1246,6 +1344,62 @@ int CheckOutputFields
     if ( !P->ParamsPresent[UTM_ZONE] )
         P->ParamsPresent[UTM_ZONE] = 1;
 
+    /* optional approximate transformer max error - default is to project
+       every output pixel exactly */
+    if ( !P->ParamsPresent[APPROX_MAX_ERROR] )
+    {
+        P->approx_max_error = 0.0;
+        P->ParamsPresent[APPROX_MAX_ERROR] = 1;
+    }
+
+    /* optional number of resampling threads - default is a single thread */
+    if ( !P->ParamsPresent[NUM_THREADS] )
+    {
+        P->nthreads = 1;
+        P->ParamsPresent[NUM_THREADS] = 1;
+    }
+
+    /* optional tile size - default is one row GeoTIFF strips, or untiled
+       HDF-EOS fields */
+    if ( !P->ParamsPresent[OUTPUT_TILE_SIZE] )
+    {
+        P->output_tile_size = 0;
+        P->ParamsPresent[OUTPUT_TILE_SIZE] = 1;
+    }
+
+    /* optional compression - default is uncompressed.  HDF-EOS has no LZW
+       compression, so HDF-EOS output uses deflate instead. */
+    if ( !P->ParamsPresent[OUTPUT_COMPRESSION] )
+    {
+        P->output_compression = COMPRESS_NONE;
+        P->ParamsPresent[OUTPUT_COMPRESSION] = 1;
+    }
+    if ( P->output_filetype == HDFEOS &&
+         P->output_compression == COMPRESS_LZW )
+    {
+        ErrorHandler( FALSE, "CheckOutputFields", ERROR_COMPRESSION_FIELD,
+            "LZW compression isn't available for HDF-EOS output; DEFLATE "
+            "will be used instead." );
+        P->output_compression = COMPRESS_DEFLATE;
+    }
+
+    /* optional deflate level - default is zlib's default */
+    if ( !P->ParamsPresent[OUTPUT_COMPRESSION_LEVEL] )
+    {
+        P->output_compression_level = DEFAULT_COMPRESSION_LEVEL;
+        P->ParamsPresent[OUTPUT_COMPRESSION_LEVEL] = 1;
+    }
+
+    /* optional cloud optimized GeoTIFF - default is a plain GeoTIFF.  A
+       cloud optimized GeoTIFF is always tiled. */
+    if ( !P->ParamsPresent[OUTPUT_COG] )
+    {
+        P->output_cog = FALSE;
+        P->ParamsPresent[OUTPUT_COG] = 1;
+    }
+    if ( P->output_cog && P->output_tile_size == 0 )
+        P->output_tile_size = DEFAULT_TILE_SIZE;
+
     /* check that all fields are present */
     for ( iparam = INPUT_FILENAME; iparam < NSTRINGS; iparam++ )
     {
@@ -1326,7 +1480,10 @@ int CheckOutputFieldsHDF2RB
            used in the HDF2RB conversion */
         if (iparam == SPATIAL_SUBSET_TYPE || iparam == RESAMPLING_TYPE ||
             iparam == OUTPUT_PROJ_TYPE || iparam == OUTPUT_PROJ_PARMS ||
-            iparam == PIXEL_SIZE || iparam == UTM_ZONE || iparam == DATUM)
+            iparam == PIXEL_SIZE || iparam == UTM_ZONE || iparam == DATUM ||
+            iparam == APPROX_MAX_ERROR || iparam == NUM_THREADS ||
+            iparam == OUTPUT_TILE_SIZE || iparam == OUTPUT_COMPRESSION ||
+            iparam == OUTPUT_COG || iparam == OUTPUT_COMPRESSION_LEVEL)
             continue;
 
         if ( !P->ParamsPresent[iparam] )
@@ -2544,3 +2701,316 @@ int GetOutputDatum
     /* return number of characters parsed */
     return n;
 }
+
+/******************************************************************************
+
+MODULE:  GetApproxMaxError
+
+PURPOSE:  Read the maximum error allowed for the approximate output to input
+          pixel mapping from a parameter file
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+n               Number of characters parsed
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+  
+NOTES:
+  The error is specified in input pixels.  A value of 0.0 projects every
+  output pixel exactly.
+
+******************************************************************************/
+int GetApproxMaxError
+(
+    char *str,
+    ModisDescriptor *P
+)
+
+{
+    int n;
+    double max_error;
+    char s[LINE_BUFSIZ];
+
+    /* scan the max error field */
+    if ( sscanf( str, " = %lf%n", &max_error, &n ) < 1 )
+    {
+        sprintf( s, "Incorrect APPROX_MAX_ERROR field (bad or missing "
+                    "value).\n" );
+        ErrorHandler( TRUE, "ReadParameterFile", ERROR_APPROXERR_FIELD, s );
+        return ERROR_APPROXERR_FIELD;
+    }
+
+    if ( max_error < 0.0 )
+    {
+        sprintf( s, "Incorrect APPROX_MAX_ERROR field (value must be greater "
+                    "than or equal to 0.0).\n" );
+        ErrorHandler( TRUE, "ReadParameterFile", ERROR_APPROXERR_VALUE, s );
+        return ERROR_APPROXERR_VALUE;
+    }
+    P->approx_max_error = max_error;
+
+    /* return value is number of characters parsed */
+    return n;
+}
+
+/******************************************************************************
+
+MODULE:  GetNumThreads
+
+PURPOSE:  Read the number of resampling threads from a parameter file
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+n               Number of characters parsed
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+  
+NOTES:
+  A value of 0 uses one thread per online processor.  The field is still
+  parsed (and checked) if the -threads switch was used.
+
+******************************************************************************/
+int GetNumThreads
+(
+    char *str,
+    ModisDescriptor *P
+)
+
+{
+    int n;
+    int nthreads;
+    char s[LINE_BUFSIZ];
+
+    /* scan the number of threads field */
+    if ( sscanf( str, " = %d%n", &nthreads, &n ) < 1 || nthreads < 0 )
+    {
+        sprintf( s, "Incorrect NUM_THREADS field (value must be 0 or "
+                    "greater).\n" );
+        ErrorHandler( TRUE, "ReadParameterFile", ERROR_THREADS_FIELD, s );
+        return ERROR_THREADS_FIELD;
+    }
+
+    /* the -threads command-line switch overrides the parameter file */
+    if ( !P->nswitch )
+        P->nthreads = nthreads;
+
+    /* return value is number of characters parsed */
+    return n;
+}
+
+/******************************************************************************
+
+MODULE:  GetOutputTileSize
+
+PURPOSE:  Read the GeoTIFF or HDF-EOS output tile size from a parameter
+          file
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+n               Number of characters parsed
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+  
+NOTES:
+  The tiles are square.  A value of 0 writes strips instead of tiles (an
+  untiled field for HDF-EOS output, unless it is compressed).  The TIFF
+  specification requires tile sizes to be a multiple of 16.
+
+******************************************************************************/
+int GetOutputTileSize
+(
+    char *str,
+    ModisDescriptor *P
+)
+
+{
+    int n;
+    int tile_size;
+    char s[LINE_BUFSIZ];
+
+    /* scan the tile size field */
+    if ( sscanf( str, " = %d%n", &tile_size, &n ) < 1 || tile_size < 0 ||
+         tile_size % 16 != 0 )
+    {
+        sprintf( s, "Incorrect OUTPUT_TILE_SIZE field (value must be 0 or "
+                    "a multiple of 16).\n" );
+        ErrorHandler( TRUE, "ReadParameterFile", ERROR_TILESIZE_FIELD, s );
+        return ERROR_TILESIZE_FIELD;
+    }
+    P->output_tile_size = tile_size;
+
+    /* return value is number of characters parsed */
+    return n;
+}
+
+/******************************************************************************
+
+MODULE:  GetOutputCompression
+
+PURPOSE:  Read the GeoTIFF or HDF-EOS output compression from a parameter
+          file
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+n               Number of characters parsed
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+  
+NOTES:
+  Valid values are NONE, DEFLATE and LZW.
+
+******************************************************************************/
+int GetOutputCompression
+(
+    char *str,
+    ModisDescriptor *P
+)
+
+{
+    int n;
+    char compression[LINE_BUFSIZ];
+    char s[LINE_BUFSIZ];
+
+    /* scan the compression field */
+    if ( sscanf( str, " = %s%n", compression, &n ) < 1 )
+    {
+        sprintf( s, "Incorrect OUTPUT_COMPRESSION field (bad or missing "
+                    "value).\n" );
+        ErrorHandler( TRUE, "ReadParameterFile", ERROR_COMPRESSION_FIELD, s );
+        return ERROR_COMPRESSION_FIELD;
+    }
+
+    if ( strcasecmp( compression, "NONE" ) == 0 )
+        P->output_compression = COMPRESS_NONE;
+    else if ( strcasecmp( compression, "DEFLATE" ) == 0 )
+        P->output_compression = COMPRESS_DEFLATE;
+    else if ( strcasecmp( compression, "LZW" ) == 0 )
+        P->output_compression = COMPRESS_LZW;
+    else
+    {
+        sprintf( s, "Incorrect OUTPUT_COMPRESSION field (value must be "
+                    "NONE, DEFLATE or LZW).\n" );
+        ErrorHandler( TRUE, "ReadParameterFile", ERROR_COMPRESSION_FIELD, s );
+        return ERROR_COMPRESSION_FIELD;
+    }
+
+    /* return value is number of characters parsed */
+    return n;
+}
+
+/******************************************************************************
+
+MODULE:  GetOutputCOG
+
+PURPOSE:  Read whether a cloud optimized GeoTIFF is written from a parameter
+          file
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+n               Number of characters parsed
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+  
+NOTES:
+  Valid values are YES and NO.
+
+******************************************************************************/
+int GetOutputCOG
+(
+    char *str,
+    ModisDescriptor *P
+)
+
+{
+    int n;
+    char cog[LINE_BUFSIZ];
+    char s[LINE_BUFSIZ];
+
+    /* scan the cloud optimized GeoTIFF field */
+    if ( sscanf( str, " = %s%n", cog, &n ) < 1 ||
+         ( strcasecmp( cog, "YES" ) != 0 && strcasecmp( cog, "NO" ) != 0 ) )
+    {
+        sprintf( s, "Incorrect OUTPUT_COG field (value must be YES or "
+                    "NO).\n" );
+        ErrorHandler( TRUE, "ReadParameterFile", ERROR_COG_FIELD, s );
+        return ERROR_COG_FIELD;
+    }
+    P->output_cog = ( strcasecmp( cog, "YES" ) == 0 );
+
+    /* return value is number of characters parsed */
+    return n;
+}
+
+/******************************************************************************
+
+MODULE:  GetOutputCompressionLevel
+
+PURPOSE:  Read the deflate compression level from a parameter file
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+n               Number of characters parsed
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+  
+NOTES:
+  Valid values are 1 (fastest) to 9 (smallest).  The level is only used
+  with OUTPUT_COMPRESSION = DEFLATE.
+
+******************************************************************************/
+int GetOutputCompressionLevel
+(
+    char *str,
+    ModisDescriptor *P
+)
+
+{
+    int n;
+    int level;
+    char s[LINE_BUFSIZ];
+
+    /* scan the compression level field */
+    if ( sscanf( str, " = %d%n", &level, &n ) < 1 || level < 1 ||
+         level > 9 )
+    {
+        sprintf( s, "Incorrect OUTPUT_COMPRESSION_LEVEL field (value must "
+                    "be 1 to 9).\n" );
+        ErrorHandler( TRUE, "ReadParameterFile",
+            ERROR_COMPRESSION_LEVEL_FIELD, s );
+        return ERROR_COMPRESSION_LEVEL_FIELD;
+    }
+    P->output_compression_level = level;
+
+    /* return value is number of characters parsed */
+    return n;
+}
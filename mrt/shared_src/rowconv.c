@@ -0,0 +1,421 @@
+
+/******************************************************************************
+
+FILE:  rowconv.c
+
+PURPOSE:  Convert rows of data between the file data types and double
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development (from ReadRow and
+                                       WriteRow)
+
+HARDWARE AND/OR SOFTWARE LIMITATIONS:
+  None
+
+PROJECT:    MODIS Reprojection Tool
+
+NOTES:
+  1. There is one read (widening) and one write (round and saturate) kernel
+     for each data type.  SelectRowConverters picks the pair for a file
+     descriptor, so ReadRow and WriteRow don't switch on the data type for
+     every row.
+  2. The kernels are written without branches or function calls in the loop
+     bodies (the rounding and clipping are done with conditional
+     expressions), so the compiler vectorizes them with whatever SIMD
+     instructions the target has, and they still compile anywhere as plain
+     scalar loops.
+  3. The results are the same as the original conversions in ReadRow and
+     WriteRow: values are rounded half away from zero, then clipped to the
+     range of the output type.  As before, unsigned 32-bit output is clipped
+     to MRT_INT32_MAX and 32-bit float output is clipped to zero and
+     MRT_FLOAT4_MAX.
+
+******************************************************************************/
+#include "mrt_dtype.h"
+#include "shared_resample.h"
+#include <float.h>
+
+/* round half away from zero, the same as WriteRow has always done.  Only
+   the constant is selected, so there is no conditional arithmetic to keep
+   the loop from being vectorized (v - 0.5 and v + -0.5 are identical). */
+#define ROUND_HALF(v) ( ( v ) + ( ( v ) < 0.0 ? -0.5 : 0.5 ) )
+
+/* number of values clipped at a time before converting them to float */
+#define CONVERT_BLOCK 256
+
+/* clip a value to [lo, hi] */
+#define CLIP(v, lo, hi) \
+    ( ( v ) < ( lo ) ? ( lo ) : ( ( v ) > ( hi ) ? ( hi ) : ( v ) ) )
+
+/******************************************************************************
+
+MODULE:  Int8ToDouble, UInt8ToDouble, Int16ToDouble, UInt16ToDouble,
+         Int32ToDouble, UInt32ToDouble, Float32ToDouble
+
+PURPOSE:  Widen a row of native data to double
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development (from ReadRow)
+
+NOTES:
+
+******************************************************************************/
+static void Int8ToDouble
+(
+    void *in,                   /* I:  native row */
+    double *out,                /* O:  converted row */
+    size_t n                    /* I:  number of pixels */
+)
+
+{
+    MRT_INT8_PTR ptr = ( MRT_INT8_PTR ) in;
+    size_t i;
+
+    for ( i = 0; i < n; i++ )
+        out[i] = ( double ) ptr[i];
+}
+
+static void UInt8ToDouble
+(
+    void *in,                   /* I:  native row */
+    double *out,                /* O:  converted row */
+    size_t n                    /* I:  number of pixels */
+)
+
+{
+    MRT_UINT8_PTR ptr = ( MRT_UINT8_PTR ) in;
+    size_t i;
+
+    for ( i = 0; i < n; i++ )
+        out[i] = ( double ) ptr[i];
+}
+
+static void Int16ToDouble
+(
+    void *in,                   /* I:  native row */
+    double *out,                /* O:  converted row */
+    size_t n                    /* I:  number of pixels */
+)
+
+{
+    MRT_INT16_PTR ptr = ( MRT_INT16_PTR ) in;
+    size_t i;
+
+    for ( i = 0; i < n; i++ )
+        out[i] = ( double ) ptr[i];
+}
+
+static void UInt16ToDouble
+(
+    void *in,                   /* I:  native row */
+    double *out,                /* O:  converted row */
+    size_t n                    /* I:  number of pixels */
+)
+
+{
+    MRT_UINT16_PTR ptr = ( MRT_UINT16_PTR ) in;
+    size_t i;
+
+    for ( i = 0; i < n; i++ )
+        out[i] = ( double ) ptr[i];
+}
+
+static void Int32ToDouble
+(
+    void *in,                   /* I:  native row */
+    double *out,                /* O:  converted row */
+    size_t n                    /* I:  number of pixels */
+)
+
+{
+    MRT_INT32_PTR ptr = ( MRT_INT32_PTR ) in;
+    size_t i;
+
+    for ( i = 0; i < n; i++ )
+        out[i] = ( double ) ptr[i];
+}
+
+static void UInt32ToDouble
+(
+    void *in,                   /* I:  native row */
+    double *out,                /* O:  converted row */
+    size_t n                    /* I:  number of pixels */
+)
+
+{
+    MRT_UINT32_PTR ptr = ( MRT_UINT32_PTR ) in;
+    size_t i;
+
+    for ( i = 0; i < n; i++ )
+        out[i] = ( double ) ptr[i];
+}
+
+static void Float32ToDouble
+(
+    void *in,                   /* I:  native row */
+    double *out,                /* O:  converted row */
+    size_t n                    /* I:  number of pixels */
+)
+
+{
+    MRT_FLOAT4_PTR ptr = ( MRT_FLOAT4_PTR ) in;
+    size_t i;
+
+    for ( i = 0; i < n; i++ )
+        out[i] = ( double ) ptr[i];
+}
+
+/******************************************************************************
+
+MODULE:  DoubleToInt8, DoubleToUInt8, DoubleToInt16, DoubleToUInt16,
+         DoubleToInt32, DoubleToUInt32, DoubleToFloat32
+
+PURPOSE:  Round and clip a row of doubles to the native data type
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development (from WriteRow)
+
+NOTES:
+  The integer types below 32 bits are converted through int, which gives the
+  same value for the clipped range and lets the conversion be vectorized.
+  The float conversion is done as a separate pass over each block of clipped
+  values, since the compiler won't vectorize a narrowing conversion of a
+  conditionally selected value.
+
+******************************************************************************/
+static void DoubleToInt8
+(
+    double *in,                 /* I:  row of doubles */
+    void *out,                  /* O:  native row */
+    size_t n                    /* I:  number of pixels */
+)
+
+{
+    MRT_INT8_PTR ptr = ( MRT_INT8_PTR ) out;
+    size_t i;
+    double v;
+
+    for ( i = 0; i < n; i++ )
+    {
+        v = ROUND_HALF( in[i] );
+        v = CLIP( v, MRT_INT8_MIN, MRT_INT8_MAX );
+        ptr[i] = ( MRT_INT8 ) ( int ) v;
+    }
+}
+
+static void DoubleToUInt8
+(
+    double *in,                 /* I:  row of doubles */
+    void *out,                  /* O:  native row */
+    size_t n                    /* I:  number of pixels */
+)
+
+{
+    MRT_UINT8_PTR ptr = ( MRT_UINT8_PTR ) out;
+    size_t i;
+    double v;
+
+    for ( i = 0; i < n; i++ )
+    {
+        v = ROUND_HALF( in[i] );
+        v = CLIP( v, 0.0, MRT_UINT8_MAX );
+        ptr[i] = ( MRT_UINT8 ) ( int ) v;
+    }
+}
+
+static void DoubleToInt16
+(
+    double *in,                 /* I:  row of doubles */
+    void *out,                  /* O:  native row */
+    size_t n                    /* I:  number of pixels */
+)
+
+{
+    MRT_INT16_PTR ptr = ( MRT_INT16_PTR ) out;
+    size_t i;
+    double v;
+
+    for ( i = 0; i < n; i++ )
+    {
+        v = ROUND_HALF( in[i] );
+        v = CLIP( v, MRT_INT16_MIN, MRT_INT16_MAX );
+        ptr[i] = ( MRT_INT16 ) ( int ) v;
+    }
+}
+
+static void DoubleToUInt16
+(
+    double *in,                 /* I:  row of doubles */
+    void *out,                  /* O:  native row */
+    size_t n                    /* I:  number of pixels */
+)
+
+{
+    MRT_UINT16_PTR ptr = ( MRT_UINT16_PTR ) out;
+    size_t i;
+    double v;
+
+    for ( i = 0; i < n; i++ )
+    {
+        v = ROUND_HALF( in[i] );
+        v = CLIP( v, 0.0, MRT_UINT16_MAX );
+        ptr[i] = ( MRT_UINT16 ) ( int ) v;
+    }
+}
+
+static void DoubleToInt32
+(
+    double *in,                 /* I:  row of doubles */
+    void *out,                  /* O:  native row */
+    size_t n                    /* I:  number of pixels */
+)
+
+{
+    MRT_INT32_PTR ptr = ( MRT_INT32_PTR ) out;
+    size_t i;
+    double v;
+
+    for ( i = 0; i < n; i++ )
+    {
+        v = ROUND_HALF( in[i] );
+        v = CLIP( v, MRT_INT32_MIN, MRT_INT32_MAX );
+        ptr[i] = ( MRT_INT32 ) v;
+    }
+}
+
+static void DoubleToUInt32
+(
+    double *in,                 /* I:  row of doubles */
+    void *out,                  /* O:  native row */
+    size_t n                    /* I:  number of pixels */
+)
+
+{
+    MRT_UINT32_PTR ptr = ( MRT_UINT32_PTR ) out;
+    size_t i;
+    double v;
+
+    for ( i = 0; i < n; i++ )
+    {
+        v = ROUND_HALF( in[i] );
+        v = CLIP( v, 0.0, MRT_INT32_MAX );
+        ptr[i] = ( MRT_INT32 ) v;
+    }
+}
+
+static void DoubleToFloat32
+(
+    double *in,                 /* I:  row of doubles */
+    void *out,                  /* O:  native row */
+    size_t n                    /* I:  number of pixels */
+)
+
+{
+    MRT_FLOAT4_PTR ptr = ( MRT_FLOAT4_PTR ) out;
+    double clipped[CONVERT_BLOCK]; /* clipped values for one block */
+    size_t i, j, nblock;
+    double v;
+
+    for ( j = 0; j < n; j += nblock )
+    {
+        nblock = ( n - j < CONVERT_BLOCK ) ? n - j : CONVERT_BLOCK;
+        for ( i = 0; i < nblock; i++ )
+        {
+            v = in[j + i];
+            v = CLIP( v, 0.0, MRT_FLOAT4_MAX );
+            clipped[i] = v;
+        }
+        for ( i = 0; i < nblock; i++ )
+            ptr[j + i] = ( MRT_FLOAT4 ) clipped[i];
+    }
+}
+
+/******************************************************************************
+
+MODULE:  SelectRowConverters
+
+PURPOSE:  Pick the row conversion kernels for the data type of a file
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            Success
+FALSE           The data type isn't supported
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  ReadRow and WriteRow call this whenever file->datatype differs from the
+  data type the kernels were picked for, which is the first time a
+  descriptor is used and if its data type is changed afterwards.
+
+******************************************************************************/
+int SelectRowConverters
+(
+    FileDescriptor *file	/* I/O:  file descriptor */
+)
+
+{
+    file->read_convert = NULL;
+    file->write_convert = NULL;
+    file->convert_datatype = file->datatype;
+
+    switch ( file->datatype )
+    {
+	case DFNT_INT8:
+	    file->read_convert = Int8ToDouble;
+	    file->write_convert = DoubleToInt8;
+	    break;
+
+	case DFNT_UINT8:
+	    file->read_convert = UInt8ToDouble;
+	    file->write_convert = DoubleToUInt8;
+	    break;
+
+	case DFNT_INT16:
+	    file->read_convert = Int16ToDouble;
+	    file->write_convert = DoubleToInt16;
+	    break;
+
+	case DFNT_UINT16:
+	    file->read_convert = UInt16ToDouble;
+	    file->write_convert = DoubleToUInt16;
+	    break;
+
+	case DFNT_INT32:
+	    file->read_convert = Int32ToDouble;
+	    file->write_convert = DoubleToInt32;
+	    break;
+
+	case DFNT_UINT32:
+	    file->read_convert = UInt32ToDouble;
+	    file->write_convert = DoubleToUInt32;
+	    break;
+
+	case DFNT_FLOAT32:
+	    file->read_convert = Float32ToDouble;
+	    file->write_convert = DoubleToFloat32;
+	    break;
+
+	default:
+	    return ( FALSE );
+    }
+
+    return ( TRUE );
+}
@@ -0,0 +1,186 @@
+/******************************************************************************
+
+FILE:  shapefile.h
+
+PURPOSE:  Type definitions, const values and prototypes for reading ESRI
+          shapefiles
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+         10/26                         Added the shape index
+
+HARDWARE AND/OR SOFTWARE LIMITATIONS:
+    Only polygon shapes are read.
+
+PROJECT:    MODIS Reprojection Tool
+
+NOTES:
+  A shapefile is three files with the same base name: the shapes (.shp),
+  the offset of each shape in the .shp (.shx), and a dBASE table with the
+  attributes of each shape (.dbf).  See shp_io.c.
+
+  The shape index (.idx, shp_index.c) is kept next to them: a hash of the
+  shapes on an attribute, and a packed R-tree of their bounding boxes.
+
+******************************************************************************/
+
+#ifndef _SHAPEFILE_H_
+#define _SHAPEFILE_H_
+
+#include <stdio.h>
+#include "shared_resample.h"
+
+/* polygon shape types (plain, with Z and with M values) */
+#define SHP_POLYGON   5
+#define SHP_POLYGONZ 15
+#define SHP_POLYGONM 25
+
+/* sizes of the fixed parts of the files */
+#define SHP_HEADER_SIZE 100	/* .shp and .shx file header */
+#define SHP_RECORD_HEADER_SIZE 8  /* record number and length in the .shp */
+#define DBF_HEADER_SIZE 32	/* .dbf file header and field descriptor */
+
+/* longest .dbf field name (and the 0 after it) */
+#define DBF_FIELD_NAME_SIZE 11
+
+/* extension of the shape index, and children of each node of its tree */
+#define SHP_INDEX_EXT ".idx"
+#define SHP_INDEX_NODE_SIZE 16
+
+/* a field (column) of the .dbf attribute table */
+typedef struct
+{
+    char name[DBF_FIELD_NAME_SIZE + 1];
+    char type;			/* C(haracter), N(umeric), etc. */
+    int offset;			/* offset of the field in a record */
+    int length;			/* bytes in the field */
+}
+ShapeField;
+
+/* an open shapefile */
+typedef struct
+{
+    char base[LARGE_STRING];	/* file name without the extension */
+    FILE *shp;			/* shapes */
+    FILE *dbf;			/* attributes */
+    int shape_type;		/* type of all the shapes */
+    double bounds[4];		/* xmin, ymin, xmax, ymax of all the shapes */
+    int nrecords;		/* number of shapes */
+    long *offsets;		/* offset of each shape in the .shp (from the
+				   .shx) */
+    long *lengths;		/* bytes in each shape */
+    int nfields;		/* number of attributes of each shape */
+    ShapeField *fields;		/* the attributes */
+    long dbf_header_size;	/* bytes before the first .dbf record */
+    long dbf_record_size;	/* bytes in each .dbf record */
+    unsigned char *buffer;	/* a shape or a .dbf record */
+    size_t buffer_size;
+}
+ShapeFile;
+
+/* a polygon shape: one or more rings (outer boundaries and holes) of
+   points.  Each ring ends with its first point. */
+typedef struct
+{
+    double bounds[4];		/* xmin, ymin, xmax, ymax */
+    int nparts;			/* number of rings */
+    int npoints;		/* number of points in all the rings */
+    int *parts;			/* index of the first point of each ring */
+    double *x, *y;		/* the points */
+}
+ShapePolygon;
+
+/* a shape index: the shapes by an attribute (the key), and by where they
+   are.  The tree's leaves and nodes are in boxes level by level, leaves
+   first and the root last. */
+typedef struct
+{
+    char field[DBF_FIELD_NAME_SIZE + 1];  /* attribute the shapes are
+					     keyed on */
+    int nrecords;		/* number of shapes */
+    int key_size;		/* bytes for each key (and the 0 after it) */
+    char *keys;			/* key of each shape */
+    int hash_size;		/* slots in the hash table (a power of 2) */
+    int *hash;			/* shape in each slot, or -1 */
+    int node_size;		/* children of each node */
+    int nlevels;		/* levels of the tree */
+    int *level_end;		/* end of each level in boxes */
+    int nleaves;		/* shapes in the tree (null shapes aren't) */
+    int *leaf_records;		/* shape of each leaf */
+    int nboxes;			/* leaves and nodes */
+    double *boxes;		/* xmin, ymin, xmax, ymax of each */
+}
+ShapeIndex;
+
+/* Prototypes */
+ShapeFile *OpenShapeFile
+(
+    char *filename		/* I:  .shp file, or its base name */
+);
+
+void CloseShapeFile
+(
+    ShapeFile *shape		/* I:  shapefile to close */
+);
+
+int FindShapeField
+(
+    ShapeFile *shape,		/* I:  shapefile */
+    char *name			/* I:  name of the field */
+);
+
+int ReadShapeAttribute
+(
+    ShapeFile *shape,		/* I:  shapefile */
+    int record,			/* I:  shape number */
+    int field,			/* I:  field number (FindShapeField) */
+    char *value,		/* O:  value of the field, without padding */
+    int maxlen			/* I:  size of value */
+);
+
+ShapePolygon *ReadShapePolygon
+(
+    ShapeFile *shape,		/* I:  shapefile */
+    int record			/* I:  shape number */
+);
+
+void FreeShapePolygon
+(
+    ShapePolygon *polygon	/* I:  polygon to free */
+);
+
+int ReadShapeBounds
+(
+    ShapeFile *shape,		/* I:  shapefile */
+    int record,			/* I:  shape number */
+    double bounds[4]		/* O:  xmin, ymin, xmax, ymax */
+);
+
+ShapeIndex *OpenShapeIndex
+(
+    ShapeFile *shape,		/* I:  shapefile */
+    char *field			/* I:  attribute to key the shapes on */
+);
+
+void CloseShapeIndex
+(
+    ShapeIndex *index		/* I:  index to free */
+);
+
+int FindShapeRecord
+(
+    ShapeIndex *index,		/* I:  shape index */
+    char *key			/* I:  value of the attribute */
+);
+
+int SearchShapeIndex
+(
+    ShapeIndex *index,		/* I:  shape index */
+    double bounds[4],		/* I:  xmin, ymin, xmax, ymax to search */
+    int *records		/* O:  shapes whose bounding boxes meet bounds
+				       (room for index->nleaves) */
+);
+
+#endif /* _SHAPEFILE_H_ */
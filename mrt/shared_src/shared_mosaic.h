@@ -8,6 +8,9 @@ HISTORY:
 Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          05/00  Gail Schmidt
+         10/26                         Added the HDF-EOS output layout
+         10/26                         Added the first line of each band of
+                                       a mosaic cut to regions
 
 HARDWARE AND/OR SOFTWARE LIMITATIONS:  
     __DJGPP__ is included for DOS
@@ -100,6 +103,16 @@ typedef struct
 
     /* projection info structures for Geolib */
     ProjInfo *projection_info;
+
+    /* HDF-EOS output layout (mosaic only): square tile size in pixels (0 =
+       an untiled field), compression and deflate level (1-9) */
+    int output_tile_size;
+    CompressionType output_compression;
+    int output_compression_level;
+
+    /* line of the whole tile mosaic each band starts at, when the mosaic
+       is cut to the lines of its regions (mosaic only, 0 otherwise) */
+    int first_line[MAXBANDS];
 }
 MosaicDescriptor;
 
@@ -15,6 +15,24 @@ Version  Date   Programmer       Code  Reason
          04/02  Gail Schmidt           Changed data pointers from floats to
                                        doubles
          11/05  Gail Schmidt           Added #defines for HDF2RB
+         10/26                         Added the number of threads and the
+                                       FileDescriptor read lock
+         10/26                         Replaced the read buffer queue with
+                                       the native data type read cache
+         10/26                         Added the memory mapping of raw
+                                       binary input files
+         10/26                         Added the FileDescriptor row
+                                       conversion kernels
+         10/26                         Added the HdfEosFD grid ids kept
+                                       attached by the mosaic tool
+         10/26                         Added the virtual mosaic input file
+                                       type (VirtualMosaicFD)
+         10/26                         Added the HDF-EOS tile-row buffer and
+                                       the output compression level
+         10/26                         Added the HDF-EOS input block buffer
+         10/26                         Added the batch job argument limit
+         10/26                         Added the zonal statistics tables and
+                                       the FileDescriptor zonal band
 
 HARDWARE AND/OR SOFTWARE LIMITATIONS:  
     __DJGPP__ is included for DOS
@@ -41,6 +59,9 @@ NOTES:
 #define HDF2RB_NAME    "HDF to Raw Binary Tool"
 #define HDF2RB_VERSION "v4.1 March 2009"
 
+#define CROP_NAME    "MODIS Crop Tool"
+#define CROP_VERSION "v4.1 October 2026"
+
 /* character string lengths */
 #define SMALL_STRING		256
 #define LARGE_STRING		1024
@@ -66,7 +87,13 @@ NOTES:
 #define MAX_MESSAGE_LENGTH 1024
 #define EMPTY_VALUE 0.0f
 #define MAX_BUFFER_SIZE 33554432	/* 32 MB */
+#define CACHE_STRIP_ROWS 8		/* input rows in each read cache strip */
+#define HDF_BLOCK_ROWS 32		/* input rows read at once from an
+					   untiled HDF-EOS field */
+#define MAX_HDF_BLOCK_SIZE 8388608	/* 8 MB, most memory for the rows read
+					   at once from an HDF-EOS field */
 #define NUM_PROJECTION_PARAMS 15
+#define MAX_BATCH_ARGS 64		/* most arguments of a batch job */
 
 /* Cubic resampler constants */
 /* subpixel steps to include in the kernel weights */
@@ -143,7 +170,7 @@ FileOpenType;
 /* type of in/out file */
 typedef enum
 {
-    BAD_FILE_TYPE, RAW_BINARY, HDFEOS, GEOTIFF
+    BAD_FILE_TYPE, RAW_BINARY, HDFEOS, GEOTIFF, VIRTUAL_MOSAIC
 }
 FileType;
 
@@ -177,7 +204,9 @@ typedef enum
 {
     INPUT_FILENAME, SPECTRAL_SUBSET, SPATIAL_SUBSET_TYPE, SPATIAL_SUBSET_UL,
     SPATIAL_SUBSET_LR, OUTPUT_FILENAME, RESAMPLING_TYPE, OUTPUT_PROJ_TYPE,
-    OUTPUT_PROJ_PARMS, PIXEL_SIZE, UTM_ZONE, DATUM, NSTRINGS
+    OUTPUT_PROJ_PARMS, PIXEL_SIZE, UTM_ZONE, DATUM, APPROX_MAX_ERROR,
+    NUM_THREADS, OUTPUT_TILE_SIZE, OUTPUT_COMPRESSION, OUTPUT_COG,
+    OUTPUT_COMPRESSION_LEVEL, NSTRINGS
 }
 ParamType;
 
@@ -216,6 +245,13 @@ typedef enum
 }
 ResamplingType;
 
+/* compression of the output image */
+typedef enum
+{
+    COMPRESS_NONE, COMPRESS_DEFLATE, COMPRESS_LZW
+}
+CompressionType;
+
 
 /* image corner array positions (double array[??][2] */
 typedef enum
@@ -234,27 +270,38 @@ typedef enum
 SpatialSubsetType;
 
 
-/* read buffer queue element definition */
-typedef struct QueueType_tag
+/* read cache strip definition: a fixed-size slab of CACHE_STRIP_ROWS
+   input rows kept in the file's native data type */
+typedef struct CacheStripType_tag
 {
-    struct QueueType_tag *next, *prev;  /* a doubly linked list */
-    size_t row;                         /* row number, faster lookup at the
-                                           top */
-    double *data;                       /* data buffer */
+    struct CacheStripType_tag *next, *prev;  /* a doubly linked LRU list */
+    size_t strip;                       /* strip number in the file
+                                           ((size_t)-1 => unused) */
+    void *data;                         /* the strip's rows, one after
+                                           the other (either slab or the
+                                           input file's memory mapping) */
+    void *slab;                         /* the strip's own memory */
+    int row_ok[CACHE_STRIP_ROWS];       /* was each row read successfully */
 }
-QueueType;
+CacheStripType;
 
 
-/* read buffer queue definition (queue header) */
-typedef struct QueueHdrType_tag
+/* read cache definition */
+typedef struct ReadCacheType_tag
 {
-    QueueType *first, *last;  /* first and last elements */
-    int numbuffers;           /* number of buffers in this queue */
-    QueueType **in_cache;     /* pointers to elements,
-                               * one for each row in the input file
-                               * NULL => row_is_not_in_memory */
+    CacheStripType *first, *last;  /* most and least recently used strips */
+    CacheStripType *strips;        /* all the strips (one allocation) */
+    void *data;                    /* rows for all the strips (one
+                                      allocation) */
+    size_t numstrips;              /* number of strips in the cache */
+    size_t rowsize;                /* number of bytes in a native row */
+    CacheStripType **in_cache;     /* pointers to strips,
+                                    * one for each strip in the input file
+                                    * NULL => strip_is_not_in_memory */
+    double lookups;                /* number of pixels looked up */
+    double misses;                 /* number of strips read from the file */
 }
-QueueHdrType;
+ReadCacheType;
 
 
 /* describes the input/output file (band) */
@@ -269,7 +316,7 @@ typedef struct FileDescriptor_tag
     int datasize;                /* sizeof( float, int, or char ) */
     void *fileptr;               /* HdfEosFD, GeoTIFFFD, or FILE* */
     void *rowbuffer;             /* read/write buffer */
-    QueueHdrType queuetop;       /* read buffer
+    ReadCacheType cache;         /* read cache
                                     (fileopentype == FILE_READ_MODE) */
     size_t nrows, ncols;         /* physical dimensions */
     double coord_corners[4][2];  /* projection corner coordinates */
@@ -278,10 +325,69 @@ typedef struct FileDescriptor_tag
                                     coordinates */
     double background_fill;      /* background fill value */
     int bandnum;                 /* current band to read/write */
+    void ( *read_lock )( int );  /* called with TRUE before and FALSE after
+                                    ReadRow when the file is shared between
+                                    threads, otherwise NULL */
+    void *map;                   /* raw binary input file mapped into
+                                    memory, or NULL if it isn't mapped */
+    size_t mapsize;              /* size of the mapping in bytes */
+    int convert_datatype;        /* datatype the conversion kernels were
+                                    picked for (0 before the first row) */
+    void ( *read_convert )( void *, double *, size_t );
+                                 /* widen a native row to double */
+    void ( *write_convert )( double *, void *, size_t );
+                                 /* round and clip doubles to a native row */
+    struct ZonalBandType_tag *zonal;
+                                 /* zonal statistics gathered from the rows
+                                    written, or NULL (see zonal.c) */
 }
 FileDescriptor;
 
 
+/* statistics of the valid pixels of a band in one zone (e.g. a county) */
+typedef struct
+{
+    size_t count;                /* number of valid pixels */
+    double sum, sumsq;           /* sum and sum of squares of their values */
+    double min, max;             /* smallest and largest value */
+    size_t *hist;                /* pixels in each histogram bin (NULL when
+                                    there's no histogram) */
+}
+ZonalStats;
+
+/* statistics of one band in each zone of a ZonalTable */
+typedef struct ZonalBandType_tag
+{
+    struct ZonalTableType_tag *table;  /* the zones */
+    char *name;                  /* band name */
+    double fill;                 /* background fill (not counted) */
+    double min_value, max_value; /* valid range (ignored if max_value <=
+                                    min_value), also the histogram range */
+    ZonalStats *stats;           /* statistics in each zone */
+    int checked;                 /* was the written grid checked against the
+                                    label raster? */
+    double *values;              /* a written native row widened to double */
+    struct ZonalBandType_tag *next;  /* next band of the table */
+}
+ZonalBand;
+
+/* the zones, and the statistics of each band in them */
+typedef struct ZonalTableType_tag
+{
+    int nzones;                  /* number of zones */
+    char **codes;                /* code of each zone, which names its rows
+                                    of the table */
+    int nbins;                   /* histogram bins (0 = no histogram) */
+    long *labels;                /* value of each zone in the label raster,
+                                    ascending (NULL without one) */
+    FileDescriptor *label_file;  /* the label raster, or NULL */
+    long label_proj_code;        /* projection of the label raster */
+    double *label_row;           /* a row of the label raster */
+    ZonalBand *bands, *last_band;  /* the bands, in the order added */
+}
+ZonalTable;
+
+
 /* tag for an HDF-EOS file descriptor in the FileDescriptor fileptr field */
 typedef struct
 {
@@ -298,16 +404,86 @@ typedef struct
     int pos[4];			/* position of YDim, XDim, 3rdDim, 4thDim in
                                    dimension list */
     int dim3, dim4;		/* current slice and cube */
+    int *grid_ids;		/* id of each grid in gridlist, kept attached
+                                   by GetHdfEosFieldMosaic (-1 if not yet
+                                   attached; NULL if none are kept) */
+    int tile_rows;		/* rows in a tile of the current output
+                                   field (0 = the field isn't tiled) */
+    void *tilerows;		/* output rows buffered until a whole row of
+                                   tiles is in */
+    int block_rows;		/* input rows read at once from the current
+                                   field (0 = not yet picked) */
+    int block_start;		/* first row in the block (-1 = empty) */
+    int block_nrows;		/* rows in the block */
+    void *block;		/* input rows read at once */
 }
 HdfEosFD;
 
 
-/* tag for a GeoTIFF file descriptor in the FileDescriptor fileptr field */
+/* most tiles of a virtual mosaic kept open at once (HDF allows MAX_FILE
+   (32) open files, including an HDF-EOS output file) */
+#define MAX_OPEN_VIRTUAL_TILES 24
+
+/* tag for a virtual mosaic file descriptor in the FileDescriptor fileptr
+   field: one band of the tiles listed in a virtual mosaic header, read as
+   one image (see vm_oc.c) */
+typedef struct
+{
+    int numh_tiles, numv_tiles;  /* number of horiz and vert tiles */
+    size_t tile_nrows, tile_ncols;  /* size of each tile */
+    char **tile_filenames;      /* file of each tile, numv_tiles rows of
+                                   numh_tiles (NULL for a missing tile) */
+    FileDescriptor **tiles;     /* the band of each tile (NULL if it isn't
+                                   open) */
+    HdfEosFD **tile_hdfptrs;    /* HDF-EOS file of each open HDF-EOS tile */
+    unsigned long *last_use;    /* when each tile was last read */
+    unsigned long use_count;    /* number of tile rows read */
+    int nopen;                  /* number of tiles open */
+    void *background;           /* row of a missing tile in the data type
+                                   of the band */
+}
+VirtualMosaicFD;
+
+
+/* tile size of a cloud optimized GeoTIFF, or of a compressed HDF-EOS field,
+   when OUTPUT_TILE_SIZE isn't given */
+#define DEFAULT_TILE_SIZE 256
+
+/* deflate level when OUTPUT_COMPRESSION_LEVEL isn't given (zlib's default) */
+#define DEFAULT_COMPRESSION_LEVEL 6
+
+/* temporary file of each level of a cloud optimized GeoTIFF (from the
+   GeoTIFF file name and the level number) */
+#define COG_LEVEL_FILENAME "%s.%d.tmp"
+
 #ifdef _TIFF_
+/* one resolution level of a tiled GeoTIFF: the image itself, or one of the
+   overviews of a cloud optimized GeoTIFF */
+typedef struct
+{
+    TIFF *tif;			/* TIFF the tiles of the level are encoded
+				   into */
+    char *filename;		/* temporary file of the level (COG only) */
+    size_t nrows, ncols;	/* size of the level */
+    void *tilerows;		/* scanlines of the current row of tiles */
+    void *pending;		/* even row of the level waiting for the next
+				   row to be reduced into the next level */
+}
+GeoTIFFLevel;
+
+/* tag for a GeoTIFF file descriptor in the FileDescriptor fileptr field */
 typedef struct
 {
     TIFF *tif;			/* TIFF-level descriptor */
     GTIF *gtif;			/* GeoKey-level descriptor */
+    int tile_size;		/* square tile size (0 = strips) */
+    void *tilebuf;		/* one tile being encoded */
+    int nlevels;		/* number of levels (tiled output only) */
+    GeoTIFFLevel *levels;	/* the image, then its overviews by halves */
+    int average;		/* TRUE to average overview pixels, FALSE to
+				   decimate them */
+    double *reduce[3];		/* two rows and their reduction, as doubles,
+				   for averaging */
 }
 GeoTIFFFD;
 #endif
@@ -448,6 +624,28 @@ typedef struct
     /* UTM zone codes */
     int input_zone_code, output_zone_code;
 
+    /* maximum error (in input pixels) allowed when approximating the output
+       to input pixel mapping.  0.0 projects every output pixel exactly. */
+    double approx_max_error;
+
+    /* number of threads used for resampling (0 = one per processor) */
+    int nthreads;
+
+    /* GeoTIFF and HDF-EOS output layout: square tile size in pixels (0 =
+       strips, or an untiled field), compression and deflate level (1-9) */
+    int output_tile_size;
+    CompressionType output_compression;
+    int output_compression_level;
+
+    /* write a cloud optimized GeoTIFF: tiled, with overviews, and laid out
+       for ranged reads */
+    int output_cog;
+
+    /* tiles of a virtual mosaic input (input_filetype VIRTUAL_MOSAIC):
+       numv_tiles rows of numh_tiles file names, NULL for a missing tile */
+    int numh_tiles, numv_tiles;
+    char **tile_filenames;
+
     /* projection info structures for Geolib */
     ProjInfo *in_projection_info, *out_projection_info;
 
@@ -473,6 +671,7 @@ typedef struct
     int tswitch;  /* output projection type */
     int uswitch;  /* output UTM zone */
     int xswitch;  /* output pixel size */
+    int nswitch;  /* number of threads */
 
     /* specify that a parameter was present either on the
        command line or in the parameter file. note that the
@@ -481,6 +680,12 @@ typedef struct
 
     /* temporary spectral subset string from the command-line options */
     char *tmpspectralsubset;
+
+    /* label raster of the zones to gather statistics of the output bands
+       in (-zonal), or NULL, and the number of histogram bins */
+    char *zonal_filename;
+    int zonal_bins;
+    ZonalTable *zonal;
 }
 ModisDescriptor;
 
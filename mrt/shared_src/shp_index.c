@@ -0,0 +1,1066 @@
+/******************************************************************************
+
+FILE:  shp_index.c
+
+PURPOSE:  Index the shapes of a shapefile by an attribute and by location
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+         10/26                         Check a saved index before using it
+         10/26                         Tell a stale index by the sizes and
+                                       checksums of the shapefile
+
+HARDWARE AND/OR SOFTWARE LIMITATIONS:
+  The index file is in the byte order of the machine that wrote it; it's
+  rebuilt on a machine of the other byte order.
+
+PROJECT:    MODIS Reprojection Tool
+
+NOTES:
+  Finding a shape by its attribute (a county by its GEOID, say) or the
+  shapes in an area means reading the whole .dbf or .shp.  The index does
+  that once: it hashes the shapes on the attribute, and packs the bounding
+  boxes of the shapes into an R-tree (sort-tile-recursive, so every node
+  but the last of each level is full).  It's saved next to the .shx as
+  <base>.idx, and used as it is while it's keyed on the same attribute and
+  the shapefile is the one it was built from: the same sizes of the .shp,
+  .shx and .dbf, and the same checksums of the .shp header (which has the
+  bounds of all the shapes), the .shx (where each shape is, and its size)
+  and the .dbf (the attributes).  Otherwise it's built again.  Times
+  aren't used, since copies (cp -p, rsync) keep them.
+
+******************************************************************************/
+#include <math.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "shapefile.h"
+
+/* first bytes of an index file, and the int that shows its byte order */
+#define SHP_INDEX_MAGIC "MRTSHPIX"
+#define SHP_INDEX_MAGIC_SIZE 8
+#define SHP_INDEX_ORDER 0x01020304
+
+/* version of the index file layout */
+#define SHP_INDEX_VERSION 1
+
+/* parts of the shapefile the index is checked against */
+#define SHP_INDEX_NPARTS 3
+
+/* what an index was built from: the size of each part of the shapefile,
+   and a checksum of what's in it */
+typedef struct
+{
+    long sizes[SHP_INDEX_NPARTS];	/* bytes in the .shp, .shx and .dbf */
+    unsigned long sums[SHP_INDEX_NPARTS];  /* checksums of the .shp header,
+					      the .shx and the .dbf */
+}
+ShapeSource;
+
+/* a bounding box of the tree while it's built */
+typedef struct
+{
+    double bounds[4];		/* xmin, ymin, xmax, ymax */
+    int record;			/* shape number */
+}
+ShapeBox;
+
+static ShapeIndex *BuildShapeIndex( ShapeFile *shape, int field );
+static int BuildShapeTree( ShapeIndex *index, ShapeBox *leaves,
+    int nleaves );
+static ShapeIndex *ReadShapeIndex( char *filename, ShapeFile *shape,
+    int field, ShapeSource *source );
+static int CheckShapeIndex( ShapeIndex *index );
+static int ShapeHashSize( int nrecords );
+static int WriteShapeIndex( ShapeIndex *index, ShapeSource *source,
+    char *filename );
+static int ReadShapeSource( ShapeFile *shape, ShapeSource *source );
+static unsigned long HashShapeKey( char *key );
+static unsigned long HashShapeBytes( unsigned long hash,
+    unsigned char *bytes, size_t nbytes );
+static int CompareBoxX( const void *a, const void *b );
+static int CompareBoxY( const void *a, const void *b );
+
+/******************************************************************************
+
+MODULE:  OpenShapeIndex
+
+PURPOSE:  Read the index of a shapefile, or build and save it
+
+RETURN VALUE:
+Type = ShapeIndex *
+Value           Description
+-----           -----------
+index           The shape index
+NULL            Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Not being able to save the index (a read-only directory, say) is only a
+  warning; the index is built again the next time.  So is a saved index
+  that doesn't check out (see CheckShapeIndex).  If the parts of the
+  shapefile can't be read to check the index against, it's built and not
+  saved.
+
+******************************************************************************/
+ShapeIndex *OpenShapeIndex
+(
+    ShapeFile *shape,		/* I:  shapefile */
+    char *field			/* I:  attribute to key the shapes on */
+)
+
+{
+    ShapeIndex *index = NULL;		/* the index */
+    char filename[LARGE_STRING + 8];	/* name of the index file */
+    char errstr[LARGE_STRING + 64];	/* error message */
+    int fieldnum;			/* number of the field */
+    ShapeSource source;			/* what the index is built from */
+    int have_source;			/* was source read? */
+
+    fieldnum = FindShapeField( shape, field );
+    if ( fieldnum < 0 )
+    {
+	sprintf( errstr, "The shapefile has no %s attribute", field );
+	ErrorHandler( FALSE, "OpenShapeIndex", ERROR_GENERAL, errstr );
+	return ( NULL );
+    }
+
+    sprintf( filename, "%s%s", shape->base, SHP_INDEX_EXT );
+    have_source = ReadShapeSource( shape, &source );
+    if ( have_source )
+    {
+	index = ReadShapeIndex( filename, shape, fieldnum, &source );
+	if ( index )
+	    return ( index );
+    }
+
+    index = BuildShapeIndex( shape, fieldnum );
+    if ( index && have_source &&
+	 !WriteShapeIndex( index, &source, filename ) )
+    {
+	remove( filename );
+	sprintf( errstr, "Unable to save the shape index %s", filename );
+	ErrorHandler( FALSE, "OpenShapeIndex", ERROR_GENERAL, errstr );
+    }
+
+    return ( index );
+}
+
+/******************************************************************************
+
+MODULE:  CloseShapeIndex
+
+PURPOSE:  Free a shape index
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+
+******************************************************************************/
+void CloseShapeIndex
+(
+    ShapeIndex *index		/* I:  index to free */
+)
+
+{
+    if ( !index )
+	return;
+
+    free( index->keys );
+    free( index->hash );
+    free( index->level_end );
+    free( index->leaf_records );
+    free( index->boxes );
+    free( index );
+}
+
+/******************************************************************************
+
+MODULE:  FindShapeRecord
+
+PURPOSE:  Find a shape by the value of its key attribute
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+>= 0            Shape number
+-1              No shape has the key
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The key is the attribute value without its padding, as
+  ReadShapeAttribute returns it.  If shapes share a key, the first is
+  found.
+
+******************************************************************************/
+int FindShapeRecord
+(
+    ShapeIndex *index,		/* I:  shape index */
+    char *key			/* I:  value of the attribute */
+)
+
+{
+    unsigned long slot;			/* slot of the hash table */
+    int record;
+    int nprobes;			/* slots looked at */
+
+    if ( key[0] == '\0' || index->hash_size == 0 )
+	return ( -1 );
+
+    /* the table always has an empty slot, but don't count on it */
+    slot = HashShapeKey( key ) & ( index->hash_size - 1 );
+    for ( nprobes = 0; nprobes < index->hash_size &&
+	  ( record = index->hash[slot] ) >= 0; nprobes++ )
+    {
+	if ( strcmp( &index->keys[record * index->key_size], key ) == 0 )
+	    return ( record );
+	slot = ( slot + 1 ) & ( index->hash_size - 1 );
+    }
+
+    return ( -1 );
+}
+
+/******************************************************************************
+
+MODULE:  SearchShapeIndex
+
+PURPOSE:  Find the shapes whose bounding boxes meet an area
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+n               Number of shapes found
+-1              Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Boxes that only touch the area count.  The shapes are in tree order,
+  not shape number order.
+
+******************************************************************************/
+int SearchShapeIndex
+(
+    ShapeIndex *index,		/* I:  shape index */
+    double bounds[4],		/* I:  xmin, ymin, xmax, ymax to search */
+    int *records		/* O:  shapes whose bounding boxes meet bounds
+				       (room for index->nleaves) */
+)
+
+{
+    int *stack = NULL;			/* nodes left to search */
+    int *levels = NULL;			/* level of each of them */
+    int nstack = 0;			/* nodes on the stack */
+    int nfound = 0;			/* shapes found */
+    int node, level;			/* node being searched */
+    int first, last;			/* its children */
+    double *b;				/* its box */
+
+    if ( index->nlevels == 0 )
+	return ( 0 );
+
+    /* a node's children go on top of the stack, so it never holds more
+       than a node's worth for each level */
+    stack = ( int * ) malloc( ( index->nlevels * index->node_size + 1 ) *
+	sizeof( int ) );
+    levels = ( int * ) malloc( ( index->nlevels * index->node_size + 1 ) *
+	sizeof( int ) );
+    if ( !stack || !levels )
+    {
+	free( stack );
+	free( levels );
+	ErrorHandler( FALSE, "SearchShapeIndex", ERROR_MEMORY,
+	    "Shape index stack" );
+	return ( -1 );
+    }
+
+    stack[nstack] = index->nboxes - 1;
+    levels[nstack++] = index->nlevels - 1;
+    while ( nstack > 0 )
+    {
+	node = stack[--nstack];
+	level = levels[nstack];
+	b = &index->boxes[4 * node];
+	if ( b[0] > bounds[2] || b[2] < bounds[0] || b[1] > bounds[3] ||
+	     b[3] < bounds[1] )
+	    continue;
+
+	if ( level == 0 )
+	{
+	    records[nfound++] = index->leaf_records[node];
+	    continue;
+	}
+
+	/* the children are node_size at a time on the level below */
+	first = ( level > 1 ? index->level_end[level - 2] : 0 ) +
+	    ( node - index->level_end[level - 1] ) * index->node_size;
+	last = first + index->node_size;
+	if ( last > index->level_end[level - 1] )
+	    last = index->level_end[level - 1];
+	for ( ; first < last; first++ )
+	{
+	    stack[nstack] = first;
+	    levels[nstack++] = level - 1;
+	}
+    }
+
+    free( stack );
+    free( levels );
+
+    return ( nfound );
+}
+
+/******************************************************************************
+
+MODULE:  BuildShapeIndex
+
+PURPOSE:  Read the keys and bounding boxes of the shapes and index them
+
+RETURN VALUE:
+Type = ShapeIndex *
+Value           Description
+-----           -----------
+index           The shape index
+NULL            Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The hash table is open addressed (linear probing) and at most half
+  full.  Shapes with a blank key aren't in it, and null shapes aren't in
+  the tree.
+
+******************************************************************************/
+static ShapeIndex *BuildShapeIndex
+(
+    ShapeFile *shape,		/* I:  shapefile */
+    int field			/* I:  number of the key field */
+)
+
+{
+    ShapeIndex *index = NULL;		/* the index */
+    ShapeBox *leaves = NULL;		/* bounding boxes of the shapes */
+    int nleaves = 0;			/* shapes with bounding boxes */
+    char *key;				/* key of a shape */
+    char errstr[SMALL_STRING];		/* error message */
+    unsigned long slot;			/* slot of the hash table */
+    int i;
+
+    index = ( ShapeIndex * ) calloc( 1, sizeof( ShapeIndex ) );
+    if ( !index )
+    {
+	ErrorHandler( FALSE, "BuildShapeIndex", ERROR_MEMORY, "ShapeIndex" );
+	return ( NULL );
+    }
+    strcpy( index->field, shape->fields[field].name );
+    index->nrecords = shape->nrecords;
+    index->key_size = shape->fields[field].length + 1;
+    index->node_size = SHP_INDEX_NODE_SIZE;
+    index->hash_size = ShapeHashSize( shape->nrecords );
+
+    index->keys = ( char * ) calloc( shape->nrecords + 1, index->key_size );
+    index->hash = ( int * ) malloc( index->hash_size * sizeof( int ) );
+    leaves = ( ShapeBox * ) malloc( ( shape->nrecords + 1 ) *
+	sizeof( ShapeBox ) );
+    if ( !index->keys || !index->hash || !leaves )
+    {
+	ErrorHandler( FALSE, "BuildShapeIndex", ERROR_MEMORY,
+	    "Shape index" );
+	free( leaves );
+	CloseShapeIndex( index );
+	return ( NULL );
+    }
+    for ( i = 0; i < index->hash_size; i++ )
+	index->hash[i] = -1;
+
+    for ( i = 0; i < shape->nrecords; i++ )
+    {
+	key = &index->keys[i * index->key_size];
+	if ( !ReadShapeAttribute( shape, i, field, key, index->key_size ) )
+	{
+	    sprintf( errstr, "Error reading the %s of shape %d", index->field,
+		i );
+	    ErrorHandler( FALSE, "BuildShapeIndex", ERROR_GENERAL, errstr );
+	    free( leaves );
+	    CloseShapeIndex( index );
+	    return ( NULL );
+	}
+
+	if ( key[0] != '\0' && FindShapeRecord( index, key ) < 0 )
+	{
+	    slot = HashShapeKey( key ) & ( index->hash_size - 1 );
+	    while ( index->hash[slot] >= 0 )
+		slot = ( slot + 1 ) & ( index->hash_size - 1 );
+	    index->hash[slot] = i;
+	}
+
+	if ( ReadShapeBounds( shape, i, leaves[nleaves].bounds ) )
+	    leaves[nleaves++].record = i;
+    }
+
+    if ( !BuildShapeTree( index, leaves, nleaves ) )
+    {
+	free( leaves );
+	CloseShapeIndex( index );
+	return ( NULL );
+    }
+    free( leaves );
+
+    return ( index );
+}
+
+/******************************************************************************
+
+MODULE:  BuildShapeTree
+
+PURPOSE:  Pack the bounding boxes of the shapes into an R-tree
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            Success
+FALSE           Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Sort-tile-recursive: the leaves are sorted into vertical slices by x,
+  and each slice by y, so each run of node_size leaves is a compact tile.
+  Each node above is the box around the next node_size on the level below.
+
+******************************************************************************/
+static int BuildShapeTree
+(
+    ShapeIndex *index,		/* I/O:  index */
+    ShapeBox *leaves,		/* I:  bounding boxes of the shapes (sorted
+				       here) */
+    int nleaves			/* I:  number of boxes */
+)
+
+{
+    int m = index->node_size;		/* children of each node */
+    int nslices;			/* vertical slices of the leaves */
+    int slice_size;			/* leaves in each slice */
+    int n;				/* boxes on a level */
+    int first, last;			/* children of a node */
+    int level, i, j;
+    double *b, *c;			/* boxes of a node and a child */
+
+    index->nleaves = nleaves;
+    if ( nleaves == 0 )
+	return ( TRUE );
+
+    /* count the levels and boxes */
+    index->nlevels = 1;
+    index->nboxes = nleaves;
+    for ( n = nleaves; n > 1; n = ( n + m - 1 ) / m )
+    {
+	index->nlevels++;
+	index->nboxes += ( n + m - 1 ) / m;
+    }
+
+    index->level_end = ( int * ) malloc( index->nlevels * sizeof( int ) );
+    index->leaf_records = ( int * ) malloc( nleaves * sizeof( int ) );
+    index->boxes = ( double * ) malloc( 4 * index->nboxes *
+	sizeof( double ) );
+    if ( !index->level_end || !index->leaf_records || !index->boxes )
+    {
+	ErrorHandler( FALSE, "BuildShapeTree", ERROR_MEMORY, "Shape tree" );
+	return ( FALSE );
+    }
+
+    /* tile the leaves */
+    nslices = ( int ) ceil( sqrt( ( double ) ( ( nleaves + m - 1 ) / m ) ) );
+    slice_size = nslices * m;
+    qsort( leaves, nleaves, sizeof( ShapeBox ), CompareBoxX );
+    for ( i = 0; i < nleaves; i += slice_size )
+	qsort( &leaves[i], nleaves - i < slice_size ? nleaves - i :
+	    slice_size, sizeof( ShapeBox ), CompareBoxY );
+
+    for ( i = 0; i < nleaves; i++ )
+    {
+	memcpy( &index->boxes[4 * i], leaves[i].bounds, 4 * sizeof( double ) );
+	index->leaf_records[i] = leaves[i].record;
+    }
+    index->level_end[0] = nleaves;
+
+    /* and the nodes above them */
+    j = nleaves;
+    for ( level = 1; level < index->nlevels; level++ )
+    {
+	first = level > 1 ? index->level_end[level - 2] : 0;
+	for ( ; first < index->level_end[level - 1]; first = last, j++ )
+	{
+	    last = first + m;
+	    if ( last > index->level_end[level - 1] )
+		last = index->level_end[level - 1];
+
+	    b = &index->boxes[4 * j];
+	    memcpy( b, &index->boxes[4 * first], 4 * sizeof( double ) );
+	    for ( i = first + 1; i < last; i++ )
+	    {
+		c = &index->boxes[4 * i];
+		if ( c[0] < b[0] ) b[0] = c[0];
+		if ( c[1] < b[1] ) b[1] = c[1];
+		if ( c[2] > b[2] ) b[2] = c[2];
+		if ( c[3] > b[3] ) b[3] = c[3];
+	    }
+	}
+	index->level_end[level] = j;
+    }
+
+    return ( TRUE );
+}
+
+/******************************************************************************
+
+MODULE:  ReadShapeIndex
+
+PURPOSE:  Read a saved shape index
+
+RETURN VALUE:
+Type = ShapeIndex *
+Value           Description
+-----           -----------
+index           The shape index
+NULL            There's no index, or it isn't usable
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+         10/26                         Check the index against the shapefile
+         10/26                         Added the version and the ShapeSource
+
+NOTES:
+  The file is the magic number, the byte order int, the sizes, the
+  version, the key field name, the ShapeSource, then level_end, keys,
+  hash, leaf_records and boxes, all in the machine's byte order.  An index
+  with another version or ShapeSource isn't used.
+
+  The sizes are checked before anything is allocated, and the rest once
+  it's read (CheckShapeIndex), since the arrays are used as indexes
+  without further checks.
+
+******************************************************************************/
+static ShapeIndex *ReadShapeIndex
+(
+    char *filename,		/* I:  index file */
+    ShapeFile *shape,		/* I:  shapefile it should index */
+    int field,			/* I:  number of the key field */
+    ShapeSource *source		/* I:  the shapefile's sizes and
+				       checksums */
+)
+
+{
+    FILE *file;				/* the index file */
+    ShapeIndex *index = NULL;		/* the index */
+    char magic[SHP_INDEX_MAGIC_SIZE];	/* magic number */
+    int header[9];			/* byte order, sizes and version */
+    ShapeSource built_from;		/* what the index was built from */
+    int ok;
+    int i;
+
+    file = fopen( filename, "rb" );
+    if ( !file )
+	return ( NULL );
+
+    index = ( ShapeIndex * ) calloc( 1, sizeof( ShapeIndex ) );
+    ok = index &&
+	fread( magic, 1, SHP_INDEX_MAGIC_SIZE, file ) ==
+	    SHP_INDEX_MAGIC_SIZE &&
+	memcmp( magic, SHP_INDEX_MAGIC, SHP_INDEX_MAGIC_SIZE ) == 0 &&
+	fread( header, sizeof( int ), 9, file ) == 9 &&
+	header[0] == SHP_INDEX_ORDER && header[8] == SHP_INDEX_VERSION &&
+	fread( index->field, 1, DBF_FIELD_NAME_SIZE + 1, file ) ==
+	    DBF_FIELD_NAME_SIZE + 1 &&
+	fread( &built_from, sizeof( ShapeSource ), 1, file ) == 1;
+    for ( i = 0; ok && i < SHP_INDEX_NPARTS; i++ )
+	ok = built_from.sizes[i] == source->sizes[i] &&
+	    built_from.sums[i] == source->sums[i];
+    if ( ok )
+    {
+	index->nrecords = header[1];
+	index->key_size = header[2];
+	index->hash_size = header[3];
+	index->node_size = header[4];
+	index->nlevels = header[5];
+	index->nleaves = header[6];
+	index->nboxes = header[7];
+	index->field[DBF_FIELD_NAME_SIZE] = '\0';
+
+	/* the sizes are all set by the shapefile (see BuildShapeIndex and
+	   BuildShapeTree) */
+	ok = index->nrecords == shape->nrecords &&
+	    index->key_size == shape->fields[field].length + 1 &&
+	    strcasecmp( index->field, shape->fields[field].name ) == 0 &&
+	    index->hash_size == ShapeHashSize( index->nrecords ) &&
+	    index->node_size == SHP_INDEX_NODE_SIZE &&
+	    index->nleaves >= 0 && index->nleaves <= index->nrecords &&
+	    index->nlevels >= 0 && index->nlevels <= index->nleaves &&
+	    index->nboxes >= index->nleaves &&
+	    index->nboxes <= 2 * index->nleaves;
+    }
+    if ( ok )
+    {
+	index->level_end = ( int * ) malloc( ( index->nlevels + 1 ) *
+	    sizeof( int ) );
+	index->keys = ( char * ) malloc( ( index->nrecords + 1 ) *
+	    index->key_size );
+	index->hash = ( int * ) malloc( index->hash_size * sizeof( int ) );
+	index->leaf_records = ( int * ) malloc( ( index->nleaves + 1 ) *
+	    sizeof( int ) );
+	index->boxes = ( double * ) malloc( ( 4 * index->nboxes + 1 ) *
+	    sizeof( double ) );
+	ok = index->level_end && index->keys && index->hash &&
+	    index->leaf_records && index->boxes &&
+	    fread( index->level_end, sizeof( int ), index->nlevels, file ) ==
+		( size_t ) index->nlevels &&
+	    fread( index->keys, index->key_size, index->nrecords, file ) ==
+		( size_t ) index->nrecords &&
+	    fread( index->hash, sizeof( int ), index->hash_size, file ) ==
+		( size_t ) index->hash_size &&
+	    fread( index->leaf_records, sizeof( int ), index->nleaves,
+		file ) == ( size_t ) index->nleaves &&
+	    fread( index->boxes, 4 * sizeof( double ), index->nboxes,
+		file ) == ( size_t ) index->nboxes &&
+	    CheckShapeIndex( index );
+    }
+    fclose( file );
+
+    if ( !ok )
+    {
+	CloseShapeIndex( index );
+	return ( NULL );
+    }
+
+    return ( index );
+}
+
+/******************************************************************************
+
+MODULE:  CheckShapeIndex
+
+PURPOSE:  Check that a saved index is one BuildShapeIndex could have made
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            The index can be used
+FALSE           It can't (it's built again)
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The tree's levels must be the ones BuildShapeTree makes for nleaves
+  leaves, the leaves and hash slots must hold shape numbers, each key must
+  end in its key_size bytes and be found from its slot, and the hash table
+  must have an empty slot (or FindShapeRecord would probe it all).
+
+******************************************************************************/
+static int CheckShapeIndex
+(
+    ShapeIndex *index		/* I:  the index, as read (its sizes already
+				       checked against the shapefile) */
+)
+
+{
+    int m = index->node_size;		/* children of each node */
+    int nlevels = 0;			/* levels the tree should have */
+    int end = 0;			/* end of a level in boxes */
+    int n;				/* boxes on a level */
+    int nempty = 0;			/* empty hash slots */
+    int record;				/* a shape number */
+    char *key;				/* its key */
+    unsigned long slot;			/* a slot of the hash table */
+    int i;
+
+    /* the levels */
+    for ( n = index->nleaves; n > 0; n = n > 1 ? ( n + m - 1 ) / m : 0 )
+    {
+	if ( nlevels >= index->nlevels )
+	    return ( FALSE );
+	end += n;
+	if ( index->level_end[nlevels++] != end )
+	    return ( FALSE );
+    }
+    if ( nlevels != index->nlevels || end != index->nboxes )
+	return ( FALSE );
+
+    for ( i = 0; i < index->nleaves; i++ )
+	if ( index->leaf_records[i] < 0 ||
+	     index->leaf_records[i] >= index->nrecords )
+	    return ( FALSE );
+
+    for ( i = 0; i < index->nrecords; i++ )
+	if ( index->keys[i * index->key_size + index->key_size - 1] != '\0' )
+	    return ( FALSE );
+
+    /* each shape in the table is found from where its key hashes to */
+    for ( i = 0; i < index->hash_size; i++ )
+    {
+	record = index->hash[i];
+	if ( record < 0 )
+	{
+	    if ( record != -1 )
+		return ( FALSE );
+	    nempty++;
+	    continue;
+	}
+	if ( record >= index->nrecords )
+	    return ( FALSE );
+
+	key = &index->keys[record * index->key_size];
+	if ( key[0] == '\0' )
+	    return ( FALSE );
+	for ( slot = HashShapeKey( key ) & ( index->hash_size - 1 );
+	      slot != ( unsigned long ) i;
+	      slot = ( slot + 1 ) & ( index->hash_size - 1 ) )
+	    if ( index->hash[slot] == -1 )
+		return ( FALSE );
+    }
+
+    return ( nempty > 0 );
+}
+
+/******************************************************************************
+
+MODULE:  ShapeHashSize
+
+PURPOSE:  Size the hash table of an index
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+size            Slots in the table
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  A power of 2, at least 16 and twice the shapes, so the table is at most
+  half full.
+
+******************************************************************************/
+static int ShapeHashSize
+(
+    int nrecords		/* I:  number of shapes */
+)
+
+{
+    int size;
+
+    for ( size = 16; size < 2 * nrecords; size *= 2 )
+	;
+
+    return ( size );
+}
+
+/******************************************************************************
+
+MODULE:  WriteShapeIndex
+
+PURPOSE:  Save a shape index
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            Success
+FALSE           Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  See ReadShapeIndex for the layout.
+
+******************************************************************************/
+static int WriteShapeIndex
+(
+    ShapeIndex *index,		/* I:  shape index */
+    ShapeSource *source,	/* I:  the shapefile's sizes and checksums */
+    char *filename		/* I:  index file */
+)
+
+{
+    FILE *file;				/* the index file */
+    int header[9];			/* byte order, sizes and version */
+    int ok;
+
+    file = fopen( filename, "wb" );
+    if ( !file )
+	return ( FALSE );
+
+    header[0] = SHP_INDEX_ORDER;
+    header[1] = index->nrecords;
+    header[2] = index->key_size;
+    header[3] = index->hash_size;
+    header[4] = index->node_size;
+    header[5] = index->nlevels;
+    header[6] = index->nleaves;
+    header[7] = index->nboxes;
+    header[8] = SHP_INDEX_VERSION;
+
+    ok = fwrite( SHP_INDEX_MAGIC, 1, SHP_INDEX_MAGIC_SIZE, file ) ==
+	    SHP_INDEX_MAGIC_SIZE &&
+	fwrite( header, sizeof( int ), 9, file ) == 9 &&
+	fwrite( index->field, 1, DBF_FIELD_NAME_SIZE + 1, file ) ==
+	    DBF_FIELD_NAME_SIZE + 1 &&
+	fwrite( source, sizeof( ShapeSource ), 1, file ) == 1 &&
+	fwrite( index->level_end, sizeof( int ), index->nlevels, file ) ==
+	    ( size_t ) index->nlevels &&
+	fwrite( index->keys, index->key_size, index->nrecords, file ) ==
+	    ( size_t ) index->nrecords &&
+	fwrite( index->hash, sizeof( int ), index->hash_size, file ) ==
+	    ( size_t ) index->hash_size &&
+	fwrite( index->leaf_records, sizeof( int ), index->nleaves, file ) ==
+	    ( size_t ) index->nleaves &&
+	fwrite( index->boxes, 4 * sizeof( double ), index->nboxes, file ) ==
+	    ( size_t ) index->nboxes;
+
+    if ( fclose( file ) != 0 )
+	ok = FALSE;
+
+    return ( ok );
+}
+
+/******************************************************************************
+
+MODULE:  ReadShapeSource
+
+PURPOSE:  Get the sizes and checksums of the parts of a shapefile
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            Success
+FALSE           A part couldn't be read
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development (replaces
+                                       ShapeIndexIsCurrent)
+
+NOTES:
+  Only the header of the .shp is summed: the .shx has the offset and size
+  of each shape, so that and the .shp header (with the bounds of all the
+  shapes) change with the shapes, without reading them all.  The .dbf is
+  summed whole, since the keys are in it.
+
+  The upper case extensions are tried too, as OpenShapeFile does.
+
+******************************************************************************/
+static int ReadShapeSource
+(
+    ShapeFile *shape,		/* I:  shapefile */
+    ShapeSource *source		/* O:  sizes and checksums of its parts */
+)
+
+{
+    static char *ext[SHP_INDEX_NPARTS] = { ".shp", ".shx", ".dbf" };
+    static long sum_size[SHP_INDEX_NPARTS] = { SHP_HEADER_SIZE, -1, -1 };
+    char partname[LARGE_STRING + 8];	/* name of a part of the shapefile */
+    unsigned char buffer[HUGE_STRING];	/* bytes of a part */
+    struct stat part_stat;		/* status of a part */
+    FILE *part;				/* the part */
+    long left;				/* bytes left to sum, or -1 for all */
+    size_t n;				/* bytes read */
+    int i;
+
+    for ( i = 0; i < SHP_INDEX_NPARTS; i++ )
+    {
+	sprintf( partname, "%s%s", shape->base, ext[i] );
+	if ( stat( partname, &part_stat ) != 0 )
+	{
+	    strupr( partname + strlen( shape->base ) );
+	    if ( stat( partname, &part_stat ) != 0 )
+		return ( FALSE );
+	}
+
+	part = fopen( partname, "rb" );
+	if ( !part )
+	    return ( FALSE );
+
+	source->sizes[i] = ( long ) part_stat.st_size;
+	source->sums[i] = 2166136261UL;
+	left = sum_size[i];
+	while ( left != 0 && ( n = fread( buffer, 1, left > 0 &&
+	    left < HUGE_STRING ? ( size_t ) left : HUGE_STRING, part ) ) > 0 )
+	{
+	    source->sums[i] = HashShapeBytes( source->sums[i], buffer, n );
+	    if ( left > 0 )
+		left -= ( long ) n;
+	}
+
+	if ( ferror( part ) )
+	{
+	    fclose( part );
+	    return ( FALSE );
+	}
+	fclose( part );
+    }
+
+    return ( TRUE );
+}
+
+/******************************************************************************
+
+MODULE:  HashShapeKey
+
+PURPOSE:  Hash a key (32 bit FNV-1a)
+
+RETURN VALUE:
+Type = unsigned long
+Value           Description
+-----           -----------
+hash            Hash of the key
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The hash is saved with the index, so it must not change.
+
+******************************************************************************/
+static unsigned long HashShapeKey
+(
+    char *key			/* I:  key */
+)
+
+{
+    unsigned long hash = 2166136261UL;
+
+    for ( ; *key; key++ )
+	hash = ( ( hash ^ ( unsigned char ) *key ) * 16777619UL ) &
+	    0xffffffffUL;
+
+    return ( hash );
+}
+
+/******************************************************************************
+
+MODULE:  HashShapeBytes
+
+PURPOSE:  Add bytes to a hash (32 bit FNV-1a, as HashShapeKey)
+
+RETURN VALUE:
+Type = unsigned long
+Value           Description
+-----           -----------
+hash            Hash so far, with the bytes
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Start with 2166136261.  Saved with the index, so it must not change.
+
+******************************************************************************/
+static unsigned long HashShapeBytes
+(
+    unsigned long hash,		/* I:  hash so far */
+    unsigned char *bytes,	/* I:  bytes to add */
+    size_t nbytes		/* I:  number of bytes */
+)
+
+{
+    size_t i;
+
+    for ( i = 0; i < nbytes; i++ )
+	hash = ( ( hash ^ bytes[i] ) * 16777619UL ) & 0xffffffffUL;
+
+    return ( hash );
+}
+
+/******************************************************************************
+
+MODULE:  CompareBoxX, CompareBoxY
+
+PURPOSE:  qsort comparisons of the centers of two bounding boxes
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+<0, 0, >0       a is left of (below), even with, or right of (above) b
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+
+******************************************************************************/
+static int CompareBoxX
+(
+    const void *a,
+    const void *b
+)
+
+{
+    const double *ba = ( ( const ShapeBox * ) a )->bounds;
+    const double *bb = ( ( const ShapeBox * ) b )->bounds;
+    double ca = ba[0] + ba[2];
+    double cb = bb[0] + bb[2];
+
+    return ( ca < cb ? -1 : ca > cb ? 1 : 0 );
+}
+
+static int CompareBoxY
+(
+    const void *a,
+    const void *b
+)
+
+{
+    const double *ba = ( ( const ShapeBox * ) a )->bounds;
+    const double *bb = ( ( const ShapeBox * ) b )->bounds;
+    double ca = ba[1] + ba[3];
+    double cb = bb[1] + bb[3];
+
+    return ( ca < cb ? -1 : ca > cb ? 1 : 0 );
+}
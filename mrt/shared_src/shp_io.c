@@ -0,0 +1,761 @@
+/******************************************************************************
+
+FILE:  shp_io.c
+
+PURPOSE:  Read polygons and their attributes from ESRI shapefiles
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+         10/26                         Added ReadShapeBounds
+
+HARDWARE AND/OR SOFTWARE LIMITATIONS:
+  Only polygon shapes (and null shapes) are read.  Z and M values are
+  ignored.
+
+PROJECT:    MODIS Reprojection Tool
+
+NOTES:
+  The .shx is read when the shapefile is opened, so that any shape can be
+  read from the .shp with one seek.  The file and record headers are big
+  endian and everything else is little endian, whatever the machine is.
+
+******************************************************************************/
+#include "shapefile.h"
+
+/* the .shp/.shx file code, and the end of the .dbf field descriptors */
+#define SHP_FILE_CODE 9994
+#define DBF_FIELD_END 0x0D
+
+static long ShpBigLong( unsigned char *p );
+static long ShpLittleLong( unsigned char *p );
+static double ShpLittleDouble( unsigned char *p );
+static FILE *OpenShapePart( char *base, char *ext );
+static int ReadDbfHeader( ShapeFile *shape );
+static int GrowShapeBuffer( ShapeFile *shape, size_t size );
+
+/******************************************************************************
+
+MODULE:  OpenShapeFile
+
+PURPOSE:  Open a shapefile and read its index and attribute table layout
+
+RETURN VALUE:
+Type = ShapeFile *
+Value           Description
+-----           -----------
+shape           The open shapefile
+NULL            Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  filename may be the .shp file or the name without the extension; the
+  .shx and .dbf must be next to it.
+
+******************************************************************************/
+ShapeFile *OpenShapeFile
+(
+    char *filename		/* I:  .shp file, or its base name */
+)
+
+{
+    ShapeFile *shape = NULL;		/* the shapefile */
+    FILE *shx = NULL;			/* the index */
+    unsigned char header[SHP_HEADER_SIZE];  /* .shx file header */
+    unsigned char *index = NULL;	/* .shx records */
+    char base[LARGE_STRING];		/* file name without extension */
+    char errstr[LARGE_STRING + 64];	/* error message */
+    size_t len;
+    int i;
+
+    /* take off the .shp */
+    len = strlen( filename );
+    if ( len >= LARGE_STRING )
+    {
+	ErrorHandler( FALSE, "OpenShapeFile", ERROR_GENERAL,
+	    "Shapefile name is too long" );
+	return ( NULL );
+    }
+    strcpy( base, filename );
+    if ( len > 4 && strcasecmp( base + len - 4, ".shp" ) == 0 )
+	base[len - 4] = '\0';
+
+    shape = ( ShapeFile * ) calloc( 1, sizeof( ShapeFile ) );
+    if ( !shape )
+    {
+	ErrorHandler( FALSE, "OpenShapeFile", ERROR_MEMORY, "ShapeFile" );
+	return ( NULL );
+    }
+
+    strcpy( shape->base, base );
+    shape->shp = OpenShapePart( base, ".shp" );
+    shape->dbf = OpenShapePart( base, ".dbf" );
+    shx = OpenShapePart( base, ".shx" );
+    if ( !shape->shp || !shape->dbf || !shx )
+    {
+	if ( shx )
+	    fclose( shx );
+	CloseShapeFile( shape );
+	return ( NULL );
+    }
+
+    /* the number of shapes comes from the length of the index, which is in
+       16 bit words */
+    if ( fread( header, 1, SHP_HEADER_SIZE, shx ) != SHP_HEADER_SIZE ||
+	 ShpBigLong( header ) != SHP_FILE_CODE )
+    {
+	sprintf( errstr, "%s.shx is not a shapefile index", base );
+	ErrorHandler( FALSE, "OpenShapeFile", ERROR_GENERAL, errstr );
+	fclose( shx );
+	CloseShapeFile( shape );
+	return ( NULL );
+    }
+    shape->nrecords = ( int ) ( ( ShpBigLong( &header[24] ) * 2 -
+	SHP_HEADER_SIZE ) / SHP_RECORD_HEADER_SIZE );
+    shape->shape_type = ( int ) ShpLittleLong( &header[32] );
+    for ( i = 0; i < 4; i++ )
+	shape->bounds[i] = ShpLittleDouble( &header[36 + 8 * i] );
+
+    /* each index record is the offset and length of a shape, in words,
+       not counting the record header */
+    if ( shape->nrecords > 0 )
+    {
+	shape->offsets = ( long * ) malloc( shape->nrecords * sizeof( long ) );
+	shape->lengths = ( long * ) malloc( shape->nrecords * sizeof( long ) );
+	index = ( unsigned char * ) malloc( shape->nrecords *
+	    SHP_RECORD_HEADER_SIZE );
+	if ( !shape->offsets || !shape->lengths || !index )
+	{
+	    ErrorHandler( FALSE, "OpenShapeFile", ERROR_MEMORY,
+		"Shapefile index" );
+	    free( index );
+	    fclose( shx );
+	    CloseShapeFile( shape );
+	    return ( NULL );
+	}
+    }
+    if ( fread( index, SHP_RECORD_HEADER_SIZE, shape->nrecords, shx ) !=
+	 ( size_t ) shape->nrecords )
+    {
+	sprintf( errstr, "Error reading %s.shx", base );
+	ErrorHandler( FALSE, "OpenShapeFile", ERROR_GENERAL, errstr );
+	free( index );
+	fclose( shx );
+	CloseShapeFile( shape );
+	return ( NULL );
+    }
+    for ( i = 0; i < shape->nrecords; i++ )
+    {
+	shape->offsets[i] = ShpBigLong( &index[i * SHP_RECORD_HEADER_SIZE] ) *
+	    2 + SHP_RECORD_HEADER_SIZE;
+	shape->lengths[i] = ShpBigLong( &index[i * SHP_RECORD_HEADER_SIZE +
+	    4] ) * 2;
+    }
+    free( index );
+    fclose( shx );
+
+    if ( !ReadDbfHeader( shape ) )
+    {
+	sprintf( errstr, "%s.dbf is not an attribute table for %s.shx", base,
+	    base );
+	ErrorHandler( FALSE, "OpenShapeFile", ERROR_GENERAL, errstr );
+	CloseShapeFile( shape );
+	return ( NULL );
+    }
+
+    return ( shape );
+}
+
+/******************************************************************************
+
+MODULE:  CloseShapeFile
+
+PURPOSE:  Close a shapefile and free its descriptor
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+
+******************************************************************************/
+void CloseShapeFile
+(
+    ShapeFile *shape		/* I:  shapefile to close */
+)
+
+{
+    if ( !shape )
+	return;
+
+    if ( shape->shp )
+	fclose( shape->shp );
+    if ( shape->dbf )
+	fclose( shape->dbf );
+    free( shape->offsets );
+    free( shape->lengths );
+    free( shape->fields );
+    free( shape->buffer );
+    free( shape );
+}
+
+/******************************************************************************
+
+MODULE:  FindShapeField
+
+PURPOSE:  Find an attribute of the shapes by name
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+>= 0            Field number
+-1              There's no such field
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Field names are not case sensitive.
+
+******************************************************************************/
+int FindShapeField
+(
+    ShapeFile *shape,		/* I:  shapefile */
+    char *name			/* I:  name of the field */
+)
+
+{
+    int i;
+
+    for ( i = 0; i < shape->nfields; i++ )
+	if ( strcasecmp( shape->fields[i].name, name ) == 0 )
+	    return ( i );
+
+    return ( -1 );
+}
+
+/******************************************************************************
+
+MODULE:  ReadShapeAttribute
+
+PURPOSE:  Read an attribute of a shape from the .dbf
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            Success
+FALSE           Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The value is returned as text without the blanks it's padded with,
+  whatever the field type.  It's cut short if it's longer than maxlen - 1.
+
+******************************************************************************/
+int ReadShapeAttribute
+(
+    ShapeFile *shape,		/* I:  shapefile */
+    int record,			/* I:  shape number */
+    int field,			/* I:  field number (FindShapeField) */
+    char *value,		/* O:  value of the field, without padding */
+    int maxlen			/* I:  size of value */
+)
+
+{
+    ShapeField *f;			/* the field */
+    int first, last;			/* non-blank part of the field */
+
+    value[0] = '\0';
+    if ( record < 0 || record >= shape->nrecords || field < 0 ||
+	 field >= shape->nfields )
+	return ( FALSE );
+
+    f = &shape->fields[field];
+    if ( !GrowShapeBuffer( shape, f->length ) )
+	return ( FALSE );
+    if ( fseek( shape->dbf, shape->dbf_header_size + record *
+	 shape->dbf_record_size + f->offset, SEEK_SET ) != 0 ||
+	 fread( shape->buffer, 1, f->length, shape->dbf ) !=
+	 ( size_t ) f->length )
+	return ( FALSE );
+
+    for ( first = 0; first < f->length && shape->buffer[first] == ' ';
+	  first++ );
+    for ( last = f->length; last > first && ( shape->buffer[last - 1] == ' '
+	  || shape->buffer[last - 1] == '\0' ); last-- );
+    if ( last - first > maxlen - 1 )
+	last = first + maxlen - 1;
+
+    memcpy( value, &shape->buffer[first], last - first );
+    value[last - first] = '\0';
+
+    return ( TRUE );
+}
+
+/******************************************************************************
+
+MODULE:  ReadShapePolygon
+
+PURPOSE:  Read a polygon shape from the .shp
+
+RETURN VALUE:
+Type = ShapePolygon *
+Value           Description
+-----           -----------
+polygon         The polygon (with no points for a null shape)
+NULL            Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Free the polygon with FreeShapePolygon.
+
+******************************************************************************/
+ShapePolygon *ReadShapePolygon
+(
+    ShapeFile *shape,		/* I:  shapefile */
+    int record			/* I:  shape number */
+)
+
+{
+    ShapePolygon *polygon = NULL;	/* the polygon */
+    unsigned char *p;			/* the shape */
+    long length;			/* bytes in the shape */
+    long type;				/* shape type */
+    char errstr[SMALL_STRING];		/* error message */
+    int i;
+
+    if ( record < 0 || record >= shape->nrecords )
+	return ( NULL );
+
+    length = shape->lengths[record];
+    if ( length < 4 || !GrowShapeBuffer( shape, length ) ||
+	 fseek( shape->shp, shape->offsets[record], SEEK_SET ) != 0 ||
+	 fread( shape->buffer, 1, length, shape->shp ) != ( size_t ) length )
+    {
+	sprintf( errstr, "Error reading shape %d", record );
+	ErrorHandler( FALSE, "ReadShapePolygon", ERROR_GENERAL, errstr );
+	return ( NULL );
+    }
+    p = shape->buffer;
+
+    polygon = ( ShapePolygon * ) calloc( 1, sizeof( ShapePolygon ) );
+    if ( !polygon )
+    {
+	ErrorHandler( FALSE, "ReadShapePolygon", ERROR_MEMORY,
+	    "ShapePolygon" );
+	return ( NULL );
+    }
+
+    /* a null shape has no points */
+    type = ShpLittleLong( p );
+    if ( type == 0 )
+	return ( polygon );
+
+    if ( type != SHP_POLYGON && type != SHP_POLYGONZ && type != SHP_POLYGONM )
+    {
+	sprintf( errstr, "Shape %d is not a polygon (shape type %ld)", record,
+	    type );
+	ErrorHandler( FALSE, "ReadShapePolygon", ERROR_GENERAL, errstr );
+	free( polygon );
+	return ( NULL );
+    }
+
+    /* bounding box, number of rings and points, the first point of each
+       ring, and then the points */
+    if ( length >= 44 )
+    {
+	polygon->nparts = ( int ) ShpLittleLong( &p[36] );
+	polygon->npoints = ( int ) ShpLittleLong( &p[40] );
+    }
+    if ( length < 44 || polygon->nparts < 0 || polygon->npoints < 0 ||
+	 44 + 4 * ( double ) polygon->nparts + 16 * ( double )
+	 polygon->npoints > length )
+    {
+	sprintf( errstr, "Shape %d is corrupt", record );
+	ErrorHandler( FALSE, "ReadShapePolygon", ERROR_GENERAL, errstr );
+	free( polygon );
+	return ( NULL );
+    }
+
+    for ( i = 0; i < 4; i++ )
+	polygon->bounds[i] = ShpLittleDouble( &p[4 + 8 * i] );
+
+    polygon->parts = ( int * ) malloc( ( polygon->nparts + 1 ) *
+	sizeof( int ) );
+    polygon->x = ( double * ) malloc( ( polygon->npoints + 1 ) *
+	sizeof( double ) );
+    polygon->y = ( double * ) malloc( ( polygon->npoints + 1 ) *
+	sizeof( double ) );
+    if ( !polygon->parts || !polygon->x || !polygon->y )
+    {
+	ErrorHandler( FALSE, "ReadShapePolygon", ERROR_MEMORY,
+	    "ShapePolygon points" );
+	FreeShapePolygon( polygon );
+	return ( NULL );
+    }
+
+    for ( i = 0; i < polygon->nparts; i++ )
+    {
+	polygon->parts[i] = ( int ) ShpLittleLong( &p[44 + 4 * i] );
+	if ( polygon->parts[i] < 0 || polygon->parts[i] > polygon->npoints )
+	    polygon->parts[i] = polygon->npoints;
+    }
+    polygon->parts[polygon->nparts] = polygon->npoints;
+
+    p += 44 + 4 * polygon->nparts;
+    for ( i = 0; i < polygon->npoints; i++ )
+    {
+	polygon->x[i] = ShpLittleDouble( &p[16 * i] );
+	polygon->y[i] = ShpLittleDouble( &p[16 * i + 8] );
+    }
+
+    return ( polygon );
+}
+
+/******************************************************************************
+
+MODULE:  FreeShapePolygon
+
+PURPOSE:  Free a polygon read by ReadShapePolygon
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+
+******************************************************************************/
+void FreeShapePolygon
+(
+    ShapePolygon *polygon	/* I:  polygon to free */
+)
+
+{
+    if ( !polygon )
+	return;
+
+    free( polygon->parts );
+    free( polygon->x );
+    free( polygon->y );
+    free( polygon );
+}
+
+/******************************************************************************
+
+MODULE:  ReadShapeBounds
+
+PURPOSE:  Read the bounding box of a shape from the .shp
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            Success
+FALSE           Failure, or a null shape (which has no bounding box)
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Only the shape type and box at the start of the shape are read.
+
+******************************************************************************/
+int ReadShapeBounds
+(
+    ShapeFile *shape,		/* I:  shapefile */
+    int record,			/* I:  shape number */
+    double bounds[4]		/* O:  xmin, ymin, xmax, ymax */
+)
+
+{
+    unsigned char p[36];		/* shape type and bounding box */
+    int i;
+
+    if ( record < 0 || record >= shape->nrecords ||
+	 shape->lengths[record] < ( long ) sizeof( p ) ||
+	 fseek( shape->shp, shape->offsets[record], SEEK_SET ) != 0 ||
+	 fread( p, 1, sizeof( p ), shape->shp ) != sizeof( p ) ||
+	 ShpLittleLong( p ) == 0 )
+	return ( FALSE );
+
+    for ( i = 0; i < 4; i++ )
+	bounds[i] = ShpLittleDouble( &p[4 + 8 * i] );
+
+    return ( TRUE );
+}
+
+/******************************************************************************
+
+MODULE:  ReadDbfHeader
+
+PURPOSE:  Read the record layout of the .dbf attribute table
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            Success
+FALSE           The .dbf is corrupt, or doesn't have a record for each
+                shape
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Each record starts with a deletion flag byte, then the fields in the
+  order of their descriptors.
+
+******************************************************************************/
+static int ReadDbfHeader
+(
+    ShapeFile *shape		/* I/O:  shapefile */
+)
+
+{
+    unsigned char header[DBF_HEADER_SIZE];  /* file header */
+    unsigned char *descriptors = NULL;	/* field descriptors */
+    long nrecords;			/* number of records */
+    int ndescriptors;			/* room for this many descriptors */
+    int offset = 1;			/* offset of the next field */
+    int i;
+
+    if ( fread( header, 1, DBF_HEADER_SIZE, shape->dbf ) != DBF_HEADER_SIZE )
+	return ( FALSE );
+
+    nrecords = ShpLittleLong( &header[4] );
+    shape->dbf_header_size = header[8] | ( header[9] << 8 );
+    shape->dbf_record_size = header[10] | ( header[11] << 8 );
+    if ( nrecords != shape->nrecords ||
+	 shape->dbf_header_size <= DBF_HEADER_SIZE )
+	return ( FALSE );
+
+    ndescriptors = ( int ) ( shape->dbf_header_size - DBF_HEADER_SIZE ) /
+	DBF_HEADER_SIZE;
+    descriptors = ( unsigned char * ) malloc( shape->dbf_header_size -
+	DBF_HEADER_SIZE );
+    shape->fields = ( ShapeField * ) calloc( ndescriptors + 1,
+	sizeof( ShapeField ) );
+    if ( !descriptors || !shape->fields ||
+	 fread( descriptors, 1, shape->dbf_header_size - DBF_HEADER_SIZE,
+	 shape->dbf ) != ( size_t ) ( shape->dbf_header_size -
+	 DBF_HEADER_SIZE ) )
+    {
+	free( descriptors );
+	return ( FALSE );
+    }
+
+    for ( i = 0; i < ndescriptors; i++ )
+    {
+	unsigned char *d = &descriptors[i * DBF_HEADER_SIZE];
+	ShapeField *f = &shape->fields[shape->nfields];
+
+	if ( d[0] == DBF_FIELD_END )
+	    break;
+
+	memcpy( f->name, d, DBF_FIELD_NAME_SIZE );
+	f->name[DBF_FIELD_NAME_SIZE] = '\0';
+	f->type = ( char ) d[11];
+	f->length = d[16];
+	f->offset = offset;
+	offset += f->length;
+	shape->nfields++;
+    }
+    free( descriptors );
+
+    return ( offset <= shape->dbf_record_size );
+}
+
+/******************************************************************************
+
+MODULE:  OpenShapePart
+
+PURPOSE:  Open one of the files of a shapefile
+
+RETURN VALUE:
+Type = FILE *
+Value           Description
+-----           -----------
+file            The open file
+NULL            Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The upper case extension is tried too.
+
+******************************************************************************/
+static FILE *OpenShapePart
+(
+    char *base,			/* I:  name without the extension */
+    char *ext			/* I:  lower case extension */
+)
+
+{
+    char filename[LARGE_STRING + 8];	/* name of the file */
+    char errstr[LARGE_STRING + 32];	/* error message */
+    FILE *file;
+
+    sprintf( filename, "%s%s", base, ext );
+    file = fopen( filename, "rb" );
+    if ( !file )
+    {
+	strupr( filename + strlen( base ) );
+	file = fopen( filename, "rb" );
+    }
+    if ( !file )
+    {
+	sprintf( errstr, "Unable to open %s%s", base, ext );
+	ErrorHandler( FALSE, "OpenShapeFile", ERROR_OPEN_INPUTIMAGE, errstr );
+    }
+
+    return ( file );
+}
+
+/******************************************************************************
+
+MODULE:  GrowShapeBuffer
+
+PURPOSE:  Make sure the shape buffer holds at least size bytes
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            Success
+FALSE           Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+
+******************************************************************************/
+static int GrowShapeBuffer
+(
+    ShapeFile *shape,		/* I/O:  shapefile */
+    size_t size			/* I:  bytes needed */
+)
+
+{
+    unsigned char *buffer;
+
+    if ( size <= shape->buffer_size )
+	return ( TRUE );
+
+    buffer = ( unsigned char * ) realloc( shape->buffer, size );
+    if ( !buffer )
+    {
+	ErrorHandler( FALSE, "GrowShapeBuffer", ERROR_MEMORY,
+	    "Shapefile buffer" );
+	return ( FALSE );
+    }
+    shape->buffer = buffer;
+    shape->buffer_size = size;
+
+    return ( TRUE );
+}
+
+/******************************************************************************
+
+MODULE:  ShpBigLong, ShpLittleLong, ShpLittleDouble
+
+PURPOSE:  Decode the big and little endian values of a shapefile
+
+RETURN VALUE:
+Type = long or double
+Value           Description
+-----           -----------
+value           The decoded value
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The integers are 32 bit signed values.
+
+******************************************************************************/
+static long ShpBigLong
+(
+    unsigned char *p		/* I:  4 bytes, most significant first */
+)
+
+{
+    unsigned long u = ( ( unsigned long ) p[0] << 24 ) |
+	( ( unsigned long ) p[1] << 16 ) | ( ( unsigned long ) p[2] << 8 ) |
+	p[3];
+
+    return ( u & 0x80000000UL ? ( long ) ( u - 0x80000000UL ) - 0x7FFFFFFFL
+	- 1 : ( long ) u );
+}
+
+static long ShpLittleLong
+(
+    unsigned char *p		/* I:  4 bytes, least significant first */
+)
+
+{
+    unsigned char b[4];
+
+    b[0] = p[3];
+    b[1] = p[2];
+    b[2] = p[1];
+    b[3] = p[0];
+
+    return ( ShpBigLong( b ) );
+}
+
+static double ShpLittleDouble
+(
+    unsigned char *p		/* I:  8 bytes, least significant first */
+)
+
+{
+    unsigned char b[8];
+    double value;
+    int i;
+
+    if ( GetMachineEndianness( ) == MRT_BIG_ENDIAN )
+	for ( i = 0; i < 8; i++ )
+	    b[i] = p[7 - i];
+    else
+	memcpy( b, p, 8 );
+    memcpy( &value, b, 8 );
+
+    return ( value );
+}
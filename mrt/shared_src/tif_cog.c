@@ -0,0 +1,662 @@
+/******************************************************************************
+
+FILE:  tif_cog.c
+
+PURPOSE:  Write cloud optimized GeoTIFFs
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+HARDWARE AND/OR SOFTWARE LIMITATIONS:
+  Classic TIFF only, so the output must be smaller than 4 GB.
+
+PROJECT:    MODIS Reprojection Tool
+
+NOTES:
+  A cloud optimized GeoTIFF (COG) is a tiled GeoTIFF with internal
+  overviews, laid out so that a reader can fetch any window at any zoom
+  with a few ranged reads: the header and all the image file directories
+  (IFDs) come first, then the tiles of the smallest overview, and so on up
+  to the tiles of the full resolution image.
+
+  libtiff always appends a directory after its image data, so it can't lay
+  the file out this way.  Instead each level (the image and each overview)
+  is encoded by libtiff into a temporary tiled TIFF while the rows are
+  written: WriteRowGeoTIFF reduces every pair of rows of a level into a row
+  of the next level as they come in, so the image is only read once.  When
+  the GeoTIFF is closed, WriteCOGFile writes the IFDs itself and copies the
+  already compressed tiles from the temporary files.
+
+******************************************************************************/
+#include "geotiffio.h"
+#include "xtiffio.h"
+#include "shared_resample.h"
+
+/* most entries in a COG image file directory */
+#define MAX_COG_TAGS 20
+
+/* an image file directory of a COG, with its values in native byte order */
+typedef struct
+{
+    int nentries;		/* number of entries */
+    uint16 tags[MAX_COG_TAGS];	/* tag of each entry */
+    uint16 types[MAX_COG_TAGS];	/* TIFF data type of each entry */
+    uint32 counts[MAX_COG_TAGS];  /* number of values of each entry */
+    void *values[MAX_COG_TAGS];	/* values of each entry */
+    uint32 longs[MAX_COG_TAGS];	/* storage for single LONG values */
+    uint16 shorts[MAX_COG_TAGS];  /* storage for single SHORT values */
+    uint32 offset;		/* file offset of the directory */
+    uint32 ntiles;		/* number of tiles */
+    uint32 *tileoffsets;	/* file offset of each tile */
+    uint32 *tilebytecounts;	/* compressed size of each tile */
+}
+COGDirectory;
+
+/******************************************************************************
+
+MODULE:  CreateGeoTIFFOverviews
+
+PURPOSE:  Set up the overviews of a cloud optimized GeoTIFF
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+status	        See mrt_error.h for a complete list of codes
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Called by SetTIFFLayout once the image (level 0) is set up.  Each
+  overview is half the size of the one before, rounded up, until the image
+  fits in one tile.  Overviews of nearest neighbor (or unresampled) output
+  are decimated so that class values survive; otherwise they are averaged,
+  leaving out background fill.
+
+******************************************************************************/
+int CreateGeoTIFFOverviews
+(
+    FileDescriptor *output, 	/* I/O:  GeoTIFF file */
+    ModisDescriptor *modis	/* I:  session info */
+)
+
+{
+    GeoTIFFFD *geotiff = ( GeoTIFFFD * ) output->fileptr;
+    GeoTIFFLevel *level;	/* overview being set up */
+    size_t nrows, ncols;	/* size of an overview */
+    int nlevels;		/* image and overviews */
+    uint16 value;		/* tag value copied from the image */
+    char errmsg[LARGE_STRING + 32];
+    int l;
+
+    /* count the overviews */
+    nlevels = 1;
+    for ( nrows = output->nrows, ncols = output->ncols;
+          nrows > ( size_t ) geotiff->tile_size ||
+          ncols > ( size_t ) geotiff->tile_size; nlevels++ )
+    {
+	nrows = ( nrows + 1 ) / 2;
+	ncols = ( ncols + 1 ) / 2;
+    }
+
+    level = ( GeoTIFFLevel * ) realloc( geotiff->levels,
+        nlevels * sizeof( GeoTIFFLevel ) );
+    if ( !level )
+    {
+	ErrorHandler( TRUE, "CreateGeoTIFFOverviews", ERROR_MEMORY,
+	    "Allocating GeoTIFF overviews" );
+	return ( ERROR_MEMORY );
+    }
+    memset( level + 1, 0, ( nlevels - 1 ) * sizeof( GeoTIFFLevel ) );
+    geotiff->levels = level;
+    geotiff->nlevels = nlevels;
+
+    /* the image itself was opened as the first temporary file */
+    sprintf( errmsg, COG_LEVEL_FILENAME, output->filename, 0 );
+    geotiff->levels[0].filename = strdup( errmsg );
+    if ( !geotiff->levels[0].filename )
+    {
+	ErrorHandler( TRUE, "CreateGeoTIFFOverviews", ERROR_MEMORY,
+	    "Allocating GeoTIFF overviews" );
+	return ( ERROR_MEMORY );
+    }
+
+    for ( l = 1; l < nlevels; l++ )
+    {
+	level = &geotiff->levels[l];
+	level->nrows = ( geotiff->levels[l - 1].nrows + 1 ) / 2;
+	level->ncols = ( geotiff->levels[l - 1].ncols + 1 ) / 2;
+	sprintf( errmsg, COG_LEVEL_FILENAME, output->filename, l );
+	level->filename = strdup( errmsg );
+	level->tilerows = malloc( geotiff->tile_size * level->ncols *
+	    output->datasize );
+	if ( !level->filename || !level->tilerows )
+	{
+	    ErrorHandler( TRUE, "CreateGeoTIFFOverviews", ERROR_MEMORY,
+		"Allocating GeoTIFF overviews" );
+	    return ( ERROR_MEMORY );
+	}
+
+	level->tif = TIFFOpen( level->filename, "w" );
+	if ( !level->tif )
+	{
+	    sprintf( errmsg, "Unable to open %s", level->filename );
+	    ErrorHandler( TRUE, "CreateGeoTIFFOverviews",
+		ERROR_OPEN_OUTPUTIMAGE, errmsg );
+	    return ( ERROR_OPEN_OUTPUTIMAGE );
+	}
+
+	/* same layout as the image */
+	TIFFSetField( level->tif, TIFFTAG_IMAGEWIDTH,
+	    ( uint32 ) level->ncols );
+	TIFFSetField( level->tif, TIFFTAG_IMAGELENGTH,
+	    ( uint32 ) level->nrows );
+	TIFFSetField( level->tif, TIFFTAG_PHOTOMETRIC,
+	    PHOTOMETRIC_MINISBLACK );
+	TIFFSetField( level->tif, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG );
+	TIFFSetField( level->tif, TIFFTAG_SAMPLESPERPIXEL, 1 );
+	TIFFGetField( geotiff->tif, TIFFTAG_BITSPERSAMPLE, &value );
+	TIFFSetField( level->tif, TIFFTAG_BITSPERSAMPLE, value );
+	TIFFGetField( geotiff->tif, TIFFTAG_SAMPLEFORMAT, &value );
+	TIFFSetField( level->tif, TIFFTAG_SAMPLEFORMAT, value );
+	TIFFGetField( geotiff->tif, TIFFTAG_COMPRESSION, &value );
+	TIFFSetField( level->tif, TIFFTAG_COMPRESSION, value );
+	if ( value == COMPRESSION_ADOBE_DEFLATE )
+	    TIFFSetField( level->tif, TIFFTAG_ZIPQUALITY,
+		modis->output_compression_level );
+	if ( value != COMPRESSION_NONE )
+	{
+	    TIFFGetField( geotiff->tif, TIFFTAG_PREDICTOR, &value );
+	    TIFFSetField( level->tif, TIFFTAG_PREDICTOR, value );
+	}
+	TIFFSetField( level->tif, TIFFTAG_TILEWIDTH,
+	    ( uint32 ) geotiff->tile_size );
+	TIFFSetField( level->tif, TIFFTAG_TILELENGTH,
+	    ( uint32 ) geotiff->tile_size );
+    }
+
+    /* averaging goes through doubles */
+    geotiff->average = modis->resampling_type != NN &&
+        modis->resampling_type != NO_RESAMPLE;
+    if ( geotiff->average && nlevels > 1 )
+    {
+	if ( output->convert_datatype != output->datatype &&
+	     !SelectRowConverters( output ) )
+	    return ( ERROR_GENERAL );
+
+	for ( l = 0; l < 3; l++ )
+	{
+	    geotiff->reduce[l] = ( double * ) malloc( output->ncols *
+		sizeof( double ) );
+	    if ( !geotiff->reduce[l] )
+	    {
+		ErrorHandler( TRUE, "CreateGeoTIFFOverviews", ERROR_MEMORY,
+		    "Allocating GeoTIFF overviews" );
+		return ( ERROR_MEMORY );
+	    }
+	}
+    }
+
+    return ( MRT_NO_ERROR );
+}
+
+/******************************************************************************
+
+MODULE:  AddCOGEntry
+
+PURPOSE:  Add an entry to a COG image file directory
+
+RETURN VALUE:
+Type = void
+Value           Description
+-----           -----------
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Entries must be added in increasing tag order.  The values aren't
+  copied.
+
+******************************************************************************/
+static void AddCOGEntry
+(
+    COGDirectory *dir,		/* I/O:  directory */
+    uint16 tag,			/* I:  tag */
+    TIFFDataType type,		/* I:  data type of the values */
+    uint32 count,		/* I:  number of values */
+    void *values		/* I:  the values */
+)
+
+{
+    dir->tags[dir->nentries] = tag;
+    dir->types[dir->nentries] = type;
+    dir->counts[dir->nentries] = count;
+    dir->values[dir->nentries] = values;
+    dir->nentries++;
+}
+
+/******************************************************************************
+
+MODULE:  AddCOGShort, AddCOGLong
+
+PURPOSE:  Add an entry with a single SHORT or LONG value to a COG image file
+          directory
+
+RETURN VALUE:
+Type = void
+Value           Description
+-----           -----------
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+
+******************************************************************************/
+static void AddCOGShort
+(
+    COGDirectory *dir,		/* I/O:  directory */
+    uint16 tag,			/* I:  tag */
+    uint16 value		/* I:  value */
+)
+
+{
+    dir->shorts[dir->nentries] = value;
+    AddCOGEntry( dir, tag, TIFF_SHORT, 1, &dir->shorts[dir->nentries] );
+}
+
+static void AddCOGLong
+(
+    COGDirectory *dir,		/* I/O:  directory */
+    uint16 tag,			/* I:  tag */
+    uint32 value		/* I:  value */
+)
+
+{
+    dir->longs[dir->nentries] = value;
+    AddCOGEntry( dir, tag, TIFF_LONG, 1, &dir->longs[dir->nentries] );
+}
+
+/******************************************************************************
+
+MODULE:  ReadCOGDirectory
+
+PURPOSE:  Build the COG image file directory of a level from its temporary
+          TIFF
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            Success
+FALSE           Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The values of the array entries point into the TIFF's own directory, so
+  the TIFF must stay open while the directory is written.  The tile
+  offsets are filled in later by LayOutCOG.  Only the image (level 0) gets
+  the software and GeoTIFF tags; the overviews are marked as reduced
+  resolution images.
+
+******************************************************************************/
+static int ReadCOGDirectory
+(
+    TIFF *tif,			/* I:  temporary TIFF of the level */
+    int level,			/* I:  level number */
+    COGDirectory *dir		/* O:  directory */
+)
+
+{
+    uint32 width, length, tilewidth, tilelength;
+    uint16 bitspersample, compression, predictor, sampleformat;
+    uint16 count;		/* number of values of a GeoTIFF tag */
+    uint32 *tilebytecounts;
+    char *software;
+    void *values;
+
+    memset( dir, 0, sizeof( COGDirectory ) );
+    dir->ntiles = TIFFNumberOfTiles( tif );
+    dir->tileoffsets = ( uint32 * ) calloc( dir->ntiles, sizeof( uint32 ) );
+    if ( !dir->tileoffsets ||
+         !TIFFGetField( tif, TIFFTAG_TILEBYTECOUNTS, &tilebytecounts ) )
+	return ( FALSE );
+    dir->tilebytecounts = tilebytecounts;
+
+    TIFFGetField( tif, TIFFTAG_IMAGEWIDTH, &width );
+    TIFFGetField( tif, TIFFTAG_IMAGELENGTH, &length );
+    TIFFGetField( tif, TIFFTAG_TILEWIDTH, &tilewidth );
+    TIFFGetField( tif, TIFFTAG_TILELENGTH, &tilelength );
+    TIFFGetField( tif, TIFFTAG_BITSPERSAMPLE, &bitspersample );
+    TIFFGetField( tif, TIFFTAG_COMPRESSION, &compression );
+    TIFFGetFieldDefaulted( tif, TIFFTAG_SAMPLEFORMAT, &sampleformat );
+
+    if ( level > 0 )
+	AddCOGLong( dir, TIFFTAG_SUBFILETYPE, FILETYPE_REDUCEDIMAGE );
+    AddCOGLong( dir, TIFFTAG_IMAGEWIDTH, width );
+    AddCOGLong( dir, TIFFTAG_IMAGELENGTH, length );
+    AddCOGShort( dir, TIFFTAG_BITSPERSAMPLE, bitspersample );
+    AddCOGShort( dir, TIFFTAG_COMPRESSION, compression );
+    AddCOGShort( dir, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK );
+    AddCOGShort( dir, TIFFTAG_SAMPLESPERPIXEL, 1 );
+    AddCOGShort( dir, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG );
+    if ( level == 0 && TIFFGetField( tif, TIFFTAG_SOFTWARE, &software ) )
+	AddCOGEntry( dir, TIFFTAG_SOFTWARE, TIFF_ASCII, strlen( software ) + 1,
+	    software );
+    /* the predictor tag only exists once a compression scheme is set */
+    if ( compression != COMPRESSION_NONE &&
+         TIFFGetField( tif, TIFFTAG_PREDICTOR, &predictor ) )
+	AddCOGShort( dir, TIFFTAG_PREDICTOR, predictor );
+    AddCOGLong( dir, TIFFTAG_TILEWIDTH, tilewidth );
+    AddCOGLong( dir, TIFFTAG_TILELENGTH, tilelength );
+    AddCOGEntry( dir, TIFFTAG_TILEOFFSETS, TIFF_LONG, dir->ntiles,
+	dir->tileoffsets );
+    AddCOGEntry( dir, TIFFTAG_TILEBYTECOUNTS, TIFF_LONG, dir->ntiles,
+	dir->tilebytecounts );
+    AddCOGShort( dir, TIFFTAG_SAMPLEFORMAT, sampleformat );
+
+    if ( level == 0 )
+    {
+	if ( TIFFGetField( tif, TIFFTAG_GEOPIXELSCALE, &count, &values ) )
+	    AddCOGEntry( dir, TIFFTAG_GEOPIXELSCALE, TIFF_DOUBLE, count,
+		values );
+	if ( TIFFGetField( tif, TIFFTAG_GEOTIEPOINTS, &count, &values ) )
+	    AddCOGEntry( dir, TIFFTAG_GEOTIEPOINTS, TIFF_DOUBLE, count,
+		values );
+	if ( TIFFGetField( tif, TIFFTAG_GEOKEYDIRECTORY, &count, &values ) )
+	    AddCOGEntry( dir, TIFFTAG_GEOKEYDIRECTORY, TIFF_SHORT, count,
+		values );
+	if ( TIFFGetField( tif, TIFFTAG_GEODOUBLEPARAMS, &count, &values ) )
+	    AddCOGEntry( dir, TIFFTAG_GEODOUBLEPARAMS, TIFF_DOUBLE, count,
+		values );
+	if ( TIFFGetField( tif, TIFFTAG_GEOASCIIPARAMS, &values ) )
+	    AddCOGEntry( dir, TIFFTAG_GEOASCIIPARAMS, TIFF_ASCII,
+		strlen( ( char * ) values ) + 1, values );
+    }
+
+    return ( TRUE );
+}
+
+/******************************************************************************
+
+MODULE:  COGDirectorySize
+
+PURPOSE:  Find the size of a COG image file directory and its values
+
+RETURN VALUE:
+Type = double
+Value           Description
+-----           -----------
+size            Size in bytes (an even number)
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Values that don't fit in the four bytes of an entry follow the
+  directory, each starting on a word boundary.
+
+******************************************************************************/
+static double COGDirectorySize
+(
+    COGDirectory *dir		/* I:  directory */
+)
+
+{
+    double size;		/* bytes so far */
+    double nbytes;		/* size of the values of an entry */
+    int i;
+
+    size = 2 + 12 * dir->nentries + 4;
+    for ( i = 0; i < dir->nentries; i++ )
+    {
+	nbytes = ( double ) dir->counts[i] *
+	    TIFFDataWidth( ( TIFFDataType ) dir->types[i] );
+	if ( nbytes > 4 )
+	    size += nbytes + ( ( unsigned long ) nbytes & 1 );
+    }
+
+    return ( size );
+}
+
+/******************************************************************************
+
+MODULE:  WriteCOGDirectory
+
+PURPOSE:  Write a COG image file directory and its values
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            Success
+FALSE           Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The directory is written at dir->offset, which must be the current file
+  position.  The file is in native byte order.
+
+******************************************************************************/
+static int WriteCOGDirectory
+(
+    FILE *fp,			/* I:  COG being written */
+    COGDirectory *dir,		/* I:  directory */
+    uint32 next			/* I:  offset of the next directory (0 for
+				   the last) */
+)
+
+{
+    uint16 nentries = dir->nentries;
+    uint32 valueoffset;		/* where the next out-of-line values go */
+    uint32 nbytes;		/* size of the values of an entry */
+    char inline_values[4];	/* values that fit in an entry */
+    static char zero = 0;	/* word alignment padding */
+    int ok;
+    int i;
+
+    valueoffset = dir->offset + 2 + 12 * dir->nentries + 4;
+    ok = fwrite( &nentries, 2, 1, fp ) == 1;
+
+    for ( i = 0; ok && i < dir->nentries; i++ )
+    {
+	nbytes = dir->counts[i] *
+	    TIFFDataWidth( ( TIFFDataType ) dir->types[i] );
+	ok = fwrite( &dir->tags[i], 2, 1, fp ) == 1 &&
+	     fwrite( &dir->types[i], 2, 1, fp ) == 1 &&
+	     fwrite( &dir->counts[i], 4, 1, fp ) == 1;
+	if ( nbytes <= 4 )
+	{
+	    memset( inline_values, 0, 4 );
+	    memcpy( inline_values, dir->values[i], nbytes );
+	    ok = ok && fwrite( inline_values, 4, 1, fp ) == 1;
+	}
+	else
+	{
+	    ok = ok && fwrite( &valueoffset, 4, 1, fp ) == 1;
+	    valueoffset += nbytes + ( nbytes & 1 );
+	}
+    }
+    ok = ok && fwrite( &next, 4, 1, fp ) == 1;
+
+    /* the values that didn't fit */
+    for ( i = 0; ok && i < dir->nentries; i++ )
+    {
+	nbytes = dir->counts[i] *
+	    TIFFDataWidth( ( TIFFDataType ) dir->types[i] );
+	if ( nbytes > 4 )
+	    ok = fwrite( dir->values[i], 1, nbytes, fp ) == nbytes &&
+		 ( ( nbytes & 1 ) == 0 || fwrite( &zero, 1, 1, fp ) == 1 );
+    }
+
+    return ( ok );
+}
+
+/******************************************************************************
+
+MODULE:  WriteCOGFile
+
+PURPOSE:  Assemble a cloud optimized GeoTIFF from the temporary TIFFs of its
+          levels
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            Success
+FALSE           Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Called by CloseGeoTIFFFile after the temporary TIFFs are closed.  The
+  file is laid out as: header, the image and overview directories (in that
+  order, as readers expect), then the tiles from the smallest overview to
+  the image.  The tiles are copied as they were compressed.  The temporary
+  files are removed, even when the COG can't be written.
+
+******************************************************************************/
+int WriteCOGFile
+(
+    FileDescriptor *file	/* I:  GeoTIFF file, with its levels closed */
+)
+
+{
+    GeoTIFFFD *geotiff = ( GeoTIFFFD * ) file->fileptr;
+    int nlevels = geotiff->nlevels;
+    TIFF **tifs = NULL;		/* temporary TIFF of each level */
+    COGDirectory *dirs = NULL;	/* directory of each level */
+    FILE *fp = NULL;		/* the COG */
+    double offset;		/* file offset while laying out the file */
+    char header[8];		/* TIFF header */
+    uint16 magic = TIFF_VERSION;
+    uint32 first = 8;		/* offset of the first directory */
+    uint32 maxbytes = 0;	/* largest compressed tile */
+    void *tile = NULL;		/* a compressed tile */
+    char errmsg[LARGE_STRING + 32];
+    int errcode = MRT_NO_ERROR;	/* error, if the COG wasn't written */
+    int ok = FALSE;
+    int l;
+    uint32 t;
+
+    tifs = ( TIFF ** ) calloc( nlevels, sizeof( TIFF * ) );
+    dirs = ( COGDirectory * ) calloc( nlevels, sizeof( COGDirectory ) );
+    if ( !tifs || !dirs )
+    {
+	ErrorHandler( TRUE, "WriteCOGFile", ERROR_MEMORY,
+	    "Allocating COG directories" );
+	return ( FALSE );
+    }
+
+    /* directories first, then tiles from the smallest overview up */
+    offset = first;
+    for ( l = 0; l < nlevels; l++ )
+    {
+	tifs[l] = XTIFFOpen( geotiff->levels[l].filename, "r" );
+	if ( !tifs[l] || !ReadCOGDirectory( tifs[l], l, &dirs[l] ) )
+	{
+	    sprintf( errmsg, "Unable to read %s",
+		geotiff->levels[l].filename );
+	    errcode = ERROR_WRITE_OUTPUTIMAGE;
+	    goto cleanup;
+	}
+	dirs[l].offset = ( uint32 ) offset;
+	offset += COGDirectorySize( &dirs[l] );
+    }
+    for ( l = nlevels - 1; l >= 0; l-- )
+    {
+	for ( t = 0; t < dirs[l].ntiles; t++ )
+	{
+	    dirs[l].tileoffsets[t] = ( uint32 ) offset;
+	    offset += dirs[l].tilebytecounts[t];
+	    if ( dirs[l].tilebytecounts[t] > maxbytes )
+		maxbytes = dirs[l].tilebytecounts[t];
+	}
+    }
+    if ( offset > 4294967295.0 )
+    {
+	sprintf( errmsg, "%s would be larger than 4 GB", file->filename );
+	errcode = ERROR_WRITE_OUTPUTIMAGE;
+	goto cleanup;
+    }
+
+    tile = malloc( maxbytes > 0 ? maxbytes : 1 );
+    if ( tile )
+	fp = fopen( file->filename, "wb" );
+    if ( !fp )
+    {
+	sprintf( errmsg, "Unable to open %s", file->filename );
+	errcode = ERROR_OPEN_OUTPUTIMAGE;
+	goto cleanup;
+    }
+
+    /* header, in native byte order */
+    header[0] = header[1] = ( *( char * ) &magic == TIFF_VERSION ) ? 'I' :
+        'M';
+    memcpy( header + 2, &magic, 2 );
+    memcpy( header + 4, &first, 4 );
+    ok = fwrite( header, 8, 1, fp ) == 1;
+
+    for ( l = 0; ok && l < nlevels; l++ )
+	ok = WriteCOGDirectory( fp, &dirs[l],
+	    l + 1 < nlevels ? dirs[l + 1].offset : 0 );
+
+    for ( l = nlevels - 1; ok && l >= 0; l-- )
+    {
+	for ( t = 0; ok && t < dirs[l].ntiles; t++ )
+	    ok = TIFFReadRawTile( tifs[l], t, tile,
+		     dirs[l].tilebytecounts[t] ) ==
+		     ( tsize_t ) dirs[l].tilebytecounts[t] &&
+		 fwrite( tile, 1, dirs[l].tilebytecounts[t], fp ) ==
+		     dirs[l].tilebytecounts[t];
+    }
+
+    if ( fclose( fp ) != 0 )
+	ok = FALSE;
+    if ( !ok )
+    {
+	sprintf( errmsg, "Unable to write %s", file->filename );
+	errcode = ERROR_WRITE_OUTPUTIMAGE;
+    }
+
+cleanup:
+    for ( l = 0; l < nlevels; l++ )
+    {
+	if ( tifs[l] )
+	    XTIFFClose( tifs[l] );
+	free( dirs[l].tileoffsets );
+	remove( geotiff->levels[l].filename );
+    }
+    free( tifs );
+    free( dirs );
+    free( tile );
+
+    /* fatal, but only once the temporary files are gone */
+    if ( !ok )
+	ErrorHandler( TRUE, "WriteCOGFile", errcode, errmsg );
+
+    return ( ok );
+}
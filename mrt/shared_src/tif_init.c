@@ -9,6 +9,8 @@ Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          06/00  Rob Burrell            Original Development
          05/02  Gail Schmidt           Modified to handle signed vs. unsigned
+         10/26                         Added tiled and compressed output
+         10/26                         Set the deflate level
 
 HARDWARE AND/OR SOFTWARE LIMITATIONS:  
   None
@@ -33,6 +35,12 @@ void SetGeoTIFFDatum
     char *citation		/* I/O:  add datum citation */
 );
 
+static int SetTIFFLayout
+(
+    FileDescriptor *output, 	/* I:  file info */
+    ModisDescriptor *modis	/* I:  session info */
+);
+
 /******************************************************************************
 
 MODULE:  SetTIFFTags
@@ -70,6 +78,8 @@ Version  Date   Programmer       Code  Reason
          12/04  Gail Schmidt           Originally used PixelIsArea tag for
                                        the center of the pixel instead of
                                        PixelIsPoint. This has been changed.
+         10/26                         Moved the compression and strip
+                                       tags to SetTIFFLayout
 
 NOTES:
 
@@ -88,6 +98,7 @@ int SetTIFFTags
     char software[256];			/* string for software citation tag */
     char citation[256];			/* string for geo citation tag */
     ProjInfo *outproj = NULL;		/* projection data */
+    int status;				/* error status */
 
     int UTMWGS84_ZoneCodes[2][60] = { /* zone code for UTM WGS84 projections */
         {PCS_WGS84_UTM_zone_1N,
@@ -397,11 +408,9 @@ int SetTIFFTags
 
     TIFFSetField( geotiff->tif, TIFFTAG_IMAGEWIDTH, output->ncols );
     TIFFSetField( geotiff->tif, TIFFTAG_IMAGELENGTH, output->nrows );
-    TIFFSetField( geotiff->tif, TIFFTAG_COMPRESSION, COMPRESSION_NONE );
     TIFFSetField( geotiff->tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK );
     TIFFSetField( geotiff->tif, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG );
     TIFFSetField( geotiff->tif, TIFFTAG_SAMPLESPERPIXEL, 1 );
-    TIFFSetField( geotiff->tif, TIFFTAG_ROWSPERSTRIP, 1L );
 
     sprintf( software, "%s  %s", RESAMPLER_NAME, RESAMPLER_VERSION );
     TIFFSetField( geotiff->tif, TIFFTAG_SOFTWARE, software );
@@ -442,6 +451,11 @@ int SetTIFFTags
           break;
     }
 
+    /* strips or tiles, and compression (needs the sample format) */
+    status = SetTIFFLayout( output, modis );
+    if ( status != MRT_NO_ERROR )
+        return ( status );
+
     /* UL corner
        NOTE: according to the Geotiff documentation, only one tiepoint
        (the UL corner) is specified. */
@@ -998,6 +1012,111 @@ int SetTIFFTags
 
 /******************************************************************************
 
+MODULE:  SetTIFFLayout
+
+PURPOSE:  Set the TIFF compression and strip or tile tags, and allocate the
+          tile buffers
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+status	        See mrt_error.h for a complete list of codes
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+         10/26                         Set up the overviews of a COG
+         10/26                         Set the deflate level
+
+NOTES:
+  Without OUTPUT_TILE_SIZE or OUTPUT_COMPRESSION the output is laid out as
+  it always was: uncompressed, one row per strip.
+
+  Compressed output uses a horizontal differencing predictor (the floating
+  point predictor for FLOAT32), which makes smooth images compress much
+  better.  Compressed strips are sized by libtiff (about 8K each) rather
+  than one row, so the compressor has something to work with.
+
+  Tiled output is written a row of tiles at a time by WriteRowGeoTIFF, so a
+  tile-row of scanlines and one tile are buffered here.  A cloud optimized
+  GeoTIFF is always tiled, and its overviews are set up here too.
+
+******************************************************************************/
+static int SetTIFFLayout
+(
+    FileDescriptor *output, 	/* I:  file info */
+    ModisDescriptor *modis	/* I:  session info */
+)
+
+{
+    GeoTIFFFD *geotiff = ( GeoTIFFFD * ) output->fileptr;
+    size_t tile_size = modis->output_tile_size;
+
+    switch ( modis->output_compression )
+    {
+        case COMPRESS_NONE:
+          TIFFSetField( geotiff->tif, TIFFTAG_COMPRESSION, COMPRESSION_NONE );
+          break;
+        case COMPRESS_DEFLATE:
+          TIFFSetField( geotiff->tif, TIFFTAG_COMPRESSION,
+              COMPRESSION_ADOBE_DEFLATE );
+          TIFFSetField( geotiff->tif, TIFFTAG_ZIPQUALITY,
+              modis->output_compression_level );
+          break;
+        case COMPRESS_LZW:
+          TIFFSetField( geotiff->tif, TIFFTAG_COMPRESSION, COMPRESSION_LZW );
+          break;
+    }
+
+    /* the predictor tag only exists once a compression scheme is set */
+    if ( modis->output_compression != COMPRESS_NONE )
+        TIFFSetField( geotiff->tif, TIFFTAG_PREDICTOR,
+            output->datatype == DFNT_FLOAT32 ? PREDICTOR_FLOATINGPOINT :
+            PREDICTOR_HORIZONTAL );
+
+    if ( tile_size == 0 )
+    {
+        if ( modis->output_compression == COMPRESS_NONE )
+            TIFFSetField( geotiff->tif, TIFFTAG_ROWSPERSTRIP, 1L );
+        else
+            TIFFSetField( geotiff->tif, TIFFTAG_ROWSPERSTRIP,
+                TIFFDefaultStripSize( geotiff->tif, 0 ) );
+        return ( MRT_NO_ERROR );
+    }
+
+    TIFFSetField( geotiff->tif, TIFFTAG_TILEWIDTH, ( uint32 ) tile_size );
+    TIFFSetField( geotiff->tif, TIFFTAG_TILELENGTH, ( uint32 ) tile_size );
+
+    /* the image is the first level */
+    geotiff->levels = ( GeoTIFFLevel * ) calloc( 1, sizeof( GeoTIFFLevel ) );
+    geotiff->tilebuf = malloc( tile_size * tile_size * output->datasize );
+    if ( geotiff->levels )
+        geotiff->levels[0].tilerows = malloc( tile_size * output->ncols *
+            output->datasize );
+    if ( !geotiff->levels || !geotiff->levels[0].tilerows ||
+         !geotiff->tilebuf )
+    {
+        ErrorHandler( TRUE, "SetTIFFLayout", ERROR_MEMORY,
+            "Allocating GeoTIFF tile buffers" );
+        return ( ERROR_MEMORY );
+    }
+    geotiff->nlevels = 1;
+    geotiff->levels[0].tif = geotiff->tif;
+    geotiff->levels[0].nrows = output->nrows;
+    geotiff->levels[0].ncols = output->ncols;
+    geotiff->tile_size = tile_size;
+
+    /* a cloud optimized GeoTIFF adds overviews */
+    if ( modis->output_cog )
+        return ( CreateGeoTIFFOverviews( output, modis ) );
+
+    return ( MRT_NO_ERROR );
+}
+
+/******************************************************************************
+
 MODULE:  SetGeoTIFFDatum
 
 PURPOSE:  Set GeoTIFF tags for the datum used
@@ -9,6 +9,8 @@ HISTORY:
 Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          06/00  Rob Burrell            Original Development
+         10/26                         Added tiled output
+         10/26                         Added COG overviews
 
 HARDWARE AND/OR SOFTWARE LIMITATIONS:  
   None
@@ -28,6 +30,208 @@ NOTES:
 
 /******************************************************************************
 
+MODULE:  WriteTileRowGeoTIFF
+
+PURPOSE:  Encode and write the buffered row of tiles of a level of a tiled
+          TIFF image
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE			Success
+FALSE			Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+         10/26                         Write any level, not just the image
+
+NOTES:
+  Tiles hanging off the right or bottom edge of the level are padded with
+  zeros.
+
+******************************************************************************/
+static int WriteTileRowGeoTIFF
+(
+    FileDescriptor *file,	/* I:  file to write */
+    GeoTIFFLevel *level,	/* I:  level to write */
+    int row,			/* I:  first row of the tiles */
+    int nrows			/* I:  number of rows buffered */
+)
+
+{
+    GeoTIFFFD *geotiff = ( GeoTIFFFD * ) file->fileptr;
+    size_t tile_size = geotiff->tile_size;
+    size_t rowsize = level->ncols * file->datasize;	/* bytes in a row */
+    size_t tilerowsize = tile_size * file->datasize;	/* bytes in a tile
+							   row */
+    size_t col, ncols;
+    int i;
+
+    for ( col = 0; col < level->ncols; col += tile_size )
+    {
+	ncols = level->ncols - col;
+	if ( ncols > tile_size )
+	    ncols = tile_size;
+	if ( ncols < tile_size || nrows < ( int ) tile_size )
+	    memset( geotiff->tilebuf, 0, tile_size * tilerowsize );
+
+	for ( i = 0; i < nrows; i++ )
+	    memcpy( ( char * ) geotiff->tilebuf + i * tilerowsize,
+		( char * ) level->tilerows + i * rowsize +
+		col * file->datasize, ncols * file->datasize );
+
+	if ( TIFFWriteEncodedTile( level->tif,
+	    TIFFComputeTile( level->tif, col, row, 0, 0 ), geotiff->tilebuf,
+	    tile_size * tilerowsize ) == -1 )
+	    return ( FALSE );
+    }
+
+    return ( TRUE );
+}
+
+/******************************************************************************
+
+MODULE:  ReduceRowGeoTIFF
+
+PURPOSE:  Reduce two rows of a level of a tiled TIFF image to a row of the
+          next level
+
+RETURN VALUE:
+Type = void
+Value           Description
+-----           -----------
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Each pixel of the next level covers two by two pixels of the level (fewer
+  at the last row or column of a level with an odd size).  It is either the
+  upper left of them (decimation), or their average leaving out background
+  fill, rounded and clipped as WriteRow does.
+
+******************************************************************************/
+static void ReduceRowGeoTIFF
+(
+    FileDescriptor *file,	/* I:  file being written */
+    GeoTIFFLevel *level,	/* I:  level of the rows */
+    void *row0,			/* I:  even row of the level */
+    void *row1,			/* I:  next row (row0 if there isn't one) */
+    void *reduced		/* O:  row of the next level */
+)
+
+{
+    GeoTIFFFD *geotiff = ( GeoTIFFFD * ) file->fileptr;
+    double *d0 = geotiff->reduce[0];
+    double *d1 = geotiff->reduce[1];
+    double *dr = geotiff->reduce[2];
+    double sum;			/* of the pixels to average */
+    int count;			/* number of pixels to average */
+    size_t ncols = ( level->ncols + 1 ) / 2;
+    size_t col, c;
+
+    if ( !geotiff->average )
+    {
+	for ( col = 0; col < ncols; col++ )
+	    memcpy( ( char * ) reduced + col * file->datasize,
+		( char * ) row0 + 2 * col * file->datasize, file->datasize );
+	return;
+    }
+
+    file->read_convert( row0, d0, level->ncols );
+    if ( row1 != row0 )
+	file->read_convert( row1, d1, level->ncols );
+
+    for ( col = 0; col < ncols; col++ )
+    {
+	sum = 0.0;
+	count = 0;
+	for ( c = 2 * col; c < 2 * col + 2 && c < level->ncols; c++ )
+	{
+	    if ( d0[c] != file->background_fill )
+	    {
+		sum += d0[c];
+		count++;
+	    }
+	    if ( row1 != row0 && d1[c] != file->background_fill )
+	    {
+		sum += d1[c];
+		count++;
+	    }
+	}
+	dr[col] = count > 0 ? sum / count : file->background_fill;
+    }
+
+    file->write_convert( dr, reduced, ncols );
+}
+
+/******************************************************************************
+
+MODULE:  AddRowGeoTIFF
+
+PURPOSE:  Add a row to a level of a tiled TIFF image
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE			Success
+FALSE			Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The row must already be in its place in the level's tile-row buffer.  A
+  row of tiles is written when it is full (or at the last row of the
+  level).  Every odd row, and an even last row, is reduced with the row
+  before it into the next level, if there is one, and added there in
+  turn.  The tile size is even, so both rows are still in the buffer.
+
+******************************************************************************/
+static int AddRowGeoTIFF
+(
+    FileDescriptor *file,	/* I:  file to write */
+    int l,			/* I:  level number */
+    int row			/* I:  row number in the level */
+)
+
+{
+    GeoTIFFFD *geotiff = ( GeoTIFFFD * ) file->fileptr;
+    GeoTIFFLevel *level = &geotiff->levels[l];
+    GeoTIFFLevel *next;			/* next level */
+    size_t rowsize = level->ncols * file->datasize;	/* bytes in a row */
+    int tilerow = row % geotiff->tile_size;	/* row within the row of
+						   tiles */
+    char *thisrow = ( char * ) level->tilerows + tilerow * rowsize;
+    int last = ( size_t ) row == level->nrows - 1;
+
+    if ( l + 1 < geotiff->nlevels && ( row % 2 == 1 || last ) )
+    {
+	next = &geotiff->levels[l + 1];
+	ReduceRowGeoTIFF( file, level, row % 2 ? thisrow - rowsize : thisrow,
+	    thisrow, ( char * ) next->tilerows + ( row / 2 ) %
+	    geotiff->tile_size * next->ncols * file->datasize );
+	if ( !AddRowGeoTIFF( file, l + 1, row / 2 ) )
+	    return ( FALSE );
+    }
+
+    if ( tilerow == geotiff->tile_size - 1 || last )
+	return ( WriteTileRowGeoTIFF( file, level, row - tilerow,
+	    tilerow + 1 ) );
+
+    return ( TRUE );
+}
+
+/******************************************************************************
+
 MODULE:  WriteRowGeoTIFF
 
 PURPOSE:  Write a row of data to a TIFF image
@@ -44,8 +248,14 @@ Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          06/00  Rob Burrell            Original Development
          01/01  John Rishea            Standardized formatting
+         10/26                         Buffer the rows of tiled images
+         10/26                         Build the overviews of a COG
 
 NOTES:
+  Rows must be written in order.  Rows of a tiled image are buffered until
+  a whole row of tiles (or the last row of the image) is in, and then the
+  tiles are encoded together.  The overviews of a cloud optimized GeoTIFF
+  are built from the rows as they come in.
 
 ******************************************************************************/
 
@@ -56,6 +266,14 @@ int WriteRowGeoTIFF
 )
 
 {
-    return ( TIFFWriteScanline
-	( ( ( GeoTIFFFD * ) file->fileptr )->tif, file->rowbuffer, row, 0 ) );
+    GeoTIFFFD *geotiff = ( GeoTIFFFD * ) file->fileptr;
+    size_t rowsize = file->ncols * file->datasize;	/* bytes in a row */
+
+    if ( geotiff->tile_size == 0 )
+	return ( TIFFWriteScanline( geotiff->tif, file->rowbuffer, row, 0 ) );
+
+    memcpy( ( char * ) geotiff->levels[0].tilerows +
+	row % geotiff->tile_size * rowsize, file->rowbuffer, rowsize );
+
+    return ( AddRowGeoTIFF( file, 0, row ) );
 }
@@ -9,6 +9,7 @@ HISTORY:
 Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          06/00  Rob Burrell            Original Development
+         10/26                         Added cloud optimized GeoTIFFs
 
 HARDWARE AND/OR SOFTWARE LIMITATIONS:  
   None
@@ -48,6 +49,8 @@ Version  Date   Programmer       Code  Reason
                                        the pathname to insure that the
                                        extension was being pulled from the
                                        filename and not the pathname.
+         10/26                         Open a COG's image as a temporary
+                                       file
 
 NOTES:
 
@@ -67,6 +70,7 @@ FileDescriptor *OpenGeoTIFFFile
          *tmpptr = NULL,                /* pointer to the filename after
                                            finding the end of the path */
          *nameptr = NULL; 
+    char cogname[LARGE_STRING + 32];    /* temporary file of a COG image */
     GeoTIFFFD *geotiff = NULL;		/* GEOTIFF file pointer */
 
     /* read is not supported */
@@ -124,8 +128,16 @@ FileDescriptor *OpenGeoTIFFFile
 		return ( NULL );
 	    }
 
-	    /* open the file for writing */
-	    geotiff->tif = XTIFFOpen( filename, "w" );
+	    /* open the file for writing.  The image of a cloud optimized
+	       GeoTIFF goes to a temporary file, and the GeoTIFF itself is
+	       written when it is closed. */
+	    if ( modis->output_cog )
+	    {
+		sprintf( cogname, COG_LEVEL_FILENAME, filename, 0 );
+		geotiff->tif = XTIFFOpen( cogname, "w" );
+	    }
+	    else
+		geotiff->tif = XTIFFOpen( filename, "w" );
 	   
             /* if memory not allocated, error */ 
             if ( !geotiff->tif )
@@ -174,6 +186,8 @@ Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          06/00  Rob Burrell            Original Development
          01/01  John Rishea            Standardized formatting
+         10/26                         Free the tile buffers
+         10/26                         Write a COG from its levels
 
 NOTES:
 
@@ -185,6 +199,8 @@ int CloseGeoTIFFFile
 
 {
     GeoTIFFFD *geotiff = NULL;		/* cast pointer */
+    int status = TRUE;			/* COG written? */
+    int l;
 
     switch ( filedescriptor->fileopentype )
     {
@@ -199,8 +215,26 @@ int CloseGeoTIFFFile
 	    GTIFWriteKeys( geotiff->gtif );
 	    GTIFFree( geotiff->gtif );
 	    XTIFFClose( geotiff->tif );
+
+	    /* the overviews of a cloud optimized GeoTIFF, which is then put
+	       together from the temporary files */
+	    for ( l = 1; l < geotiff->nlevels; l++ )
+		TIFFClose( geotiff->levels[l].tif );
+	    if ( geotiff->nlevels > 0 && geotiff->levels[0].filename )
+		status = WriteCOGFile( filedescriptor );
+
+	    for ( l = 0; l < geotiff->nlevels; l++ )
+	    {
+		free( geotiff->levels[l].filename );
+		free( geotiff->levels[l].tilerows );
+	    }
+	    for ( l = 0; l < 3; l++ )
+		free( geotiff->reduce[l] );
+	    free( geotiff->levels );
+	    free( geotiff->tilebuf );
+	    free( geotiff );
 	    DestroyFileDescriptor( filedescriptor );
-	    break;
+	    return ( status );
 
 	default:
 	    ErrorHandler( TRUE, "CloseGeoTIFFFile", ERROR_GENERAL,
@@ -9,6 +9,10 @@ HISTORY:
 Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          04/00  John Weiss             Original Development
+         10/26                         Added -threads
+         10/26                         Added -v to the mosaic usage
+         10/26                         Added the crop usage
+         10/26                         Added the zonal statistics options
 
 HARDWARE AND/OR SOFTWARE LIMITATIONS:  
   None
@@ -37,6 +41,9 @@ Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          04/00  John Weiss             Original Development
          01/01  John Rishea            Standardized formatting
+         10/26                         Added -batch
+         10/26                         Added -zonal and -zonal_bins
+         10/26                         A failed batch job doesn't end -batch
   
 NOTES:
 
@@ -75,11 +82,26 @@ void Usage
 		     "            to be processed in the product.\n");
     fprintf( stderr, "   -u UTM_zone\n" );
     fprintf( stderr, "   -x pixel_size\n" );
+    fprintf( stderr, "   -threads number_of_threads (0 = one per "
+        "processor)\n" );
+    fprintf( stderr, "   -zonal label_file (raw binary header of zone "
+        "labels on the output grid;\n"
+        "          writes the statistics of each band in each zone to\n"
+        "          output_file_name without its extension + .zonal.csv)\n" );
+    fprintf( stderr, "   -zonal_bins number_of_histogram_bins (default "
+        "0)\n" );
     fprintf( stderr, "   -g filename for the log file\n" );
     fprintf( stderr, "\n" );
     fprintf( stderr, "Usage: resample -h file.hdf\n" );
     fprintf( stderr, "       creates raw binary header file TmpHdr.hdr\n" );
     fprintf( stderr, "\n" );
+    fprintf( stderr, "Usage: resample -batch batch_file [-g log_file]\n" );
+    fprintf( stderr, "       runs each line of batch_file (the options "
+        "above, starting with\n"
+        "       -p parameter_file) as a job, all in the one process.  A job\n"
+        "       which fails, even with a fatal error, is logged and the rest\n"
+        "       of the batch still runs\n" );
+    fprintf( stderr, "\n" );
 }
 
 
@@ -98,6 +120,14 @@ HISTORY:
 Version  Date   Programmer       Code  Reason
 -------  -----  ---------------  ----  -------------------------------------
          03/02  Gail Schmidt           Original Development
+         10/26                         Added -threads
+         10/26                         Added -v
+         10/26                         Added -tile_size and -deflate
+         10/26                         Added -r and -l
+         10/26                         Added -batch
+         10/26                         A failed batch job doesn't end -batch
+         10/26                         -threads is for raw binary mosaics
+                                       only
 
 NOTES:
 
@@ -109,11 +139,21 @@ void MosaicUsage
 )
 {
     fprintf( stderr,
-        "Usage: mrtmosaic -i input_filenames_file -t -h -o output_filename\n" );
+        "Usage: mrtmosaic -i input_filenames_file -t -h -v -o output_filename\n" );
     fprintf( stderr,
         "                 -s spectral_subset \"b1 b2 ... bN\"\n" );
     fprintf( stderr,
         "                 -g filename for the log file\n" );
+    fprintf( stderr,
+        "                 -threads number_of_threads\n" );
+    fprintf( stderr,
+        "                 -tile_size tile_size\n" );
+    fprintf( stderr,
+        "                 -deflate level\n" );
+    fprintf( stderr,
+        "                 -r region_file -l region_list\n" );
+    fprintf( stderr,
+        "       mrtmosaic -batch batch_file [-g log_file]\n" );
     fprintf( stderr,
         "   where input_filenames_file is a text file which contains the\n"
         "   names of the files to be mosaicked.\n"
@@ -129,6 +169,27 @@ void MosaicUsage
         "   to be used with the -t switch (i.e mod09ghk_h02v16.hdr).\n"
         "   If -h is specified then the mosaicked header information will\n"
         "   be output to TmpHdr.hdr (-o, -s, and -t are not needed).\n"
+        "   If -v is specified then nothing is mosaicked; output_filename\n"
+        "   (a .hdr file) gets the mosaicked header information and the\n"
+        "   list of tiles, and the resampler reads the tiles as one image\n"
+        "   (-s is not allowed; subset the bands when resampling).\n"
+        "   -threads mosaics raw binary output (-o file.hdr) on that many\n"
+        "   threads (0 = one per processor, default 1).  HDF-EOS output is\n"
+        "   always mosaicked on one thread, since the HDF library isn't\n"
+        "   thread-safe, so -threads doesn't speed it up.\n"
+        "   -tile_size writes HDF-EOS fields in tiles of about that many\n"
+        "   pixels (a multiple of 16), and -deflate compresses them at\n"
+        "   that level (1-9).\n"
+        "   Compressed fields are tiled (256 pixels unless -tile_size is\n"
+        "   given).\n"
+        "   -r reads only the tiles and lines that the regions in\n"
+        "   region_file touch: the polygons of a shapefile (.shp), or\n"
+        "   lat/long boxes, one \"ul_lat ul_lon lr_lat lr_lon\" per line.\n"
+        "   -l limits a region shapefile to the GEOID codes listed in\n"
+        "   region_list.\n"
+        "   -batch runs each line of batch_file (the switches above) as a\n"
+        "   job, all in the one process.  A job which fails, even with a\n"
+        "   fatal error, is logged and the rest of the batch still runs.\n"
         "   NOTE: Only input Sinusoidal and Integerized Sinusoidal\n"
         "   projections are supported for mosaicking.\n" );
     fprintf( stderr, "\n" );
@@ -187,3 +248,62 @@ void HDF2RB_Usage
     fprintf( stderr, "   -g filename for the log file\n" );
     fprintf( stderr, "\n" );
 }
+
+/******************************************************************************
+
+MODULE:  CropUsage
+
+PURPOSE:  Print crop tool usage info to terminal
+
+RETURN VALUE:
+Type = none
+Value           Description
+-----           -----------
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+         10/26                         Added -z and -b
+  
+NOTES:
+
+******************************************************************************/
+
+void CropUsage
+(
+    void 
+)
+
+{
+    fprintf( stderr, "\n%s %s\n\n", CROP_NAME, CROP_VERSION );
+    fprintf( stderr, "Usage: mrtcrop -i input_file_name -c county_shapefile "
+        "-o output_directory [options]\n\n" );
+    fprintf( stderr, "   -i input_file_name (raw binary header, virtual "
+        "mosaic header, or HDF-EOS)\n" );
+    fprintf( stderr, "   -c shapefile of the county polygons, in "
+        "geographic coordinates\n" );
+    fprintf( stderr, "   -o output directory; the counties are written to "
+        "output_directory/date/code.band.tif\n" );
+    fprintf( stderr, "Options:\n" );
+    fprintf( stderr, "   -l file of the codes of the counties to crop "
+        "(default is all the counties)\n" );
+    fprintf( stderr, "   -d date of the input image (default is the part "
+        "of its name after the first '.')\n" );
+    fprintf( stderr, "   -f shapefile attribute with the county codes "
+        "(default is GEOID)\n" );
+    fprintf( stderr, "   -z writes the statistics of each band in each "
+        "county to\n"
+        "      output_directory/date.csv instead of cropping\n" );
+    fprintf( stderr, "   -b number of histogram bins for -z (default 0)\n" );
+    fprintf( stderr, "   -s spectral_subset \"b1 b2 ... bN\"\n" );
+    fprintf( stderr, "   If using the -s switch, the SDSs should be "
+        "represented as an\n"
+        "   array of 0s and 1s. A '1' specifies to process that SDS;\n"
+        "   '0' specifies to skip that SDS. Unspecified SDSs will not be "
+        "processed.\n"
+        "   If the -s switch is not specified, then all SDSs will be "
+        "processed.\n");
+    fprintf( stderr, "   -g filename for the log file\n" );
+    fprintf( stderr, "\n" );
+}
@@ -0,0 +1,82 @@
+/******************************************************************************
+
+FILE:  vm_io.c
+
+PURPOSE:  Read rows from virtual mosaic files
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+HARDWARE AND/OR SOFTWARE LIMITATIONS:
+  None
+
+PROJECT:    MODIS Reprojection Tool
+
+NOTES:
+  See vm_oc.c.
+
+******************************************************************************/
+#include "shared_resample.h"
+
+/******************************************************************************
+
+MODULE:  ReadRowVirtualMosaic
+
+PURPOSE:  Read a row of a virtual mosaic from the rows of its tiles
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            Success
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Raw binary tile rows are copied straight from the tile's memory mapping
+  when they can be.  A missing tile, or a tile row that can't be read, is
+  background fill, as it is in a mosaic written by mrtmosaic.
+
+******************************************************************************/
+int ReadRowVirtualMosaic
+(
+    FileDescriptor *file,	/* I/O:  file to read */
+    int row			/* I:  row number to read */
+)
+
+{
+    VirtualMosaicFD *vm = ( VirtualMosaicFD * ) file->fileptr;
+    FileDescriptor *tile;	/* band of the tile */
+    size_t trow;		/* row in the tiles */
+    size_t rowsize;		/* bytes in a tile row */
+    void *data;			/* the tile row */
+    int v, h;
+
+    v = row / vm->tile_nrows;
+    trow = row % vm->tile_nrows;
+    rowsize = vm->tile_ncols * file->datasize;
+
+    for ( h = 0; h < vm->numh_tiles; h++ )
+    {
+	data = vm->background;
+	tile = GetVirtualMosaicTile( file, v * vm->numh_tiles + h );
+	if ( tile )
+	{
+	    data = NULL;
+	    if ( tile->filetype == RAW_BINARY )
+		data = MapRowMultiFile( tile, trow, 1 );
+	    if ( !data )
+		data = ReadRowNative( tile, trow ) ? tile->rowbuffer :
+		    vm->background;
+	}
+
+	memcpy( ( char * ) file->rowbuffer + h * rowsize, data, rowsize );
+    }
+
+    return ( TRUE );
+}
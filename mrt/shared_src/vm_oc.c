@@ -0,0 +1,505 @@
+/******************************************************************************
+
+FILE:  vm_oc.c
+
+PURPOSE:  Open and close virtual mosaic files
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+         10/26                         Key the tile headers by file name
+
+HARDWARE AND/OR SOFTWARE LIMITATIONS:
+  None
+
+PROJECT:    MODIS Reprojection Tool
+
+NOTES:
+  1. A virtual mosaic is a raw binary header for a mosaic (as written by
+     mrtmosaic -v) with a MOSAIC_TILES field listing the tiles instead of
+     .dat files.  A band of it is read as one image, each row being put
+     together from the rows of the tiles (see vm_io.c), so the tiles can be
+     resampled without writing the mosaic first.
+  2. The tiles (raw binary or HDF-EOS) are opened the first time a row of
+     them is needed.  At most MAX_OPEN_VIRTUAL_TILES are kept open; the
+     least recently used one is closed to make room.
+  3. The header of each tile is read once, when the first band is opened,
+     and kept until FreeVirtualMosaic.  A header is only used again for a
+     tile of the same name, so a later batch job with other tiles reads
+     their headers.
+
+******************************************************************************/
+#include "shared_resample.h"
+
+/* headers of the tiles, numv_tiles rows of numh_tiles (NULL if not read
+   yet) */
+static ModisDescriptor **tile_info = NULL;
+static int ntile_info = 0;
+
+static void FreeVirtualTileInfo( ModisDescriptor *info );
+
+/******************************************************************************
+
+MODULE:  ReadVirtualTileInfo
+
+PURPOSE:  Read the header of a tile of a virtual mosaic
+
+RETURN VALUE:
+Type = ModisDescriptor *
+Value           Description
+-----           -----------
+info            The tile's header
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The header is kept for the other bands, and for later runs with the same
+  tile in the same place.  Errors are fatal.
+
+******************************************************************************/
+static ModisDescriptor *ReadVirtualTileInfo
+(
+    VirtualMosaicFD *vm,	/* I:  the virtual mosaic */
+    int tile			/* I:  the tile (v * numh_tiles + h) */
+)
+
+{
+    ModisDescriptor *info;	/* the tile's header */
+    int ntiles = vm->numh_tiles * vm->numv_tiles;
+    char errstr[LARGE_STRING];
+
+    /* the headers kept are of a mosaic with another layout of tiles */
+    if ( tile_info != NULL && ntile_info != ntiles )
+	FreeVirtualMosaic( );
+
+    if ( tile_info == NULL )
+    {
+	tile_info = ( ModisDescriptor ** )
+	    calloc( ntiles, sizeof( ModisDescriptor * ) );
+	if ( !tile_info )
+	    ErrorHandler( TRUE, "ReadVirtualTileInfo", ERROR_MEMORY,
+		"Virtual Mosaic Tiles" );
+	ntile_info = ntiles;
+    }
+
+    if ( tile_info[tile] )
+    {
+	if ( strcmp( tile_info[tile]->input_filename,
+	    vm->tile_filenames[tile] ) == 0 )
+	    return ( tile_info[tile] );
+
+	/* another tile was here */
+	FreeVirtualTileInfo( tile_info[tile] );
+	tile_info[tile] = NULL;
+    }
+
+    info = ( ModisDescriptor * ) calloc( 1, sizeof( ModisDescriptor ) );
+    if ( !info )
+	ErrorHandler( TRUE, "ReadVirtualTileInfo", ERROR_MEMORY,
+	    "Virtual Mosaic Tile" );
+    InitializeModisDescriptor( info );
+    info->input_filename = strdup( vm->tile_filenames[tile] );
+    if ( !info->input_filename )
+	ErrorHandler( TRUE, "ReadVirtualTileInfo", ERROR_MEMORY,
+	    "Virtual Mosaic Tile" );
+
+    /* the tile rows are read top to bottom */
+    info->resampling_type = NO_RESAMPLE;
+
+    GetInputFileExt( info->input_filename, &info->input_filetype );
+    switch ( info->input_filetype )
+    {
+	case RAW_BINARY:
+	    ReadHeaderFile( info );
+	    break;
+
+	case HDFEOS:
+	    ReadHDFHeader( info );
+	    break;
+    }
+
+    /* a tile can't be another virtual mosaic */
+    if ( info->input_filetype != RAW_BINARY &&
+	 info->input_filetype != HDFEOS )
+    {
+	sprintf( errstr, "Tile %s of the virtual mosaic must be a raw binary "
+	    "header or an HDF-EOS file", info->input_filename );
+	ErrorHandler( TRUE, "ReadVirtualTileInfo", ERROR_OPEN_INPUTIMAGE,
+	    errstr );
+    }
+
+    tile_info[tile] = info;
+    return ( info );
+}
+
+/******************************************************************************
+
+MODULE:  OpenVirtualMosaic
+
+PURPOSE:  Open a band of a virtual mosaic for reading
+
+RETURN VALUE:
+Type = FileDescriptor
+Value           Description
+-----           -----------
+file            Success
+NULL            Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  No tile is opened here, but the headers of all the tiles are read.
+  Missing tiles read as the background fill.
+
+******************************************************************************/
+FileDescriptor *OpenVirtualMosaic
+(
+    ModisDescriptor *modis,	/* I:  session info */
+    FileOpenType mode,		/* I:  reading (virtual mosaics can't be
+                                       written) */
+    int bandnum,		/* I:  band number to read */
+    int *status			/* O:  error status */
+)
+
+{
+    FileDescriptor *file = NULL;	/* new file descriptor */
+    VirtualMosaicFD *vm = NULL;		/* the tiles */
+    double *fill = NULL;		/* a row of background fill */
+    int ntiles;				/* number of tiles */
+    size_t i;
+
+    if ( mode != FILE_READ_MODE )
+    {
+	ErrorHandler( TRUE, "OpenVirtualMosaic", ERROR_OPEN_OUTPUTIMAGE,
+	    "A virtual mosaic can only be read" );
+	*status = ERROR_OPEN_OUTPUTIMAGE;
+	return ( NULL );
+    }
+
+    /* create a descriptor using this band */
+    file = CreateFileDescriptor( modis, bandnum, mode, modis->input_filename );
+    if ( !file )
+    {
+	*status = ERROR_OPEN_INPUTIMAGE;
+	return ( NULL );
+    }
+
+    ntiles = modis->numh_tiles * modis->numv_tiles;
+    vm = ( VirtualMosaicFD * ) calloc( 1, sizeof( VirtualMosaicFD ) );
+    if ( vm )
+    {
+	vm->tiles = ( FileDescriptor ** )
+	    calloc( ntiles, sizeof( FileDescriptor * ) );
+	vm->tile_hdfptrs = ( HdfEosFD ** )
+	    calloc( ntiles, sizeof( HdfEosFD * ) );
+	vm->last_use = ( unsigned long * )
+	    calloc( ntiles, sizeof( unsigned long ) );
+	vm->background = calloc( file->ncols, file->datasize );
+    }
+    fill = ( double * ) malloc( file->ncols * sizeof( double ) );
+    if ( !vm || !vm->tiles || !vm->tile_hdfptrs || !vm->last_use ||
+	 !vm->background || !fill )
+	ErrorHandler( TRUE, "OpenVirtualMosaic", ERROR_MEMORY,
+	    "Virtual Mosaic Descriptor" );
+
+    vm->numh_tiles = modis->numh_tiles;
+    vm->numv_tiles = modis->numv_tiles;
+    vm->tile_nrows = file->nrows / vm->numv_tiles;
+    vm->tile_ncols = file->ncols / vm->numh_tiles;
+    vm->tile_filenames = modis->tile_filenames;
+    file->fileptr = vm;
+
+    if ( vm->tile_nrows * vm->numv_tiles != file->nrows ||
+	 vm->tile_ncols * vm->numh_tiles != file->ncols )
+    {
+	ErrorHandler( TRUE, "OpenVirtualMosaic", ERROR_OPEN_INPUTIMAGE,
+	    "The virtual mosaic size isn't a whole number of tiles" );
+	*status = ERROR_OPEN_INPUTIMAGE;
+	free( fill );
+	CloseVirtualMosaic( file );
+	return ( NULL );
+    }
+
+    /* read the tile headers now: reading an HDF-EOS header sets up GCTP,
+       which mustn't happen once the resampler has set up its projections */
+    for ( i = 0; i < ( size_t ) ntiles; i++ )
+	if ( vm->tile_filenames[i] )
+	    ReadVirtualTileInfo( vm, ( int ) i );
+
+    /* a row of a missing tile, in the band's data type */
+    if ( !SelectRowConverters( file ) )
+	ErrorHandler( TRUE, "OpenVirtualMosaic", ERROR_GENERAL,
+	    "Bad data type" );
+    for ( i = 0; i < file->ncols; i++ )
+	fill[i] = file->background_fill;
+    file->write_convert( fill, vm->background, vm->tile_ncols );
+    free( fill );
+
+    return ( file );
+}
+
+/******************************************************************************
+
+MODULE:  CloseVirtualTile
+
+PURPOSE:  Close a tile of a virtual mosaic
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+
+******************************************************************************/
+static void CloseVirtualTile
+(
+    VirtualMosaicFD *vm,	/* I/O:  the virtual mosaic */
+    int tile			/* I:  the tile to close */
+)
+
+{
+    if ( vm->tiles[tile] == NULL )
+	return;
+
+    if ( vm->tile_hdfptrs[tile] )
+    {
+	DestroyFileDescriptor( vm->tiles[tile] );
+	CloseHdfEos( vm->tile_hdfptrs[tile] );
+	vm->tile_hdfptrs[tile] = NULL;
+    }
+    else
+	CloseFile( vm->tiles[tile] );
+
+    vm->tiles[tile] = NULL;
+    vm->nopen--;
+}
+
+/******************************************************************************
+
+MODULE:  GetVirtualMosaicTile
+
+PURPOSE:  Get the band of a tile of a virtual mosaic, opening it if needed
+
+RETURN VALUE:
+Type = FileDescriptor *
+Value           Description
+-----           -----------
+tile            The band of the tile
+NULL            The tile is missing
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The tile's band must be the same size and data type as its part of the
+  virtual mosaic.  Errors opening the tile are fatal.
+
+******************************************************************************/
+FileDescriptor *GetVirtualMosaicTile
+(
+    FileDescriptor *file,	/* I/O:  band of the virtual mosaic */
+    int tile			/* I:  the tile (v * numh_tiles + h) */
+)
+
+{
+    VirtualMosaicFD *vm = ( VirtualMosaicFD * ) file->fileptr;
+    ModisDescriptor *info;	/* the tile's header */
+    FileDescriptor *input = NULL;	/* band of the tile */
+    HdfEosFD *hdfptr = NULL;	/* the tile's HDF-EOS file */
+    int ntiles = vm->numh_tiles * vm->numv_tiles;
+    int i, oldest;
+    int status = MRT_NO_ERROR;
+    char errstr[LARGE_STRING];
+
+    vm->last_use[tile] = ++vm->use_count;
+    if ( vm->tiles[tile] )
+	return ( vm->tiles[tile] );
+    if ( vm->tile_filenames[tile] == NULL )
+	return ( NULL );
+
+    /* make room */
+    while ( vm->nopen >= MAX_OPEN_VIRTUAL_TILES )
+    {
+	oldest = -1;
+	for ( i = 0; i < ntiles; i++ )
+	    if ( vm->tiles[i] &&
+		 ( oldest < 0 || vm->last_use[i] < vm->last_use[oldest] ) )
+		oldest = i;
+	CloseVirtualTile( vm, oldest );
+    }
+
+    /* open the same band of the tile */
+    info = ReadVirtualTileInfo( vm, tile );
+    if ( ( size_t ) file->bandnum >= info->nbands )
+    {
+	sprintf( errstr, "Tile %s of the virtual mosaic has no band %d",
+	    info->input_filename, file->bandnum + 1 );
+	ErrorHandler( TRUE, "GetVirtualMosaicTile", ERROR_OPEN_INPUTIMAGE,
+	    errstr );
+    }
+
+    if ( info->input_filetype == HDFEOS )
+    {
+	hdfptr = OpenHdfEosFile( info->input_filename, "", FILE_READ_MODE,
+	    &status );
+	if ( hdfptr )
+	    input = MakeHdfEosFD( info, hdfptr, FILE_READ_MODE,
+		file->bandnum, &status );
+	if ( input )
+	    GetHdfEosField( info, hdfptr, file->bandnum );
+    }
+    else
+	input = OpenMultiFile( info, FILE_READ_MODE, file->bandnum, &status );
+
+    if ( !input )
+    {
+	sprintf( errstr, "Unable to open tile %s of the virtual mosaic",
+	    info->input_filename );
+	ErrorHandler( TRUE, "GetVirtualMosaicTile", ERROR_OPEN_INPUTIMAGE,
+	    errstr );
+    }
+
+    /* the rows are read once each, straight into the virtual row */
+    DestroyFileBuffers( input );
+
+    vm->tiles[tile] = input;
+    vm->tile_hdfptrs[tile] = hdfptr;
+    vm->nopen++;
+
+    if ( input->nrows != vm->tile_nrows || input->ncols != vm->tile_ncols ||
+	 input->datatype != file->datatype )
+    {
+	sprintf( errstr, "Band %d of tile %s doesn't match the virtual mosaic "
+	    "(size or data type)", file->bandnum + 1, info->input_filename );
+	ErrorHandler( TRUE, "GetVirtualMosaicTile", ERROR_OPEN_INPUTIMAGE,
+	    errstr );
+    }
+
+    return ( input );
+}
+
+/******************************************************************************
+
+MODULE:  CloseVirtualMosaic
+
+PURPOSE:  Close a band of a virtual mosaic and its open tiles
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            Always
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+
+******************************************************************************/
+int CloseVirtualMosaic
+(
+    FileDescriptor *filedescriptor	/* I:  the file to close */
+)
+
+{
+    VirtualMosaicFD *vm = ( VirtualMosaicFD * ) filedescriptor->fileptr;
+    int i;
+
+    if ( vm )
+    {
+	if ( vm->tiles )
+	    for ( i = 0; i < vm->numh_tiles * vm->numv_tiles; i++ )
+		CloseVirtualTile( vm, i );
+	free( vm->tiles );
+	free( vm->tile_hdfptrs );
+	free( vm->last_use );
+	free( vm->background );
+	free( vm );
+    }
+
+    DestroyFileDescriptor( filedescriptor );
+
+    return ( TRUE );
+}
+
+/******************************************************************************
+
+MODULE:  FreeVirtualTileInfo
+
+PURPOSE:  Free the header of a tile
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+
+******************************************************************************/
+static void FreeVirtualTileInfo
+(
+    ModisDescriptor *info	/* I:  the header to free */
+)
+
+{
+    size_t k;
+
+    for ( k = 0; info->bandinfo && k < info->nbands; k++ )
+	free( info->bandinfo[k].name );
+    free( info->bandinfo );
+    free( info->input_filename );
+    free( info );
+}
+
+/******************************************************************************
+
+MODULE:  FreeVirtualMosaic
+
+PURPOSE:  Free the tile headers kept for virtual mosaics
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Called at the end of the run; it does nothing if no tile was read.
+
+******************************************************************************/
+void FreeVirtualMosaic
+(
+    void
+)
+
+{
+    int i;
+
+    for ( i = 0; i < ntile_info; i++ )
+	if ( tile_info[i] )
+	    FreeVirtualTileInfo( tile_info[i] );
+
+    free( tile_info );
+    tile_info = NULL;
+    ntile_info = 0;
+}
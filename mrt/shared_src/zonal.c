@@ -0,0 +1,893 @@
+/******************************************************************************
+
+FILE:  zonal.c
+
+PURPOSE:  Gather statistics of image bands in zones (counties) as their rows
+          go by, and write them as a table
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+HARDWARE AND/OR SOFTWARE LIMITATIONS:
+  None
+
+PROJECT:    MODIS Reprojection Tool
+
+NOTES:
+  A ZonalTable holds the zones and, for each band added to it, the count,
+  sum, sum of squares, smallest and largest of the valid pixels in each
+  zone, and optionally a histogram.  Nothing but the table is kept, so the
+  statistics of thousands of counties take the memory of a few rows of the
+  image.
+
+  The zones come either from a label raster, a raw binary image (.hdr) of
+  the output grid whose pixels hold the label of their zone, or from the
+  caller (the crop tool's county polygons), which adds runs of pixels to a
+  zone itself.  With a label raster, a band is gathered as it's written: a
+  FileDescriptor with its zonal field set adds each row WriteRow or
+  WriteRowNative writes to the band's statistics.
+
+  A pixel is valid if it isn't the band's fill value and, if the band has a
+  valid range (max_value > min_value), is inside it.  Values are as stored,
+  without the scale factor and offset.  The histogram has nbins bins of the
+  same width from min_value to max_value.
+
+******************************************************************************/
+#include <math.h>
+#include "mrt_dtype.h"
+#include "shared_resample.h"
+
+static ZonalTable *AllocZonalTable( int nzones, int nbins );
+static int InsertZonalLabel( long label, long **labels, int *nlabels,
+    int *maxlabels );
+static int FindZonalLabel( ZonalTable *table, long label );
+
+/******************************************************************************
+
+MODULE:  CreateZonalTable
+
+PURPOSE:  Create a table of zones whose pixels are added by the caller
+
+RETURN VALUE:
+Type = ZonalTable *
+Value           Description
+-----           -----------
+table           The table, without bands
+NULL            Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Pixels are added to zone i (codes[i]) with AccumulateZonalRun.
+
+******************************************************************************/
+ZonalTable *CreateZonalTable
+(
+    int nzones,			/* I:  number of zones */
+    char *codes[],		/* I:  code of each zone */
+    int nbins			/* I:  histogram bins (0 = no histogram) */
+)
+
+{
+    ZonalTable *table;		/* the table */
+    int i;
+
+    table = AllocZonalTable( nzones, nbins );
+    if ( !table )
+	return ( NULL );
+
+    for ( i = 0; i < nzones; i++ )
+    {
+	table->codes[i] = strdup( codes[i] );
+	if ( !table->codes[i] )
+	{
+	    ErrorHandler( FALSE, "CreateZonalTable", ERROR_MEMORY,
+		"Zone codes" );
+	    CloseZonalTable( table );
+	    return ( NULL );
+	}
+    }
+
+    return ( table );
+}
+
+/******************************************************************************
+
+MODULE:  OpenZonalLabels
+
+PURPOSE:  Open a label raster and create a table of its zones
+
+RETURN VALUE:
+Type = ZonalTable *
+Value           Description
+-----           -----------
+table           The table, without bands
+NULL            Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The label raster is a raw binary image (.hdr) whose first band holds
+  integer labels.  Each positive label other than the band's fill value is
+  a zone, coded as the label itself; pixels of 0, negative or fill labels
+  aren't in any zone.  The raster is read once here to find the labels,
+  then again, row by row, as the bands are written (AccumulateZonalRow).
+
+******************************************************************************/
+ZonalTable *OpenZonalLabels
+(
+    char *label_filename,	/* I:  label raster (.hdr) */
+    int nbins			/* I:  histogram bins (0 = no histogram) */
+)
+
+{
+    ModisDescriptor *modis;	/* header of the label raster */
+    FileDescriptor *labels;	/* the label band */
+    ZonalTable *table = NULL;	/* the table */
+    double *row_labels = NULL;	/* a row of the label raster */
+    long *zones = NULL;		/* labels found, ascending */
+    int nzones = 0, maxzones = 0;  /* labels found, and room for them */
+    long label, last = 0;	/* label of a pixel, and of the last zone */
+    int status;			/* error status */
+    size_t row, col;
+    int i;
+    char errstr[LARGE_STRING + 64];  /* error message */
+
+    modis = ( ModisDescriptor * ) calloc( 1, sizeof( ModisDescriptor ) );
+    if ( !modis )
+    {
+	ErrorHandler( FALSE, "OpenZonalLabels", ERROR_MEMORY,
+	    "ModisDescriptor" );
+	return ( NULL );
+    }
+    InitializeModisDescriptor( modis );
+    modis->input_filename = strdup( label_filename );
+    if ( !modis->input_filename )
+    {
+	ErrorHandler( FALSE, "OpenZonalLabels", ERROR_MEMORY,
+	    "Label file name" );
+	free( modis );
+	return ( NULL );
+    }
+
+    /* read the header and open the first band */
+    labels = NULL;
+    status = GetInputFileExt( label_filename, &modis->input_filetype );
+    if ( status == MRT_NO_ERROR && modis->input_filetype != RAW_BINARY )
+	status = ERROR_ZONAL_FIELD;
+    if ( status == MRT_NO_ERROR )
+	status = ReadHeaderFile( modis );
+    if ( status == MRT_NO_ERROR )
+    {
+	modis->in_projection_info = GetInputProjection( modis );
+	labels = OpenInImage( modis, 0, &status );
+    }
+    if ( !labels )
+    {
+	sprintf( errstr, "Unable to open the zone label raster %s (it must "
+	    "be a raw binary .hdr file)", label_filename );
+	ErrorHandler( FALSE, "OpenZonalLabels", ERROR_ZONAL_FIELD, errstr );
+	FreeModisDescriptor( modis );
+	free( modis );
+	return ( NULL );
+    }
+    ClobberFileBuffers( labels );
+    GetInputImageCorners( modis, labels );
+
+    row_labels = ( double * ) calloc( labels->ncols, sizeof( double ) );
+    if ( !row_labels )
+    {
+	ErrorHandler( FALSE, "OpenZonalLabels", ERROR_MEMORY, "Label row" );
+	goto fail;
+    }
+
+    /* find the labels */
+    for ( row = 0; row < labels->nrows; row++ )
+    {
+	if ( !ReadRow( labels, ( int ) row, row_labels ) )
+	{
+	    sprintf( errstr, "Unable to read row " MRT_SIZE_T_FMT " of %s",
+		row, label_filename );
+	    ErrorHandler( FALSE, "OpenZonalLabels", ERROR_READ_INPUTIMAGE,
+		errstr );
+	    goto fail;
+	}
+
+	for ( col = 0; col < labels->ncols; col++ )
+	{
+	    if ( row_labels[col] <= 0.0 ||
+		 row_labels[col] == labels->background_fill )
+		continue;
+	    label = ( long ) row_labels[col];
+	    if ( nzones > 0 && label == last )
+		continue;
+	    if ( !InsertZonalLabel( label, &zones, &nzones, &maxzones ) )
+		goto fail;
+	    last = label;
+	}
+    }
+
+    table = AllocZonalTable( nzones, nbins );
+    if ( !table )
+	goto fail;
+    table->labels = zones;
+    zones = NULL;
+    for ( i = 0; i < nzones; i++ )
+    {
+	sprintf( errstr, "%ld", table->labels[i] );
+	table->codes[i] = strdup( errstr );
+	if ( !table->codes[i] )
+	{
+	    ErrorHandler( FALSE, "OpenZonalLabels", ERROR_MEMORY,
+		"Zone codes" );
+	    goto fail;
+	}
+    }
+    table->label_file = labels;
+    table->label_proj_code = modis->in_projection_info->proj_code;
+    table->label_row = row_labels;
+
+    FreeModisDescriptor( modis );
+    free( modis );
+
+    MessageHandler( "OpenZonalLabels", "%d zones in %s", nzones,
+	label_filename );
+    return ( table );
+
+fail:
+    if ( table )
+    {
+	table->label_file = NULL;
+	table->label_row = NULL;
+	CloseZonalTable( table );
+    }
+    free( zones );
+    free( row_labels );
+    CloseFile( labels );
+    FreeModisDescriptor( modis );
+    free( modis );
+    return ( NULL );
+}
+
+/******************************************************************************
+
+MODULE:  AddZonalBand
+
+PURPOSE:  Add a band to a table of zones
+
+RETURN VALUE:
+Type = ZonalBand *
+Value           Description
+-----           -----------
+band            The band, with empty statistics in every zone
+NULL            Failure
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The bands are written to the table in the order they're added.
+
+******************************************************************************/
+ZonalBand *AddZonalBand
+(
+    ZonalTable *table,		/* I/O:  the zones */
+    char *name,			/* I:  band name */
+    double fill,		/* I:  background fill value */
+    double min_value,		/* I:  smallest valid value */
+    double max_value		/* I:  largest valid value (the band has no
+				       valid range if not > min_value) */
+)
+
+{
+    ZonalBand *band;		/* the band */
+    int with_hist;		/* does the band get histograms? */
+    size_t *hist = NULL;	/* histograms of the zones */
+    int i;
+
+    with_hist = table->nbins > 0 && table->nzones > 0 &&
+	max_value > min_value;
+    band = ( ZonalBand * ) calloc( 1, sizeof( ZonalBand ) );
+    if ( band )
+    {
+	band->name = strdup( name );
+	band->stats = ( ZonalStats * ) calloc( table->nzones > 0 ?
+	    table->nzones : 1, sizeof( ZonalStats ) );
+	if ( with_hist )
+	    hist = ( size_t * ) calloc( ( size_t ) table->nzones *
+		table->nbins, sizeof( size_t ) );
+    }
+    if ( !band || !band->name || !band->stats || ( with_hist && !hist ) )
+    {
+	ErrorHandler( FALSE, "AddZonalBand", ERROR_MEMORY,
+	    "Zonal statistics" );
+	if ( band )
+	{
+	    free( band->name );
+	    free( band->stats );
+	    free( band );
+	}
+	free( hist );
+	return ( NULL );
+    }
+
+    band->table = table;
+    band->fill = fill;
+    band->min_value = min_value;
+    band->max_value = max_value;
+    for ( i = 0; i < table->nzones; i++ )
+    {
+	band->stats[i].min = HUGE_VAL;
+	band->stats[i].max = -HUGE_VAL;
+	band->stats[i].hist = hist ? hist + ( size_t ) i * table->nbins :
+	    NULL;
+    }
+
+    if ( table->last_band )
+	table->last_band->next = band;
+    else
+	table->bands = band;
+    table->last_band = band;
+
+    return ( band );
+}
+
+/******************************************************************************
+
+MODULE:  AttachZonalBand
+
+PURPOSE:  Gather the statistics of a band from the rows written to an output
+          file, using the table's label raster
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            The band is attached
+FALSE           The table has no label raster, or it isn't in the output
+                projection
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  The size and corners of the output file are checked against the label
+  raster when its first row is written, since they aren't set until then.
+
+******************************************************************************/
+int AttachZonalBand
+(
+    ZonalBand *band,		/* I:  band of a table with a label raster */
+    FileDescriptor *output,	/* I/O:  output file the band is written to */
+    long proj_code		/* I:  GCTP projection of the output */
+)
+
+{
+    ZonalTable *table = band->table;	/* the zones */
+    char errstr[SMALL_STRING];		/* error message */
+
+    if ( !table->label_file )
+    {
+	ErrorHandler( FALSE, "AttachZonalBand", ERROR_ZONAL_FIELD,
+	    "The zones have no label raster" );
+	return ( FALSE );
+    }
+
+    if ( proj_code != table->label_proj_code )
+    {
+	sprintf( errstr, "The zone label raster isn't in the output "
+	    "projection (GCTP code %ld, not %ld)", table->label_proj_code,
+	    proj_code );
+	ErrorHandler( FALSE, "AttachZonalBand", ERROR_ZONAL_FIELD, errstr );
+	return ( FALSE );
+    }
+
+    band->checked = FALSE;
+    output->zonal = band;
+    return ( TRUE );
+}
+
+/******************************************************************************
+
+MODULE:  AccumulateZonalRun
+
+PURPOSE:  Add a run of pixels to the statistics of a zone
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+
+******************************************************************************/
+void AccumulateZonalRun
+(
+    ZonalBand *band,		/* I/O:  band whose statistics are added to */
+    int zone,			/* I:  zone the pixels are in */
+    double *values,		/* I:  the pixels */
+    size_t n			/* I:  number of pixels */
+)
+
+{
+    ZonalStats *z = &band->stats[zone];  /* statistics of the zone */
+    int ranged;			/* does the band have a valid range? */
+    int nbins = band->table->nbins;  /* histogram bins */
+    double binscale = 0.0;	/* bins per unit of value */
+    double v;			/* a pixel */
+    int bin;
+    size_t i;
+
+    ranged = band->max_value > band->min_value;
+    if ( z->hist )
+	binscale = nbins / ( band->max_value - band->min_value );
+
+    for ( i = 0; i < n; i++ )
+    {
+	v = values[i];
+	if ( v == band->fill ||
+	     ( ranged && ( v < band->min_value || v > band->max_value ) ) )
+	    continue;
+
+	z->count++;
+	z->sum += v;
+	z->sumsq += v * v;
+	if ( v < z->min )
+	    z->min = v;
+	if ( v > z->max )
+	    z->max = v;
+
+	if ( z->hist )
+	{
+	    bin = ( int ) ( ( v - band->min_value ) * binscale );
+	    if ( bin >= nbins )
+		bin = nbins - 1;
+	    z->hist[bin]++;
+	}
+    }
+}
+
+/******************************************************************************
+
+MODULE:  AccumulateZonalRow
+
+PURPOSE:  Add the row in an output file's row buffer to the statistics of
+          the band attached to the file
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            Success
+FALSE           The label raster couldn't be read
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Called by WriteRow and WriteRowNative.  An output file which isn't on the
+  grid of the label raster (a band of another resolution, say) is only a
+  warning: the band is detached and left out of the table.
+
+  Runs of pixels with the same label are added at once, and the zone of a
+  label is looked up only when it changes.
+
+******************************************************************************/
+int AccumulateZonalRow
+(
+    FileDescriptor *file,	/* I/O:  output file, with the row to add in
+				         its row buffer */
+    int row			/* I:  row number */
+)
+
+{
+    ZonalBand *band = file->zonal;	/* band of the file */
+    ZonalTable *table = band->table;	/* the zones */
+    FileDescriptor *labels = table->label_file;  /* the label raster */
+    double *lrow = table->label_row;	/* a row of labels */
+    double tolerance;			/* largest corner difference */
+    long label;				/* label of a run */
+    int zone = -1;			/* zone of the run */
+    long zone_label = 0;		/* label of that zone */
+    size_t col, start;
+    int i;
+    char errstr[LARGE_STRING + 64];	/* error message */
+
+    if ( !band->checked )
+    {
+	band->checked = TRUE;
+	tolerance = 0.5 * labels->pixel_size;
+	for ( i = 0; i < 4; i++ )
+	{
+	    if ( fabs( file->coord_corners[i][0] -
+		       labels->coord_corners[i][0] ) > tolerance ||
+		 fabs( file->coord_corners[i][1] -
+		       labels->coord_corners[i][1] ) > tolerance )
+		break;
+	}
+	if ( file->nrows != labels->nrows || file->ncols != labels->ncols ||
+	     i < 4 )
+	{
+	    sprintf( errstr, "Band %s isn't on the grid of the zone label "
+		"raster, so it's left out of the zonal statistics",
+		band->name );
+	    ErrorHandler( FALSE, "AccumulateZonalRow", ERROR_ZONAL_FIELD,
+		errstr );
+	    free( band->stats[0].hist );
+	    free( band->stats );
+	    band->stats = NULL;
+	    file->zonal = NULL;
+	    return ( TRUE );
+	}
+
+	band->values = ( double * ) calloc( file->ncols, sizeof( double ) );
+	if ( !band->values )
+	{
+	    ErrorHandler( FALSE, "AccumulateZonalRow", ERROR_MEMORY,
+		"Zonal row" );
+	    return ( FALSE );
+	}
+    }
+
+    /* the row as stored, widened to double */
+    if ( file->convert_datatype != file->datatype &&
+	 !SelectRowConverters( file ) )
+	return ( FALSE );
+    file->read_convert( file->rowbuffer, band->values, file->ncols );
+
+    if ( !ReadRow( labels, row, lrow ) )
+    {
+	sprintf( errstr, "Unable to read row %d of the zone label raster",
+	    row );
+	ErrorHandler( FALSE, "AccumulateZonalRow", ERROR_READ_INPUTIMAGE,
+	    errstr );
+	return ( FALSE );
+    }
+
+    for ( col = 0; col < file->ncols; col = start )
+    {
+	start = col + 1;
+	if ( lrow[col] <= 0.0 || lrow[col] == labels->background_fill )
+	    continue;
+
+	/* the run of the label */
+	while ( start < file->ncols && lrow[start] == lrow[col] )
+	    start++;
+
+	label = ( long ) lrow[col];
+	if ( zone < 0 || label != zone_label )
+	{
+	    zone = FindZonalLabel( table, label );
+	    zone_label = label;
+	}
+	if ( zone >= 0 )
+	    AccumulateZonalRun( band, zone, &band->values[col], start - col );
+    }
+
+    return ( TRUE );
+}
+
+/******************************************************************************
+
+MODULE:  WriteZonalTable
+
+PURPOSE:  Write the statistics of each band in each zone as a CSV table
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            Success
+FALSE           The file couldn't be written
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  One line per band and zone:
+
+    zone,band,count,sum,sum_sq,min,max,mean[,bin_0,...,bin_<nbins-1>]
+
+  min, max and mean are empty for a zone with no valid pixels, and the
+  bins are empty for a band with no valid range.  The variance is
+  sum_sq / count - mean * mean, and sums can be added across dates or
+  zones.
+
+******************************************************************************/
+int WriteZonalTable
+(
+    ZonalTable *table,		/* I:  the statistics */
+    char *filename		/* I:  CSV file to write */
+)
+
+{
+    FILE *fp;			/* the CSV file */
+    ZonalBand *band;		/* a band of the table */
+    ZonalStats *z;		/* statistics of a band in a zone */
+    int i, j;
+    int nbands = 0;		/* bands written */
+    char errstr[LARGE_STRING + 64];  /* error message */
+
+    fp = fopen( filename, "w" );
+    if ( !fp )
+    {
+	sprintf( errstr, "Unable to open %s", filename );
+	ErrorHandler( FALSE, "WriteZonalTable", ERROR_OPEN_OUTPUTIMAGE,
+	    errstr );
+	return ( FALSE );
+    }
+
+    fprintf( fp, "zone,band,count,sum,sum_sq,min,max,mean" );
+    for ( j = 0; j < table->nbins; j++ )
+	fprintf( fp, ",bin_%d", j );
+    fprintf( fp, "\n" );
+
+    for ( band = table->bands; band; band = band->next )
+    {
+	if ( !band->stats )
+	    continue;
+	nbands++;
+
+	for ( i = 0; i < table->nzones; i++ )
+	{
+	    z = &band->stats[i];
+	    fprintf( fp, "%s,%s," MRT_SIZE_T_FMT ",%.17g,%.17g",
+		table->codes[i], band->name, z->count, z->sum, z->sumsq );
+	    if ( z->count > 0 )
+		fprintf( fp, ",%.9g,%.9g,%.10g", z->min, z->max,
+		    z->sum / z->count );
+	    else
+		fprintf( fp, ",,," );
+
+	    for ( j = 0; j < table->nbins; j++ )
+	    {
+		if ( z->hist )
+		    fprintf( fp, "," MRT_SIZE_T_FMT, z->hist[j] );
+		else
+		    fprintf( fp, "," );
+	    }
+	    fprintf( fp, "\n" );
+	}
+    }
+
+    if ( fclose( fp ) != 0 )
+    {
+	sprintf( errstr, "Unable to write %s", filename );
+	ErrorHandler( FALSE, "WriteZonalTable", ERROR_WRITE_OUTPUTIMAGE,
+	    errstr );
+	return ( FALSE );
+    }
+
+    MessageHandler( "WriteZonalTable", "%d zones, %d bands: %s",
+	table->nzones, nbands, filename );
+    return ( TRUE );
+}
+
+/******************************************************************************
+
+MODULE:  CloseZonalTable
+
+PURPOSE:  Close a table's label raster and free the table
+
+RETURN VALUE:
+Type = none
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+  Output files the bands were attached to must not be written afterwards.
+
+******************************************************************************/
+void CloseZonalTable
+(
+    ZonalTable *table		/* I:  table to free (may be NULL) */
+)
+
+{
+    ZonalBand *band, *next;	/* a band, and the one after it */
+    int i;
+
+    if ( !table )
+	return;
+
+    for ( band = table->bands; band; band = next )
+    {
+	next = band->next;
+	if ( band->stats )
+	{
+	    free( band->stats[0].hist );
+	    free( band->stats );
+	}
+	free( band->values );
+	free( band->name );
+	free( band );
+    }
+
+    if ( table->codes )
+    {
+	for ( i = 0; i < table->nzones; i++ )
+	    free( table->codes[i] );
+	free( table->codes );
+    }
+    free( table->labels );
+    free( table->label_row );
+    if ( table->label_file )
+	CloseFile( table->label_file );
+    free( table );
+}
+
+/******************************************************************************
+
+MODULE:  AllocZonalTable
+
+PURPOSE:  Allocate a table of zones, without their codes
+
+RETURN VALUE:
+Type = ZonalTable *
+Value           Description
+-----           -----------
+table           The table
+NULL            Out of memory
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+
+******************************************************************************/
+static ZonalTable *AllocZonalTable
+(
+    int nzones,			/* I:  number of zones */
+    int nbins			/* I:  histogram bins */
+)
+
+{
+    ZonalTable *table;		/* the table */
+
+    table = ( ZonalTable * ) calloc( 1, sizeof( ZonalTable ) );
+    if ( table )
+	table->codes = ( char ** ) calloc( nzones > 0 ? nzones : 1,
+	    sizeof( char * ) );
+    if ( !table || !table->codes )
+    {
+	ErrorHandler( FALSE, "AllocZonalTable", ERROR_MEMORY, "Zonal table" );
+	free( table );
+	return ( NULL );
+    }
+
+    table->nzones = nzones;
+    table->nbins = nbins;
+    return ( table );
+}
+
+/******************************************************************************
+
+MODULE:  InsertZonalLabel
+
+PURPOSE:  Add a label to the ascending list of labels found, if it isn't
+          there yet
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+TRUE            Success
+FALSE           Out of memory
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+
+******************************************************************************/
+static int InsertZonalLabel
+(
+    long label,			/* I:  the label */
+    long **labels,		/* I/O:  labels found, ascending */
+    int *nlabels,		/* I/O:  number of labels found */
+    int *maxlabels		/* I/O:  room for labels */
+)
+
+{
+    long *more;			/* larger list of labels */
+    int lo = 0, hi = *nlabels, mid;  /* binary search */
+
+    while ( lo < hi )
+    {
+	mid = ( lo + hi ) / 2;
+	if ( ( *labels )[mid] < label )
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    if ( lo < *nlabels && ( *labels )[lo] == label )
+	return ( TRUE );
+
+    if ( *nlabels == *maxlabels )
+    {
+	more = ( long * ) realloc( *labels, ( *maxlabels > 0 ?
+	    2 * *maxlabels : 256 ) * sizeof( long ) );
+	if ( !more )
+	{
+	    ErrorHandler( FALSE, "InsertZonalLabel", ERROR_MEMORY,
+		"Zone labels" );
+	    return ( FALSE );
+	}
+	*labels = more;
+	*maxlabels = *maxlabels > 0 ? 2 * *maxlabels : 256;
+    }
+
+    memmove( &( *labels )[lo + 1], &( *labels )[lo],
+	( *nlabels - lo ) * sizeof( long ) );
+    ( *labels )[lo] = label;
+    ( *nlabels )++;
+    return ( TRUE );
+}
+
+/******************************************************************************
+
+MODULE:  FindZonalLabel
+
+PURPOSE:  Find the zone of a label
+
+RETURN VALUE:
+Type = int
+Value           Description
+-----           -----------
+>= 0            The zone
+-1              The label isn't a zone
+
+HISTORY:
+Version  Date   Programmer       Code  Reason
+-------  -----  ---------------  ----  -------------------------------------
+         10/26                         Original Development
+
+NOTES:
+
+******************************************************************************/
+static int FindZonalLabel
+(
+    ZonalTable *table,		/* I:  table with a label raster */
+    long label			/* I:  the label */
+)
+
+{
+    int lo = 0, hi = table->nzones, mid;  /* binary search */
+
+    while ( lo < hi )
+    {
+	mid = ( lo + hi ) / 2;
+	if ( table->labels[mid] < label )
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+
+    return ( lo < table->nzones && table->labels[lo] == label ? lo : -1 );
+}